@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------
+// Instanced 2D Quad Post-Processing Vertex Shader
+//--------------------------------------------------------------------------------------
+// As the 2D quad vertex shader, but draws a quad for every area in the instance constant buffer in a single draw call.
+// Used to draw the same area post-process in many places (see PostProcessInstances.h)
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// The vertex ID picks the corner of the quad as in 2DQuad_pp.hlsl. The instance ID is another automatically generated
+// index, counting the copies of the quad being drawn. It picks which area's placement to use from the constant buffer
+PostProcessingInput main(uint vertexId : SV_VertexID, uint instanceId : SV_InstanceID)
+{
+	PostProcessingInput output;
+
+	const float2 Quad[4] = { float2(0.0, 0.0),   // Top-left
+	                         float2(0.0, 1.0),   // Bottom-left
+	                         float2(1.0, 0.0),   // Top-right
+	                         float2(1.0, 1.0) }; // Bottom-right
+
+	float2 quadCoord = Quad[vertexId];
+	AreaInstance area = gAreaInstances[instanceId];
+
+	// Same as the 2D quad shader, using this instance's area rather than gArea2DTopLeft etc.
+	float2 areaCoord = area.area2DTopLeft + quadCoord * area.area2DSize;
+
+	float2 screenCoord = areaCoord * 2 - 1;
+	screenCoord.y = -screenCoord.y;
+
+	output.areaUV  = quadCoord;
+	output.sceneUV = areaCoord;
+	output.projectedPosition = float4(screenCoord, area.area2DDepth, 1);
+	output.area2DRect = float4(area.area2DTopLeft, area.area2DSize); // Effects that depend on the area size need the size of this instance
+
+	return output;
+}
@@ -42,6 +42,7 @@ PostProcessingInput main(uint vertexId : SV_VertexID)
 	output.areaUV  = quadCoord;  // These UVs refer to the area being post-processed (see ascii diagram below)
 	output.sceneUV = areaCoord;  // These UVs refer to the scene texture (see diagram below)
 	output.projectedPosition = float4( screenCoord, gArea2DDepth, 1 );
+	output.area2DRect = float4(gArea2DTopLeft, gArea2DSize);
 
 
 	// We send two sets of UV coordinates to the post-processing shaders
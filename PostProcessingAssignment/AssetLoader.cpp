@@ -0,0 +1,371 @@
+//--------------------------------------------------------------------------------------
+// AssetLoader class - loads meshes and textures on worker threads
+//--------------------------------------------------------------------------------------
+
+#include "AssetLoader.h"
+#include "Mesh.h"
+#include "Common.h"
+
+#include <DDSTextureLoader.h>
+#include <WICTextureLoader.h>
+#include <objbase.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Milliseconds since the given time
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Read a whole file into memory. Returns false if it can't be read
+static bool ReadWholeFile(const std::string& fileName, std::vector<unsigned char>& data)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file)  return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)  return false;
+	data.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+
+// Return true if the file name has a .dds extension (case insensitive)
+static bool IsDDSFile(const std::string& fileName)
+{
+	std::string dds = ".dds";
+	return fileName.size() >= 4 &&
+	       std::equal(dds.rbegin(), dds.rend(), fileName.rbegin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); });
+}
+
+
+//--------------------------------------------------------------------------------------
+// Construction
+//--------------------------------------------------------------------------------------
+
+// Loader with the given number of worker threads, 0 for one per hardware thread other than the calling thread
+AssetLoader::AssetLoader(unsigned int numThreads /*= 0*/)
+{
+	if (numThreads == 0)  numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (unsigned int i = 0; i < numThreads; ++i)  mThreads.emplace_back(&AssetLoader::WorkerThread, this);
+}
+
+// Waits for the worker threads to finish their current assets. Assets that were not taken are released
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mQueued.notify_all();
+	for (auto& thread : mThreads)  thread.join();
+
+	for (auto& asset : mAssets)
+	{
+		delete asset->mesh;
+		if (asset->commands)    asset->commands->Release();
+		if (asset->textureSRV)  asset->textureSRV->Release();
+		if (asset->texture)     asset->texture->Release();
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Loading
+//--------------------------------------------------------------------------------------
+
+// Start loading a mesh, see the Mesh constructor for the parameters
+MeshHandle AssetLoader::LoadMesh(const std::string& fileName, bool requireTangents /*= false*/)
+{
+	auto asset = std::make_unique<Asset>();
+	asset->type = AssetType::Mesh;
+	asset->fileName = fileName;
+	asset->requireTangents = requireTangents;
+	++mStats.meshes;
+
+	MeshHandle handle;
+	handle.asset = Start(std::move(asset));
+	return handle;
+}
+
+
+// Start loading a texture, DDS or any format supported by WIC (jpg, png etc.)
+TextureHandle AssetLoader::LoadTexture(const std::string& fileName)
+{
+	auto asset = std::make_unique<Asset>();
+	asset->type = AssetType::Texture;
+	asset->fileName = fileName;
+	++mStats.textures;
+
+	TextureHandle handle;
+	handle.asset = Start(std::move(asset));
+	return handle;
+}
+
+
+// Add an asset and queue it for the worker threads
+unsigned int AssetLoader::Start(std::unique_ptr<Asset> asset)
+{
+	if (!mStarted)
+	{
+		mStart = std::chrono::steady_clock::now();
+		mStarted = true;
+	}
+
+	unsigned int index;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		index = static_cast<unsigned int>(mAssets.size());
+		mAssets.push_back(std::move(asset));
+		mQueue.push_back(index);
+	}
+	mQueued.notify_one();
+	return index;
+}
+
+
+// Prepare assets as they are queued until the loader is destroyed
+void AssetLoader::WorkerThread()
+{
+	// WIC is used through COM, which must be initialised on each thread that uses it
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	while (true)
+	{
+		Asset* asset;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mQueued.wait(lock, [&] { return mQuit || !mQueue.empty(); });
+			if (mQuit)  break;
+			asset = mAssets[mQueue.front()].get();
+			mQueue.pop_front();
+		}
+
+		double readMs = 0, decodeMs = 0;
+		std::string error;
+		try
+		{
+			Prepare(*asset, readMs, decodeMs);
+		}
+		catch (const std::runtime_error& e)
+		{
+			error = e.what();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			asset->error = error;
+			asset->prepared = true;
+			mStats.readMs   += readMs;
+			mStats.decodeMs += decodeMs;
+		}
+		mPrepared.notify_all();
+	}
+
+	if (SUCCEEDED(comResult))  CoUninitialize();
+}
+
+
+// Read and decode an asset, on a worker thread. Adds the time spent to the given totals. Will throw a std::runtime_error exception
+// on failure
+void AssetLoader::Prepare(Asset& asset, double& readMs, double& decodeMs)
+{
+	auto start = std::chrono::steady_clock::now();
+	if (asset.type == AssetType::Mesh)
+	{
+		// As the Mesh constructor: use the cache file in place if it is up to date, otherwise import the mesh and save the cache
+		MeshCacheKey key = Mesh::CacheKey(asset.fileName, asset.requireTangents);
+		readMs += MsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		std::string cacheFileName = MeshCacheFileName(asset.fileName);
+		if (!asset.view.Open(cacheFileName, key))
+		{
+			asset.data = Mesh::ImportData(asset.fileName, asset.requireTangents);
+			SaveMeshCache(cacheFileName, key, asset.data); // Not an error if the cache can't be written, it will just be imported again
+		}
+		decodeMs += MsSince(start);
+	}
+	else
+	{
+		if (!ReadWholeFile(asset.fileName, asset.fileData))  throw std::runtime_error("Error loading texture (" + asset.fileName + "). Cannot read file");
+		readMs += MsSince(start);
+
+		// DDS files hold textures ready for the GPU, they are created from the file data in Upload. Other files are decoded here.
+		// They need a context to fill the texture and generate its mip-maps, a deferred context records that for Upload to run
+		if (!IsDDSFile(asset.fileName))
+		{
+			start = std::chrono::steady_clock::now();
+			ID3D11DeviceContext* context = nullptr;
+			HRESULT hr = gD3DDevice->CreateDeferredContext(0, &context);
+			if (SUCCEEDED(hr))
+			{
+				hr = DirectX::CreateWICTextureFromMemory(gD3DDevice, context, asset.fileData.data(), asset.fileData.size(),
+				                                         &asset.texture, &asset.textureSRV);
+				if (SUCCEEDED(hr))  hr = context->FinishCommandList(FALSE, &asset.commands);
+				context->Release();
+			}
+			std::vector<unsigned char>().swap(asset.fileData); // Free the file data, it has been decoded
+			decodeMs += MsSince(start);
+			if (FAILED(hr))  throw std::runtime_error("Error loading texture (" + asset.fileName + ")");
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Taking assets
+//--------------------------------------------------------------------------------------
+
+// Return true if the asset has been prepared and can be taken without waiting for the worker threads
+bool AssetLoader::IsPrepared(MeshHandle mesh)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mesh.asset < mAssets.size() && mAssets[mesh.asset]->prepared;
+}
+
+bool AssetLoader::IsPrepared(TextureHandle texture)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return texture.asset < mAssets.size() && mAssets[texture.asset]->prepared;
+}
+
+
+// Upload all the assets that have been prepared so far, without waiting for any others
+void AssetLoader::UploadPrepared()
+{
+	std::vector<Asset*> ready;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (auto& asset : mAssets)
+		{
+			if (asset->prepared && !asset->uploaded)  ready.push_back(asset.get());
+		}
+	}
+	for (auto asset : ready)  Upload(*asset);
+}
+
+
+// Create the GPU resources for a prepared asset, on the calling thread
+void AssetLoader::Upload(Asset& asset)
+{
+	asset.uploaded = true;
+	if (!asset.error.empty())  return;
+
+	auto start = std::chrono::steady_clock::now();
+	bool cached = false;
+	try
+	{
+		if (asset.type == AssetType::Mesh)
+		{
+			cached = asset.view.IsOpen();
+			asset.mesh = cached ? new Mesh(asset.view) : new Mesh(asset.data);
+			asset.view.Close();
+			asset.data = MeshData();
+		}
+		else if (asset.commands)
+		{
+			gD3DContext->ExecuteCommandList(asset.commands, TRUE); // Keep the context's state, the commands set none that is needed
+			asset.commands->Release();
+			asset.commands = nullptr;
+		}
+		else
+		{
+			HRESULT hr = DirectX::CreateDDSTextureFromMemory(gD3DDevice, asset.fileData.data(), asset.fileData.size(),
+			                                                 &asset.texture, &asset.textureSRV);
+			std::vector<unsigned char>().swap(asset.fileData);
+			if (FAILED(hr))  throw std::runtime_error("Error loading texture (" + asset.fileName + ")");
+		}
+	}
+	catch (const std::runtime_error& e)
+	{
+		asset.error = e.what();
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.uploadMs += MsSince(start);
+	if (cached)  ++mStats.cached;
+}
+
+
+// Wait for an asset to be prepared, uploading others while waiting, then upload it. Returns null if the handle isn't for an asset
+// of the given type that hasn't been taken
+AssetLoader::Asset* AssetLoader::Wait(unsigned int index, AssetType type)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (index >= mAssets.size() || mAssets[index]->type != type || mAssets[index]->taken)  return nullptr;
+	Asset& asset = *mAssets[index];
+
+	while (!asset.prepared)
+	{
+		auto start = std::chrono::steady_clock::now();
+		mPrepared.wait(lock);
+		mStats.waitMs += MsSince(start);
+
+		lock.unlock();
+		UploadPrepared();
+		lock.lock();
+	}
+	lock.unlock();
+
+	if (!asset.uploaded)  Upload(asset);
+	asset.taken = true;
+	mStats.wallMs = MsSince(mStart);
+	if (!asset.error.empty())  mLastError = asset.error;
+	return &asset;
+}
+
+
+// Wait for a mesh and return it, the caller then owns it. Will throw a std::runtime_error exception on failure
+Mesh* AssetLoader::TakeMesh(MeshHandle mesh)
+{
+	Asset* asset = Wait(mesh.asset, AssetType::Mesh);
+	if (asset == nullptr)  throw std::runtime_error("Invalid mesh handle");
+	if (!asset->error.empty())  throw std::runtime_error(asset->error);
+
+	Mesh* taken = asset->mesh;
+	asset->mesh = nullptr;
+	return taken;
+}
+
+
+// Wait for a texture and fill in the pointers, which need to be released before quitting. Returns false on failure
+bool AssetLoader::TakeTexture(TextureHandle texture, ID3D11Resource** resource, ID3D11ShaderResourceView** textureSRV)
+{
+	Asset* asset = Wait(texture.asset, AssetType::Texture);
+	if (asset == nullptr)
+	{
+		mLastError = "Invalid texture handle";
+		return false;
+	}
+	if (!asset->error.empty())  return false;
+
+	*resource   = asset->texture;
+	*textureSRV = asset->textureSRV;
+	asset->texture    = nullptr;
+	asset->textureSRV = nullptr;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Data access
+//--------------------------------------------------------------------------------------
+
+AssetLoadStats AssetLoader::Stats()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
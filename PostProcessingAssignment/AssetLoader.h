@@ -0,0 +1,172 @@
+//--------------------------------------------------------------------------------------
+// AssetLoader class - loads meshes and textures on worker threads
+//--------------------------------------------------------------------------------------
+// Loading an asset has two steps. Preparing it - reading the file, importing a mesh (or opening
+// its cache, see MeshData.h) and decoding a texture - runs on the loader's own threads, all assets
+// at once. Uploading it - creating the GPU buffers and textures from the prepared data - is done
+// on the thread that owns gD3DContext, one asset at a time, when the asset is taken.
+//
+// Load functions return straight away with a handle. The caller can carry on with other work
+// (e.g. compiling shaders) then take each asset when it is needed, waiting only for that asset.
+// Any other assets that have been prepared by then are uploaded while waiting.
+//
+// Textures that aren't DDS files are decoded with WIC and have mip-maps generated, which needs a
+// device context. Each one is recorded into a deferred context on its worker thread, and the
+// upload runs the resulting command list on gD3DContext
+
+#ifndef _ASSET_LOADER_H_INCLUDED_
+#define _ASSET_LOADER_H_INCLUDED_
+
+#include "MeshData.h"
+#define NOMINMAX // Use this to stop Windows headers defining "min" and "max", which breaks some libraries (e.g. assimp)
+#include <d3d11.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Mesh;
+
+
+// Handles to assets being loaded, returned by AssetLoader. Only valid with the loader that returned them
+struct MeshHandle    { unsigned int asset = ~0u; };
+struct TextureHandle { unsigned int asset = ~0u; };
+
+
+// Time spent in each step of loading, in milliseconds. Steps done on the worker threads are summed over all the threads, so they
+// can add up to more than the wall time
+struct AssetLoadStats
+{
+	unsigned int meshes   = 0;
+	unsigned int textures = 0;
+	unsigned int cached   = 0; // Meshes created from an up to date cache file rather than imported
+
+	double readMs   = 0; // Reading files (for meshes, hashing them for the cache key)
+	double decodeMs = 0; // Importing meshes or opening their caches, and decoding textures
+	double uploadMs = 0; // Creating GPU resources on the calling thread
+	double waitMs   = 0; // Calling thread waiting for assets to be prepared
+	double wallMs   = 0; // From the first asset being started to the last being taken
+};
+
+
+class AssetLoader
+{
+public:
+
+	// Construction //
+
+	// Loader with the given number of worker threads, 0 for one per hardware thread other than the calling thread
+	explicit AssetLoader(unsigned int numThreads = 0);
+
+	// Waits for the worker threads to finish their current assets. Assets that were not taken are released
+	~AssetLoader();
+
+	// Threads can't be copied
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+
+	// Loading //
+
+	// Start loading a mesh, see the Mesh constructor for the parameters
+	MeshHandle LoadMesh(const std::string& fileName, bool requireTangents = false);
+
+	// Start loading a texture, DDS or any format supported by WIC (jpg, png etc.)
+	TextureHandle LoadTexture(const std::string& fileName);
+
+
+	// Taking assets //
+	// Must be called on the thread that uses gD3DContext. Each asset can only be taken once
+
+	// Return true if the asset has been prepared and can be taken without waiting for the worker threads
+	bool IsPrepared(MeshHandle mesh);
+	bool IsPrepared(TextureHandle texture);
+
+	// Upload all the assets that have been prepared so far, without waiting for any others
+	void UploadPrepared();
+
+	// Wait for a mesh and return it, the caller then owns it. Will throw a std::runtime_error exception on failure as the Mesh
+	// constructor does
+	Mesh* TakeMesh(MeshHandle mesh);
+
+	// Wait for a texture and fill in the pointers as LoadTexture does (see GraphicsHelpers.h), which need to be released before
+	// quitting. Returns false on failure
+	bool TakeTexture(TextureHandle texture, ID3D11Resource** resource, ID3D11ShaderResourceView** textureSRV);
+
+
+	// Data access //
+
+	// Error message for the last asset that failed, empty if none have
+	const std::string& LastError() const { return mLastError; }
+
+	AssetLoadStats Stats();
+
+
+private:
+	enum class AssetType { Mesh, Texture };
+
+	// Everything about one asset. Worker threads only write the prepared data, then set prepared under the mutex. After that only
+	// the calling thread uses the asset
+	struct Asset
+	{
+		AssetType   type;
+		std::string fileName;
+		bool        requireTangents = false;
+
+		bool        prepared = false;
+		bool        uploaded = false;
+		bool        taken    = false;
+		std::string error;    // Empty if the asset has been loaded so far
+
+		// Prepared meshes: the cache file in place if it was up to date, otherwise the imported data
+		MeshCacheView view;
+		MeshData      data;
+
+		// Prepared textures: the contents of a DDS file, or the commands that fill a WIC texture and generate its mip-maps
+		std::vector<unsigned char> fileData;
+		ID3D11CommandList*         commands = nullptr;
+
+		// Uploaded assets
+		Mesh*                     mesh       = nullptr;
+		ID3D11Resource*           texture    = nullptr;
+		ID3D11ShaderResourceView* textureSRV = nullptr;
+	};
+
+	// Add an asset and queue it for the worker threads
+	unsigned int Start(std::unique_ptr<Asset> asset);
+
+	// Prepare assets as they are queued until the loader is destroyed
+	void WorkerThread();
+
+	// Read and decode an asset, on a worker thread. Adds the time spent to the given totals
+	void Prepare(Asset& asset, double& readMs, double& decodeMs);
+
+	// Create the GPU resources for a prepared asset, on the calling thread
+	void Upload(Asset& asset);
+
+	// Wait for an asset to be prepared, uploading others while waiting, then upload it and mark it taken. Returns null if the
+	// handle isn't for an asset of the given type that hasn't been taken
+	Asset* Wait(unsigned int asset, AssetType type);
+
+	std::vector<std::thread> mThreads;
+
+	std::mutex                          mMutex;    // Guards the queue, the prepared flags and the worker thread totals
+	std::condition_variable             mQueued;   // Signalled when an asset is queued or the loader is destroyed
+	std::condition_variable             mPrepared; // Signalled when an asset has been prepared
+	std::deque<unsigned int>            mQueue;
+	std::deque<std::unique_ptr<Asset>>  mAssets;   // Pointers so worker threads can use an asset while others are added
+	bool                                mQuit = false;
+
+	AssetLoadStats mStats;
+	std::chrono::steady_clock::time_point mStart;
+	bool        mStarted = false;
+	std::string mLastError;
+};
+
+
+#endif // _ASSET_LOADER_H_INCLUDED_
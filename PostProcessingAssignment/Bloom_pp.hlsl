@@ -1,37 +1,85 @@
+//--------------------------------------------------------------------------------------
+// Bloom Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Each pass of the bloom runs one stage of this shader, chosen by gBloomStage (see PostProcessBloom.h
+// for the stages and PostProcessBloom.cpp for a CPU version that matches this shader). Sample offsets
+// are in texels of the source texture, read from the texture itself, so the bloom works at any size
+
 #include "Common.hlsli"
 
-Texture2D    SceneTexture : register(t0);
-SamplerState PointSample  : register(s0);
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The texture from the previous stage (or the scene for the bright pass and composite)
+Texture2D    SceneTexture   : register(t0);
+SamplerState BilinearSample : register(s0); // Must be bilinear, each sample averages the texels around it. Clamped at the edges
+
+// Second texture for the stages that combine two: the downsample of the same size for the upsample stage, the glow for the composite
+Texture2D    AddTexture     : register(t1);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Average 4 bilinear samples at the corners of a 2 texel square (a 4x4 texel box) then keep only the colour above the threshold.
+// The knee gives a curve into the cut-off rather than a sharp edge, which would flicker as pixels cross it
+float3 BrightPass(float2 uv, float2 texel)
+{
+	float3 colour = (SceneTexture.Sample(BilinearSample, uv + float2(-texel.x, -texel.y)).rgb +
+	                 SceneTexture.Sample(BilinearSample, uv + float2( texel.x, -texel.y)).rgb +
+	                 SceneTexture.Sample(BilinearSample, uv + float2(-texel.x,  texel.y)).rgb +
+	                 SceneTexture.Sample(BilinearSample, uv + float2( texel.x,  texel.y)).rgb) * 0.25f;
+
+	float brightness = max(max(colour.r, colour.g), colour.b);
+	float soft = clamp(brightness - gBloomThreshold + gBloomKnee, 0.0f, 2 * gBloomKnee);
+	soft = soft * soft / (4 * gBloomKnee + 0.0001f);
+	float contribution = max(soft, brightness - gBloomThreshold) / max(brightness, 0.0001f);
+	return colour * contribution;
+}
+
+// Dual filter downsample: the centre (between 2x2 texels) and four diagonals a texel away, centre weighted 4 of 8
+float3 Downsample(float2 uv, float2 texel)
+{
+	float3 colour = SceneTexture.Sample(BilinearSample, uv).rgb * 4;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2(-texel.x, -texel.y)).rgb;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2( texel.x, -texel.y)).rgb;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2(-texel.x,  texel.y)).rgb;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2( texel.x,  texel.y)).rgb;
+	return colour / 8;
+}
+
+// Dual filter upsample: a diamond of four samples a texel away (weight 1) and four diagonals half a texel away (weight 2),
+// plus the downsample of the same size
+float3 Upsample(float2 uv, float2 texel)
+{
+	float3 colour = SceneTexture.Sample(BilinearSample, uv + float2(-texel.x, 0)).rgb;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2( texel.x, 0)).rgb;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2(0, -texel.y)).rgb;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2(0,  texel.y)).rgb;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2(-texel.x, -texel.y) * 0.5f).rgb * 2;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2( texel.x, -texel.y) * 0.5f).rgb * 2;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2(-texel.x,  texel.y) * 0.5f).rgb * 2;
+	colour += SceneTexture.Sample(BilinearSample, uv + float2( texel.x,  texel.y) * 0.5f).rgb * 2;
+	return colour / 12 + AddTexture.Sample(BilinearSample, uv).rgb;
+}
+
 
 float4 main(PostProcessingInput input) : SV_Target
 {
-	float blurSize = 1.0f / 512.0f;
-	float intensity = 0.35f;
-	float3 sum = float3(0, 0, 0);
-
-	float2 uv = input.sceneUV / float2(1920, 1080);
-
-	sum += SceneTexture.Sample(PointSample, float2(uv.x - 4.0f * blurSize, uv.y)).rgb * 0.05f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x - 3.0f * blurSize, uv.y)).rgb * 0.09f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x - 2.0f * blurSize, uv.y)).rgb * 0.12f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x - blurSize, uv.y)).rgb * 0.15f;
-	sum += SceneTexture.Sample(PointSample, uv).rgb * 0.16f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x + blurSize, uv.y)).rgb * 0.15f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x + 2.0f * blurSize, uv.y)).rgb * 0.12f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x + 3.0f * blurSize, uv.y)).rgb * 0.09f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x + 4.0f * blurSize, uv.y)).rgb * 0.05f;
-
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y - 4.0f * blurSize)).rgb * 0.05f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y - 3.0f * blurSize)).rgb * 0.09f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y - 2.0f * blurSize)).rgb * 0.12f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y - blurSize)).rgb * 0.15f;
-	sum += SceneTexture.Sample(PointSample, uv).rgb * 0.16f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y + blurSize)).rgb * 0.15f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y + 2.0f * blurSize)).rgb * 0.12f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y + 3.0f * blurSize)).rgb * 0.09f;
-	sum += SceneTexture.Sample(PointSample, float2(uv.x, uv.y + 4.0f * blurSize)).rgb * 0.05f;
-
-	float3 colour = sum * intensity + SceneTexture.Sample(PointSample, uv).rgb;
+	float width, height;
+	SceneTexture.GetDimensions(width, height);
+	float2 texel = float2(1.0f / width, 1.0f / height);
+
+	if (gBloomStage == BLOOM_BRIGHT_PASS)  return float4(BrightPass(input.sceneUV, texel), 1.0f);
+	if (gBloomStage == BLOOM_DOWNSAMPLE)   return float4(Downsample(input.sceneUV, texel), 1.0f);
+	if (gBloomStage == BLOOM_UPSAMPLE)     return float4(Upsample  (input.sceneUV, texel), 1.0f);
+
+	// Composite: add the glow to the scene
+	float3 colour = SceneTexture.Sample(BilinearSample, input.sceneUV).rgb +
+	                AddTexture.Sample(BilinearSample, input.sceneUV).rgb * gBloomIntensity;
 
 	// Calculate alpha to display the effect in a softened circle, could use a texture rather than calculations for the same task.
 	// Uses the second set of area texture coordinates, which range from (0,0) to (1,1) over the area being processed
@@ -40,6 +88,5 @@ float4 main(PostProcessingInput input) : SV_Target
 	float centreLengthSq = dot(centreVector, centreVector);
 	float alpha = 1.0f - saturate((centreLengthSq - 0.25f + softEdge) / softEdge); // Soft circle calculation based on fact that this circle has a radius of 0.5 (as area UVs go from 0->1)
 
-	// Got the RGB from the scene texture
 	return float4(colour, alpha);
-}
\ No newline at end of file
+}
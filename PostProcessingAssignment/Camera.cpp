@@ -11,74 +11,107 @@ void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode
                                       KeyCode moveForward, KeyCode moveBackward, KeyCode moveLeft, KeyCode moveRight)
 {
 	//**** ROTATION ****
+	// Same as changing the X and Y angles while there is no Z rotation: X rotation comes before the current rotation, Y after
+	CQuaternion rotation = mTransform.rotation;
 	if (KeyHeld(Key_Down))
 	{
-		mRotation.x += ROTATION_SPEED * frameTime; // Use of frameTime to ensure same speed on different machines
+		rotation = QuaternionRotationX(ROTATION_SPEED * frameTime, TrigPolicy::Fast) * rotation; // Use of frameTime to ensure same speed on different machines
 	}
 	if (KeyHeld(Key_Up))
 	{
-		mRotation.x -= ROTATION_SPEED * frameTime;
+		rotation = QuaternionRotationX(-ROTATION_SPEED * frameTime, TrigPolicy::Fast) * rotation;
 	}
 	if (KeyHeld(Key_Right))
 	{
-		mRotation.y += ROTATION_SPEED * frameTime;
+		rotation = rotation * QuaternionRotationY(ROTATION_SPEED * frameTime, TrigPolicy::Fast);
 	}
 	if (KeyHeld(Key_Left))
 	{
-		mRotation.y -= ROTATION_SPEED * frameTime;
+		rotation = rotation * QuaternionRotationY(-ROTATION_SPEED * frameTime, TrigPolicy::Fast);
 	}
 
 	//**** LOCAL MOVEMENT ****
+	// Local axes come from the rotation before it changed this frame, as they did from the world matrix
+	CVector3 position = mTransform.position;
 	if (KeyHeld(Key_D))
 	{
-		mPosition.x += MOVEMENT_SPEED * frameTime * mWorldMatrix.e00; // See comments on local movement in UpdateCube code above
-		mPosition.y += MOVEMENT_SPEED * frameTime * mWorldMatrix.e01; 
-		mPosition.z += MOVEMENT_SPEED * frameTime * mWorldMatrix.e02; 
+		position += MOVEMENT_SPEED * frameTime * mTransform.rotation.GetXAxis(); // See comments on local movement in UpdateCube code above
 	}
 	if (KeyHeld(Key_A))
 	{
-		mPosition.x -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e00;
-		mPosition.y -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e01;
-		mPosition.z -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e02;
+		position -= MOVEMENT_SPEED * frameTime * mTransform.rotation.GetXAxis();
 	}
 	if (KeyHeld(Key_W))
 	{
-		mPosition.x += MOVEMENT_SPEED * frameTime * mWorldMatrix.e20;
-		mPosition.y += MOVEMENT_SPEED * frameTime * mWorldMatrix.e21;
-		mPosition.z += MOVEMENT_SPEED * frameTime * mWorldMatrix.e22;
+		position += MOVEMENT_SPEED * frameTime * mTransform.rotation.GetZAxis();
 	}
 	if (KeyHeld(Key_S))
 	{
-		mPosition.x -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e20;
-		mPosition.y -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e21;
-		mPosition.z -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e22;
+		position -= MOVEMENT_SPEED * frameTime * mTransform.rotation.GetZAxis();
+	}
+
+	// Only mark the matrices for rebuilding if something moved. The rotation is kept unit length as rounding errors build up
+	if (KeyHeld(Key_Down) || KeyHeld(Key_Up) || KeyHeld(Key_Right) || KeyHeld(Key_Left))
+	{
+		mTransform.rotation = Normalise(rotation);
+		mViewDirty = true;
+	}
+	if (KeyHeld(Key_D) || KeyHeld(Key_A) || KeyHeld(Key_W) || KeyHeld(Key_S))
+	{
+		mTransform.position = position;
+		mViewDirty = true;
 	}
 }
 
 
-// Update the matrices used for the camera in the rendering pipeline
+// Update the matrices used for the camera in the rendering pipeline. Only those depending on something that has changed are rebuilt
 void Camera::UpdateMatrices()
 {
-    // "World" matrix for the camera - treat it like a model at first
-    mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
-
-    // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
-    mViewMatrix = InverseAffine(mWorldMatrix);
-
-    // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
-    float tanFOVx = std::tan(mFOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = mAspectRatio / tanFOVx;
-    float scaleZa = mFarClip / (mFarClip - mNearClip);
-    float scaleZb = -mNearClip * scaleZa;
-
-    mProjectionMatrix = { scaleX,   0.0f,    0.0f,   0.0f,
-                            0.0f, scaleY,    0.0f,   0.0f,
-                            0.0f,   0.0f, scaleZa,   1.0f,
-                            0.0f,   0.0f, scaleZb,   0.0f };
+    if (!mViewDirty && !mProjectionDirty)  return;
+
+    if (mViewDirty)
+    {
+        // "World" matrix for the camera - treat it like a model at first
+        mWorldMatrix = mTransform.GetMatrix();
+
+        // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
+        // The camera has no scale, so the inverse transform is exact and cheaper than inverting the matrix
+        mViewMatrix = Inverse(mTransform).GetMatrix();
+        ++mUpdateCounts.view;
+    }
+
+    if (mProjectionDirty)
+    {
+        // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
+        mTanHalfFOVx = std::tan(mFOVx * 0.5f);
+        float scaleX = 1.0f / mTanHalfFOVx;
+        float scaleY = mAspectRatio / mTanHalfFOVx;
+        float scaleZa = mFarClip / (mFarClip - mNearClip);
+        float scaleZb = -mNearClip * scaleZa;
+
+        mProjectionMatrix = { scaleX,   0.0f,    0.0f,   0.0f,
+                                0.0f, scaleY,    0.0f,   0.0f,
+                                0.0f,   0.0f, scaleZa,   1.0f,
+                                0.0f,   0.0f, scaleZb,   0.0f };
+
+        // Its inverse takes projected points back to camera space. Most of the matrix is zero, so that is simple
+        mInverseProjectionMatrix = { 1.0f / scaleX,          0.0f, 0.0f,                0.0f,
+                                              0.0f, 1.0f / scaleY, 0.0f,                0.0f,
+                                              0.0f,          0.0f, 0.0f,     1.0f / scaleZb,
+                                              0.0f,          0.0f, 1.0f, -scaleZa / scaleZb };
+        ++mUpdateCounts.projection;
+    }
 
     // The view-projection matrix combines the two matrices usually used for the camera into one, which can save a multiply in the shaders (optional)
     mViewProjectionMatrix = mViewMatrix * mProjectionMatrix;
+
+    // The inverse of the view-projection is the inverse projection followed by the inverse view, i.e. the world matrix
+    mInverseViewProjectionMatrix = mInverseProjectionMatrix * mWorldMatrix;
+    mFrustum = FrustumFromMatrix(mViewProjectionMatrix);
+    ++mUpdateCounts.viewProjection;
+
+    mViewDirty = false;
+    mProjectionDirty = false;
 }
 
 
@@ -117,6 +150,27 @@ CVector3 Camera::PixelFromWorldPt(CVector3 worldPoint, unsigned int viewportWidt
 }
 
 
+// Return the world point at the given pixel coordinates and depth buffer value, the reverse of PixelFromWorldPt
+CVector3 Camera::WorldPtFromPixel(CVector3 pixelPoint, unsigned int viewportWidth, unsigned int viewportHeight)
+{
+	UpdateMatrices();
+
+	// Pixel coordinates to -1->1 viewport coordinates (y upwards), then back through the projection and view to world space
+	CVector4 viewportPt = { pixelPoint.x * (2.0f / viewportWidth) - 1.0f, 1.0f - pixelPoint.y * (2.0f / viewportHeight), pixelPoint.z, 1.0f };
+	CVector4 worldPt = viewportPt * mInverseViewProjectionMatrix;
+
+	return { worldPt.x / worldPt.w, worldPt.y / worldPt.w, worldPt.z / worldPt.w };
+}
+
+
+// Get the ray from the camera through the given pixel: origin is on the near clip and direction is unit length
+void Camera::WorldRayFromPixel(CVector2 pixel, unsigned int viewportWidth, unsigned int viewportHeight, CVector3& origin, CVector3& direction)
+{
+	origin = WorldPtFromPixel({ pixel.x, pixel.y, 0.0f }, viewportWidth, viewportHeight);
+	direction = Normalise(WorldPtFromPixel({ pixel.x, pixel.y, 1.0f }, viewportWidth, viewportHeight) - origin);
+}
+
+
 // Return the size of a pixel in world space at the given Z distance. Allows us to convert the 2D size of areas on the screen to actualy sizes in the world
 // Pass the viewport width and height
 CVector2 Camera::PixelSizeInWorldSpace(float Z, unsigned int viewportWidth, unsigned int viewportHeight)
@@ -124,8 +178,9 @@ CVector2 Camera::PixelSizeInWorldSpace(float Z, unsigned int viewportWidth, unsi
 	CVector2 size;
 
 	// Size of the entire viewport in world space at the near clip distance - uses same geometry work that was shown in the camera picking lecture
+	UpdateMatrices();
 	CVector2 viewportSizeAtNearClip;
-    viewportSizeAtNearClip.x = 2 * mNearClip * std::tan(mFOVx * 0.5f);
+    viewportSizeAtNearClip.x = 2 * mNearClip * mTanHalfFOVx;
     viewportSizeAtNearClip.y = viewportSizeAtNearClip.x /  mAspectRatio;
 
 	// Size of the entire viewport in world space at the given Z distance
@@ -6,6 +6,9 @@
 #include "CVector2.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "CQuaternion.h"
+#include "CTransform.h"
+#include "Frustum.h"
 #include "MathHelpers.h"
 #include "Input.h"
 
@@ -13,6 +16,16 @@
 #define _CAMERA_H_INCLUDED_
 
 
+// Number of times each group of camera matrices has been rebuilt since the camera was created. They only change when the
+// camera moves or its settings change, so none should be rebuilt on frames when it is still
+struct CameraUpdateCounts
+{
+	unsigned int view           = 0; // World and view matrices
+	unsigned int projection     = 0; // Projection matrix and its inverse
+	unsigned int viewProjection = 0; // Combined view-projection matrix, its inverse and the frustum planes
+};
+
+
 class Camera
 {
 public:
@@ -23,7 +36,7 @@ public:
 	// Constructor - initialise all settings, sensible defaults provided for everything.
 	Camera(CVector3 position = {0,0,0}, CVector3 rotation = {0,0,0}, 
            float fov = PI/3, float aspectRatio = 4.0f / 3.0f, float nearClip = 0.1f, float farClip = 10000.0f)
-        : mPosition(position), mRotation(rotation), mFOVx(fov), mAspectRatio(aspectRatio), mNearClip(nearClip), mFarClip(farClip)
+        : mTransform(position, QuaternionRotationEuler(rotation)), mFOVx(fov), mAspectRatio(aspectRatio), mNearClip(nearClip), mFarClip(farClip)
     {
     }
 
@@ -37,25 +50,35 @@ public:
 	// Data access
 	//-------------------------------------
 
-	// Getters / setters
-	CVector3 Position()  { return mPosition; }
-	CVector3 Rotation()  { return mRotation;	}
-	void SetPosition(CVector3 position)  { mPosition = position; }
-	void SetRotation(CVector3 rotation)  { mRotation = rotation; }
+	// Getters / setters. Rotation angles are applied in the order Z, X, Y, as for models
+	CVector3    Position()    { return mTransform.position; }
+	CVector3    Rotation()    { return mTransform.rotation.GetEulerAngles(); }
+	CQuaternion Quaternion()  { return mTransform.rotation; }
+	void SetPosition(CVector3 position)     { mTransform.position = position;  mViewDirty = true; }
+	void SetRotation(CVector3 rotation)     { mTransform.rotation = QuaternionRotationEuler(rotation);  mViewDirty = true; }
+	void SetRotation(CQuaternion rotation)  { mTransform.rotation = rotation;  mViewDirty = true; }
 
 	float FOV()       { return mFOVx;     }
 	float NearClip()  { return mNearClip; }
 	float FarClip()   { return mFarClip;  }
 
-	void SetFOV     (float fov     )  { mFOVx     = fov;      }
-	void SetNearClip(float nearClip)  { mNearClip = nearClip; }
-	void SetFarClip (float farClip )  { mFarClip  = farClip;  }
+	void SetFOV     (float fov     )  { mFOVx     = fov;       mProjectionDirty = true; }
+	void SetNearClip(float nearClip)  { mNearClip = nearClip;  mProjectionDirty = true; }
+	void SetFarClip (float farClip )  { mFarClip  = farClip;   mProjectionDirty = true; }
+
+	// Read only access to camera matrices, updated on request from position, rotation and camera settings. They are only
+	// rebuilt when one of those has changed since the last request
+	CMatrix4x4 WorldMatrix()                  { UpdateMatrices(); return mWorldMatrix; }
+	CMatrix4x4 ViewMatrix()                   { UpdateMatrices(); return mViewMatrix;           }
+	CMatrix4x4 ProjectionMatrix()             { UpdateMatrices(); return mProjectionMatrix;     }
+	CMatrix4x4 ViewProjectionMatrix()         { UpdateMatrices(); return mViewProjectionMatrix; }
+	CMatrix4x4 InverseViewProjectionMatrix()  { UpdateMatrices(); return mInverseViewProjectionMatrix; } // Projected points to world
 
-	// Read only access to camera matrices, updated on request from position, rotation and camera settings
-	CMatrix4x4 WorldMatrix()           { UpdateMatrices(); return mWorldMatrix; }
-	CMatrix4x4 ViewMatrix()            { UpdateMatrices(); return mViewMatrix;           }
-	CMatrix4x4 ProjectionMatrix()      { UpdateMatrices(); return mProjectionMatrix;     }
-	CMatrix4x4 ViewProjectionMatrix()  { UpdateMatrices(); return mViewProjectionMatrix; }
+	// The world space planes bounding what the camera can see (see Frustum.h)
+	Frustum ViewFrustum()  { UpdateMatrices(); return mFrustum; }
+
+	// How many times the matrices have been rebuilt
+	CameraUpdateCounts UpdateCounts()  { return mUpdateCounts; }
 
 
 	//-------------------------------------
@@ -69,6 +92,14 @@ public:
 	// is less than the camera near clip (use NearClip() member function), then the world
 	// point is behind the camera and the 2D x and y coordinates are to be ignored.
 	CVector3 PixelFromWorldPt(CVector3 worldPoint, unsigned int viewportWidth, unsigned int viewportHeight);
+
+	// Return the world point at the given pixel coordinates (x and y) and depth buffer value (z, 0 at the near clip and 1 at the
+	// far clip), the reverse of PixelFromWorldPt. Pass the viewport width and height. Uses the inverse view-projection matrix, so
+	// is a single matrix multiply (see UnprojectFromViewport in TransformBatch.h for many points at once)
+	CVector3 WorldPtFromPixel(CVector3 pixelPoint, unsigned int viewportWidth, unsigned int viewportHeight);
+
+	// Get the ray from the camera through the given pixel for picking: origin is on the near clip and direction is unit length
+	void WorldRayFromPixel(CVector2 pixel, unsigned int viewportWidth, unsigned int viewportHeight, CVector3& origin, CVector3& direction);
 	
 	// Return the size of a pixel in world space at the given Z distance. Allows us to convert the 2D size of areas on the screen to actualy sizes in the world
 	// Pass the viewport width and height
@@ -82,9 +113,8 @@ private:
 	// Update the matrices used for the camera in the rendering pipeline
 	void UpdateMatrices();
 
-	// Postition and rotations for the camera (rarely scale cameras)
-	CVector3 mPosition;
-	CVector3 mRotation;
+	// Postition and rotation for the camera (rarely scale cameras, so scale is left at 1)
+	CTransform mTransform;
 
 	// Camera settings: field of view, aspect ratio, near and far clip plane distances.
 	// Note that the FOVx angle is measured in radians (radians = degrees * PI/180) from left to right of screen
@@ -93,6 +123,11 @@ private:
 	float mNearClip;
 	float mFarClip;
 
+	// Set when the position or rotation (view), or the camera settings (projection), have changed since the matrices were made
+	bool mViewDirty       = true;
+	bool mProjectionDirty = true;
+	CameraUpdateCounts mUpdateCounts;
+
 	// Current view, projection and combined view-projection matrices (DirectX matrix type)
 	CMatrix4x4 mWorldMatrix; // Easiest to treat the camera like a model and give it a "world" matrix...
 	CMatrix4x4 mViewMatrix;  // ...then the view matrix used in the shaders is the inverse of its world matrix
@@ -100,6 +135,12 @@ private:
 	CMatrix4x4 mProjectionMatrix;     // Projection matrix holds the field of view and near/far clip distances
 	CMatrix4x4 mViewProjectionMatrix; // Combine (multiply) the view and projection matrices together, which
 	                                  // can sometimes save a matrix multiply in the shader (optional)
+
+	// Derived from the matrices above and kept with them
+	CMatrix4x4 mInverseProjectionMatrix;
+	CMatrix4x4 mInverseViewProjectionMatrix;
+	Frustum    mFrustum;
+	float      mTanHalfFOVx; // Used for the projection and for PixelSizeInWorldSpace
 };
 
 
@@ -7,8 +7,10 @@
 #include "CVector2.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "PostProcessingConstants.h"
 
 #include <d3d11.h>
+#include <cstddef>
 #include <string>
 
 
@@ -98,8 +100,30 @@ struct PerModelConstants
     CVector3   objectColour;  // Allows each light model to be tinted to match the light colour they cast
 	float      explodeAmount; // Used in the geometry shader to control how much the polygons are exploded outwards
 
+	// How the vertex shader decodes the packed vertices of the sub-mesh being rendered, see VertexDecode in MeshData.h. Set by Mesh
+	CVector3   positionScale;
+	float      octahedralNormals; // 1 if normals are octahedral encoded, 0 if they are plain float3
+	CVector3   positionOffset;
+	float      paddingA;
+	CVector2   uvScale;
+	CVector2   uvOffset;
+
 	CMatrix4x4 boneMatrices[MAX_BONES];
 };
+
+// The HLSL packing rules put each variable of cbuffer PerModelConstants in Common.hlsli at these offsets (a variable may not
+// straddle a 16-byte boundary). The structure above must lay out the same way or the shaders read the wrong values
+static_assert(offsetof(PerModelConstants, worldMatrix)       ==   0, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, objectColour)      ==  64, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, explodeAmount)     ==  76, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, positionScale)     ==  80, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, octahedralNormals) ==  92, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, positionOffset)    ==  96, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, paddingA)          == 108, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, uvScale)           == 112, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, uvOffset)          == 120, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(offsetof(PerModelConstants, boneMatrices)      == 128, "PerModelConstants must match the cbuffer in Common.hlsli");
+static_assert(sizeof(PerModelConstants) == 128 + 64 * MAX_BONES, "PerModelConstants must match the cbuffer in Common.hlsli");
 extern PerModelConstants gPerModelConstants;      // This variable holds the CPU-side constant buffer described above
 extern ID3D11Buffer*     gPerModelConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
 
@@ -108,44 +132,7 @@ extern ID3D11Buffer*     gPerModelConstantBuffer; // This variable controls the
 
 //**************************
 
-// Settings used by post-processes - must match the similar structure in the Common.hlsli shader file
-struct PostProcessingConstants
-{
-	CVector2 area2DTopLeft; // Top-left of post-process area on screen, provided as coordinate from 0.0->1.0 not as a pixel coordinate
-	CVector2 area2DSize;    // Size of post-process area on screen, provided as sizes from 0.0->1.0 (1 = full screen) not as a size in pixels
-	float    area2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
-	CVector3 paddingA;      // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
-
-	CVector4 polygon2DPoints[4]; // Four points of a polygon in 2D viewport space for polygon post-processing. Matrix transformations already done on C++ side
-
-	// Tint post-process settings
-	CVector3 tintColour1;
-	float	 paddingB;
-	CVector3 tintColour2;
-	float    paddingC;
-
-	// Grey noise post-process settings
-    CVector2 noiseScale;
-	CVector2 noiseOffset;
-
-	// Burn post-process settings
-	float    burnHeight;
-	CVector3 paddingD;
-
-	// Distort post-process settings
-	float    distortLevel;
-	CVector3 paddingE;
-
-	// Spiral post-process settings
-	float    spiralLevel;
-	CVector3 paddingF;
-
-	// Heat haze post-process settings
-	float    heatHazeTimer;
-	CVector3 paddingG;
-
-	bool	 horizontalBlur;
-};
+// Settings used by post-processes are in PostProcessingConstants.h, which has no DirectX so CPU code can use them too
 extern PostProcessingConstants gPostProcessingConstants;      // This variable holds the CPU-side constant buffer described above
 extern ID3D11Buffer*           gPostProcessingConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
 
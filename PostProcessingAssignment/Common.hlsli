@@ -55,6 +55,14 @@ struct PostProcessingInput
 	float4 projectedPosition     : SV_Position;
 	noperspective float2 sceneUV : sceneUV;      // "noperspective" is needed for polygon processing or the sampling of the scene texture doesn't work correctly (ask tutor if you are interested)
 	float2 areaUV                : areaUV;
+	nointerpolation float4 area2DRect : area2DRect; // Top-left (xy) and size (zw) of the area being processed. Same as gArea2DTopLeft/gArea2DSize except for instanced areas
+};
+
+// The vertex data for polygon post-processing (see 2DPolygon_pp.hlsl). Must match PolygonVertex in PostProcessPolygons.h
+struct PolygonVertex
+{
+	float4 projectedPosition : position; // 2D viewport position, matrix transformations already done on C++ side
+	float2 areaUV            : uv;
 };
 //**************************
 
@@ -110,10 +118,45 @@ cbuffer PerModelConstants : register(b1) // The b1 gives this constant buffer th
     float3   gObjectColour;  // Useed for tinting light models
 	float    gExplodeAmount; // Used in the geometry shader to control how much the polygons are exploded outwards
 
+	// How to decode the vertices of the mesh being rendered, which may be packed into smaller formats (see VertexPacking.h)
+	float3   gPositionScale;
+	float    gOctahedralNormals; // 1 if normals are octahedral encoded, 0 if they are plain float3
+	float3   gPositionOffset;
+	float    paddingModelA;
+	float2   gUVScale;
+	float2   gUVOffset;
+
 	float4x4 gBoneMatrices[MAX_BONES];
 }
 
 
+//**************************
+
+// Vertex decoding. Packed positions and uvs are fractions of a box around them, and packed normals are octahedral encoded in
+// the xy of the input (the z is 0, as the format only has two values). Unpacked vertices use a scale of 1 and offset of 0
+
+float3 DecodePosition(float3 position)
+{
+	return position * gPositionScale + gPositionOffset;
+}
+
+float2 DecodeUV(float2 uv)
+{
+	return uv * gUVScale + gUVOffset;
+}
+
+// Unfold the octahedron that the normal was projected onto - same as DecodeOctahedral in VertexPacking.cpp
+float3 DecodeNormal(float3 normal)
+{
+	if (gOctahedralNormals == 0)  return normal;
+
+	float3 n = float3(normal.xy, 1 - abs(normal.x) - abs(normal.y));
+	float fold = saturate(-n.z);
+	n.xy += (n.xy >= 0) ? -fold : fold;
+	return normalize(n);
+}
+
+
 //**************************
 
 // This is where we receive post-processing settings from the C++ side
@@ -126,8 +169,6 @@ cbuffer PostProcessingConstants : register(b1)
 	float  gArea2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
 	float3 paddingA;       // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
 
-  	float4 gPolygon2DPoints[4]; // Four points of a polygon in 2D viewport space for polygon post-processing. Matrix transformations already done on C++ side
-
 	// Tint post-process settings
 	float3 gTintColour1;
     float  paddingB;
@@ -155,6 +196,60 @@ cbuffer PostProcessingConstants : register(b1)
 	float3 paddingG;
 
     bool   gHorizontalBlur;
+
+	// Fused post-process settings (see Fused_pp.hlsl)
+	uint   gFusedEffectCount; // Number of effects in the list below
+	uint   gFusedAreaBlend;   // Non-zero to fade each effect by its alpha, as alpha blending does for unfused area effects
+	float  paddingH;
+	uint4  gFusedEffects[2];  // Up to 8 effect identifiers (see below), applied in order
+
+	// Gaussian blur settings (see GaussianBlur_pp.hlsl)
+	uint   gGaussianTapCount; // Number of taps below, the first is the centre
+	float3 paddingI;
+	float4 gGaussianTaps[8];  // Up to 16 taps, two in each float4 as (offset in texels, weight). Mirrored either side of the centre
+
+	// Bloom settings (see Bloom_pp.hlsl)
+	uint   gBloomStage;       // Which stage of the bloom the pass is (see below)
+	float  gBloomThreshold;   // Brightness above which pixels glow
+	float  gBloomKnee;        // Width of the soft transition around the threshold
+	float  gBloomIntensity;   // Strength of the glow, already divided by the number of levels
+}
+
+// Bloom stages - must match the BloomPass enum in PostProcessBloom.h
+static const uint BLOOM_BRIGHT_PASS = 0;
+static const uint BLOOM_DOWNSAMPLE  = 1;
+static const uint BLOOM_UPSAMPLE    = 2;
+static const uint BLOOM_COMPOSITE   = 3;
+
+// Effect identifiers for the fused post-process - must match the FusedEffect enum in PostProcessingConstants.h
+static const uint FUSED_TINT       = 1;
+static const uint FUSED_RETRO      = 2;
+static const uint FUSED_GREY_NOISE = 3;
+
+// Settings shared by the retro post-process and the fused post-process. Also in PostProcessingConstants.h for the CPU versions
+static const float2 gRetroPixelSize   = float2(144.0f, 81.0f);       // Number of large "pixels" across and down the screen
+static const float3 gRetroColourDepth = float3(32.0f, 64.0f, 32.0f); // Number of levels for each of red, green and blue
+
+// Settings shared by the grey noise post-process and the fused post-process. Also in PostProcessingConstants.h
+static const float gNoiseStrength = 0.5f;  // How noticable the noise is
+static const float gNoiseSoftEdge = 0.20f; // Softness of the edge of the circle - range 0.001 (hard edge) to 0.25 (very soft)
+
+
+// Placements of many area post-processes drawn with one instanced draw call (see 2DQuadInstanced_pp.hlsl)
+// These must match the AreaInstance and AreaInstanceConstants structures in PostProcessingConstants.h
+static const uint MAX_AREA_INSTANCES = 1024;
+
+struct AreaInstance
+{
+	float2 area2DTopLeft; // As gArea2DTopLeft, gArea2DSize and gArea2DDepth above, for one instance
+	float2 area2DSize;
+	float  area2DDepth;
+	float3 padding;
+};
+
+cbuffer AreaInstanceConstants : register(b2)
+{
+	AreaInstance gAreaInstances[MAX_AREA_INSTANCES];
 }
 
 //**************************
@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------
+// Fused Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// Runs several per-pixel post-processes in a single pass. Effects such as tint only look at the
+// pixel they are writing, so instead of each effect reading and writing the whole screen, the
+// scene pixel is read once and each effect is applied in turn before writing the result.
+// The list of effects comes from the constant buffer (see PostProcessChain.cpp for how it is chosen)
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
+
+// The scene has been rendered to a texture, these variables allow access to that texture
+Texture2D    SceneTexture : register(t0);
+SamplerState PointSample  : register(s0); // We don't usually want to filter (bilinear, trilinear etc.) the scene texture when
+                                          // post-processing so this sampler will use "point sampling" - no filtering
+
+// Noise texture for the grey noise effect
+Texture2D    NoiseMap      : register(t1);
+SamplerState TrilinearWrap : register(s1);
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Post-processing shader that applies the list of per-pixel effects in gFusedEffects to the scene texture
+float4 main(PostProcessingInput input) : SV_Target
+{
+	// Retro is only ever the first effect, it picks which scene pixel is read for the whole pass
+	float2 sceneUV = input.sceneUV;
+	if (gFusedEffects[0].x == FUSED_RETRO)
+	{
+		sceneUV = floor(sceneUV * gRetroPixelSize) / gRetroPixelSize;
+	}
+	float3 colour = SceneTexture.Sample(PointSample, sceneUV).rgb;
+
+	// Soft circle alpha for effects that use it (same calculation as GreyNoise_pp.hlsl)
+	float2 centreVector = input.areaUV - float2(0.5f, 0.5f);
+	float centreLengthSq = dot(centreVector, centreVector);
+	float circleAlpha = 1.0f - saturate((centreLengthSq - 0.25f + gNoiseSoftEdge) / gNoiseSoftEdge);
+
+	// Same effect list for every pixel so these branches are cheap
+	for (uint i = 0; i < gFusedEffectCount; ++i)
+	{
+		uint effect = gFusedEffects[i / 4][i % 4];
+		float3 result = colour;
+		float  alpha  = 1.0f;
+
+		if (effect == FUSED_TINT)
+		{
+			result = colour * lerp(gTintColour1, gTintColour2, input.sceneUV.y);
+		}
+		else if (effect == FUSED_RETRO)
+		{
+			result = floor(colour * gRetroColourDepth) / gRetroColourDepth;
+		}
+		else if (effect == FUSED_GREY_NOISE)
+		{
+			float grey = (colour.r + colour.g + colour.b) / 3.0f;
+			float2 noiseUV = input.sceneUV * gNoiseScale + gNoiseOffset;
+			grey += gNoiseStrength * (NoiseMap.Sample(TrilinearWrap, noiseUV).r - 0.5f);
+			result = float3(grey, grey, grey);
+			alpha = circleAlpha;
+		}
+
+		// Area effects are alpha blended one at a time when not fused, so do the same blend here
+		colour = gFusedAreaBlend ? lerp(colour, result, alpha) : result;
+	}
+
+	return float4(colour, 1.0f);
+}
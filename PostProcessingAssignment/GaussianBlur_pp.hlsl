@@ -1,71 +1,43 @@
+//--------------------------------------------------------------------------------------
+// Gaussian Blur Post-Processing Pixel Shader
+//--------------------------------------------------------------------------------------
+// One direction of a separable gaussian blur, run once horizontally then once vertically. The taps
+// are generated on the CPU for the current blur size (see PostProcessGaussian.h). Each tap sits
+// between two texels so the bilinear sampler reads both with the right weights in one sample
+
 #include "Common.hlsli"
 
-Texture2D    SceneTexture : register(t0);
-SamplerState PointSample  : register(s0);
 
-float4 main(PostProcessingInput input) : SV_Target
-{
-	/*float2 texelSize = float2(1.0f / 1920.0f, 1.0f / 1080.0f);
-	float2 direction = texelSize * (gHorizontalBlur ? float2(1.0f, 0.0f) : float2(0.0f, 1.0f));
-	float blurSize = 10.0f;
+//--------------------------------------------------------------------------------------
+// Textures (texture maps)
+//--------------------------------------------------------------------------------------
 
-	float kernel = 0.12f * blurSize;
-	float4 colour = SceneTexture.Sample(PointSample, input.sceneUV) * kernel;
-	float total = kernel;
-	for (int i = 0; i < 2; i++)
-	{
-		for (int j = 1; j < blurSize; j++)
-		{
-			kernel = smoothstep(0.0033f, 0.0033f + blurSize, 0.0033f + blurSize - j);
-			float2 offset = direction * j;
-			colour += SceneTexture.Sample(PointSample, input.sceneUV + offset) * kernel;
-			total += kernel;
-		}
+// The scene has been rendered to a texture, these variables allow access to that texture
+Texture2D    SceneTexture   : register(t0);
+SamplerState BilinearSample : register(s0); // Must be bilinear, the taps rely on filtering between texels. Clamped at the edges
 
-		direction = -direction;
-	}*/
 
-	float2 texelSize = float2(1.0f / 1920.0f, 1.0f / 1080.0f);
-	float2 direction = float2(0.0f, 1.0f);
-	if (gHorizontalBlur)
-	{
-		direction = float2(1.0f, 0.0f);
-	}
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
 
-	const int stepCount = 9;
-
-	float weights[stepCount];
-	weights[0] = 0.10855;
-	weights[1] = 0.13135;
-	weights[2] = 0.10406;
-	weights[3] = 0.07216;
-	weights[4] = 0.04380;
-	weights[5] = 0.02328;
-	weights[6] = 0.01083;
-	weights[7] = 0.00441;
-	weights[8] = 0.00157;
-
-	float offsets[stepCount];
-	offsets[0] = 0.66293;
-	offsets[1] = 2.47904;
-	offsets[2] = 4.46232;
-	offsets[3] = 6.44568;
-	offsets[4] = 8.42917;
-	offsets[5] = 10.41281;
-	offsets[6] = 12.39664;
-	offsets[7] = 14.38070;
-	offsets[8] = 16.36501;
+float4 main(PostProcessingInput input) : SV_Target
+{
+	// The source can be smaller than the screen (see PlanGaussianBlur), so get the texel size from the texture itself
+	float width, height;
+	SceneTexture.GetDimensions(width, height);
+	float2 texelSize = float2(1.0f / width, 1.0f / height);
+	float2 direction = texelSize * (gHorizontalBlur ? float2(1.0f, 0.0f) : float2(0.0f, 1.0f));
 
-	float4 colour;
-	for (int i = 0; i < stepCount; i++)
+	// Taps are packed two to a float4 (offset, weight, offset, weight). The first is the centre texel
+	float3 colour = SceneTexture.Sample(BilinearSample, input.sceneUV).rgb * gGaussianTaps[0].y;
+	for (uint i = 1; i < gGaussianTapCount; i++)
 	{
-		float2 uvOffset = offsets[i] * texelSize;
-		float4 col = SceneTexture.Sample(PointSample, input.sceneUV + uvOffset) + SceneTexture.Sample(PointSample, input.sceneUV - uvOffset);
-		col *= weights[i];
-
-		colour += col;
+		float2 tap = (i % 2 == 0) ? gGaussianTaps[i / 2].xy : gGaussianTaps[i / 2].zw;
+		float2 uvOffset = direction * tap.x;
+		colour += (SceneTexture.Sample(BilinearSample, input.sceneUV + uvOffset).rgb +
+		           SceneTexture.Sample(BilinearSample, input.sceneUV - uvOffset).rgb) * tap.y;
 	}
 
-	colour.a = 0.1f;
-	return colour;
-}
\ No newline at end of file
+	return float4(colour, 0.1f);
+}
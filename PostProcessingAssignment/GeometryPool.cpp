@@ -0,0 +1,437 @@
+//--------------------------------------------------------------------------------------
+// GeometryPool class - shared vertex and index buffers for all meshes
+//--------------------------------------------------------------------------------------
+
+#include "GeometryPool.h"
+#include "Shader.h" // Needed for helper function CreateSignatureForVertexLayout
+#include "Common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+
+GeometryPool gGeometryPool;
+
+
+//--------------------------------------------------------------------------------------
+// Construction
+//--------------------------------------------------------------------------------------
+
+// Pool whose buffers start at the given sizes. No GPU resources are created until geometry is added
+GeometryPool::GeometryPool(unsigned int minVertexBytes /*= 4 << 20*/, unsigned int minIndexBytes /*= 1 << 20*/)
+	: mMinVertexBytes(minVertexBytes), mMinIndexBytes(minIndexBytes)
+{
+}
+
+
+// Release all GPU resources. Any ranges still in the pool are lost
+void GeometryPool::Release()
+{
+	for (auto& layout : mLayouts)
+	{
+		if (layout->buffer)       layout->buffer->Release();
+		if (layout->inputLayout)  layout->inputLayout->Release();
+	}
+	mLayouts.clear();
+
+	for (auto& indices : mIndexBuffers)
+	{
+		if (indices.buffer)  indices.buffer->Release();
+		indices = IndexBuffer();
+	}
+	mRanges = 0;
+	ForgetBindings();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Geometry
+//--------------------------------------------------------------------------------------
+
+// Copy vertices with the given layout and indices into the pool and return where they are. Will throw a std::runtime_error
+// exception on failure
+GeometryRange GeometryPool::Add(const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int numElements, unsigned int vertexSize,
+                                const void* vertices, unsigned int numVertices, const void* indices, unsigned int numIndices, unsigned int indexSize)
+{
+	GeometryRange range;
+	if (numVertices == 0 || numIndices == 0)  return range; // Nothing to draw
+
+	range.layout      = FindLayout(elements, numElements, vertexSize);
+	range.numVertices = numVertices;
+	range.numIndices  = numIndices;
+	range.indexSize   = indexSize;
+
+	LayoutBuffer& layout = *mLayouts[range.layout];
+	range.firstVertex = AllocateInBuffer(layout.buffer, layout.allocator, numVertices, vertexSize, mMinVertexBytes, D3D11_BIND_VERTEX_BUFFER);
+
+	IndexBuffer& indexBuffer = Indices(indexSize);
+	try
+	{
+		range.firstIndex = AllocateInBuffer(indexBuffer.buffer, indexBuffer.allocator, numIndices, indexSize, mMinIndexBytes, D3D11_BIND_INDEX_BUFFER);
+	}
+	catch (const std::runtime_error&)
+	{
+		layout.allocator.Free(range.firstVertex, numVertices);
+		throw;
+	}
+
+	// Copy the geometry into its part of the buffers. For buffers the box is in bytes
+	D3D11_BOX box = { range.firstVertex * vertexSize, 0, 0, (range.firstVertex + numVertices) * vertexSize, 1, 1 };
+	gD3DContext->UpdateSubresource(layout.buffer, 0, &box, vertices, 0, 0);
+	box = { range.firstIndex * indexSize, 0, 0, (range.firstIndex + numIndices) * indexSize, 1, 1 };
+	gD3DContext->UpdateSubresource(indexBuffer.buffer, 0, &box, indices, 0, 0);
+
+	++mRanges;
+	return range;
+}
+
+
+// Free the space of geometry that is no longer needed, for later geometry to reuse
+void GeometryPool::Remove(const GeometryRange& range)
+{
+	if (range.numVertices == 0 || range.numIndices == 0 || range.layout >= mLayouts.size())  return; // Nothing was allocated
+
+	mLayouts[range.layout]->allocator.Free(range.firstVertex, range.numVertices);
+	Indices(range.indexSize).allocator.Free(range.firstIndex, range.numIndices);
+	--mRanges;
+}
+
+
+// Find the layout buffer for a vertex layout, creating it (and its input layout) if it is new
+unsigned int GeometryPool::FindLayout(const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int numElements, unsigned int vertexSize)
+{
+	for (unsigned int l = 0; l < mLayouts.size(); ++l)
+	{
+		const LayoutBuffer& layout = *mLayouts[l];
+		if (layout.vertexSize != vertexSize || layout.elements.size() != numElements)  continue;
+
+		bool same = true;
+		for (unsigned int e = 0; e < numElements && same; ++e)
+		{
+			const D3D11_INPUT_ELEMENT_DESC& a = layout.elements[e];
+			const D3D11_INPUT_ELEMENT_DESC& b = elements[e];
+			same = layout.semantics[e] == b.SemanticName && a.SemanticIndex == b.SemanticIndex && a.Format == b.Format &&
+			       a.InputSlot == b.InputSlot && a.AlignedByteOffset == b.AlignedByteOffset && a.InputSlotClass == b.InputSlotClass &&
+			       a.InstanceDataStepRate == b.InstanceDataStepRate;
+		}
+		if (same)  return l;
+	}
+
+	// New layout
+	auto layout = std::make_unique<LayoutBuffer>();
+	layout->vertexSize = vertexSize;
+	layout->elements.assign(elements, elements + numElements);
+	for (auto& element : layout->elements)
+	{
+		layout->semantics.push_back(element.SemanticName);
+		element.SemanticName = nullptr;
+	}
+
+	// Create a "vertex layout" to describe to DirectX what is data in each vertex
+	auto shaderSignature = CreateSignatureForVertexLayout(elements, static_cast<int>(numElements));
+	if (shaderSignature == nullptr)  throw std::runtime_error("Unsupported vertex layout for mesh");
+	HRESULT hr = gD3DDevice->CreateInputLayout(elements, numElements, shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
+	                                           &layout->inputLayout);
+	shaderSignature->Release();
+	if (FAILED(hr))  throw std::runtime_error("Failure creating input layout for mesh");
+
+	mLayouts.push_back(std::move(layout));
+	return static_cast<unsigned int>(mLayouts.size() - 1);
+}
+
+
+// Allocate count items of the given size from a buffer, growing the buffer if there isn't room. The buffer is replaced by one
+// at least twice the size with the old contents copied over on the GPU
+unsigned int GeometryPool::AllocateInBuffer(ID3D11Buffer*& buffer, RangeAllocator& allocator, unsigned int count, unsigned int itemSize,
+                                            unsigned int minBytes, UINT bindFlags)
+{
+	unsigned int first = allocator.Allocate(count);
+	if (first != RangeAllocator::Invalid)  return first;
+
+	// Room for the new items even if the free space at the end of the buffer is too small to hold any of them. Buffers of up to
+	// 128MB (D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM) are supported on all hardware
+	const uint64_t maxCapacity = (128ull << 20) / itemSize;
+	uint64_t needed = static_cast<uint64_t>(allocator.Capacity()) + count;
+	uint64_t capacity = std::max<uint64_t>({ static_cast<uint64_t>(allocator.Capacity()) * 2, needed, (minBytes + itemSize - 1) / itemSize });
+	capacity = std::min(capacity, maxCapacity);
+	if (capacity < needed)  throw std::runtime_error("Too much mesh geometry for shared buffer");
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.BindFlags = bindFlags;
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT; // Filled with UpdateSubresource and CopySubresourceRegion
+	bufferDesc.ByteWidth = static_cast<UINT>(capacity * itemSize);
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	ID3D11Buffer* newBuffer = nullptr;
+	HRESULT hr = gD3DDevice->CreateBuffer(&bufferDesc, nullptr, &newBuffer);
+	if (FAILED(hr))  throw std::runtime_error("Failure creating shared geometry buffer for mesh");
+
+	if (buffer)
+	{
+		D3D11_BOX box = { 0, 0, 0, allocator.Capacity() * itemSize, 1, 1 };
+		gD3DContext->CopySubresourceRegion(newBuffer, 0, 0, 0, 0, buffer, 0, &box);
+		if (buffer == mBoundVertexBuffer || buffer == mBoundIndexBuffer)  ForgetBindings();
+		buffer->Release();
+	}
+	buffer = newBuffer;
+
+	allocator.Grow(static_cast<uint32_t>(capacity));
+	return allocator.Allocate(count);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Drawing
+//--------------------------------------------------------------------------------------
+
+// Draw a range as a triangle list, setting only the buffers, input layout and topology that are not already set
+void GeometryPool::Draw(const GeometryRange& range)
+{
+	if (range.layout >= mLayouts.size())  return;
+	const LayoutBuffer& layout = *mLayouts[range.layout];
+	ID3D11Buffer* indexBuffer = Indices(range.indexSize).buffer;
+
+	// Set vertex buffer as next data source for GPU. The offset is 0 as the range's vertices are picked with the base vertex
+	if (layout.buffer != mBoundVertexBuffer)
+	{
+		UINT stride = layout.vertexSize;
+		UINT offset = 0;
+		gD3DContext->IASetVertexBuffers(0, 1, &layout.buffer, &stride, &offset);
+		mBoundVertexBuffer = layout.buffer;
+		++mBindings;
+	}
+
+	// Indicate the layout of vertex buffer
+	if (layout.inputLayout != mBoundLayout)
+	{
+		gD3DContext->IASetInputLayout(layout.inputLayout);
+		mBoundLayout = layout.inputLayout;
+		++mBindings;
+	}
+
+	// Set index buffer as next data source for GPU, indicate whether it uses 16 or 32-bit integers
+	if (indexBuffer != mBoundIndexBuffer)
+	{
+		gD3DContext->IASetIndexBuffer(indexBuffer, range.indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+		mBoundIndexBuffer = indexBuffer;
+		++mBindings;
+	}
+
+	// Using triangle lists only in the pool
+	if (!mTopologyBound)
+	{
+		gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		mTopologyBound = true;
+		++mBindings;
+	}
+
+	// Render the range's part of the buffers, its indices are relative to its first vertex
+	gD3DContext->DrawIndexed(range.numIndices, range.firstIndex, static_cast<INT>(range.firstVertex));
+	++mDraws;
+}
+
+
+// Must be called when other code has changed the input assembler state, so the next Draw sets everything again
+void GeometryPool::ForgetBindings()
+{
+	mBoundLayout       = nullptr;
+	mBoundVertexBuffer = nullptr;
+	mBoundIndexBuffer  = nullptr;
+	mTopologyBound     = false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Data access
+//--------------------------------------------------------------------------------------
+
+GeometryPoolStats GeometryPool::Stats() const
+{
+	GeometryPoolStats stats;
+	stats.layouts = static_cast<unsigned int>(mLayouts.size());
+	stats.ranges  = mRanges;
+	for (auto& layout : mLayouts)
+	{
+		stats.vertexBytes  += static_cast<size_t>(layout->allocator.Capacity()) * layout->vertexSize;
+		stats.usedBytes    += static_cast<size_t>(layout->allocator.Used()) * layout->vertexSize;
+		stats.fragmentation = std::max(stats.fragmentation, layout->allocator.Fragmentation());
+	}
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		unsigned int indexSize = (i == 0) ? 2 : 4;
+		stats.indexBytes   += static_cast<size_t>(mIndexBuffers[i].allocator.Capacity()) * indexSize;
+		stats.usedBytes    += static_cast<size_t>(mIndexBuffers[i].allocator.Used()) * indexSize;
+		stats.fragmentation = std::max(stats.fragmentation, mIndexBuffers[i].allocator.Fragmentation());
+	}
+	stats.draws    = mDraws;
+	stats.bindings = mBindings;
+	return stats;
+}
+
+void GeometryPool::ResetStats()
+{
+	mDraws = mBindings = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Copy the first bytes of a GPU buffer to the CPU through a staging buffer. Will throw a std::runtime_error exception on failure
+static std::vector<unsigned char> ReadBuffer(ID3D11Buffer* buffer, unsigned int bytes)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.BindFlags = 0;
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.ByteWidth = bytes;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	ID3D11Buffer* staging = nullptr;
+	if (buffer == nullptr || FAILED(gD3DDevice->CreateBuffer(&bufferDesc, nullptr, &staging)))
+	{
+		throw std::runtime_error("Failure creating staging buffer for geometry pool check");
+	}
+
+	D3D11_BOX box = { 0, 0, 0, bytes, 1, 1 };
+	gD3DContext->CopySubresourceRegion(staging, 0, 0, 0, 0, buffer, 0, &box);
+
+	std::vector<unsigned char> data(bytes);
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT hr = gD3DContext->Map(staging, 0, D3D11_MAP_READ, 0, &mapped);
+	if (SUCCEEDED(hr))
+	{
+		std::memcpy(data.data(), mapped.pData, bytes);
+		gD3DContext->Unmap(staging, 0);
+	}
+	staging->Release();
+	if (FAILED(hr))  throw std::runtime_error("Failure reading geometry pool buffer");
+	return data;
+}
+
+
+// Add ranges of different sizes to a pool with tiny buffers, removing some along the way, then read the buffers back and check
+// each range's geometry is where Draw will use it
+GeometryPoolCheck CheckGeometryPool(unsigned int ranges)
+{
+	GeometryPoolCheck result;
+
+	// The layout meshes without bones use, with vertices that are all different
+	D3D11_INPUT_ELEMENT_DESC elements[] =
+	{
+		{ "position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "normal",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "uv",       0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	const unsigned int vertexSize = 32;
+
+	struct AddedRange
+	{
+		GeometryRange              range;
+		std::vector<float>         vertices;
+		std::vector<unsigned char> indices;
+	};
+	std::vector<AddedRange> added;
+
+	try
+	{
+		GeometryPool pool(256, 64);
+
+		// Ranges with no geometry have nothing to free, whatever layout they say they have
+		GeometryRange empty = pool.Add(elements, 3, vertexSize, nullptr, 0, nullptr, 0, 2);
+		pool.Remove(empty);
+		ID3D11Buffer* previousVertices = nullptr;
+		ID3D11Buffer* previousIndices[2] = { nullptr, nullptr };
+		for (unsigned int r = 0; r < ranges; ++r)
+		{
+			AddedRange geometry;
+			unsigned int numVertices = 3 + (r * 7) % 40;
+			unsigned int numIndices  = 3 * (1 + (r * 5) % 30);
+			unsigned int indexSize   = (r % 2 == 0) ? 2 : 4;
+			geometry.vertices.resize(numVertices * vertexSize / sizeof(float));
+			for (size_t f = 0; f < geometry.vertices.size(); ++f)  geometry.vertices[f] = r * 1000.0f + f;
+			geometry.indices.resize(static_cast<size_t>(numIndices) * indexSize);
+			for (unsigned int i = 0; i < numIndices; ++i)
+			{
+				uint32_t index = (i * 7 + r) % numVertices;
+				if (indexSize == 2)
+				{
+					uint16_t index16 = static_cast<uint16_t>(index);
+					std::memcpy(geometry.indices.data() + i * 2, &index16, 2);
+				}
+				else
+				{
+					std::memcpy(geometry.indices.data() + i * 4, &index, 4);
+				}
+			}
+
+			geometry.range = pool.Add(elements, 3, vertexSize, geometry.vertices.data(), numVertices, geometry.indices.data(), numIndices, indexSize);
+			added.push_back(std::move(geometry));
+
+			// Buffers are replaced when they grow
+			ID3D11Buffer* vertices = pool.mLayouts[0]->buffer;
+			ID3D11Buffer*& indices = previousIndices[indexSize == 2 ? 0 : 1];
+			if (previousVertices && vertices != previousVertices)  ++result.vertexGrows;
+			if (indices && pool.Indices(indexSize).buffer != indices)  ++result.indexGrows;
+			previousVertices = vertices;
+			indices = pool.Indices(indexSize).buffer;
+
+			// Free every third range, leaving holes for later ranges to fill
+			if (r % 3 == 2)
+			{
+				pool.Remove(added[added.size() - 2].range);
+				added.erase(added.end() - 2);
+			}
+		}
+
+		// An empty range claiming a layout that is in use, as a default range may, must not free anything
+		GeometryPoolStats before = pool.Stats();
+		GeometryRange emptyInLayout;
+		emptyInLayout.layout = 0;
+		emptyInLayout.numVertices = 5;
+		pool.Remove(emptyInLayout);
+		pool.Remove(empty);
+		GeometryPoolStats after = pool.Stats();
+		result.emptyRanges = empty.numVertices == 0 && after.ranges == before.ranges && after.ranges == added.size() &&
+		                     after.usedBytes == before.usedBytes;
+
+		// Read the buffers back, each range's geometry must be at its base vertex and start index
+		const GeometryPool::LayoutBuffer& layout = *pool.mLayouts[0];
+		std::vector<unsigned char> vertexData = ReadBuffer(layout.buffer, layout.allocator.Capacity() * vertexSize);
+		std::vector<unsigned char> indexData[2];
+		for (unsigned int i = 0; i < 2; ++i)
+		{
+			const GeometryPool::IndexBuffer& indexBuffer = pool.mIndexBuffers[i];
+			indexData[i] = ReadBuffer(indexBuffer.buffer, indexBuffer.allocator.Capacity() * (i == 0 ? 2 : 4));
+		}
+
+		result.contents = !added.empty();
+		for (auto& geometry : added)
+		{
+			const GeometryRange& range = geometry.range;
+			size_t vertexStart = static_cast<size_t>(range.firstVertex) * vertexSize;
+			size_t indexStart  = static_cast<size_t>(range.firstIndex) * range.indexSize;
+			const std::vector<unsigned char>& indices = indexData[range.indexSize == 2 ? 0 : 1];
+			if (range.layout != 0 || vertexStart + range.numVertices * vertexSize > vertexData.size() ||
+			    indexStart + geometry.indices.size() > indices.size() ||
+			    std::memcmp(vertexData.data() + vertexStart, geometry.vertices.data(), range.numVertices * vertexSize) != 0 ||
+			    std::memcmp(indices.data() + indexStart, geometry.indices.data(), geometry.indices.size()) != 0)
+			{
+				result.contents = false;
+			}
+		}
+	}
+	catch (const std::runtime_error&)
+	{
+		result.contents = false;
+	}
+
+	result.passed = result.contents && result.emptyRanges && result.vertexGrows > 0 && result.indexGrows > 0;
+	return result;
+}
@@ -0,0 +1,177 @@
+//--------------------------------------------------------------------------------------
+// GeometryPool class - shared vertex and index buffers for all meshes
+//--------------------------------------------------------------------------------------
+// Rather than each sub-mesh having its own buffers and input layout, geometry is placed in a
+// few large buffers: one vertex buffer for each vertex layout in use, and one index buffer each
+// for 16 and 32-bit indices. Space in them is handed out with a RangeAllocator, and a sub-mesh
+// is drawn from its part of the buffers with the start index and base vertex of DrawIndexed, so
+// its indices stay relative to its own vertices. Sub-meshes with identical layouts share a
+// single input layout object.
+//
+// With only a few buffers, draws one after another usually use the same ones, so the pool
+// remembers what it last bound and only calls IASet* functions for what has changed. Other code
+// that sets the input assembler must call ForgetBindings before the pool draws again.
+//
+// Buffers start at a minimum size and double when full, copying their contents on the GPU, so
+// callers hold GeometryRange values rather than buffer pointers
+
+#ifndef _GEOMETRY_POOL_H_INCLUDED_
+#define _GEOMETRY_POOL_H_INCLUDED_
+
+#include "RangeAllocator.h"
+#define NOMINMAX // Use this to stop Windows headers defining "min" and "max", which breaks some libraries (e.g. assimp)
+#include <d3d11.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Where some geometry is in the pool, returned by GeometryPool::Add
+struct GeometryRange
+{
+	unsigned int layout      = ~0u; // Which vertex buffer / input layout, ~0 if the range holds no geometry
+	unsigned int firstVertex = 0;   // Base vertex for DrawIndexed
+	unsigned int numVertices = 0;
+	unsigned int firstIndex  = 0;   // Start index for DrawIndexed
+	unsigned int numIndices  = 0;
+	unsigned int indexSize   = 4;   // 2 or 4 bytes
+};
+
+
+// Counts of what the pool holds and how it has drawn since the last ResetStats
+struct GeometryPoolStats
+{
+	unsigned int layouts     = 0; // Distinct vertex layouts, each with an input layout and vertex buffer
+	unsigned int ranges      = 0; // Geometry ranges added and not removed
+	size_t       vertexBytes = 0; // Size of all vertex buffers
+	size_t       indexBytes  = 0; // Size of both index buffers
+	size_t       usedBytes   = 0; // Parts of the above in use
+	float        fragmentation = 0; // Largest fragmentation of any of the buffers' free space, see RangeAllocator
+
+	unsigned int draws    = 0;
+	unsigned int bindings = 0; // IASet* calls made, at most 4 per draw without the pool skipping repeats
+};
+
+
+struct GeometryPoolCheck;
+
+class GeometryPool
+{
+public:
+
+	// Construction //
+
+	// Pool whose buffers start at the given sizes. No GPU resources are created until geometry is added
+	explicit GeometryPool(unsigned int minVertexBytes = 4 << 20, unsigned int minIndexBytes = 1 << 20);
+
+	// Releases the GPU resources, which should be done with Release before the device is released
+	~GeometryPool()  { Release(); }
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// Release all GPU resources. Any ranges still in the pool are lost
+	void Release();
+
+
+	// Geometry //
+
+	// Copy vertices with the given layout and indices (indexSize bytes each, 2 or 4) into the pool and return where they are.
+	// Will throw a std::runtime_error exception on failure, as the Mesh constructor does
+	GeometryRange Add(const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int numElements, unsigned int vertexSize,
+	                  const void* vertices, unsigned int numVertices, const void* indices, unsigned int numIndices, unsigned int indexSize);
+
+	// Free the space of geometry that is no longer needed, for later geometry to reuse
+	void Remove(const GeometryRange& range);
+
+
+	// Drawing //
+
+	// Draw a range as a triangle list, setting only the buffers, input layout and topology that are not already set
+	void Draw(const GeometryRange& range);
+
+	// Must be called when other code has changed the input assembler state, so the next Draw sets everything again
+	void ForgetBindings();
+
+
+	// Data access //
+
+	GeometryPoolStats Stats() const;
+	void ResetStats();
+
+
+private:
+	// A vertex layout and the vertex buffer holding all geometry with it. Semantic names are copied, the element pointers to
+	// them are not kept
+	struct LayoutBuffer
+	{
+		std::vector<std::string>              semantics;
+		std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+		unsigned int                          vertexSize  = 0;
+		ID3D11InputLayout*                    inputLayout = nullptr;
+		ID3D11Buffer*                         buffer      = nullptr;
+		RangeAllocator                        allocator; // In vertices
+	};
+
+	// An index buffer for one index size
+	struct IndexBuffer
+	{
+		ID3D11Buffer*  buffer = nullptr;
+		RangeAllocator allocator; // In indices
+	};
+
+	// Find the layout buffer for a vertex layout, creating it (and its input layout) if it is new
+	unsigned int FindLayout(const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int numElements, unsigned int vertexSize);
+
+	// Allocate count items of the given size from a buffer, growing the buffer if there isn't room
+	unsigned int AllocateInBuffer(ID3D11Buffer*& buffer, RangeAllocator& allocator, unsigned int count, unsigned int itemSize,
+	                              unsigned int minBytes, UINT bindFlags);
+
+	IndexBuffer& Indices(unsigned int indexSize)  { return mIndexBuffers[indexSize == 2 ? 0 : 1]; }
+
+	std::vector<std::unique_ptr<LayoutBuffer>> mLayouts;
+	IndexBuffer                                mIndexBuffers[2]; // 16-bit then 32-bit
+	unsigned int mMinVertexBytes;
+	unsigned int mMinIndexBytes;
+	unsigned int mRanges = 0;
+
+	// What the pool last set on gD3DContext, null if unknown
+	ID3D11InputLayout* mBoundLayout       = nullptr;
+	ID3D11Buffer*      mBoundVertexBuffer = nullptr;
+	ID3D11Buffer*      mBoundIndexBuffer  = nullptr;
+	bool               mTopologyBound     = false;
+
+	unsigned int mDraws    = 0;
+	unsigned int mBindings = 0;
+
+	// Reads the buffers back to check where ranges are
+	friend GeometryPoolCheck CheckGeometryPool(unsigned int ranges);
+};
+
+// The pool all meshes use. Defined in GeometryPool.cpp
+extern GeometryPool gGeometryPool;
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckGeometryPool
+struct GeometryPoolCheck
+{
+	unsigned int vertexGrows = 0; // Times the vertex buffer was replaced by a bigger one while ranges were added
+	unsigned int indexGrows  = 0; // The same for both index buffers
+
+	bool contents    = false; // True if every range's vertices and indices were read back from its offsets after all the growing
+	bool emptyRanges = false; // True if adding and removing ranges with no geometry left the pool unchanged
+	bool passed      = false; // True if all of the above and every buffer grew at least once
+};
+
+// Add the given number of ranges of different sizes to a pool with tiny buffers, removing some along the way, so the buffers
+// grow several times with their contents copied on the GPU. Then read the buffers back and check each range's geometry is where
+// Draw will use it. Needs the graphics device
+GeometryPoolCheck CheckGeometryPool(unsigned int ranges);
+
+
+#endif // _GEOMETRY_POOL_H_INCLUDED_
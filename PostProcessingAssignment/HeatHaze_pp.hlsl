@@ -38,7 +38,7 @@ float4 main(PostProcessingInput input) : SV_Target
 	
 	// Offset for scene texture UV based on haze effect
 	// Adjust size of UV offset based on the constant EffectStrength, the overall size of area being processed, and the alpha value calculated above
-	float2 hazeOffset = float2(SinY, SinX) * effectStrength * alpha * gArea2DSize;
+	float2 hazeOffset = float2(SinY, SinX) * effectStrength * alpha * input.area2DRect.zw;
 
 	// Get pixel from scene texture, offset using haze
     float3 colour = SceneTexture.Sample(PointSample, input.sceneUV + hazeOffset).rgb;
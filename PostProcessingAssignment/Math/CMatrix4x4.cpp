@@ -3,8 +3,10 @@
 //--------------------------------------------------------------------------------------
 
 #include "CMatrix4x4.h"
+#include "FastTrig.h"
+
+#include <cmath>
 
-#include <algorithm>
 
 /*-----------------------------------------------------------------------------------------
     Member functions
@@ -29,111 +31,89 @@ CVector3 CMatrix4x4::GetRow(int iRow) const
 }
 
 
-// Post-multiply this matrix by the given one
-CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
-{
-    if (this == &m)
-    {
-        // Special case of multiplying by self - no copy optimisations so use binary version
-        *this = m * m;
-    }
-    else
-    {
-        float t0, t1, t2;
-
-        t0 = e00 * m.e00 + e01 * m.e10 + e02 * m.e20 + e03 * m.e30;
-        t1 = e00 * m.e01 + e01 * m.e11 + e02 * m.e21 + e03 * m.e31;
-        t2 = e00 * m.e02 + e01 * m.e12 + e02 * m.e22 + e03 * m.e32;
-        e03 = e00 * m.e03 + e01 * m.e13 + e02 * m.e23 + e03 * m.e33;
-        e00 = t0;
-        e01 = t1;
-        e02 = t2;
-
-        t0 = e10 * m.e00 + e11 * m.e10 + e12 * m.e20 + e13 * m.e30;
-        t1 = e10 * m.e01 + e11 * m.e11 + e12 * m.e21 + e13 * m.e31;
-        t2 = e10 * m.e02 + e11 * m.e12 + e12 * m.e22 + e13 * m.e32;
-        e13 = e10 * m.e03 + e11 * m.e13 + e12 * m.e23 + e13 * m.e33;
-        e10 = t0;
-        e11 = t1;
-        e12 = t2;
-
-        t0 = e20 * m.e00 + e21 * m.e10 + e22 * m.e20 + e23 * m.e30;
-        t1 = e20 * m.e01 + e21 * m.e11 + e22 * m.e21 + e23 * m.e31;
-        t2 = e20 * m.e02 + e21 * m.e12 + e22 * m.e22 + e23 * m.e32;
-        e23 = e20 * m.e03 + e21 * m.e13 + e22 * m.e23 + e23 * m.e33;
-        e20 = t0;
-        e21 = t1;
-        e22 = t2;
-
-        t0 = e30 * m.e00 + e31 * m.e10 + e32 * m.e20 + e33 * m.e30;
-        t1 = e30 * m.e01 + e31 * m.e11 + e32 * m.e21 + e33 * m.e31;
-        t2 = e30 * m.e02 + e31 * m.e12 + e32 * m.e22 + e33 * m.e32;
-        e33 = e30 * m.e03 + e31 * m.e13 + e32 * m.e23 + e33 * m.e33;
-        e30 = t0;
-        e31 = t1;
-        e32 = t2;
-    }
-    return *this;
-}
+/*-----------------------------------------------------------------------------------------
+    SIMD helpers
+-----------------------------------------------------------------------------------------*/
+// Shuffles for the inverse and determinant. The SIMD multiply, transform and transpose are in the header
 
+#if MATH_SIMD == MATH_SIMD_SSE2 || MATH_SIMD == MATH_SIMD_AVX
 
-// Return the given CVector4 transformed by this matrix
-CVector4 CMatrix4x4::operator*=(const CVector4& v)
+// Return [a[K], a[K], b[K], b[K]]
+template <int K>
+static inline __m128 PairOf(__m128 a, __m128 b)
 {
-    CVector4 vOut;
-
-	vOut.x = v.x * e00 + v.y * e10 + v.z * e20 + v.w * e30;
-	vOut.y = v.x * e01 + v.y * e11 + v.z * e21 + v.w * e31;
-	vOut.z = v.x * e02 + v.y * e12 + v.z * e22 + v.w * e32;
-	vOut.w = v.x * e03 + v.y * e13 + v.z * e23 + v.w * e33;
-
-	return vOut;
+    return _mm_shuffle_ps(a, b, _MM_SHUFFLE(K, K, K, K));
 }
 
-
-/*-----------------------------------------------------------------------------------------
-    Non-member Operators
------------------------------------------------------------------------------------------*/
-
-// Matrix-matrix multiplication
-CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
+// Return the 2x2 determinants of columns i and j, [cij, cij, sij, sij] as named in MatrixAdjugateScalar. Each high and low
+// pair holds column i or j of rows 2 and 0 (high) or 3 and 1 (low)
+static inline __m128 Minors(__m128 highI, __m128 lowI, __m128 highJ, __m128 lowJ)
 {
-    CMatrix4x4 mOut;
-
-    mOut.e00 = m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20 + m1.e03*m2.e30;
-    mOut.e01 = m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21 + m1.e03*m2.e31;
-    mOut.e02 = m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22 + m1.e03*m2.e32;
-    mOut.e03 = m1.e00*m2.e03 + m1.e01*m2.e13 + m1.e02*m2.e23 + m1.e03*m2.e33;
-
-    mOut.e10 = m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20 + m1.e13*m2.e30;
-    mOut.e11 = m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21 + m1.e13*m2.e31;
-    mOut.e12 = m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22 + m1.e13*m2.e32;
-    mOut.e13 = m1.e10*m2.e03 + m1.e11*m2.e13 + m1.e12*m2.e23 + m1.e13*m2.e33;
-
-    mOut.e20 = m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20 + m1.e23*m2.e30;
-    mOut.e21 = m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21 + m1.e23*m2.e31;
-    mOut.e22 = m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22 + m1.e23*m2.e32;
-    mOut.e23 = m1.e20*m2.e03 + m1.e21*m2.e13 + m1.e22*m2.e23 + m1.e23*m2.e33;
-
-    mOut.e30 = m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m1.e33*m2.e30;
-    mOut.e31 = m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m1.e33*m2.e31;
-    mOut.e32 = m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m1.e33*m2.e32;
-    mOut.e33 = m1.e30*m2.e03 + m1.e31*m2.e13 + m1.e32*m2.e23 + m1.e33*m2.e33;
+    return _mm_sub_ps(_mm_mul_ps(highI, lowJ), _mm_mul_ps(lowI, highJ));
+}
 
-    return mOut;
+// Return [m1k, m0k, m3k, m2k] for the matrix with rows r0-r3
+template <int K>
+static inline __m128 ColumnSwapped(__m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+    return _mm_shuffle_ps(PairOf<K>(r1, r0), PairOf<K>(r3, r2), _MM_SHUFFLE(2, 0, 2, 0));
 }
 
-// Return the given CVector4 transformed by the given matrix
-CVector4 operator*(const CVector4& v, const CMatrix4x4& m)
+// Return a * b - c * d + e * f
+static inline __m128 Cofactors(__m128 a, __m128 b, __m128 c, __m128 d, __m128 e, __m128 f)
 {
-    CVector4 vOut;
+    return _mm_add_ps(_mm_sub_ps(_mm_mul_ps(a, b), _mm_mul_ps(c, d)), _mm_mul_ps(e, f));
+}
 
-	vOut.x = v.x * m.e00 + v.y * m.e10 + v.z * m.e20 + v.w * m.e30;
-	vOut.y = v.x * m.e01 + v.y * m.e11 + v.z * m.e21 + v.w * m.e31;
-	vOut.z = v.x * m.e02 + v.y * m.e12 + v.z * m.e22 + v.w * m.e32;
-	vOut.w = v.x * m.e03 + v.y * m.e13 + v.z * m.e23 + v.w * m.e33;
+#endif
 
-	return vOut;
+
+// Set adjugate to the adjugate of m and return the determinant. Exactly the same results as MatrixAdjugateScalar and
+// DeterminantScalar: each row of the adjugate is worked out four elements at a time with the same sums in the same order
+static float Adjugate(const CMatrix4x4& m, CMatrix4x4& adjugate)
+{
+#if MATH_SIMD == MATH_SIMD_SSE2 || MATH_SIMD == MATH_SIMD_AVX
+    __m128 r0 = _mm_load_ps(&m.e00);
+    __m128 r1 = _mm_load_ps(&m.e10);
+    __m128 r2 = _mm_load_ps(&m.e20);
+    __m128 r3 = _mm_load_ps(&m.e30);
+
+    __m128 high0 = PairOf<0>(r2, r0), high1 = PairOf<1>(r2, r0), high2 = PairOf<2>(r2, r0), high3 = PairOf<3>(r2, r0);
+    __m128 low0  = PairOf<0>(r3, r1), low1  = PairOf<1>(r3, r1), low2  = PairOf<2>(r3, r1), low3  = PairOf<3>(r3, r1);
+    __m128 minors01 = Minors(high0, low0, high1, low1);
+    __m128 minors02 = Minors(high0, low0, high2, low2);
+    __m128 minors03 = Minors(high0, low0, high3, low3);
+    __m128 minors12 = Minors(high1, low1, high2, low2);
+    __m128 minors13 = Minors(high1, low1, high3, low3);
+    __m128 minors23 = Minors(high2, low2, high3, low3);
+
+    __m128 column0 = ColumnSwapped<0>(r0, r1, r2, r3);
+    __m128 column1 = ColumnSwapped<1>(r0, r1, r2, r3);
+    __m128 column2 = ColumnSwapped<2>(r0, r1, r2, r3);
+    __m128 column3 = ColumnSwapped<3>(r0, r1, r2, r3);
+
+    // Alternate signs, multiplying by -1 is exact so gives the same as negating the sums in the scalar version
+    const __m128 plusMinus  = _mm_setr_ps( 1.0f, -1.0f,  1.0f, -1.0f);
+    const __m128 minusPlus  = _mm_setr_ps(-1.0f,  1.0f, -1.0f,  1.0f);
+    __m128 a0 = _mm_mul_ps(Cofactors(column1, minors23, column2, minors13, column3, minors12), plusMinus);
+    __m128 a1 = _mm_mul_ps(Cofactors(column0, minors23, column2, minors03, column3, minors02), minusPlus);
+    __m128 a2 = _mm_mul_ps(Cofactors(column0, minors13, column1, minors03, column3, minors01), plusMinus);
+    __m128 a3 = _mm_mul_ps(Cofactors(column0, minors12, column1, minors02, column2, minors01), minusPlus);
+    _mm_store_ps(&adjugate.e00, a0);
+    _mm_store_ps(&adjugate.e10, a1);
+    _mm_store_ps(&adjugate.e20, a2);
+    _mm_store_ps(&adjugate.e30, a3);
+
+    // Row 0 times column 0 of the adjugate, added up in order
+    alignas(16) float products[4];
+    _mm_store_ps(products, _mm_mul_ps(r0, _mm_movelh_ps(_mm_unpacklo_ps(a0, a1), _mm_unpacklo_ps(a2, a3))));
+    return products[0] + products[1] + products[2] + products[3];
+
+#else
+    // NEON has no single shuffle for most of the patterns above, so uses the scalar version
+    adjugate = MatrixAdjugateScalar(m);
+    return m.e00*adjugate.e00 + m.e01*adjugate.e10 + m.e02*adjugate.e20 + m.e03*adjugate.e30;
+#endif
 }
 
 
@@ -144,31 +124,13 @@ CVector4 operator*(const CVector4& v, const CMatrix4x4& m)
 // The following functions create a new matrix holding a particular transformation
 // They can be used as temporaries in calculations, e.g.
 //     CMatrix4x4 m = MatrixScaling( 3.0f ) * MatrixTranslation( CVector3(10.0f, -10.0f, 20.0f) );
-
-// Return an identity matrix
-CMatrix4x4 MatrixIdentity()
-{
-    return CMatrix4x4{ 1, 0, 0, 0,
-                       0, 1, 0, 0,
-                       0, 0, 1, 0,
-                       0, 0, 0, 1 };
-}
-
-// Return a translation matrix of the given vector
-CMatrix4x4 MatrixTranslation(const CVector3& t)
-{
-    return CMatrix4x4  { 1,   0,   0,  0,
-                         0,   1,   0,  0,
-                         0,   0,   1,  0,
-                       t.x, t.y, t.z,  1 };
-}
-
+// Those not here are constexpr, in the header file
 
 // Return an X-axis rotation matrix of the given angle (in radians)
-CMatrix4x4 MatrixRotationX(float x)
+CMatrix4x4 MatrixRotationX(float x, TrigPolicy policy /*= TrigPolicy::Precise*/)
 {
-    float sX = std::sin(x);
-    float cX = std::cos(x);
+    float sX, cX;
+    SinCos(x, sX, cX, policy);
 
     return CMatrix4x4{ 1,   0,   0,  0,
                        0,  cX,  sX,  0,
@@ -177,10 +139,10 @@ CMatrix4x4 MatrixRotationX(float x)
 }
 
 // Return a Y-axis rotation matrix of the given angle (in radians)
-CMatrix4x4 MatrixRotationY(float y)
+CMatrix4x4 MatrixRotationY(float y, TrigPolicy policy /*= TrigPolicy::Precise*/)
 {
-    float sY = std::sin(y);
-    float cY = std::cos(y);
+    float sY, cY;
+    SinCos(y, sY, cY, policy);
 
     return CMatrix4x4{ cY,   0, -sY,  0,
                         0,   1,   0,  0,
@@ -189,10 +151,10 @@ CMatrix4x4 MatrixRotationY(float y)
 }
 
 // Return a Z-axis rotation matrix of the given angle (in radians)
-CMatrix4x4 MatrixRotationZ(float z)
+CMatrix4x4 MatrixRotationZ(float z, TrigPolicy policy /*= TrigPolicy::Precise*/)
 {
-    float sZ = std::sin(z);
-    float cZ = std::cos(z);
+    float sZ, cZ;
+    SinCos(z, sZ, cZ, policy);
 
     return CMatrix4x4{ cZ,  sZ,  0,  0,
                       -sZ,  cZ,  0,  0,
@@ -201,63 +163,149 @@ CMatrix4x4 MatrixRotationZ(float z)
 }
 
 
-// Return a matrix that is a scaling in X,Y and Z of the values in the given vector
-CMatrix4x4 MatrixScaling(const CVector3& s)
+// Return the determinant of the given matrix. The same value as DeterminantScalar
+float Determinant(const CMatrix4x4& m)
+{
+    CMatrix4x4 adjugate;
+    return Adjugate(m, adjugate);
+}
+
+
+// Set inverse to the inverse of any matrix and return true. Returns false, leaving inverse unchanged, if the matrix has no
+// inverse or is too close to having none
+bool Inverse(const CMatrix4x4& m, CMatrix4x4& inverse, float tolerance /*= 1e-6f*/)
+{
+    CMatrix4x4 adjugate;
+    float det = Adjugate(m, adjugate);
+
+    // The determinant is at most the product of the row lengths, when the rows are at right angles. It is much smaller when they
+    // are close to parallel and the inverse is mostly rounding errors. Squares are compared to avoid square roots, in doubles
+    // so large or small values can't overflow. Written so NaN determinants fail too
+    double largestSquared = 1.0;
+    const float* row = &m.e00;
+    for (int i = 0; i < 4; ++i, row += 4)
+    {
+        largestSquared *= static_cast<double>(row[0])*row[0] + static_cast<double>(row[1])*row[1] +
+                          static_cast<double>(row[2])*row[2] + static_cast<double>(row[3])*row[3];
+    }
+    double detSquared = static_cast<double>(det) * det;
+    if (!(detSquared > static_cast<double>(tolerance) * tolerance * largestSquared) || !std::isfinite(det))  return false;
+
+    float invDet = 1.0f / det;
+#if MATH_SIMD == MATH_SIMD_SSE2 || MATH_SIMD == MATH_SIMD_AVX
+    __m128 scale = _mm_set1_ps(invDet);
+    _mm_store_ps(&inverse.e00, _mm_mul_ps(_mm_load_ps(&adjugate.e00), scale));
+    _mm_store_ps(&inverse.e10, _mm_mul_ps(_mm_load_ps(&adjugate.e10), scale));
+    _mm_store_ps(&inverse.e20, _mm_mul_ps(_mm_load_ps(&adjugate.e20), scale));
+    _mm_store_ps(&inverse.e30, _mm_mul_ps(_mm_load_ps(&adjugate.e30), scale));
+#else
+    const float* a = &adjugate.e00;
+    float* out = &inverse.e00;
+    for (int i = 0; i < 16; ++i)  out[i] = a[i] * invDet;
+#endif
+    return true;
+}
+
+
+// 3x3 matrices in doubles for the polar decomposition, which repeatedly averages a matrix with its inverse transpose
+struct Matrix3d
 {
-    return CMatrix4x4{ s.x,   0,   0,  0,
-                       0,   s.y,   0,  0,
-                       0,     0, s.z,  0,
-                       0,     0,   0,  1 };
+    double e[3][3];
+};
+
+// Return the cofactor matrix of m (the inverse transpose times the determinant) and set det to the determinant
+static Matrix3d Cofactors3d(const Matrix3d& m, double& det)
+{
+    Matrix3d c;
+    for (int i = 0; i < 3; ++i)
+    {
+        int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        for (int j = 0; j < 3; ++j)
+        {
+            int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            c.e[i][j] = m.e[i1][j1] * m.e[i2][j2] - m.e[i1][j2] * m.e[i2][j1];
+        }
+    }
+    det = m.e[0][0] * c.e[0][0] + m.e[0][1] * c.e[0][1] + m.e[0][2] * c.e[0][2];
+    return c;
 }
 
-// Return a matrix that is a uniform scaling of the given amount
-CMatrix4x4 MatrixScaling(const float s)
+// Sum of the squares of the elements of m (the square of the Frobenius norm)
+static double LengthSquared3d(const Matrix3d& m)
 {
-    return CMatrix4x4{ s, 0, 0, 0,
-                       0, s, 0, 0,
-                       0, 0, s, 0,
-                       0, 0, 0, 1 };
+    double sum = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)  sum += m.e[i][j] * m.e[i][j];
+    }
+    return sum;
 }
 
 
-// Return the inverse of given matrix assuming that it is an affine matrix
-// Advanced calulation needed to get the view matrix from the camera's positioning matrix
-CMatrix4x4 InverseAffine(const CMatrix4x4& m)
+// Split the upper-left 3x3 of the given matrix into a symmetric stretch followed by an orthogonal matrix, m = stretch * orthogonal.
+// Returns false, leaving the outputs unchanged, if the 3x3 has no inverse or is too close to having none
+bool PolarDecompose(const CMatrix4x4& m, CMatrix4x4& stretch, CMatrix4x4& orthogonal)
 {
-    CMatrix4x4 mOut;
+    Matrix3d q;
+    const float* row = &m.e00;
+    for (int i = 0; i < 3; ++i, row += 4)
+    {
+        for (int j = 0; j < 3; ++j)  q.e[i][j] = row[j];
+    }
 
-    // Calculate determinant of upper left 3x3
-    float det0 = m.e11*m.e22 - m.e12*m.e21;
-    float det1 = m.e12*m.e20 - m.e10*m.e22;
-    float det2 = m.e10*m.e21 - m.e11*m.e20;
-    float det = m.e00*det0 + m.e01*det1 + m.e02*det2;
+    // Newton iteration: the average of the matrix and its inverse transpose converges quadratically to the orthogonal factor.
+    // Scaling the two to the same size first (Higham's scaling) makes the first steps much faster when the scale is far from 1
+    for (int iteration = 0; iteration < 20; ++iteration)
+    {
+        double det;
+        Matrix3d cofactors = Cofactors3d(q, det);
+        if (iteration == 0)
+        {
+            // The same test as Inverse with the default tolerance, on the rows of the 3x3
+            double largest = 1.0;
+            for (int i = 0; i < 3; ++i)  largest *= std::sqrt(q.e[i][0] * q.e[i][0] + q.e[i][1] * q.e[i][1] + q.e[i][2] * q.e[i][2]);
+            if (!(std::abs(det) > 1e-6 * largest))  return false;
+        }
+
+        double size = std::sqrt(LengthSquared3d(q));
+        double inverseSize = std::sqrt(LengthSquared3d(cofactors)) / std::abs(det);
+        double gamma = std::sqrt(inverseSize / size);
+        double change = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                double next = 0.5 * (gamma * q.e[i][j] + cofactors.e[i][j] / (gamma * det));
+                change += (next - q.e[i][j]) * (next - q.e[i][j]);
+                q.e[i][j] = next;
+            }
+        }
+        if (change < 1e-24)  break;
+    }
 
-    // Calculate inverse of upper left 3x3
-    float invDet = 1.0f / det;
-    mOut.e00 = invDet * det0;
-    mOut.e10 = invDet * det1;
-    mOut.e20 = invDet * det2;
-
-    mOut.e01 = invDet * (m.e21*m.e02 - m.e22*m.e01);
-    mOut.e11 = invDet * (m.e22*m.e00 - m.e20*m.e02);
-    mOut.e21 = invDet * (m.e20*m.e01 - m.e21*m.e00);
-
-    mOut.e02 = invDet * (m.e01*m.e12 - m.e02*m.e11);
-    mOut.e12 = invDet * (m.e02*m.e10 - m.e00*m.e12);
-    mOut.e22 = invDet * (m.e00*m.e11 - m.e01*m.e10);
-
-    // Transform negative translation by inverted 3x3 to get inverse
-    mOut.e30 = -m.e30*mOut.e00 - m.e31*mOut.e10 - m.e32*mOut.e20;
-    mOut.e31 = -m.e30*mOut.e01 - m.e31*mOut.e11 - m.e32*mOut.e21;
-    mOut.e32 = -m.e30*mOut.e02 - m.e31*mOut.e12 - m.e32*mOut.e22;
-
-    // Fill in right column for affine matrix
-    mOut.e03 = 0.0f;
-    mOut.e13 = 0.0f;
-    mOut.e23 = 0.0f;
-    mOut.e33 = 1.0f;
-
-    return mOut;
+    // The stretch is m times the transpose of the orthogonal factor, averaged with its transpose to make it exactly symmetric
+    Matrix3d s;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            s.e[i][j] = 0;
+            for (int k = 0; k < 3; ++k)  s.e[i][j] += (&m.e00)[i * 4 + k] * q.e[j][k];
+        }
+    }
+
+    stretch = orthogonal = MatrixIdentity();
+    float* stretchRow = &stretch.e00;
+    float* orthogonalRow = &orthogonal.e00;
+    for (int i = 0; i < 3; ++i, stretchRow += 4, orthogonalRow += 4)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            stretchRow[j] = static_cast<float>(0.5 * (s.e[i][j] + s.e[j][i]));
+            orthogonalRow[j] = static_cast<float>(q.e[i][j]);
+        }
+    }
+    return true;
 }
 
 
@@ -283,7 +331,7 @@ void CMatrix4x4::FaceTarget(const CVector3& target)
 
 
 // Return the rotation stored in this matrix as Euler angles
-CVector3 CMatrix4x4::GetEulerAngles()
+CVector3 CMatrix4x4::GetEulerAngles(TrigPolicy policy /*= TrigPolicy::Precise*/)
 {
 	// Calculate matrix scaling
 	float scaleX = sqrt( e00*e00 + e01*e01 + e02*e02 );
@@ -318,19 +366,67 @@ CVector3 CMatrix4x4::GetEulerAngles()
 	    cY =  e00 * invScaleX;
     }
 
-	return { atan2(sX, cX), atan2(sY, cY), atan2(sZ, cZ) };
+	return { Atan2(sX, cX, policy), Atan2(sY, cY, policy), Atan2(sZ, cZ, policy) };
 }
 
 
+// Make the x, y and z axes unit length and at right angles. Returns false if the y and z axes are parallel or either is zero length
+bool CMatrix4x4::Orthonormalise()
+{
+    CVector3 axisZ = Normalise(GetZAxis());
+    CVector3 axisX = Normalise(Cross(GetYAxis(), axisZ));
+    if (IsZero(Length(axisZ)) || IsZero(Length(axisX)))  return false;
+    CVector3 axisY = Cross(axisZ, axisX); // Will already be normalised
+
+    SetRow(0, axisX);
+    SetRow(1, axisY);
+    SetRow(2, axisZ);
+    return true;
+}
 
-// Transpose the matrix (rows become columns). There are two ways to store a matrix, by rows or by columns.
-// Different apps use different methods. Use Transpose to swap when necessary.
-void CMatrix4x4::Transpose()
+
+/*-----------------------------------------------------------------------------------------
+    Compile-time tests
+-----------------------------------------------------------------------------------------*/
+// These fail to compile if the constexpr functions give wrong results
+
+static constexpr bool Near(float a, float b, float tolerance = 1e-6f)
 {
-    std::swap(e01, e10);
-    std::swap(e02, e20);
-    std::swap(e03, e30);
-    std::swap(e12, e21);
-    std::swap(e13, e31);
-    std::swap(e23, e32);
+    return a - b < tolerance && b - a < tolerance;
 }
+
+static constexpr bool Near(const CMatrix4x4& m1, const CMatrix4x4& m2, float tolerance = 1e-6f)
+{
+    return Near(m1.e00, m2.e00, tolerance) && Near(m1.e01, m2.e01, tolerance) && Near(m1.e02, m2.e02, tolerance) && Near(m1.e03, m2.e03, tolerance) &&
+           Near(m1.e10, m2.e10, tolerance) && Near(m1.e11, m2.e11, tolerance) && Near(m1.e12, m2.e12, tolerance) && Near(m1.e13, m2.e13, tolerance) &&
+           Near(m1.e20, m2.e20, tolerance) && Near(m1.e21, m2.e21, tolerance) && Near(m1.e22, m2.e22, tolerance) && Near(m1.e23, m2.e23, tolerance) &&
+           Near(m1.e30, m2.e30, tolerance) && Near(m1.e31, m2.e31, tolerance) && Near(m1.e32, m2.e32, tolerance) && Near(m1.e33, m2.e33, tolerance);
+}
+
+// Sine and cosine
+static_assert(Near(ConstexprSin(0.0f), 0.0f) && Near(ConstexprCos(0.0f), 1.0f), "ConstexprSin/Cos of 0");
+static_assert(Near(ConstexprSin(PI / 6), 0.5f) && Near(ConstexprCos(PI / 3), 0.5f), "ConstexprSin/Cos of 30/60 degrees");
+static_assert(Near(ConstexprSin(ToRadians(90.0f)), 1.0f) && Near(ConstexprCos(PI), -1.0f), "ConstexprSin/Cos of 90/180 degrees");
+static_assert(Near(ConstexprSin(ToRadians(-750.0f)), -0.5f), "ConstexprSin range reduction");
+static_assert(Near(ConstexprTan(PI / 4), 1.0f), "ConstexprTan of 45 degrees");
+
+// Matrices
+constexpr CMatrix4x4 testTranslation = MatrixTranslation({ 1.0f, 2.0f, 3.0f });
+static_assert(Near(MatrixMultiplyScalar(MatrixIdentity(), testTranslation), testTranslation), "Identity * translation");
+static_assert(MatrixTransposeScalar(testTranslation).e03 == 1.0f && MatrixTransposeScalar(testTranslation).e30 == 0.0f, "Transpose");
+static_assert(MatrixTransformScalar({ 1.0f, 1.0f, 1.0f, 1.0f }, MatrixMultiplyScalar(MatrixScaling(2.0f), testTranslation)).z == 5.0f,
+              "Transform point by scaling * translation");
+
+constexpr CMatrix4x4 testRotation = ConstexprMatrixRotationY(ToRadians(90.0f));
+static_assert(Near(MatrixTransformScalar({ 1.0f, 0.0f, 0.0f, 0.0f }, testRotation).z, -1.0f), "Rotate x axis 90 degrees around y");
+
+constexpr CMatrix4x4 testAffine = MatrixMultiplyScalar(MatrixMultiplyScalar(ConstexprMatrixRotationX(0.5f), ConstexprMatrixRotationZ(1.2f)),
+                                                       testTranslation);
+static_assert(Near(MatrixMultiplyScalar(testAffine, InverseAffine(testAffine)), MatrixIdentity()), "InverseAffine");
+static_assert(Near(MatrixMultiplyScalar(MatrixTransposeScalar(testRotation), testRotation), MatrixIdentity()), "Rotations are orthogonal");
+
+constexpr CMatrix4x4 testProjection = { 1.3f, 0, 0, 0,   0, 1.7f, 0, 0,   0, 0, 1.0001f, 1,   0, 0, -0.10001f, 0 };
+static_assert(Near(MatrixMultiplyScalar(testAffine, MatrixInverseScalar(testAffine)), MatrixIdentity()), "General inverse");
+static_assert(Near(MatrixMultiplyScalar(testProjection, MatrixInverseScalar(testProjection)), MatrixIdentity(), 1e-5f), "Inverse projection");
+static_assert(Near(DeterminantScalar(MatrixScaling({ 2.0f, 3.0f, -4.0f })), -24.0f), "Determinant of scaling");
+static_assert(DeterminantScalar(MatrixScaling({ 1.0f, 0.0f, 1.0f })) == 0.0f, "Determinant of flattening");
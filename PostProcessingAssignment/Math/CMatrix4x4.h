@@ -1,18 +1,24 @@
 //--------------------------------------------------------------------------------------
 // Matrix4x4 class (cut down version) to hold matrices for 3D
 //--------------------------------------------------------------------------------------
-// Code in .cpp file
+// Code in .cpp file, except constexpr functions which are here so they can be used for compile-time constants, and the
+// multiply, transform and transpose, which are here so they inline as well as the scalar versions do
+//
+// Rows are stored 16-byte aligned so products, transposes and vector transforms can work on a
+// whole row at a time with SIMD instructions (see MathSIMD.h for the choice of instruction set)
 
 #ifndef _CMATRIX4X4_H_DEFINED_
 #define _CMATRIX4X4_H_DEFINED_
 
 #include "CVector3.h"
 #include "CVector4.h"
+#include "MathSIMD.h"
 #include <cmath>
+#include <cstring>
 
 
-// Matrix class
-class CMatrix4x4
+// Matrix class. Still 16 floats with no padding, so it can be copied straight into constant buffers
+class alignas(16) CMatrix4x4
 {
 // Concrete class - public access
 public:
@@ -35,8 +41,8 @@ public:
     // Can be used to access position or x,y,z axes from a matrix
     CVector3 GetRow(int iRow) const;
 
-    // Initialise this matrix with a pointer to 16 floats 
-    void SetValues(float* matrixValues)  { *this = *reinterpret_cast<CMatrix4x4*>(matrixValues); }
+    // Initialise this matrix with a pointer to 16 floats. They don't need to be aligned
+    void SetValues(const float* matrixValues)  { std::memcpy(this, matrixValues, sizeof(CMatrix4x4)); }
 
  
     // Helper functions
@@ -44,7 +50,7 @@ public:
     CVector3 GetYAxis() const { return GetRow(1); }
     CVector3 GetZAxis() const { return GetRow(2); }
     CVector3 GetPosition() const  { return GetRow(3); }
-    CVector3 GetEulerAngles();
+    CVector3 GetEulerAngles(TrigPolicy policy = TrigPolicy::Precise);
     CVector3 GetScale() const  { return { Length(GetXAxis()), Length(GetYAxis()) , Length(GetZAxis()) }; }
 
     
@@ -66,18 +72,298 @@ public:
     // Transpose the matrix (rows become columns). There are two ways to store a matrix, by rows or by columns.
     // Different apps use different methods. Use Transpose to swap when necessary.
     void Transpose();
+
+
+    // Make the x, y and z axes (rows 0-2) unit length and at right angles, removing scale and shear and the drift from many
+    // small rotations. The z axis keeps its direction, then the x axis is made perpendicular to the y and z axes as FaceTarget
+    // does, so a mirrored matrix loses its mirroring. Position and the fourth column are unchanged. Returns false, leaving the
+    // matrix unchanged, if the y and z axes are parallel or either is zero length
+    bool Orthonormalise();
 };
 
 
+/*-----------------------------------------------------------------------------------------
+  Scalar versions
+-----------------------------------------------------------------------------------------*/
+// Plain C++ versions of the operations below, whatever MATH_SIMD is. The SIMD versions add
+// up in the same order so give exactly the same results, these are kept to check that and to
+// time them against (see MatrixBenchmark.h). Both are inline, so neither pays for a call.
+// They are constexpr so can also combine matrices at compile time, e.g.
+//     constexpr CMatrix4x4 m = MatrixMultiplyScalar(MatrixScaling(3.0f), MatrixTranslation({ 10.0f, -10.0f, 20.0f }));
+
+// Matrix-matrix multiplication
+constexpr CMatrix4x4 MatrixMultiplyScalar(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    CMatrix4x4 mOut{};
+
+    mOut.e00 = m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20 + m1.e03*m2.e30;
+    mOut.e01 = m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21 + m1.e03*m2.e31;
+    mOut.e02 = m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22 + m1.e03*m2.e32;
+    mOut.e03 = m1.e00*m2.e03 + m1.e01*m2.e13 + m1.e02*m2.e23 + m1.e03*m2.e33;
+
+    mOut.e10 = m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20 + m1.e13*m2.e30;
+    mOut.e11 = m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21 + m1.e13*m2.e31;
+    mOut.e12 = m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22 + m1.e13*m2.e32;
+    mOut.e13 = m1.e10*m2.e03 + m1.e11*m2.e13 + m1.e12*m2.e23 + m1.e13*m2.e33;
+
+    mOut.e20 = m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20 + m1.e23*m2.e30;
+    mOut.e21 = m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21 + m1.e23*m2.e31;
+    mOut.e22 = m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22 + m1.e23*m2.e32;
+    mOut.e23 = m1.e20*m2.e03 + m1.e21*m2.e13 + m1.e22*m2.e23 + m1.e23*m2.e33;
+
+    mOut.e30 = m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m1.e33*m2.e30;
+    mOut.e31 = m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m1.e33*m2.e31;
+    mOut.e32 = m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m1.e33*m2.e32;
+    mOut.e33 = m1.e30*m2.e03 + m1.e31*m2.e13 + m1.e32*m2.e23 + m1.e33*m2.e33;
+
+    return mOut;
+}
+
+// Return the given CVector4 transformed by the given matrix
+constexpr CVector4 MatrixTransformScalar(const CVector4& v, const CMatrix4x4& m)
+{
+	return { v.x * m.e00 + v.y * m.e10 + v.z * m.e20 + v.w * m.e30,
+	         v.x * m.e01 + v.y * m.e11 + v.z * m.e21 + v.w * m.e31,
+	         v.x * m.e02 + v.y * m.e12 + v.z * m.e22 + v.w * m.e32,
+	         v.x * m.e03 + v.y * m.e13 + v.z * m.e23 + v.w * m.e33 };
+}
+
+// Return the transpose of the given matrix
+constexpr CMatrix4x4 MatrixTransposeScalar(const CMatrix4x4& m)
+{
+    return CMatrix4x4{ m.e00, m.e10, m.e20, m.e30,
+                       m.e01, m.e11, m.e21, m.e31,
+                       m.e02, m.e12, m.e22, m.e32,
+                       m.e03, m.e13, m.e23, m.e33 };
+}
+
+// Return the adjugate of the given matrix, the transpose of its matrix of cofactors, which is the inverse times the determinant.
+// Uses the 2x2 determinants of rows 0-1 and rows 2-3, sharing them between the cofactors
+constexpr CMatrix4x4 MatrixAdjugateScalar(const CMatrix4x4& m)
+{
+    // 2x2 determinants of columns i and j of rows 0-1 (sij) and rows 2-3 (cij)
+    float s01 = m.e00*m.e11 - m.e10*m.e01,  c01 = m.e20*m.e31 - m.e30*m.e21;
+    float s02 = m.e00*m.e12 - m.e10*m.e02,  c02 = m.e20*m.e32 - m.e30*m.e22;
+    float s03 = m.e00*m.e13 - m.e10*m.e03,  c03 = m.e20*m.e33 - m.e30*m.e23;
+    float s12 = m.e01*m.e12 - m.e11*m.e02,  c12 = m.e21*m.e32 - m.e31*m.e22;
+    float s13 = m.e01*m.e13 - m.e11*m.e03,  c13 = m.e21*m.e33 - m.e31*m.e23;
+    float s23 = m.e02*m.e13 - m.e12*m.e03,  c23 = m.e22*m.e33 - m.e32*m.e23;
+
+    return CMatrix4x4{  m.e11*c23 - m.e12*c13 + m.e13*c12,  -(m.e01*c23 - m.e02*c13 + m.e03*c12),
+                       m.e31*s23 - m.e32*s13 + m.e33*s12,  -(m.e21*s23 - m.e22*s13 + m.e23*s12),
+                     -(m.e10*c23 - m.e12*c03 + m.e13*c02),   m.e00*c23 - m.e02*c03 + m.e03*c02,
+                     -(m.e30*s23 - m.e32*s03 + m.e33*s02),   m.e20*s23 - m.e22*s03 + m.e23*s02,
+                       m.e10*c13 - m.e11*c03 + m.e13*c01,  -(m.e00*c13 - m.e01*c03 + m.e03*c01),
+                       m.e30*s13 - m.e31*s03 + m.e33*s01,  -(m.e20*s13 - m.e21*s03 + m.e23*s01),
+                     -(m.e10*c12 - m.e11*c02 + m.e12*c01),   m.e00*c12 - m.e01*c02 + m.e02*c01,
+                     -(m.e30*s12 - m.e31*s02 + m.e32*s01),   m.e20*s12 - m.e21*s02 + m.e22*s01 };
+}
+
+// Return the determinant of the given matrix, row 0 times column 0 of the adjugate
+constexpr float DeterminantScalar(const CMatrix4x4& m)
+{
+    CMatrix4x4 adjugate = MatrixAdjugateScalar(m);
+    return m.e00*adjugate.e00 + m.e01*adjugate.e10 + m.e02*adjugate.e20 + m.e03*adjugate.e30;
+}
+
+// Return the inverse of the given matrix. There is no check for a determinant of 0 (which gives infinities), Inverse below has one
+constexpr CMatrix4x4 MatrixInverseScalar(const CMatrix4x4& m)
+{
+    CMatrix4x4 a = MatrixAdjugateScalar(m);
+    float invDet = 1.0f / (m.e00*a.e00 + m.e01*a.e10 + m.e02*a.e20 + m.e03*a.e30);
+
+    return CMatrix4x4{ a.e00 * invDet, a.e01 * invDet, a.e02 * invDet, a.e03 * invDet,
+                       a.e10 * invDet, a.e11 * invDet, a.e12 * invDet, a.e13 * invDet,
+                       a.e20 * invDet, a.e21 * invDet, a.e22 * invDet, a.e23 * invDet,
+                       a.e30 * invDet, a.e31 * invDet, a.e32 * invDet, a.e33 * invDet };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    SIMD helpers
+-----------------------------------------------------------------------------------------*/
+// A row vector times a matrix is the sum of the matrix rows scaled by each element of the vector.
+// The rows are added in the same order as the scalar code with separate multiplies and adds
+// (not fused multiply-adds, which round differently), so the results are exactly the same.
+//
+// These and the operators using them are inline: a call to an out-of-line function costs more
+// than a single transform or transpose, and stops the compiler keeping matrices in registers
+// across a loop, so out-of-line SIMD versions were slower than the inline scalar versions
+
+#if MATH_SIMD == MATH_SIMD_SSE2 || MATH_SIMD == MATH_SIMD_AVX
+
+// Return row vector v times the matrix with rows r0-r3
+inline __m128 MatrixMultiplyRowSIMD(__m128 v, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+    __m128 out =            _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+    out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+    out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+    out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+    return out;
+}
+
+#endif
+
+#if MATH_SIMD == MATH_SIMD_AVX
+
+// As above on two row vectors at once, one in each half of v. Each of r0-r3 holds a matrix row twice
+inline __m256 MatrixMultiplyTwoRowsSIMD(__m256 v, __m256 r0, __m256 r1, __m256 r2, __m256 r3)
+{
+    __m256 out =               _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+    out = _mm256_add_ps(out, _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+    out = _mm256_add_ps(out, _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+    out = _mm256_add_ps(out, _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+    return out;
+}
+
+#elif MATH_SIMD == MATH_SIMD_NEON
+
+// Return row vector v times the matrix with rows r0-r3
+inline float32x4_t MatrixMultiplyRowSIMD(float32x4_t v, float32x4_t r0, float32x4_t r1, float32x4_t r2, float32x4_t r3)
+{
+    float32x4_t out =           vmulq_n_f32(r0, vgetq_lane_f32(v, 0));
+    out = vaddq_f32(out, vmulq_n_f32(r1, vgetq_lane_f32(v, 1)));
+    out = vaddq_f32(out, vmulq_n_f32(r2, vgetq_lane_f32(v, 2)));
+    out = vaddq_f32(out, vmulq_n_f32(r3, vgetq_lane_f32(v, 3)));
+    return out;
+}
+
+#endif
+
+
+// Set mOut to m1 * m2. Everything is loaded before anything is stored so mOut can be m1 or m2
+inline void MatrixMultiply(const CMatrix4x4& m1, const CMatrix4x4& m2, CMatrix4x4& mOut)
+{
+#if MATH_SIMD == MATH_SIMD_AVX
+    // Two rows of the result at a time. The rows of m1 are loaded separately, as a matrix just written a row at a time can't
+    // be forwarded from the stores to a single 256-bit load, which then waits for the stores to finish. The 256-bit stores need
+    // not be 32-byte aligned
+    __m256 m1Rows01 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&m1.e00)), _mm_load_ps(&m1.e10), 1);
+    __m256 m1Rows23 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&m1.e20)), _mm_load_ps(&m1.e30), 1);
+    __m256 r0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e00));
+    __m256 r1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e10));
+    __m256 r2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e20));
+    __m256 r3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e30));
+    __m256 out01 = MatrixMultiplyTwoRowsSIMD(m1Rows01, r0, r1, r2, r3);
+    __m256 out23 = MatrixMultiplyTwoRowsSIMD(m1Rows23, r0, r1, r2, r3);
+
+    _mm256_storeu_ps(&mOut.e00, out01);
+    _mm256_storeu_ps(&mOut.e20, out23);
+
+#elif MATH_SIMD == MATH_SIMD_SSE2
+    __m128 r0 = _mm_load_ps(&m2.e00);
+    __m128 r1 = _mm_load_ps(&m2.e10);
+    __m128 r2 = _mm_load_ps(&m2.e20);
+    __m128 r3 = _mm_load_ps(&m2.e30);
+    __m128 out0 = MatrixMultiplyRowSIMD(_mm_load_ps(&m1.e00), r0, r1, r2, r3);
+    __m128 out1 = MatrixMultiplyRowSIMD(_mm_load_ps(&m1.e10), r0, r1, r2, r3);
+    __m128 out2 = MatrixMultiplyRowSIMD(_mm_load_ps(&m1.e20), r0, r1, r2, r3);
+    __m128 out3 = MatrixMultiplyRowSIMD(_mm_load_ps(&m1.e30), r0, r1, r2, r3);
+
+    _mm_store_ps(&mOut.e00, out0);
+    _mm_store_ps(&mOut.e10, out1);
+    _mm_store_ps(&mOut.e20, out2);
+    _mm_store_ps(&mOut.e30, out3);
+
+#elif MATH_SIMD == MATH_SIMD_NEON
+    float32x4_t r0 = vld1q_f32(&m2.e00);
+    float32x4_t r1 = vld1q_f32(&m2.e10);
+    float32x4_t r2 = vld1q_f32(&m2.e20);
+    float32x4_t r3 = vld1q_f32(&m2.e30);
+    float32x4_t out0 = MatrixMultiplyRowSIMD(vld1q_f32(&m1.e00), r0, r1, r2, r3);
+    float32x4_t out1 = MatrixMultiplyRowSIMD(vld1q_f32(&m1.e10), r0, r1, r2, r3);
+    float32x4_t out2 = MatrixMultiplyRowSIMD(vld1q_f32(&m1.e20), r0, r1, r2, r3);
+    float32x4_t out3 = MatrixMultiplyRowSIMD(vld1q_f32(&m1.e30), r0, r1, r2, r3);
+
+    vst1q_f32(&mOut.e00, out0);
+    vst1q_f32(&mOut.e10, out1);
+    vst1q_f32(&mOut.e20, out2);
+    vst1q_f32(&mOut.e30, out3);
+
+#else
+    mOut = MatrixMultiplyScalar(m1, m2);
+#endif
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Inline member functions
+-----------------------------------------------------------------------------------------*/
+
+// Post-multiply this matrix by the given one
+inline CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
+{
+    MatrixMultiply(*this, m, *this);
+    return *this;
+}
+
+
+// Transpose the matrix (rows become columns). There are two ways to store a matrix, by rows or by columns.
+// Different apps use different methods. Use Transpose to swap when necessary.
+// With AVX the compiler's own code for the scalar version is faster than the SSE2 shuffles (see BenchmarkMatrixOps)
+inline void CMatrix4x4::Transpose()
+{
+#if MATH_SIMD == MATH_SIMD_SSE2
+    __m128 r0 = _mm_load_ps(&e00);
+    __m128 r1 = _mm_load_ps(&e10);
+    __m128 r2 = _mm_load_ps(&e20);
+    __m128 r3 = _mm_load_ps(&e30);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_store_ps(&e00, r0);
+    _mm_store_ps(&e10, r1);
+    _mm_store_ps(&e20, r2);
+    _mm_store_ps(&e30, r3);
+
+#elif MATH_SIMD == MATH_SIMD_NEON
+    // The interleaved load reads every fourth float into each register, i.e. the columns
+    float32x4x4_t columns = vld4q_f32(&e00);
+    vst1q_f32(&e00, columns.val[0]);
+    vst1q_f32(&e10, columns.val[1]);
+    vst1q_f32(&e20, columns.val[2]);
+    vst1q_f32(&e30, columns.val[3]);
+
+#else
+    *this = MatrixTransposeScalar(*this);
+#endif
+}
+
+
 /*-----------------------------------------------------------------------------------------
     Non-member Operators
 -----------------------------------------------------------------------------------------*/
 
 // Matrix-matrix multiplication
-CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2);
+inline CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    CMatrix4x4 mOut;
+    MatrixMultiply(m1, m2, mOut);
+    return mOut;
+}
 
 // Return the given CVector4 transformed by the given matrix
-CVector4 operator*(const CVector4& v, const CMatrix4x4& m);
+inline CVector4 operator*(const CVector4& v, const CMatrix4x4& m)
+{
+    // CVector4s are not aligned so use unaligned loads and stores for them
+    CVector4 vOut;
+#if MATH_SIMD == MATH_SIMD_SSE2 || MATH_SIMD == MATH_SIMD_AVX
+    __m128 out = MatrixMultiplyRowSIMD(_mm_loadu_ps(&v.x), _mm_load_ps(&m.e00), _mm_load_ps(&m.e10), _mm_load_ps(&m.e20), _mm_load_ps(&m.e30));
+    _mm_storeu_ps(&vOut.x, out);
+
+#elif MATH_SIMD == MATH_SIMD_NEON
+    float32x4_t out = MatrixMultiplyRowSIMD(vld1q_f32(&v.x), vld1q_f32(&m.e00), vld1q_f32(&m.e10), vld1q_f32(&m.e20), vld1q_f32(&m.e30));
+    vst1q_f32(&vOut.x, out);
+
+#else
+    vOut = MatrixTransformScalar(v, m);
+#endif
+    return vOut;
+}
+
+// Return the given CVector4 transformed by this matrix
+inline CVector4 CMatrix4x4::operator*=(const CVector4& v)
+{
+    return v * *this;
+}
 
 
 /*-----------------------------------------------------------------------------------------
@@ -87,35 +373,151 @@ CVector4 operator*(const CVector4& v, const CMatrix4x4& m);
 // The following functions create a new matrix holding a particular transformation
 // They can be used as temporaries in calculations, e.g.
 //     CMatrix4x4 m = MatrixScaling( 3.0f ) * MatrixTranslation( CVector3(10.0f, -10.0f, 20.0f) );
+// Those that are constexpr can also be used for compile-time constants
 
 // Return an identity matrix
-CMatrix4x4 MatrixIdentity();
+constexpr CMatrix4x4 MatrixIdentity()
+{
+    return CMatrix4x4{ 1, 0, 0, 0,
+                       0, 1, 0, 0,
+                       0, 0, 1, 0,
+                       0, 0, 0, 1 };
+}
 
 // Return a translation matrix of the given vector
-CMatrix4x4 MatrixTranslation(const CVector3& t);
+constexpr CMatrix4x4 MatrixTranslation(const CVector3& t)
+{
+    return CMatrix4x4  { 1,   0,   0,  0,
+                         0,   1,   0,  0,
+                         0,   0,   1,  0,
+                       t.x, t.y, t.z,  1 };
+}
 
 
-// Return an X-axis rotation matrix of the given angle (in radians)
-CMatrix4x4 MatrixRotationX(float x);
+// Return an X-axis rotation matrix of the given angle (in radians). Pass TrigPolicy::Fast to use the faster sine and cosine
+// in FastTrig.h, e.g. for animation each frame
+CMatrix4x4 MatrixRotationX(float x, TrigPolicy policy = TrigPolicy::Precise);
 
 // Return a Y-axis rotation matrix of the given angle (in radians)
-CMatrix4x4 MatrixRotationY(float y);
+CMatrix4x4 MatrixRotationY(float y, TrigPolicy policy = TrigPolicy::Precise);
 
 // Return a Z-axis rotation matrix of the given angle (in radians)
-CMatrix4x4 MatrixRotationZ(float z);
+CMatrix4x4 MatrixRotationZ(float z, TrigPolicy policy = TrigPolicy::Precise);
+
+
+// Compile-time versions of the rotation matrices above, for constant angles (see ConstexprSin)
+constexpr CMatrix4x4 ConstexprMatrixRotationX(float x)
+{
+    float sX = ConstexprSin(x);
+    float cX = ConstexprCos(x);
+
+    return CMatrix4x4{ 1,   0,   0,  0,
+                       0,  cX,  sX,  0,
+                       0, -sX,  cX,  0,
+                       0,   0,   0,  1 };
+}
+
+constexpr CMatrix4x4 ConstexprMatrixRotationY(float y)
+{
+    float sY = ConstexprSin(y);
+    float cY = ConstexprCos(y);
+
+    return CMatrix4x4{ cY,   0, -sY,  0,
+                        0,   1,   0,  0,
+                       sY,   0,  cY,  0,
+                        0,   0,   0,  1 };
+}
+
+constexpr CMatrix4x4 ConstexprMatrixRotationZ(float z)
+{
+    float sZ = ConstexprSin(z);
+    float cZ = ConstexprCos(z);
+
+    return CMatrix4x4{ cZ,  sZ,  0,  0,
+                      -sZ,  cZ,  0,  0,
+                        0,   0,  1,  0,
+                        0,   0,  0,  1 };
+}
 
 
 // Return a matrix that is a scaling in X,Y and Z of the values in the given vector
-CMatrix4x4 MatrixScaling(const CVector3& s);
+constexpr CMatrix4x4 MatrixScaling(const CVector3& s)
+{
+    return CMatrix4x4{ s.x,   0,   0,  0,
+                       0,   s.y,   0,  0,
+                       0,     0, s.z,  0,
+                       0,     0,   0,  1 };
+}
 
 // Return a matrix that is a uniform scaling of the given amount
-CMatrix4x4 MatrixScaling(const float s);
+constexpr CMatrix4x4 MatrixScaling(const float s)
+{
+    return CMatrix4x4{ s, 0, 0, 0,
+                       0, s, 0, 0,
+                       0, 0, s, 0,
+                       0, 0, 0, 1 };
+}
 
 
 
 // Return the inverse of given matrix assuming that it is an affine matrix
 // Advanced calulation needed to get the view matrix from the camera's positioning matrix
-CMatrix4x4 InverseAffine(const CMatrix4x4& m);
+// There is no check for a determinant of 0, use Inverse below if the matrix might have no inverse (e.g. a scale of 0)
+constexpr CMatrix4x4 InverseAffine(const CMatrix4x4& m)
+{
+    CMatrix4x4 mOut{};
+
+    // Calculate determinant of upper left 3x3
+    float det0 = m.e11*m.e22 - m.e12*m.e21;
+    float det1 = m.e12*m.e20 - m.e10*m.e22;
+    float det2 = m.e10*m.e21 - m.e11*m.e20;
+    float det = m.e00*det0 + m.e01*det1 + m.e02*det2;
+
+    // Calculate inverse of upper left 3x3
+    float invDet = 1.0f / det;
+    mOut.e00 = invDet * det0;
+    mOut.e10 = invDet * det1;
+    mOut.e20 = invDet * det2;
+
+    mOut.e01 = invDet * (m.e21*m.e02 - m.e22*m.e01);
+    mOut.e11 = invDet * (m.e22*m.e00 - m.e20*m.e02);
+    mOut.e21 = invDet * (m.e20*m.e01 - m.e21*m.e00);
+
+    mOut.e02 = invDet * (m.e01*m.e12 - m.e02*m.e11);
+    mOut.e12 = invDet * (m.e02*m.e10 - m.e00*m.e12);
+    mOut.e22 = invDet * (m.e00*m.e11 - m.e01*m.e10);
+
+    // Transform negative translation by inverted 3x3 to get inverse
+    mOut.e30 = -m.e30*mOut.e00 - m.e31*mOut.e10 - m.e32*mOut.e20;
+    mOut.e31 = -m.e30*mOut.e01 - m.e31*mOut.e11 - m.e32*mOut.e21;
+    mOut.e32 = -m.e30*mOut.e02 - m.e31*mOut.e12 - m.e32*mOut.e22;
+
+    // Fill in right column for affine matrix
+    mOut.e03 = 0.0f;
+    mOut.e13 = 0.0f;
+    mOut.e23 = 0.0f;
+    mOut.e33 = 1.0f;
+
+    return mOut;
+}
+
+
+// Return the determinant of the given matrix. The same value as DeterminantScalar
+float Determinant(const CMatrix4x4& m);
+
+// Set inverse to the inverse of any matrix, including projection matrices, and return true. Gives exactly the same result as
+// MatrixInverseScalar. Returns false, leaving inverse unchanged, if the matrix has no inverse or is too close to having none for
+// a useful result in floats: when the size of the determinant is no more than tolerance times the product of the lengths of the
+// rows, the largest it could be for those rows
+bool Inverse(const CMatrix4x4& m, CMatrix4x4& inverse, float tolerance = 1e-6f);
+
+
+// Split the upper-left 3x3 of the given matrix into a symmetric stretch (scale and shear) followed by an orthogonal matrix,
+// m = stretch * orthogonal (the polar decomposition). The orthogonal matrix is the rotation closest to m, or a rotation and
+// mirror if m is mirrored (negative determinant), so is the best rotation to take from a sheared matrix. Both outputs have the
+// identity in row 3 and column 3. Returns false, leaving the outputs unchanged, if the 3x3 has no inverse or is too close to
+// having none, by the same test as Inverse with the default tolerance
+bool PolarDecompose(const CMatrix4x4& m, CMatrix4x4& stretch, CMatrix4x4& orthogonal);
 
 
 #endif // _CMATRIX4X4_H_DEFINED_
@@ -0,0 +1,184 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version), to hold rotations
+//--------------------------------------------------------------------------------------
+
+#include "CQuaternion.h"
+#include "FastTrig.h"
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the rotation as a matrix. The quaternion must be unit length
+CMatrix4x4 CQuaternion::GetMatrix() const
+{
+    CVector3 axisX = GetXAxis();
+    CVector3 axisY = GetYAxis();
+    CVector3 axisZ = GetZAxis();
+    return CMatrix4x4{ axisX.x, axisX.y, axisX.z, 0,
+                       axisY.x, axisY.y, axisY.z, 0,
+                       axisZ.x, axisZ.y, axisZ.z, 0,
+                             0,       0,       0, 1 };
+}
+
+
+// Return the X, Y and Z angles of the rotation (in radians), as used by QuaternionRotationEuler
+CVector3 CQuaternion::GetEulerAngles(TrigPolicy policy /*= TrigPolicy::Precise*/) const
+{
+    // Same method as CMatrix4x4::GetEulerAngles, using only the matrix elements needed. They have no scaling to remove, and the
+    // cos(X) divisions cancel out inside atan2
+    float sX = -2 * (y*z - x*w); // -e21
+    if (sX > 1.0f)   sX = 1.0f;  // Rounding can take it just past 1 near gimbal lock
+    if (sX < -1.0f)  sX = -1.0f;
+    float cX = std::sqrt(1.0f - sX*sX);
+
+    // If no gimbal lock...
+    if (cX > 0.001f)
+    {
+        return { Atan2(sX, cX, policy), Atan2(2 * (x*z + y*w), 1 - 2 * (x*x + y*y), policy),   // atan2(e20, e22)
+                                        Atan2(2 * (x*y + z*w), 1 - 2 * (x*x + z*z), policy) }; // atan2(e01, e11)
+    }
+    else
+    {
+        // Gimbal lock - force Z angle to 0
+        return { Atan2(sX, cX, policy), Atan2(-2 * (x*z - y*w), 1 - 2 * (y*y + z*z), policy), 0.0f }; // atan2(-e02, e00)
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return a rotation around the X, Y or Z axis of the given angle (in radians)
+CQuaternion QuaternionRotationX(float x, TrigPolicy policy /*= TrigPolicy::Precise*/)
+{
+    float s, c;
+    SinCos(x * 0.5f, s, c, policy);
+    return { s, 0, 0, c };
+}
+
+CQuaternion QuaternionRotationY(float y, TrigPolicy policy /*= TrigPolicy::Precise*/)
+{
+    float s, c;
+    SinCos(y * 0.5f, s, c, policy);
+    return { 0, s, 0, c };
+}
+
+CQuaternion QuaternionRotationZ(float z, TrigPolicy policy /*= TrigPolicy::Precise*/)
+{
+    float s, c;
+    SinCos(z * 0.5f, s, c, policy);
+    return { 0, 0, s, c };
+}
+
+
+// Return a rotation of the given angle (in radians) around the given unit-length axis
+CQuaternion QuaternionRotationAxis(const CVector3& axis, float angle, TrigPolicy policy /*= TrigPolicy::Precise*/)
+{
+    float s, c;
+    SinCos(angle * 0.5f, s, c, policy);
+    return { axis.x * s, axis.y * s, axis.z * s, c };
+}
+
+
+// Return the rotation of the given X, Y and Z angles (in radians). Same rotation as
+// MatrixRotationZ(z) * MatrixRotationX(x) * MatrixRotationY(y)
+CQuaternion QuaternionRotationEuler(const CVector3& angles, TrigPolicy policy /*= TrigPolicy::Precise*/)
+{
+    // QuaternionRotationZ(z) * QuaternionRotationX(x) * QuaternionRotationY(y) multiplied out, most terms are zero
+    float sX, cX, sY, cY, sZ, cZ;
+    SinCos(angles.x * 0.5f, sX, cX, policy);
+    SinCos(angles.y * 0.5f, sY, cY, policy);
+    SinCos(angles.z * 0.5f, sZ, cZ, policy);
+    return { cY * sX * cZ + sY * cX * sZ,
+             sY * cX * cZ - cY * sX * sZ,
+             cY * cX * sZ - sY * sX * cZ,
+             cY * cX * cZ + sY * sX * sZ };
+}
+
+
+// Return the rotation in a matrix holding rotation only, or rotation and scaling (not shear)
+CQuaternion QuaternionFromMatrix(const CMatrix4x4& m)
+{
+    // Remove scaling from the axes. A mirrored matrix (negative determinant) has one axis flipped back to make a rotation
+    CVector3 axisX = Normalise(m.GetXAxis());
+    CVector3 axisY = Normalise(m.GetYAxis());
+    CVector3 axisZ = Normalise(m.GetZAxis());
+    if (Dot(Cross(axisX, axisY), axisZ) < 0)  axisX = -axisX;
+
+    // Use the largest of w, x, y or z to start with, so there's no division by a small value
+    float trace = axisX.x + axisY.y + axisZ.z;
+    CQuaternion q;
+    if (trace > 0)
+    {
+        float s = 0.5f / std::sqrt(trace + 1.0f);
+        q = { (axisY.z - axisZ.y) * s, (axisZ.x - axisX.z) * s, (axisX.y - axisY.x) * s, 0.25f / s };
+    }
+    else if (axisX.x > axisY.y && axisX.x > axisZ.z)
+    {
+        float s = 2.0f * std::sqrt(1.0f + axisX.x - axisY.y - axisZ.z);
+        q = { 0.25f * s, (axisX.y + axisY.x) / s, (axisX.z + axisZ.x) / s, (axisY.z - axisZ.y) / s };
+    }
+    else if (axisY.y > axisZ.z)
+    {
+        float s = 2.0f * std::sqrt(1.0f + axisY.y - axisX.x - axisZ.z);
+        q = { (axisX.y + axisY.x) / s, 0.25f * s, (axisY.z + axisZ.y) / s, (axisZ.x - axisX.z) / s };
+    }
+    else
+    {
+        float s = 2.0f * std::sqrt(1.0f + axisZ.z - axisX.x - axisY.y);
+        q = { (axisX.z + axisZ.x) / s, (axisY.z + axisZ.y) / s, 0.25f * s, (axisX.y - axisY.x) / s };
+    }
+    return Normalise(q);
+}
+
+
+// Return unit length quaternion of the same rotation
+CQuaternion Normalise(const CQuaternion& q)
+{
+    float lengthSq = Dot(q, q);
+
+    // Ensure quaternion is not zero length (use BaseMath.h float approx. fn with default epsilon)
+    if (IsZero(lengthSq))
+    {
+        return QuaternionIdentity();
+    }
+    else
+    {
+        float invLength = InvSqrt(lengthSq);
+        return { q.x * invLength, q.y * invLength, q.z * invLength, q.w * invLength };
+    }
+}
+
+
+// Interpolate between two unit quaternions by the shorter way round at a steady speed
+CQuaternion Slerp(const CQuaternion& q1, const CQuaternion& q2, float t)
+{
+    // q and -q are the same rotation, pick the one nearer q1 to go the shorter way round
+    float cosAngle = Dot(q1, q2);
+    float sign = 1.0f;
+    if (cosAngle < 0)
+    {
+        cosAngle = -cosAngle;
+        sign = -1.0f;
+    }
+
+    // Nearly the same rotation - sin(angle) is too small to divide by, but a straight line is close enough
+    if (cosAngle > 0.9995f)  return Nlerp(q1, q2, t);
+
+    float angle = std::acos(cosAngle);
+    float invSin = 1.0f / std::sin(angle);
+    float w1 = std::sin((1.0f - t) * angle) * invSin;
+    float w2 = std::sin(t * angle) * invSin * sign;
+    return { q1.x * w1 + q2.x * w2, q1.y * w1 + q2.y * w2, q1.z * w1 + q2.z * w2, q1.w * w1 + q2.w * w2 };
+}
+
+// Interpolate between two unit quaternions by the shorter way round, straight line then normalised
+CQuaternion Nlerp(const CQuaternion& q1, const CQuaternion& q2, float t)
+{
+    float w1 = 1.0f - t;
+    float w2 = (Dot(q1, q2) < 0) ? -t : t;
+    return Normalise({ q1.x * w1 + q2.x * w2, q1.y * w1 + q2.y * w2, q1.z * w1 + q2.z * w2, q1.w * w1 + q2.w * w2 });
+}
@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version), to hold rotations
+//--------------------------------------------------------------------------------------
+// Simple operations are constexpr in this file so they can be used for compile-time constants,
+// other code in .cpp file
+//
+// Quaternions rotate the same way as the matrices in CMatrix4x4.h, and are combined in the same
+// order: q1 * q2 is the rotation q1 followed by q2, just like MatrixRotationX(a) * MatrixRotationY(b)
+
+#ifndef _CQUATERNION_H_DEFINED_
+#define _CQUATERNION_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "MathHelpers.h"
+#include <cmath>
+
+class CQuaternion
+{
+// Concrete class - public access
+public:
+    // Quaternion components, x, y and z are the axis of rotation times sin(angle / 2), w is cos(angle / 2)
+    float x;
+    float y;
+    float z;
+    float w;
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance). Value-initialising (CQuaternion{}) sets them to 0,
+    // which is not a rotation, use QuaternionIdentity() for no rotation
+    CQuaternion() = default;
+
+    // Construct with 4 values
+    constexpr CQuaternion(const float xIn, const float yIn, const float zIn, const float wIn) : x(xIn), y(yIn), z(zIn), w(wIn) {}
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // The x, y and z axes of the rotation, i.e. rows 0-2 of the rotation matrix. Cheaper than building the whole matrix
+    constexpr CVector3 GetXAxis() const  { return { 1 - 2 * (y*y + z*z),     2 * (x*y + z*w),     2 * (x*z - y*w) }; }
+    constexpr CVector3 GetYAxis() const  { return {     2 * (x*y - z*w), 1 - 2 * (x*x + z*z),     2 * (y*z + x*w) }; }
+    constexpr CVector3 GetZAxis() const  { return {     2 * (x*z + y*w),     2 * (y*z - x*w), 1 - 2 * (x*x + y*y) }; }
+
+    // Return the rotation as a matrix. The quaternion must be unit length
+    CMatrix4x4 GetMatrix() const;
+
+    // Return the X, Y and Z angles of the rotation (in radians), as used by QuaternionRotationEuler. Gives the same angles as
+    // CMatrix4x4::GetEulerAngles on the rotation matrix, but with no need to remove scaling first
+    CVector3 GetEulerAngles(TrigPolicy policy = TrigPolicy::Precise) const;
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two rotations, the result is rotation q1 followed by q2 (the same order as matrices)
+constexpr CQuaternion operator* (const CQuaternion& q1, const CQuaternion& q2)
+{
+    return { q2.w * q1.x + q2.x * q1.w + q2.y * q1.z - q2.z * q1.y,
+             q2.w * q1.y - q2.x * q1.z + q2.y * q1.w + q2.z * q1.x,
+             q2.w * q1.z + q2.x * q1.y - q2.y * q1.x + q2.z * q1.w,
+             q2.w * q1.w - q2.x * q1.x - q2.y * q1.y - q2.z * q1.z };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return a quaternion of no rotation
+constexpr CQuaternion QuaternionIdentity()
+{
+    return { 0, 0, 0, 1 };
+}
+
+// Dot product of two quaternions, 1 or -1 for unit quaternions of the same rotation
+constexpr float Dot(const CQuaternion& q1, const CQuaternion& q2)
+{
+    return q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+}
+
+// Return the opposite rotation of a unit quaternion
+constexpr CQuaternion Inverse(const CQuaternion& q)
+{
+    return { -q.x, -q.y, -q.z, q.w };
+}
+
+// Return the given vector rotated by a unit quaternion. Same result as multiplying by the rotation matrix
+constexpr CVector3 RotateVector(const CVector3& v, const CQuaternion& q)
+{
+    // v + 2w(u x v) + 2u x (u x v), where u is (x, y, z) of the quaternion
+    CVector3 u = { q.x, q.y, q.z };
+    CVector3 t = 2.0f * Cross(u, v);
+    return v + q.w * t + Cross(u, t);
+}
+
+
+// The functions below taking angles can use the standard library sine and cosine, or the faster ones in FastTrig.h if passed
+// TrigPolicy::Fast
+
+// Return a rotation around the X, Y or Z axis of the given angle (in radians)
+CQuaternion QuaternionRotationX(float x, TrigPolicy policy = TrigPolicy::Precise);
+CQuaternion QuaternionRotationY(float y, TrigPolicy policy = TrigPolicy::Precise);
+CQuaternion QuaternionRotationZ(float z, TrigPolicy policy = TrigPolicy::Precise);
+
+// Return a rotation of the given angle (in radians) around the given unit-length axis
+CQuaternion QuaternionRotationAxis(const CVector3& axis, float angle, TrigPolicy policy = TrigPolicy::Precise);
+
+// Return the rotation of the given X, Y and Z angles (in radians). Same rotation as
+// MatrixRotationZ(z) * MatrixRotationX(x) * MatrixRotationY(y), the order used by models and cameras
+CQuaternion QuaternionRotationEuler(const CVector3& angles, TrigPolicy policy = TrigPolicy::Precise);
+
+// Return the rotation in a matrix holding rotation only, or rotation and scaling (not shear)
+CQuaternion QuaternionFromMatrix(const CMatrix4x4& m);
+
+
+// Return unit length quaternion of the same rotation. Use after combining many rotations to stop rounding errors building up
+CQuaternion Normalise(const CQuaternion& q);
+
+// Interpolate between two unit quaternions by the shorter way round, t = 0 gives q1, t = 1 gives q2. Slerp rotates at a steady
+// speed. Nlerp is quicker but the speed varies a little, which doesn't show for small steps (e.g. between animation keys)
+CQuaternion Slerp(const CQuaternion& q1, const CQuaternion& q2, float t);
+CQuaternion Nlerp(const CQuaternion& q1, const CQuaternion& q2, float t);
+
+
+#endif // _CQUATERNION_H_DEFINED_
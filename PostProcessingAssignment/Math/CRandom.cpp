@@ -0,0 +1,388 @@
+//--------------------------------------------------------------------------------------
+// Random number generator class - counter-based (Philox4x32-10), with independent streams
+//--------------------------------------------------------------------------------------
+
+#include "CRandom.h"
+#include "SIMDPack.h"
+
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+
+/*-----------------------------------------------------------------------------------------
+    Philox4x32-10
+-----------------------------------------------------------------------------------------*/
+// Salmon et al, "Parallel Random Numbers: As Easy as 1, 2, 3" (2011). Ten rounds of multiplies and xors of a 4 x 32-bit
+// counter with a 2 x 32-bit key. The rounds are written once for one block (uint32_t) or 4 or 8 blocks (one per lane of
+// __m128i / __m256i), using the overloaded helpers below
+
+static const uint32_t PhiloxMultiplier0 = 0xD2511F53;
+static const uint32_t PhiloxMultiplier1 = 0xCD9E8D57;
+static const uint32_t PhiloxKeyStep0    = 0x9E3779B9; // Golden ratio
+static const uint32_t PhiloxKeyStep1    = 0xBB67AE85; // sqrt(3) - 1
+
+// High and low 32 bits of a * m
+static inline void MulHiLo(uint32_t a, uint32_t m, uint32_t& hi, uint32_t& lo)
+{
+    uint64_t product = static_cast<uint64_t>(a) * m;
+    hi = static_cast<uint32_t>(product >> 32);
+    lo = static_cast<uint32_t>(product);
+}
+
+static inline void MulHiLo(__m128i a, uint32_t m, __m128i& hi, __m128i& lo)
+{
+    // The multiply instruction takes the even lanes and gives 64-bit products, so multiply the odd lanes shifted down too and
+    // merge the halves of the products
+    __m128i multiplier = _mm_set1_epi32(static_cast<int>(m));
+    __m128i even = _mm_mul_epu32(a, multiplier);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), multiplier);
+    lo = _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+    hi = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+}
+
+static inline void MulHiLo(__m256i a, uint32_t m, __m256i& hi, __m256i& lo)
+{
+    __m256i multiplier = _mm256_set1_epi32(static_cast<int>(m));
+    __m256i even = _mm256_mul_epu32(a, multiplier);
+    __m256i odd  = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), multiplier);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+static inline uint32_t Xor(uint32_t a, uint32_t b, uint32_t key)  { return a ^ b ^ key; }
+static inline __m128i  Xor(__m128i a, __m128i b, uint32_t key)    { return _mm_xor_si128(_mm_xor_si128(a, b), _mm_set1_epi32(static_cast<int>(key))); }
+static inline __m256i  Xor(__m256i a, __m256i b, uint32_t key)    { return _mm256_xor_si256(_mm256_xor_si256(a, b), _mm256_set1_epi32(static_cast<int>(key))); }
+
+// Encrypt the counters c with the key, in place
+template <typename U>
+static inline void Philox(U c[4], const uint32_t key[2])
+{
+    uint32_t key0 = key[0];
+    uint32_t key1 = key[1];
+    for (int round = 0; round < 10; ++round)
+    {
+        U hi0, lo0, hi1, lo1;
+        MulHiLo(c[0], PhiloxMultiplier0, hi0, lo0);
+        MulHiLo(c[2], PhiloxMultiplier1, hi1, lo1);
+        c[0] = Xor(hi1, c[1], key0);
+        c[1] = lo1;
+        c[2] = Xor(hi0, c[3], key1);
+        c[3] = lo0;
+        key0 += PhiloxKeyStep0;
+        key1 += PhiloxKeyStep1;
+    }
+}
+
+// Write the four values of the given block
+static void PhiloxBlock(uint64_t block, uint32_t stream, const uint32_t key[2], uint32_t* out)
+{
+    uint32_t c[4] = { static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), stream, 0 };
+    Philox(c, key);
+    for (int i = 0; i < 4; ++i)  out[i] = c[i];
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Converting and storing
+-----------------------------------------------------------------------------------------*/
+// Floats use the top 24 bits of each value, all a float can hold evenly spaced from 0 to 1
+
+static const float UIntToFloat = 1.0f / 16777216.0f; // 2^-24
+
+static inline void Store(uint32_t* p, uint32_t v, float, float)  { *p = v; }
+static inline void Store(uint32_t* p, __m128i v, float, float)   { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+static inline void Store(uint32_t* p, __m256i v, float, float)   { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+
+// For floats, a + range * (0 to 1)
+static inline float ToFloat(uint32_t v, float a, float range)  { return a + range * (static_cast<float>(v >> 8) * UIntToFloat); }
+static inline void Store(float* p, uint32_t v, float a, float range)  { *p = ToFloat(v, a, range); }
+static inline void Store(float* p, __m128i v, float a, float range)
+{
+    __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(v, 8)), _mm_set1_ps(UIntToFloat));
+    _mm_storeu_ps(p, _mm_add_ps(_mm_set1_ps(a), _mm_mul_ps(_mm_set1_ps(range), f)));
+}
+static inline void Store(float* p, __m256i v, float a, float range)
+{
+    __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(v, 8)), _mm256_set1_ps(UIntToFloat));
+    _mm256_storeu_ps(p, _mm256_add_ps(_mm256_set1_ps(a), _mm256_mul_ps(_mm256_set1_ps(range), f)));
+}
+
+
+// Write count blocks (4 values each) starting at the given block, one block at a time. Each pack type has a version
+template <typename T>
+static void FillBlocks(Float1, uint64_t block, unsigned int count, uint32_t stream, const uint32_t key[2], T* out, float a, float range)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        uint32_t values[4];
+        PhiloxBlock(block + i, stream, key, values);
+        for (int v = 0; v < 4; ++v)  Store(out + i * 4 + v, values[v], a, range);
+    }
+}
+
+// Four blocks at a time, one per lane. The results come out with each value of the block in a different register, so are
+// transposed to store the blocks in order
+template <typename T>
+static void FillBlocks(Float4, uint64_t block, unsigned int count, uint32_t stream, const uint32_t key[2], T* out, float a, float range)
+{
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint64_t first = block + i;
+        if (static_cast<uint32_t>(first) > 0xFFFFFFFF - 3)  break; // Low half of the counter would wrap inside the pack
+        __m128i c[4] = { _mm_add_epi32(_mm_set1_epi32(static_cast<int>(first)), _mm_setr_epi32(0, 1, 2, 3)),
+                         _mm_set1_epi32(static_cast<int>(first >> 32)), _mm_set1_epi32(static_cast<int>(stream)), _mm_setzero_si128() };
+        Philox(c, key);
+
+        __m128i t0 = _mm_unpacklo_epi32(c[0], c[1]);
+        __m128i t1 = _mm_unpacklo_epi32(c[2], c[3]);
+        __m128i t2 = _mm_unpackhi_epi32(c[0], c[1]);
+        __m128i t3 = _mm_unpackhi_epi32(c[2], c[3]);
+        Store(out + i * 4,      _mm_unpacklo_epi64(t0, t1), a, range);
+        Store(out + i * 4 + 4,  _mm_unpackhi_epi64(t0, t1), a, range);
+        Store(out + i * 4 + 8,  _mm_unpacklo_epi64(t2, t3), a, range);
+        Store(out + i * 4 + 12, _mm_unpackhi_epi64(t2, t3), a, range);
+    }
+    FillBlocks(Float1(), block + i, count - i, stream, key, out + i * 4, a, range);
+}
+
+// Eight blocks at a time. The AVX2 unpacks work within each 128-bit half, so the lower half of the counters is for the even
+// blocks and the upper half the odd ones. Then each transposed register holds two neighbouring blocks
+template <typename T>
+static void FillBlocks(Float8, uint64_t block, unsigned int count, uint32_t stream, const uint32_t key[2], T* out, float a, float range)
+{
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint64_t first = block + i;
+        if (static_cast<uint32_t>(first) > 0xFFFFFFFF - 7)  break;
+        __m256i c[4] = { _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first)), _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7)),
+                         _mm256_set1_epi32(static_cast<int>(first >> 32)), _mm256_set1_epi32(static_cast<int>(stream)), _mm256_setzero_si256() };
+        Philox(c, key);
+
+        __m256i t0 = _mm256_unpacklo_epi32(c[0], c[1]);
+        __m256i t1 = _mm256_unpacklo_epi32(c[2], c[3]);
+        __m256i t2 = _mm256_unpackhi_epi32(c[0], c[1]);
+        __m256i t3 = _mm256_unpackhi_epi32(c[2], c[3]);
+        Store(out + i * 4,      _mm256_unpacklo_epi64(t0, t1), a, range); // Blocks 0 and 1
+        Store(out + i * 4 + 8,  _mm256_unpackhi_epi64(t0, t1), a, range); // 2 and 3
+        Store(out + i * 4 + 16, _mm256_unpacklo_epi64(t2, t3), a, range); // 4 and 5
+        Store(out + i * 4 + 24, _mm256_unpackhi_epi64(t2, t3), a, range); // 6 and 7
+    }
+    FillBlocks(Float4(), block + i, count - i, stream, key, out + i * 4, a, range);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Constructors
+-----------------------------------------------------------------------------------------*/
+
+// Start at the beginning of the given stream of the given seed
+CRandom::CRandom(uint64_t seed /*= 0*/, uint32_t stream /*= 0*/)
+    : mKey{ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) }, mStream(stream), mPosition(0)
+{
+    mBlockNumber = 0;
+    PhiloxBlock(mBlockNumber, mStream, mKey, mBlock);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Single values
+-----------------------------------------------------------------------------------------*/
+
+// Return the next 32 random bits
+uint32_t CRandom::NextUInt()
+{
+    uint64_t blockNumber = mPosition >> 2;
+    if (blockNumber != mBlockNumber)
+    {
+        mBlockNumber = blockNumber;
+        PhiloxBlock(mBlockNumber, mStream, mKey, mBlock);
+    }
+    return mBlock[mPosition++ & 3];
+}
+
+// Return the next random integer from a to b (inclusive)
+uint32_t CRandom::NextUInt(uint32_t a, uint32_t b)
+{
+    // Scale the 32 bits to the range rather than using %, so all the bits are used (Lemire's method without the rejection step,
+    // the bias is at most range / 2^32)
+    uint64_t range = static_cast<uint64_t>(b - a) + 1;
+    return a + static_cast<uint32_t>((NextUInt() * range) >> 32);
+}
+
+// Return the next random float from 0 to 1 (excluding 1)
+float CRandom::NextFloat()
+{
+    return ToFloat(NextUInt(), 0.0f, 1.0f);
+}
+
+// Return the next random float from a to b
+float CRandom::NextFloat(float a, float b)
+{
+    return ToFloat(NextUInt(), a, b - a);
+}
+
+// Return the next random double from 0 to 1 (excluding 1)
+double CRandom::NextDouble()
+{
+    uint64_t high = NextUInt() >> 5; // 27 bits
+    uint64_t low  = NextUInt() >> 6; // 26 bits
+    return static_cast<double>((high << 26) | low) * (1.0 / 9007199254740992.0); // 2^-53
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Many values
+-----------------------------------------------------------------------------------------*/
+
+// Values before the next whole block and after the last come from NextUInt, the whole blocks between from FillBlocks
+template <typename T>
+void CRandom::FillValues(T* values, unsigned int count, float a, float range, int lanes)
+{
+    unsigned int i = 0;
+    for (; i < count && (mPosition & 3) != 0; ++i)  Store(values + i, NextUInt(), a, range);
+
+    unsigned int blocks = (count - i) / 4;
+    if (blocks > 0)
+    {
+        WithPack(lanes, [&](auto pack) { FillBlocks(pack, mPosition >> 2, blocks, mStream, mKey, values + i, a, range); });
+        mPosition += blocks * 4ull;
+        i += blocks * 4;
+    }
+
+    for (; i < count; ++i)  Store(values + i, NextUInt(), a, range);
+}
+
+void CRandom::Fill(uint32_t* values, unsigned int count, int lanes /*= 0*/)
+{
+    FillValues(values, count, 0.0f, 0.0f, lanes);
+}
+
+void CRandom::Fill(float* values, unsigned int count, float a /*= 0.0f*/, float b /*= 1.0f*/, int lanes /*= 0*/)
+{
+    FillValues(values, count, a, b - a, lanes);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Per-thread generators
+-----------------------------------------------------------------------------------------*/
+
+// Return the calling thread's own generator
+CRandom& ThreadRandom()
+{
+    static std::atomic<uint32_t> nextStream(0);
+    thread_local CRandom random(0, nextStream++);
+    return random;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Time making count random floats repeats times and check the statistics of the values
+RandomBenchmark BenchmarkRandom(unsigned int count, unsigned int repeats)
+{
+    using Clock = std::chrono::steady_clock;
+    RandomBenchmark result;
+    if (count < 1024 || repeats == 0)  return result;
+
+    // Published test vectors (Random123 kat_vectors): counter, key, expected block
+    struct KnownAnswer { uint32_t counter[4], key[2], expected[4]; };
+    const KnownAnswer knownAnswers[] =
+    {
+        { { 0, 0, 0, 0 }, { 0, 0 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+        { { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff }, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+        { { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 }, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+    };
+    result.knownAnswers = true;
+    for (auto& test : knownAnswers)
+    {
+        uint32_t c[4] = { test.counter[0], test.counter[1], test.counter[2], test.counter[3] };
+        Philox(c, test.key);
+        result.knownAnswers = result.knownAnswers && std::equal(c, c + 4, test.expected);
+    }
+
+    // Every pack width, starting part way through a block, and jumping back with Seek should give the same values as NextUInt.
+    // Start just before the low half of the block counter wraps to check the carry
+    const uint64_t start = (0xFFFFFFFFull << 2) - 42;
+    CRandom single(12345, 7);
+    single.Seek(start);
+    std::vector<uint32_t> expected(count), values(count);
+    for (auto& value : expected)  value = single.NextUInt();
+    result.match = true;
+    for (int lanes : { 1, 4, 8 })
+    {
+        CRandom random(12345, 7);
+        random.Seek(start);
+        random.Fill(values.data(), 5, lanes); // Leaves the position part way through a block
+        random.Fill(values.data() + 5, count - 5, lanes);
+        result.match = result.match && values == expected && random.Position() == start + count;
+        random.Seek(start + 3);
+        result.match = result.match && random.NextUInt() == expected[3];
+    }
+
+    // Statistics of floats from stream 0 and uints from stream 1
+    CRandom random(1);
+    std::vector<float> floats(count), floats2(count);
+    random.Fill(floats.data(), count);
+    CRandom(1, 1).Fill(floats2.data(), count);
+    CRandom(1, 1).Fill(values.data(), count);
+    double sum = 0, sumSquares = 0, sumNeighbours = 0, sumStreams = 0;
+    std::vector<unsigned int> buckets(256, 0), bits(32, 0);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        double f = floats[i] - 0.5; // Centre on 0 for the correlations
+        sum += floats[i];
+        sumSquares += f * f;
+        sumNeighbours += f * (floats[(i + 1) % count] - 0.5);
+        sumStreams += f * (floats2[i] - 0.5);
+        ++buckets[static_cast<unsigned int>(floats[i] * 256)];
+        for (int bit = 0; bit < 32; ++bit)  bits[bit] += (values[i] >> bit) & 1;
+    }
+    const double variance = 1.0 / 12.0;
+    result.mean = sum / count;
+    result.variance = sumSquares / count - (result.mean - 0.5) * (result.mean - 0.5);
+    result.correlation = sumNeighbours / (count * variance);
+    result.streamCorrelation = sumStreams / (count * variance);
+    double expectedPerBucket = count / 256.0;
+    for (auto bucket : buckets)  result.chiSquared += (bucket - expectedPerBucket) * (bucket - expectedPerBucket) / expectedPerBucket;
+    for (auto bit : bits)  result.worstBitBalance = std::max(result.worstBitBalance, std::abs(static_cast<double>(bit) / count - 0.5));
+    result.worstBitBalance += 0.5;
+
+    // Allow five standard deviations for each statistic, so a correct generator will practically never fail
+    double root = std::sqrt(static_cast<double>(count));
+    result.passed = result.knownAnswers && result.match &&
+                    std::abs(result.mean - 0.5)         < 5 * std::sqrt(variance) / root &&
+                    std::abs(result.variance - variance) < 5 * std::sqrt(1.0 / 80.0 - variance * variance) / root &&
+                    std::abs(result.chiSquared - 255)   < 5 * std::sqrt(2.0 * 255) &&
+                    std::abs(result.correlation)        < 5 / root &&
+                    std::abs(result.streamCorrelation)  < 5 / root &&
+                    result.worstBitBalance - 0.5        < 5 * 0.5 / root;
+
+    // Millions of floats per second running the given function
+    auto time = [&](auto run)
+    {
+        run(); // Warm up
+        auto start = Clock::now();
+        for (unsigned int repeat = 0; repeat < repeats; ++repeat)  run();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return seconds > 0 ? count * static_cast<double>(repeats) / (seconds * 1000000.0) : 0;
+    };
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    result.randMPS    = time([&]() { for (auto& f : floats)  f = static_cast<float>(rand()) / RAND_MAX; });
+    result.mt19937MPS = time([&]() { for (auto& f : floats)  f = distribution(generator); });
+    result.scalarMPS  = time([&]() { for (auto& f : floats)  f = random.NextFloat(); });
+    result.fillMPS    = time([&]() { random.Fill(floats.data(), count); });
+
+    return result;
+}
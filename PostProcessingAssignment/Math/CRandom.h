@@ -0,0 +1,124 @@
+//--------------------------------------------------------------------------------------
+// Random number generator class - counter-based (Philox4x32-10), with independent streams
+//--------------------------------------------------------------------------------------
+// Value n of a sequence is worked out directly from n, the seed and the stream number: block n/4
+// is the Philox4x32-10 encryption of the counter (n/4, stream) with the seed as the key, giving
+// four 32-bit values. So there is no state to share between threads - each thread uses its own
+// stream of the same seed - any position can be jumped to with Seek, and many values can be made
+// at once, 8 blocks at a time with AVX2, 4 with SSE4.1.
+//
+// Results are the same on every platform and for every pack width, so runs with the same seed
+// can be repeated exactly. Not for cryptography - the key is the seed, which is not secret
+
+#ifndef _CRANDOM_H_DEFINED_
+#define _CRANDOM_H_DEFINED_
+
+#include <stdint.h>
+
+
+class CRandom
+{
+public:
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Start at the beginning of the given stream of the given seed. Different streams of the same seed don't overlap, so use
+    // one per thread (e.g. the ThreadPool thread number) to get repeatable results however the work is shared out
+    explicit CRandom(uint64_t seed = 0, uint32_t stream = 0);
+
+
+    /*-----------------------------------------------------------------------------------------
+        Single values
+    -----------------------------------------------------------------------------------------*/
+
+    // Return the next 32 random bits
+    uint32_t NextUInt();
+
+    // Return the next random integer from a to b (inclusive)
+    uint32_t NextUInt(uint32_t a, uint32_t b);
+
+    // Return the next random float from 0 to 1 (excluding 1), one of 2^24 evenly spaced values
+    float NextFloat();
+
+    // Return the next random float from a to b, a + (b - a) * NextFloat()
+    float NextFloat(float a, float b);
+
+    // Return the next random double from 0 to 1 (excluding 1), one of 2^53 evenly spaced values. Uses two 32-bit values
+    double NextDouble();
+
+
+    /*-----------------------------------------------------------------------------------------
+        Many values
+    -----------------------------------------------------------------------------------------*/
+    // Give the same values as calling NextUInt / NextFloat count times. The lanes parameter chooses the pack width: 8 (AVX2),
+    // 4 (SSE4.1) or 1 (plain C++), any other value or one the CPU doesn't support uses the widest it does
+
+    void Fill(uint32_t* values, unsigned int count, int lanes = 0);
+    void Fill(float* values, unsigned int count, float a = 0.0f, float b = 1.0f, int lanes = 0);
+
+
+    /*-----------------------------------------------------------------------------------------
+        Position
+    -----------------------------------------------------------------------------------------*/
+
+    // Number of 32-bit values used so far (NextDouble uses two)
+    uint64_t Position() const  { return mPosition; }
+
+    // Jump to the given position in the stream, later or earlier
+    void Seek(uint64_t position)  { mPosition = position; }
+
+
+/*-----------------------------------------------------------------------------------------
+    Private members
+-----------------------------------------------------------------------------------------*/
+private:
+    // Shared by both versions of Fill, range is b - a
+    template <typename T>
+    void FillValues(T* values, unsigned int count, float a, float range, int lanes);
+
+    uint32_t mKey[2];    // The seed
+    uint32_t mStream;
+    uint64_t mPosition;  // Next value to return
+
+    // Last block worked out, so NextUInt only runs Philox for every fourth value
+    uint64_t mBlockNumber;
+    uint32_t mBlock[4];
+};
+
+
+// Return the calling thread's own generator, used by the Random functions in MathHelpers.h. Threads are given streams of
+// seed 0 in the order they first call this, so a single-threaded program gets the same values every run
+CRandom& ThreadRandom();
+
+
+/*-----------------------------------------------------------------------------------------
+    Benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Results of BenchmarkRandom. Throughputs are millions of floats per second on one thread
+struct RandomBenchmark
+{
+    double randMPS    = 0; // C rand() scaled to 0..1, as MathHelpers Random used
+    double mt19937MPS = 0; // std::mt19937 with std::uniform_real_distribution
+    double scalarMPS  = 0; // CRandom::NextFloat
+    double fillMPS    = 0; // CRandom::Fill, widest pack the CPU supports
+
+    // Statistics of the floats, which should be close to those of a uniform distribution
+    double mean         = 0; // Expect 0.5
+    double variance     = 0; // Expect 1/12
+    double chiSquared   = 0; // Of 256 equal buckets, expect 255 (the degrees of freedom), rarely above 330
+    double correlation  = 0; // Between neighbouring values, expect 0
+    double streamCorrelation = 0; // Between the same positions of streams 0 and 1, expect 0
+    double worstBitBalance   = 0; // Fraction of the uint values with each bit set, furthest from 0.5 of the 32 bits
+
+    bool knownAnswers = false; // True if the blocks match published Philox4x32-10 test vectors
+    bool match  = false;       // True if all pack widths, Seek and single values gave the same sequence
+    bool passed = false;       // True if the above and all statistics are within the range expected for the count
+};
+
+// Time making count random floats repeats times and check the statistics of the values
+RandomBenchmark BenchmarkRandom(unsigned int count, unsigned int repeats);
+
+
+#endif // _CRANDOM_H_DEFINED_
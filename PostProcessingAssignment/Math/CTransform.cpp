@@ -0,0 +1,210 @@
+//--------------------------------------------------------------------------------------
+// Transform class - position, rotation and scale, held separately
+//--------------------------------------------------------------------------------------
+
+#include "CTransform.h"
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the transform as a matrix
+CMatrix4x4 CTransform::GetMatrix() const
+{
+    // Rows 0-2 are the rotated axes times the scale, row 3 is the position
+    CVector3 axisX = rotation.GetXAxis() * scale.x;
+    CVector3 axisY = rotation.GetYAxis() * scale.y;
+    CVector3 axisZ = rotation.GetZAxis() * scale.z;
+    return CMatrix4x4{    axisX.x,    axisX.y,    axisX.z, 0,
+                          axisY.x,    axisY.y,    axisY.z, 0,
+                          axisZ.x,    axisZ.y,    axisZ.z, 0,
+                       position.x, position.y, position.z, 1 };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two transforms, the result is t1 followed by t2 (the same order as matrices)
+CTransform operator*(const CTransform& t1, const CTransform& t2)
+{
+    CVector3 scaledPosition = { t1.position.x * t2.scale.x, t1.position.y * t2.scale.y, t1.position.z * t2.scale.z };
+    return { RotateVector(scaledPosition, t2.rotation) + t2.position,
+             t1.rotation * t2.rotation,
+             { t1.scale.x * t2.scale.x, t1.scale.y * t2.scale.y, t1.scale.z * t2.scale.z } };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the transform of a matrix holding scaling, rotation and translation
+CTransform TransformFromMatrix(const CMatrix4x4& m)
+{
+    CVector3 scale = m.GetScale();
+    if (Dot(Cross(m.GetXAxis(), m.GetYAxis()), m.GetZAxis()) < 0)  scale.x = -scale.x; // Mirrored, see QuaternionFromMatrix
+    return { m.GetPosition(), QuaternionFromMatrix(m), scale };
+}
+
+
+// Split a matrix into a transform and the stretch left over. Returns false if the matrix has no inverse
+bool DecomposeMatrix(const CMatrix4x4& m, CTransform& transform, CMatrix4x4& stretch)
+{
+    CMatrix4x4 polarStretch, orthogonal;
+    if (!PolarDecompose(m, polarStretch, orthogonal))  return false;
+
+    // A mirrored matrix has a mirrored orthogonal part. Flip its x axis and the x column of the stretch to leave a rotation
+    if (Determinant(orthogonal) < 0)
+    {
+        orthogonal.SetRow(0, -orthogonal.GetXAxis());
+        polarStretch.e00 = -polarStretch.e00;
+        polarStretch.e10 = -polarStretch.e10;
+        polarStretch.e20 = -polarStretch.e20;
+    }
+
+    transform = { m.GetPosition(), QuaternionFromMatrix(orthogonal), { polarStretch.e00, polarStretch.e11, polarStretch.e22 } };
+    stretch = polarStretch;
+    return true;
+}
+
+
+// Return the opposite transform, exact for uniform scale
+CTransform Inverse(const CTransform& t)
+{
+    CQuaternion inverseRotation = Inverse(t.rotation);
+    CVector3 inverseScale = { 1.0f / t.scale.x, 1.0f / t.scale.y, 1.0f / t.scale.z };
+    CVector3 position = RotateVector(t.position, inverseRotation);
+    return { { -position.x * inverseScale.x, -position.y * inverseScale.y, -position.z * inverseScale.z }, inverseRotation, inverseScale };
+}
+
+
+// Return the given point transformed, the same as CVector4(p, 1) * t.GetMatrix()
+CVector3 TransformPoint(const CVector3& p, const CTransform& t)
+{
+    return RotateVector({ p.x * t.scale.x, p.y * t.scale.y, p.z * t.scale.z }, t.rotation) + t.position;
+}
+
+
+// Interpolate between two transforms, t = 0 gives t1, t = 1 gives t2
+CTransform Interpolate(const CTransform& t1, const CTransform& t2, float t)
+{
+    return { t1.position + (t2.position - t1.position) * t, Slerp(t1.rotation, t2.rotation, t), t1.scale + (t2.scale - t1.scale) * t };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Largest difference between the elements of two matrices, relative to the size of the elements if they are larger than 1
+static float Difference(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    const float* e1 = &m1.e00;
+    const float* e2 = &m2.e00;
+    float difference = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        difference = std::max(difference, std::abs(e1[i] - e2[i]) / std::max(1.0f, std::abs(e1[i])));
+    }
+    return difference;
+}
+
+
+// Time the given number of random transforms and matrices, each operation repeats times, and check their accuracy
+TransformBenchmark BenchmarkTransforms(unsigned int count, unsigned int repeats)
+{
+    TransformBenchmark result;
+    if (count == 0 || repeats == 0)  return result;
+
+    // Random transforms, the same each run. The X angle is kept away from +-90 degrees where the Euler angles are ambiguous
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> positionValue(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> angleX(-1.5f, 1.5f);
+    std::uniform_real_distribution<float> angleYZ(-3.1f, 3.1f);
+    std::uniform_real_distribution<float> scaleValue(0.5f, 2.0f);
+
+    std::vector<CVector3>   angles(count + 1);
+    std::vector<CTransform> transforms(count + 1);    // Non-uniform scale
+    std::vector<CTransform> uniformScale(count + 1);  // The same with uniform scale, for combining and inverting
+    std::vector<CMatrix4x4> matrices(count + 1);      // The same transforms built from matrices, as Model::SetRotation did
+    for (unsigned int i = 0; i <= count; ++i)
+    {
+        angles[i] = { angleX(random), angleYZ(random), angleYZ(random) };
+        CVector3 position = { positionValue(random), positionValue(random), positionValue(random) };
+        CVector3 scale = { scaleValue(random), scaleValue(random), scaleValue(random) };
+        transforms[i] = { position, QuaternionRotationEuler(angles[i]), scale };
+        uniformScale[i] = { position, transforms[i].rotation, { scale.x, scale.x, scale.x } };
+        matrices[i] = MatrixScaling(scale) * MatrixRotationZ(angles[i].z) * MatrixRotationX(angles[i].x) * MatrixRotationY(angles[i].y) *
+                      MatrixTranslation(position);
+    }
+
+    // Nanoseconds per operation running op(i) on every index, results are kept so the work isn't optimised away
+    auto time = [&](auto& results, auto op)
+    {
+        for (unsigned int i = 0; i < count; ++i)  results[i] = op(i); // Warm up
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+        {
+            for (unsigned int i = 0; i < count; ++i)  results[i] = op(i);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1000000000.0 / (static_cast<double>(count) * repeats);
+    };
+    std::vector<CVector3>   vectorResults(count);
+    std::vector<CMatrix4x4> matrixResults(count);
+    std::vector<CTransform> transformResults(count);
+
+    result.getRotationMatrixNs = time(vectorResults, [&](unsigned int i) { return matrices[i].GetEulerAngles(); });
+    result.getRotationNs       = time(vectorResults, [&](unsigned int i) { return transforms[i].rotation.GetEulerAngles(); });
+    result.setRotationMatrixNs = time(matrixResults, [&](unsigned int i)
+    {
+        const CMatrix4x4& m = matrices[i];
+        return MatrixScaling(m.GetScale()) * MatrixRotationZ(angles[i + 1].z) * MatrixRotationX(angles[i + 1].x) *
+               MatrixRotationY(angles[i + 1].y) * MatrixTranslation(m.GetPosition());
+    });
+    result.setRotationNs   = time(matrixResults, [&](unsigned int i)
+    {
+        return CTransform(transforms[i].position, QuaternionRotationEuler(angles[i + 1]), transforms[i].scale).GetMatrix();
+    });
+    result.combineMatrixNs = time(matrixResults,    [&](unsigned int i) { return matrices[i] * matrices[i + 1]; });
+    result.combineNs       = time(transformResults, [&](unsigned int i) { return transforms[i] * uniformScale[i + 1]; });
+    result.toMatrixNs      = time(matrixResults,    [&](unsigned int i) { return transforms[i].GetMatrix(); });
+
+    // Accuracy against the matrix versions
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const CTransform& transform = transforms[i];
+        result.matrixError  = std::max(result.matrixError, Difference(matrices[i], transform.GetMatrix()));
+        result.combineError = std::max(result.combineError, Difference(transform.GetMatrix() * uniformScale[i + 1].GetMatrix(),
+                                                                       (transform * uniformScale[i + 1]).GetMatrix()));
+
+        result.roundTripError = std::max(result.roundTripError, Difference(transform.GetMatrix(), TransformFromMatrix(transform.GetMatrix()).GetMatrix()));
+        CVector3 angleError = transform.rotation.GetEulerAngles() - angles[i];
+        result.roundTripError = std::max({ result.roundTripError, std::abs(angleError.x), std::abs(angleError.y), std::abs(angleError.z) });
+
+        const CTransform& u = uniformScale[i];
+        result.inverseError = std::max(result.inverseError, Difference(MatrixIdentity(), (u * Inverse(u)).GetMatrix()));
+
+        // Slerp part way through a rotation around one axis should be the same as rotating part way around it
+        CVector3 axis = Normalise(angles[i + 1]);
+        float angle = std::abs(angles[i + 1].y); // Less than 180 degrees so Slerp goes the same way round
+        float fraction = scaleValue(random) - 1.0f;
+        CQuaternion slerped = Slerp(transform.rotation, transform.rotation * QuaternionRotationAxis(axis, angle), fraction);
+        CQuaternion expected = transform.rotation * QuaternionRotationAxis(axis, angle * fraction);
+        result.slerpError = std::max(result.slerpError, Difference(expected.GetMatrix(), slerped.GetMatrix()));
+    }
+
+    // Rounding errors of a few float steps are expected, more would show a mistake
+    const float tolerance = 0.0001f;
+    result.passed = result.matrixError < tolerance && result.combineError < tolerance && result.roundTripError < tolerance &&
+                    result.inverseError < tolerance && result.slerpError < tolerance;
+    return result;
+}
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------
+// Transform class - position, rotation and scale, held separately
+//--------------------------------------------------------------------------------------
+// A compact alternative to a 4x4 matrix for placing models and cameras: a translation, a unit
+// quaternion rotation and a scale. Position, rotation and scale can be read and changed directly,
+// where a matrix needs them extracting (see CMatrix4x4::GetEulerAngles) and rebuilding. Convert to
+// a matrix with GetMatrix when needed for rendering.
+//
+// Transforms combine in the same order as matrices: t1 * t2 is t1 followed by t2. Each transform
+// is scale, then rotation, then translation, the same as
+//     MatrixScaling(scale) * rotation.GetMatrix() * MatrixTranslation(position)
+
+#ifndef _CTRANSFORM_H_DEFINED_
+#define _CTRANSFORM_H_DEFINED_
+
+#include "CVector3.h"
+#include "CQuaternion.h"
+#include "CMatrix4x4.h"
+
+
+class CTransform
+{
+// Concrete class - public access
+public:
+    CVector3    position;
+    CQuaternion rotation; // Must be unit length
+    CVector3    scale;
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - unlike the vector and matrix classes, sets no transformation, so containers of transforms start usable
+    constexpr CTransform() : position(0, 0, 0), rotation(QuaternionIdentity()), scale(1, 1, 1) {}
+
+    // Construct with position, rotation and scale
+    constexpr CTransform(const CVector3& positionIn, const CQuaternion& rotationIn, const CVector3& scaleIn = { 1, 1, 1 })
+        : position(positionIn), rotation(rotationIn), scale(scaleIn) {}
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Return the transform as a matrix
+    CMatrix4x4 GetMatrix() const;
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two transforms, the result is t1 followed by t2 (the same order as matrices). Gives the same result as multiplying
+// the matrices if t2 has uniform scale. Otherwise the matrix would shear t1, which can't be held in a transform
+CTransform operator*(const CTransform& t1, const CTransform& t2);
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the transform of a matrix holding scaling, rotation and translation. Shear is lost. A mirrored matrix is given a
+// negative x scale
+CTransform TransformFromMatrix(const CMatrix4x4& m);
+
+// Split a matrix into a transform and the stretch left over, m = stretch * transform.rotation.GetMatrix() * translation, using
+// PolarDecompose. Unlike TransformFromMatrix the rotation is the closest one to the matrix when it is sheared (e.g. the child
+// of a non-uniformly scaled parent), and transform.scale is the diagonal of the stretch. Without shear both give the same
+// transform. A mirrored matrix is given a negative x scale. Returns false, leaving the outputs unchanged, if the matrix has
+// no inverse
+bool DecomposeMatrix(const CMatrix4x4& m, CTransform& transform, CMatrix4x4& stretch);
+
+// Return the opposite transform, exact for uniform scale (see operator*)
+CTransform Inverse(const CTransform& t);
+
+// Return the given point transformed, the same as CVector4(p, 1) * t.GetMatrix()
+CVector3 TransformPoint(const CVector3& p, const CTransform& t);
+
+// Interpolate between two transforms, t = 0 gives t1, t = 1 gives t2. Position and scale are interpolated in straight lines,
+// rotation with Slerp
+CTransform Interpolate(const CTransform& t1, const CTransform& t2, float t);
+
+
+/*-----------------------------------------------------------------------------------------
+    Benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Results of BenchmarkTransforms: the time each operation takes as a transform and on a matrix as Model did before it held
+// transforms, in nanoseconds per operation, and the largest errors found comparing the two
+struct TransformBenchmark
+{
+    double getRotationMatrixNs = 0; // Euler angles from a scaled matrix, CMatrix4x4::GetEulerAngles
+    double getRotationNs       = 0; // Euler angles from a quaternion
+    double setRotationMatrixNs = 0; // Rebuild a matrix from its scale and position and new Euler angles
+    double setRotationNs       = 0; // Set rotation from Euler angles and convert to a matrix
+    double combineMatrixNs     = 0; // Matrix product
+    double combineNs           = 0; // Transform product
+    double toMatrixNs          = 0; // Transform to matrix
+
+    float matrixError    = 0; // Largest difference between a transform's matrix and the same transform built from matrices
+    float combineError   = 0; // Largest difference between the matrix of a transform product and the matrix product
+    float roundTripError = 0; // Largest difference after transform -> matrix -> transform, and Euler angles -> quaternion -> angles
+    float inverseError   = 0; // Largest difference from identity of a transform times its inverse
+    float slerpError     = 0; // Largest difference between Slerp and the matching rotation around the axis between the ends
+    bool  passed = false;     // True if all of the errors are within float rounding
+};
+
+// Time the given number of random transforms and matrices, each operation repeats times, and check their accuracy
+TransformBenchmark BenchmarkTransforms(unsigned int count, unsigned int repeats);
+
+
+#endif // _CTRANSFORM_H_DEFINED_
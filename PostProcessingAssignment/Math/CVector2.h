@@ -2,7 +2,8 @@
 // Vector2 class (cut down version), mainly used for texture coordinates (UVs)
 // but can be used for 2D points as well
 //--------------------------------------------------------------------------------------
-// Code in .cpp file
+// Simple operations are constexpr in this file so they can be used for compile-time constants,
+// other code in .cpp file
 
 #ifndef _CVECTOR2_H_DEFINED_
 #define _CVECTOR2_H_DEFINED_
@@ -22,22 +23,14 @@ public:
         Constructors
     -----------------------------------------------------------------------------------------*/
 
-    // Default constructor - leaves values uninitialised (for performance)
-    CVector2() {}
+    // Default constructor - leaves values uninitialised (for performance). Value-initialising (CVector2{}) sets them to 0
+    CVector2() = default;
 
     // Construct with 2 values
-    CVector2(const float xIn, const float yIn)
-    {
-        x = xIn;
-        y = yIn;
-    }
+    constexpr CVector2(const float xIn, const float yIn) : x(xIn), y(yIn) {}
 
     // Construct using a pointer to 2 floats
-    CVector2(const float* elts)
-    {
-        x = elts[0];
-        y = elts[1];
-    }
+    constexpr CVector2(const float* elts) : x(elts[0]), y(elts[1]) {}
 
 
     /*-----------------------------------------------------------------------------------------
@@ -45,22 +38,50 @@ public:
     -----------------------------------------------------------------------------------------*/
 
     // Addition of another vector to this one, e.g. Position += Velocity
-    CVector2& operator+= (const CVector2& v);
+    constexpr CVector2& operator+= (const CVector2& v)
+    {
+        x += v.x;
+        y += v.y;
+        return *this;
+    }
 
     // Subtraction of another vector from this one, e.g. Velocity -= Gravity
-    CVector2& operator-= (const CVector2& v);
+    constexpr CVector2& operator-= (const CVector2& v)
+    {
+        x -= v.x;
+        y -= v.y;
+        return *this;
+    }
 
     // Negate this vector (e.g. Velocity = -Velocity)
-    CVector2& operator- ();
+    constexpr CVector2& operator- ()
+    {
+        x = -x;
+        y = -y;
+        return *this;
+    }
 
     // Plus sign in front of vector - called unary positive and usually does nothing. Included for completeness (e.g. Velocity = +Velocity)
-    CVector2& operator+ ();
+    constexpr CVector2& operator+ ()
+    {
+        return *this;
+    }
 
 	// Multiply vector by scalar (scales vector);
-    CVector2& operator*= (float s);
+    constexpr CVector2& operator*= (float s)
+    {
+        x *= s;
+        y *= s;
+        return *this;
+    }
 
 	// Divide vector by scalar (scales vector);
-    CVector2& operator/= (float s);
+    constexpr CVector2& operator/= (float s)
+    {
+        x /= s;
+        y /= s;
+        return *this;
+    }
 };
 
 
@@ -69,15 +90,30 @@ public:
 -----------------------------------------------------------------------------------------*/
 
 // Vector-vector addition
-CVector2 operator+ (const CVector2& v, const CVector2& w);
+constexpr CVector2 operator+ (const CVector2& v, const CVector2& w)
+{
+    return { v.x + w.x, v.y + w.y };
+}
 
 // Vector-vector subtraction
-CVector2 operator- (const CVector2& v, const CVector2& w);
+constexpr CVector2 operator- (const CVector2& v, const CVector2& w)
+{
+    return { v.x - w.x, v.y - w.y };
+}
 
 // Vector-scalar multiplication & division
-CVector2 operator* (const CVector2& v, float s);
-CVector2 operator* (float s, const CVector2& v);
-CVector2 operator/ (const CVector2& v, float s);
+constexpr CVector2 operator* (const CVector2& v, float s)
+{
+    return { v.x * s, v.y * s };
+}
+constexpr CVector2 operator* (float s, const CVector2& v)
+{
+    return { v.x * s, v.y * s };
+}
+constexpr CVector2 operator/ (const CVector2& v, float s)
+{
+    return { v.x / s, v.y / s };
+}
 
 
 /*-----------------------------------------------------------------------------------------
@@ -85,7 +121,10 @@ Non-member functions
 -----------------------------------------------------------------------------------------*/
 
 // Dot product of two given vectors (order not important) - non-member version
-float Dot(const CVector2& v1, const CVector2& v2);
+constexpr float Dot(const CVector2& v1, const CVector2& v2)
+{
+    return v1.x * v2.x + v1.y * v2.y;
+}
 
 // Return unit length vector in the same direction as given one
 CVector2 Normalise(const CVector2& v);
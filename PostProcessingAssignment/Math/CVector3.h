@@ -1,7 +1,8 @@
 //--------------------------------------------------------------------------------------
 // Vector3 class (cut down version), to hold points and vectors
 //--------------------------------------------------------------------------------------
-// Code in .cpp file
+// Simple operations are constexpr in this file so they can be used for compile-time constants,
+// other code in .cpp file
 
 #ifndef _CVECTOR3_H_DEFINED_
 #define _CVECTOR3_H_DEFINED_
@@ -22,24 +23,14 @@ public:
         Constructors
     -----------------------------------------------------------------------------------------*/
 
-	// Default constructor - leaves values uninitialised (for performance)
-	CVector3() {}
+	// Default constructor - leaves values uninitialised (for performance). Value-initialising (CVector3{}) sets them to 0
+	CVector3() = default;
 
 	// Construct with 3 values
-	CVector3(const float xIn, const float yIn, const float zIn)
-	{
-		x = xIn;
-		y = yIn;
-		z = zIn;
-	}
+	constexpr CVector3(const float xIn, const float yIn, const float zIn) : x(xIn), y(yIn), z(zIn) {}
 	
     // Construct using a pointer to three floats
-    CVector3(const float* elts)
-    {
-        x = elts[0];
-        y = elts[1];
-        z = elts[2];
-    }
+    constexpr CVector3(const float* elts) : x(elts[0]), y(elts[1]), z(elts[2]) {}
 
 
     /*-----------------------------------------------------------------------------------------
@@ -47,22 +38,55 @@ public:
     -----------------------------------------------------------------------------------------*/
 
     // Addition of another vector to this one, e.g. Position += Velocity
-    CVector3& operator+= (const CVector3& v);
+    constexpr CVector3& operator+= (const CVector3& v)
+    {
+        x += v.x;
+        y += v.y;
+        z += v.z;
+        return *this;
+    }
 
     // Subtraction of another vector from this one, e.g. Velocity -= Gravity
-    CVector3& operator-= (const CVector3& v);
+    constexpr CVector3& operator-= (const CVector3& v)
+    {
+        x -= v.x;
+        y -= v.y;
+        z -= v.z;
+        return *this;
+    }
 
     // Negate this vector (e.g. Velocity = -Velocity)
-    CVector3& operator- ();
+    constexpr CVector3& operator- ()
+    {
+        x = -x;
+        y = -y;
+        z = -z;
+        return *this;
+    }
 
     // Plus sign in front of vector - called unary positive and usually does nothing. Included for completeness (e.g. Velocity = +Velocity)
-    CVector3& operator+ ();
+    constexpr CVector3& operator+ ()
+    {
+        return *this;
+    }
 
     // Multiply vector by scalar (scales vector);
-    CVector3& operator*= (float s);
+    constexpr CVector3& operator*= (float s)
+    {
+        x *= s;
+        y *= s;
+        z *= s;
+        return *this;
+    }
 
 	// Divide vector by scalar (scales vector);
-    CVector3& operator/= (float s);
+    constexpr CVector3& operator/= (float s)
+    {
+        x /= s;
+        y /= s;
+        z /= s;
+        return *this;
+    }
 };
 	
 
@@ -71,15 +95,30 @@ public:
 -----------------------------------------------------------------------------------------*/
 
 // Vector-vector addition
-CVector3 operator+ (const CVector3& v, const CVector3& w);
+constexpr CVector3 operator+ (const CVector3& v, const CVector3& w)
+{
+    return { v.x + w.x, v.y + w.y, v.z + w.z };
+}
 
 // Vector-vector subtraction
-CVector3 operator- (const CVector3& v, const CVector3& w);
+constexpr CVector3 operator- (const CVector3& v, const CVector3& w)
+{
+    return { v.x - w.x, v.y - w.y, v.z - w.z };
+}
 
 // Vector-scalar multiplication & division
-CVector3 operator* (const CVector3& v, float s);
-CVector3 operator* (float s, const CVector3& v);
-CVector3 operator/ (const CVector3& v, float s);
+constexpr CVector3 operator* (const CVector3& v, float s)
+{
+    return { v.x * s, v.y * s, v.z * s };
+}
+constexpr CVector3 operator* (float s, const CVector3& v)
+{
+    return { v.x * s, v.y * s, v.z * s };
+}
+constexpr CVector3 operator/ (const CVector3& v, float s)
+{
+    return { v.x / s, v.y / s, v.z / s };
+}
 
 
 /*-----------------------------------------------------------------------------------------
@@ -87,10 +126,16 @@ CVector3 operator/ (const CVector3& v, float s);
 -----------------------------------------------------------------------------------------*/
 
 // Dot product of two given vectors (order not important) - non-member version
-float Dot(const CVector3& v1, const CVector3& v2);
+constexpr float Dot(const CVector3& v1, const CVector3& v2)
+{
+    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
 
 // Cross product of two given vectors (order is important) - non-member version
-CVector3 Cross(const CVector3& v1, const CVector3& v2);
+constexpr CVector3 Cross(const CVector3& v1, const CVector3& v2)
+{
+    return { v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x };
+}
 
 // Return unit length vector in the same direction as given one
 CVector3 Normalise(const CVector3& v);
@@ -98,8 +143,4 @@ CVector3 Normalise(const CVector3& v);
 // Returns length of a vector
 float Length(const CVector3& v);
 
-CVector3 HSLToRGB(CVector3 HSL);
-
-CVector3 RGBToHSL(CVector3 RGB);
-
 #endif // _CVECTOR3_H_DEFINED_
@@ -1,7 +1,7 @@
 //--------------------------------------------------------------------------------------
 // Vector4 class (cut down version), to hold points and vectors for matrix work
 //--------------------------------------------------------------------------------------
-// Code in .cpp file
+// Code in this file, constructors are constexpr so they can be used for compile-time constants
 
 #ifndef _CVECTOR4_H_DEFINED_
 #define _CVECTOR4_H_DEFINED_
@@ -24,35 +24,17 @@ public:
         Constructors
     -----------------------------------------------------------------------------------------*/
 
-	// Default constructor - leaves values uninitialised (for performance)
-	CVector4() {}
+	// Default constructor - leaves values uninitialised (for performance). Value-initialising (CVector4{}) sets them to 0
+	CVector4() = default;
 
 	// Construct with 4 values
-	CVector4(const float xIn, const float yIn, const float zIn, const float wIn)
-	{
-		x = xIn;
-		y = yIn;
-		z = zIn;
-		w = wIn;
-	}
+	constexpr CVector4(const float xIn, const float yIn, const float zIn, const float wIn) : x(xIn), y(yIn), z(zIn), w(wIn) {}
 	
 	// Construct with CVector3 and a float for the w value (use to initialise with points (w=1) and vectors (w=0))
-	CVector4(const CVector3& vIn, const float wIn)
-	{
-		x = vIn.x;
-		y = vIn.y;
-		z = vIn.z;
-		w = wIn;
-	}
+	constexpr CVector4(const CVector3& vIn, const float wIn) : x(vIn.x), y(vIn.y), z(vIn.z), w(wIn) {}
 	
     // Construct using a pointer to 4 floats
-    CVector4(const float* elts)
-    {
-        x = elts[0];
-        y = elts[1];
-        z = elts[2];
-        w = elts[3];
-    }
+    constexpr CVector4(const float* elts) : x(elts[0]), y(elts[1]), z(elts[2]), w(elts[3]) {}
 
 
 };
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------
+// Fast trigonometry - polynomial sin, cos, tan and atan2 for single floats and SIMD packs
+//--------------------------------------------------------------------------------------
+
+#include "FastTrig.h"
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Arrays
+//--------------------------------------------------------------------------------------
+
+// Write the sine and cosine of count angles. Either output can be null if it is not needed
+void SinCosArray(const float* angles, unsigned int count, float* sines, float* cosines, TrigPolicy policy, int lanes /*= 0*/)
+{
+	if (policy == TrigPolicy::Precise)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			if (sines   != nullptr)  sines[i]   = std::sin(angles[i]);
+			if (cosines != nullptr)  cosines[i] = std::cos(angles[i]);
+		}
+		return;
+	}
+
+	WithPack(lanes, [&](auto pack)
+	{
+		ForEachPack<decltype(pack)>(count, [&](auto pack, unsigned int i)
+		{
+			using G = decltype(pack);
+			G s, c;
+			FastSinCos(Load(angles + i, G()), s, c);
+			if (sines   != nullptr)  Store(sines + i, s);
+			if (cosines != nullptr)  Store(cosines + i, c);
+		});
+	});
+}
+
+
+// Write the atan2 of count pairs of y and x values
+void Atan2Array(const float* y, const float* x, unsigned int count, float* angles, TrigPolicy policy, int lanes /*= 0*/)
+{
+	if (policy == TrigPolicy::Precise)
+	{
+		for (unsigned int i = 0; i < count; ++i)  angles[i] = std::atan2(y[i], x[i]);
+		return;
+	}
+
+	WithPack(lanes, [&](auto pack)
+	{
+		ForEachPack<decltype(pack)>(count, [&](auto pack, unsigned int i)
+		{
+			using G = decltype(pack);
+			Store(angles + i, FastAtan2(Load(y + i, G()), Load(x + i, G())));
+		});
+	});
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time sin/cos and atan2 on the given number of random values, each repeats times, and measure the errors of the fast versions
+TrigBenchmark BenchmarkTrig(unsigned int count, unsigned int repeats)
+{
+	using Clock = std::chrono::steady_clock;
+	TrigBenchmark result;
+	if (count == 0 || repeats == 0)  return result;
+
+	// Fixed seed so every run times the same values. Angles cover the range documented in FastTrig.h, tangent angles stay away
+	// from the poles at +-pi/2
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> angleValue(-8192.0f, 8192.0f);
+	std::uniform_real_distribution<float> tanAngleValue(-1.55f, 1.55f);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+	std::vector<float> angles(count), tanAngles(count), y(count), x(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		// Every fourth angle is small, where most angles used for rotations are
+		angles[i] = (i % 4 == 0) ? angleValue(generator) * (1.0f / 1024.0f) : angleValue(generator);
+		tanAngles[i] = tanAngleValue(generator);
+		y[i] = coordinate(generator);
+		x[i] = coordinate(generator);
+	}
+	x[0] = y[0] = 0; // Check atan2(0, 0) and the axes
+	if (count > 2)  { x[1] = 0;  y[2] = 0; }
+
+	// Errors against double precision, and check all pack widths give the same results as the single float versions
+	std::vector<float> sines(count), cosines(count), results(count);
+	result.passed = true;
+	for (int lanes : { 1, 4, 8 })
+	{
+		SinCosArray(angles.data(), count, sines.data(), cosines.data(), TrigPolicy::Fast, lanes);
+		Atan2Array(y.data(), x.data(), count, results.data(), TrigPolicy::Fast, lanes);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			result.passed = result.passed && sines[i] == FastSin(angles[i]) && cosines[i] == FastCos(angles[i]) &&
+			                                 results[i] == FastAtan2(y[i], x[i]);
+		}
+	}
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		double angle = angles[i];
+		result.sinCosError = std::max({ result.sinCosError, static_cast<float>(std::abs(sines[i] - std::sin(angle))),
+		                                                    static_cast<float>(std::abs(cosines[i] - std::cos(angle))) });
+		double tangent = std::tan(static_cast<double>(tanAngles[i]));
+		result.tanError = std::max(result.tanError, static_cast<float>(std::abs((FastTan(tanAngles[i]) - tangent) / tangent)));
+		result.atan2Error = std::max(result.atan2Error, static_cast<float>(std::abs(results[i] - std::atan2(static_cast<double>(y[i]), x[i]))));
+	}
+	result.passed = result.passed && result.sinCosError <= 1.0e-7f && result.tanError <= 2.3e-7f && result.atan2Error <= 2.7e-7f;
+
+	// Millions of values per second running the given function
+	auto time = [&](auto run)
+	{
+		run(); // Warm up
+		auto start = Clock::now();
+		for (unsigned int repeat = 0; repeat < repeats; ++repeat)  run();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		return seconds > 0 ? count * static_cast<double>(repeats) / (seconds * 1000000.0) : 0;
+	};
+
+	result.sinCosPreciseMPS = time([&]() { SinCosArray(angles.data(), count, sines.data(), cosines.data(), TrigPolicy::Precise); });
+	result.sinCosScalarMPS  = time([&]() { SinCosArray(angles.data(), count, sines.data(), cosines.data(), TrigPolicy::Fast, 1); });
+	result.sinCosSIMDMPS    = time([&]() { SinCosArray(angles.data(), count, sines.data(), cosines.data(), TrigPolicy::Fast); });
+	result.atan2PreciseMPS  = time([&]() { Atan2Array(y.data(), x.data(), count, results.data(), TrigPolicy::Precise); });
+	result.atan2ScalarMPS   = time([&]() { Atan2Array(y.data(), x.data(), count, results.data(), TrigPolicy::Fast, 1); });
+	result.atan2SIMDMPS     = time([&]() { Atan2Array(y.data(), x.data(), count, results.data(), TrigPolicy::Fast); });
+
+	return result;
+}
@@ -0,0 +1,190 @@
+//--------------------------------------------------------------------------------------
+// Fast trigonometry - polynomial sin, cos, tan and atan2 for single floats and SIMD packs
+//--------------------------------------------------------------------------------------
+// The fast versions reduce the angle to -pi/4..pi/4 (or the ratio to 0..tan(pi/8) for atan2) and
+// use minimax polynomials there. They are written once as templates on the pack types in
+// SIMDPack.h, so Float1, Float4 and Float8 give exactly the same results. Measured largest errors
+// against double precision (see BenchmarkTrig):
+//   FastSin / FastCos / FastSinCos: 1.0e-7 for angles within +-8192 radians, growing beyond (5e-7 at 100000)
+//   FastTan:   2.3e-7 relative, for angles within -1.55..1.55 - larger near the poles at +-pi/2
+//   FastAtan2: 2.7e-7 radians. atan2(-0, x < 0) gives pi rather than -pi
+//
+// Code that can use either picks with a TrigPolicy parameter (see MathHelpers.h), which defaults to the standard library
+
+#ifndef _FAST_TRIG_H_DEFINED_
+#define _FAST_TRIG_H_DEFINED_
+
+#include "SIMDPack.h"
+#include "MathHelpers.h" // TrigPolicy
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+// Fast versions for any pack type
+//--------------------------------------------------------------------------------------
+
+// Reduce angles to r in -pi/4..pi/4 and return the sine and cosine of r, and the nearest whole number k of pi/2 in the angle
+template <typename F>
+inline void FastSinCosReduced(F angle, F& k, F& sinR, F& cosR)
+{
+	// r = angle - k * pi/2. pi/2 is split into three parts with few enough bits that k times each part is exact for k below
+	// 2^15, so r is accurate (Cody-Waite reduction)
+	k = Floor(angle * 0.636619772f + 0.5f);
+	F r = ((angle - k * 1.5703125f) - k * 4.837512969970703125e-4f) - k * 7.54978995489188216e-8f;
+
+	// Minimax polynomials for -pi/4..pi/4 (coefficients as used in the Cephes library)
+	F r2 = r * r;
+	sinR = r + r * r2 * ((-1.9515295891e-4f * r2 + 8.3321608736e-3f) * r2 - 1.6666654611e-1f);
+	cosR = 1.0f - 0.5f * r2 + r2 * r2 * ((2.443315711809948e-5f * r2 - 1.388731625493765e-3f) * r2 + 4.166664568298827e-2f);
+}
+
+// Sine and cosine of the same angles together, sharing the range reduction
+template <typename F>
+inline void FastSinCos(F angle, F& sine, F& cosine)
+{
+	F k, sinR, cosR;
+	FastSinCosReduced(angle, k, sinR, cosR);
+
+	// Quadrant 0..3: odd quadrants swap sine and cosine, sine is negative in quadrants 2 and 3, cosine in 1 and 2
+	F quadrant = k - 4.0f * Floor(k * 0.25f);
+	auto odd = (quadrant - 2.0f * Floor(quadrant * 0.5f)) >= Splat(0.5f, F());
+	F s = Select(odd, cosR, sinR);
+	F c = Select(odd, sinR, cosR);
+	F cosQuadrant = quadrant + 1.0f - 4.0f * Floor((quadrant + 1.0f) * 0.25f);
+	sine   = Select(quadrant    >= Splat(1.5f, F()), 0.0f - s, s);
+	cosine = Select(cosQuadrant >= Splat(1.5f, F()), 0.0f - c, c);
+}
+
+// The same for single values, giving the same results. Picks the quadrant from tables, where selects would be branches
+inline void FastSinCos(Float1 angle, Float1& sine, Float1& cosine)
+{
+	static const float sinSign[4] = { 1, 1, -1, -1 };
+	static const float cosSign[4] = { 1, -1, -1, 1 };
+	Float1 k, sinR, cosR;
+	FastSinCosReduced(angle, k, sinR, cosR);
+	int quadrant = static_cast<int>(k.v) & 3;
+	int odd = quadrant & 1;
+	float reduced[2] = { sinR.v, cosR.v };
+	sine.v   = reduced[odd]     * sinSign[quadrant];
+	cosine.v = reduced[1 - odd] * cosSign[quadrant];
+}
+
+template <typename F>
+inline F FastSin(F angle)
+{
+	F s, c;
+	FastSinCos(angle, s, c);
+	return s;
+}
+
+template <typename F>
+inline F FastCos(F angle)
+{
+	F s, c;
+	FastSinCos(angle, s, c);
+	return c;
+}
+
+template <typename F>
+inline F FastTan(F angle)
+{
+	F s, c;
+	FastSinCos(angle, s, c);
+	return s / c;
+}
+
+// Angle of the vector (x, y) from the x axis, -pi to pi, as std::atan2
+template <typename F>
+inline F FastAtan2(F y, F x)
+{
+	// Angle of the smaller of |x|, |y| over the larger, 0..1. Above tan(pi/8), use atan(t) = pi/4 + atan((t - 1) / (t + 1))
+	F absX = Max(x, 0.0f - x);
+	F absY = Max(y, 0.0f - y);
+	F larger  = Max(absX, absY);
+	F smaller = Min(absX, absY);
+	F t = Select(Splat(0.0f, F()) < larger, smaller / larger, Splat(0.0f, F())); // atan2(0, 0) is 0
+	auto aboveTanPi8 = Splat(0.414213562f, F()) < t;
+	t = Select(aboveTanPi8, (t - 1.0f) / (t + 1.0f), t);
+
+	// Minimax polynomial for -tan(pi/8)..tan(pi/8) (Cephes coefficients)
+	F t2 = t * t;
+	F angle = (((8.05374449538e-2f * t2 - 1.38776856032e-1f) * t2 + 1.99777106478e-1f) * t2 - 3.33329491539e-1f) * t2 * t + t;
+	angle = Select(aboveTanPi8, angle + 0.785398163f, angle);
+
+	// Back to the full circle
+	angle = Select(absX < absY, 1.57079633f - angle, angle);
+	angle = Select(x < Splat(0.0f, F()), 3.14159265f - angle, angle);
+	return Select(y < Splat(0.0f, F()), 0.0f - angle, angle);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Single floats
+//--------------------------------------------------------------------------------------
+
+inline void  FastSinCos(float angle, float& sine, float& cosine)  { Float1 s, c;  FastSinCos(Float1{ angle }, s, c);  sine = s.v;  cosine = c.v; }
+inline float FastSin(float angle)           { float s, c;  FastSinCos(angle, s, c);  return s; }
+inline float FastCos(float angle)           { float s, c;  FastSinCos(angle, s, c);  return c; }
+inline float FastTan(float angle)           { float s, c;  FastSinCos(angle, s, c);  return s / c; }
+inline float FastAtan2(float y, float x)    { return FastAtan2(Float1{ y }, Float1{ x }).v; }
+
+
+// Versions choosing between the standard library and the fast versions above
+inline void SinCos(float angle, float& sine, float& cosine, TrigPolicy policy = TrigPolicy::Precise)
+{
+	if (policy == TrigPolicy::Fast)
+	{
+		FastSinCos(angle, sine, cosine);
+	}
+	else
+	{
+		sine   = std::sin(angle);
+		cosine = std::cos(angle);
+	}
+}
+
+inline float Sin(float angle, TrigPolicy policy)         { return policy == TrigPolicy::Fast ? FastSin(angle)     : std::sin(angle); }
+inline float Cos(float angle, TrigPolicy policy)         { return policy == TrigPolicy::Fast ? FastCos(angle)     : std::cos(angle); }
+inline float Tan(float angle, TrigPolicy policy)         { return policy == TrigPolicy::Fast ? FastTan(angle)     : std::tan(angle); }
+inline float Atan2(float y, float x, TrigPolicy policy)  { return policy == TrigPolicy::Fast ? FastAtan2(y, x)     : std::atan2(y, x); }
+
+
+//--------------------------------------------------------------------------------------
+// Arrays
+//--------------------------------------------------------------------------------------
+// The lanes parameter chooses the pack width for the fast versions: 8 (AVX2), 4 (SSE4.1) or 1 (plain C++). Any other value,
+// or a width the CPU doesn't support, uses the widest the CPU supports
+
+// Write the sine and cosine of count angles. Either output can be null if it is not needed
+void SinCosArray(const float* angles, unsigned int count, float* sines, float* cosines, TrigPolicy policy, int lanes = 0);
+
+// Write the atan2 of count pairs of y and x values
+void Atan2Array(const float* y, const float* x, unsigned int count, float* angles, TrigPolicy policy, int lanes = 0);
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Results of BenchmarkTrig. Throughputs are millions of values per second on one thread, errors are the largest found against
+// double precision results
+struct TrigBenchmark
+{
+	double sinCosPreciseMPS = 0; // std::sin and std::cos
+	double sinCosScalarMPS  = 0; // FastSinCos one float at a time
+	double sinCosSIMDMPS    = 0; // FastSinCos, widest pack the CPU supports
+	double atan2PreciseMPS  = 0; // std::atan2
+	double atan2ScalarMPS   = 0;
+	double atan2SIMDMPS     = 0;
+
+	float sinCosError = 0; // For angles within +-8192 radians
+	float tanError    = 0; // Relative, for angles away from the poles
+	float atan2Error  = 0;
+	bool  passed = false;  // True if the errors are within those listed at the top of this file and all pack widths gave the same results
+};
+
+// Time sin/cos and atan2 on the given number of random values, each repeats times, and measure the errors of the fast versions
+TrigBenchmark BenchmarkTrig(unsigned int count, unsigned int repeats);
+
+
+#endif // _FAST_TRIG_H_DEFINED_
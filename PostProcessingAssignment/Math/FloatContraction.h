@@ -0,0 +1,27 @@
+//--------------------------------------------------------------------------------------
+// Turn off floating point contraction for the maths code
+//--------------------------------------------------------------------------------------
+// The SIMD versions of the maths, colour and trig functions do each multiply and add as a
+// separate instruction, and their checks require them to give exactly the same bits as the plain
+// C++ versions. A compiler allowed to contract a * b + c into a single fused multiply-add (FMA)
+// rounds once rather than twice, so on a CPU with FMA the plain C++ versions would give slightly
+// different results and the checks would fail.
+//
+// MSVC only contracts with /fp:fast or /fp:contract (the project uses /fp:precise), but GCC
+// contracts by default and clang within expressions. This header turns contraction off for the
+// rest of every file that includes it. It is included by MathSIMD.h and SIMDPack.h, so covers
+// every file with SIMD code or its checks.
+
+#ifndef _FLOAT_CONTRACTION_H_DEFINED_
+#define _FLOAT_CONTRACTION_H_DEFINED_
+
+#if defined(__clang__)
+	#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+	#pragma GCC optimize ("fp-contract=off") // GCC ignores the standard pragma above
+#elif defined(_MSC_VER)
+	#pragma fp_contract (off)
+#endif
+
+
+#endif // _FLOAT_CONTRACTION_H_DEFINED_
@@ -0,0 +1,315 @@
+//--------------------------------------------------------------------------------------
+// View frustum - the six planes bounding what a camera can see - and culling against it
+//--------------------------------------------------------------------------------------
+
+#include "Frustum.h"
+#include "SIMDPack.h"
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <limits>
+
+
+// Return the frustum of the given view-projection matrix, for a projection giving depths 0 to 1
+Frustum FrustumFromMatrix(const CMatrix4x4& m)
+{
+	// A point p is visible if its projected position c = p * m has -c.w <= c.x <= c.w, the same for y, and 0 <= c.z <= c.w.
+	// Each of those is a plane made from the matrix columns, e.g. c.x + c.w >= 0 is the left plane (column 0 + column 3)
+	CVector4 column0 = { m.e00, m.e10, m.e20, m.e30 };
+	CVector4 column1 = { m.e01, m.e11, m.e21, m.e31 };
+	CVector4 column2 = { m.e02, m.e12, m.e22, m.e32 };
+	CVector4 column3 = { m.e03, m.e13, m.e23, m.e33 };
+
+	// Return the normalised plane a + sign * b
+	auto plane = [](const CVector4& a, const CVector4& b, float sign)
+	{
+		CVector4 p = { a.x + sign * b.x, a.y + sign * b.y, a.z + sign * b.z, a.w + sign * b.w };
+		float invLength = InvSqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+		return CVector4{ p.x * invLength, p.y * invLength, p.z * invLength, p.w * invLength };
+	};
+
+	Frustum frustum;
+	frustum.planes[FrustumLeft]   = plane(column3, column0,  1.0f);
+	frustum.planes[FrustumRight]  = plane(column3, column0, -1.0f);
+	frustum.planes[FrustumBottom] = plane(column3, column1,  1.0f);
+	frustum.planes[FrustumTop]    = plane(column3, column1, -1.0f);
+	frustum.planes[FrustumNear]   = plane(column2, column3,  0.0f); // Column 2 alone
+	frustum.planes[FrustumFar]    = plane(column3, column2, -1.0f);
+	return frustum;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Bounding volumes
+//--------------------------------------------------------------------------------------
+
+// Return a box holding nothing, which points and boxes can be added to
+BoundingBox EmptyBox()
+{
+	const float big = std::numeric_limits<float>::max();
+	return { { big, big, big }, { -big, -big, -big } };
+}
+
+// True if the box holds nothing
+bool IsEmpty(const BoundingBox& box)
+{
+	return box.minimum.x > box.maximum.x || box.minimum.y > box.maximum.y || box.minimum.z > box.maximum.z;
+}
+
+// Return the box enlarged to hold the given point or box
+BoundingBox AddToBox(const BoundingBox& box, const CVector3& point)
+{
+	return { { std::min(box.minimum.x, point.x), std::min(box.minimum.y, point.y), std::min(box.minimum.z, point.z) },
+	         { std::max(box.maximum.x, point.x), std::max(box.maximum.y, point.y), std::max(box.maximum.z, point.z) } };
+}
+
+BoundingBox AddToBox(const BoundingBox& box, const BoundingBox& add)
+{
+	if (IsEmpty(add))  return box;
+	return AddToBox(AddToBox(box, add.minimum), add.maximum);
+}
+
+
+// Return the axis-aligned box holding the given box after transforming by an affine matrix
+BoundingBox TransformBox(const BoundingBox& box, const CMatrix4x4& m)
+{
+	if (IsEmpty(box))  return box;
+
+	// Transform the centre, then each row of the matrix adds its absolute value times the half-size on that axis
+	CVector3 centre = (box.minimum + box.maximum) * 0.5f;
+	CVector3 halfSize = (box.maximum - box.minimum) * 0.5f;
+	CVector3 newCentre = { centre.x * m.e00 + centre.y * m.e10 + centre.z * m.e20 + m.e30,
+	                       centre.x * m.e01 + centre.y * m.e11 + centre.z * m.e21 + m.e31,
+	                       centre.x * m.e02 + centre.y * m.e12 + centre.z * m.e22 + m.e32 };
+	CVector3 newHalfSize = { halfSize.x * std::abs(m.e00) + halfSize.y * std::abs(m.e10) + halfSize.z * std::abs(m.e20),
+	                         halfSize.x * std::abs(m.e01) + halfSize.y * std::abs(m.e11) + halfSize.z * std::abs(m.e21),
+	                         halfSize.x * std::abs(m.e02) + halfSize.y * std::abs(m.e12) + halfSize.z * std::abs(m.e22) };
+	return { newCentre - newHalfSize, newCentre + newHalfSize };
+}
+
+// Return a sphere holding the given box
+BoundingSphere SphereAroundBox(const BoundingBox& box)
+{
+	return { (box.minimum + box.maximum) * 0.5f, Length(box.maximum - box.minimum) * 0.5f };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Culling
+//--------------------------------------------------------------------------------------
+// A sphere is outside a plane if its centre is further than its radius behind it. A box is outside if its corner furthest
+// in front of the plane (the "positive vertex", chosen by the signs of the plane normal) is behind it
+
+// True if any of the sphere may be inside the frustum
+bool IsVisible(const Frustum& frustum, const BoundingSphere& sphere)
+{
+	for (auto& plane : frustum.planes)
+	{
+		float distance = plane.x * sphere.centre.x + plane.y * sphere.centre.y + plane.z * sphere.centre.z + plane.w;
+		if (distance + sphere.radius < 0)  return false;
+	}
+	return true;
+}
+
+// True if any of the box may be inside the frustum
+bool IsVisible(const Frustum& frustum, const BoundingBox& box)
+{
+	if (IsEmpty(box))  return false;
+	for (auto& plane : frustum.planes)
+	{
+		float x = plane.x >= 0 ? box.maximum.x : box.minimum.x;
+		float y = plane.y >= 0 ? box.maximum.y : box.minimum.y;
+		float z = plane.z >= 0 ? box.maximum.z : box.minimum.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0)  return false;
+	}
+	return true;
+}
+
+
+// Write the visible flags for a pack of bounds from the smallest distance in front of any plane, return the number visible
+template <typename F>
+static unsigned int StoreVisible(F nearestDistance, unsigned char* visible)
+{
+	int bits = MaskBits(nearestDistance >= Splat(0.0f, F()));
+	unsigned int visibleCount = 0;
+	for (int lane = 0; lane < F::Lanes; ++lane)
+	{
+		visible[lane] = (bits >> lane) & 1;
+		visibleCount += visible[lane];
+	}
+	return visibleCount;
+}
+
+// Cull spheres with the given pack type
+template <typename F>
+static unsigned int CullSphereStreams(const Frustum& frustum, const SphereStreams& spheres, unsigned int count, unsigned char* visible)
+{
+	unsigned int visibleCount = 0;
+	ForEachPack<F>(count, [&](auto pack, unsigned int i)
+	{
+		using G = decltype(pack);
+		G x = Load(spheres.x + i, G());
+		G y = Load(spheres.y + i, G());
+		G z = Load(spheres.z + i, G());
+		G radius = Load(spheres.radius + i, G());
+
+		// Distance + radius is below zero for any plane the sphere is outside, so keep the smallest
+		G nearest = Splat(std::numeric_limits<float>::max(), G());
+		for (auto& plane : frustum.planes)
+		{
+			G distance = x * plane.x + y * plane.y + z * plane.z + plane.w;
+			nearest = Min(nearest, distance + radius);
+		}
+		visibleCount += StoreVisible(nearest, visible + i);
+	});
+	return visibleCount;
+}
+
+// Cull boxes with the given pack type
+template <typename F>
+static unsigned int CullBoxStreams(const Frustum& frustum, const BoxStreams& boxes, unsigned int count, unsigned char* visible)
+{
+	// The positive vertex of each plane is chosen from the same corner of every box, so pick the arrays before the loop. Boxes from
+	// EmptyBox have every corner far behind every plane, so need no special case
+	const float* cornerX[NumFrustumPlanes];
+	const float* cornerY[NumFrustumPlanes];
+	const float* cornerZ[NumFrustumPlanes];
+	for (int p = 0; p < NumFrustumPlanes; ++p)
+	{
+		cornerX[p] = frustum.planes[p].x >= 0 ? boxes.maxX : boxes.minX;
+		cornerY[p] = frustum.planes[p].y >= 0 ? boxes.maxY : boxes.minY;
+		cornerZ[p] = frustum.planes[p].z >= 0 ? boxes.maxZ : boxes.minZ;
+	}
+
+	unsigned int visibleCount = 0;
+	ForEachPack<F>(count, [&](auto pack, unsigned int i)
+	{
+		using G = decltype(pack);
+		G nearest = Splat(std::numeric_limits<float>::max(), G());
+		for (int p = 0; p < NumFrustumPlanes; ++p)
+		{
+			const CVector4& plane = frustum.planes[p];
+			G distance = Load(cornerX[p] + i, G()) * plane.x + Load(cornerY[p] + i, G()) * plane.y +
+			             Load(cornerZ[p] + i, G()) * plane.z + plane.w;
+			nearest = Min(nearest, distance);
+		}
+		visibleCount += StoreVisible(nearest, visible + i);
+	});
+	return visibleCount;
+}
+
+
+// Cull count spheres, setting visible[i] to 1 for those that may be inside the frustum. Returns the number visible
+unsigned int CullSpheres(const Frustum& frustum, const SphereStreams& spheres, unsigned int count, unsigned char* visible,
+                         int lanes /*= 0*/)
+{
+	unsigned int visibleCount = 0;
+	WithPack(lanes, [&](auto pack) { visibleCount = CullSphereStreams<decltype(pack)>(frustum, spheres, count, visible); });
+	return visibleCount;
+}
+
+// Cull count boxes, setting visible[i] to 1 for those that may be inside the frustum. Returns the number visible
+unsigned int CullBoxes(const Frustum& frustum, const BoxStreams& boxes, unsigned int count, unsigned char* visible,
+                       int lanes /*= 0*/)
+{
+	unsigned int visibleCount = 0;
+	WithPack(lanes, [&](auto pack) { visibleCount = CullBoxStreams<decltype(pack)>(frustum, boxes, count, visible); });
+	return visibleCount;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time culling the given number of random spheres and boxes around a camera, each repeats times. Also checks the results
+CullingBenchmark BenchmarkCulling(unsigned int count, unsigned int repeats)
+{
+	using Clock = std::chrono::steady_clock;
+	CullingBenchmark result;
+	result.count = count;
+	if (count == 0 || repeats == 0)  return result;
+
+	// A camera looking across a field of objects, so some are in view, some to the side and some behind
+	CMatrix4x4 view = InverseAffine(MatrixRotationX(0.3f) * MatrixRotationY(0.8f) * MatrixTranslation({ 0, 100, -800 }));
+	CMatrix4x4 projection = { 1.3f, 0, 0, 0,   0, 1.7f, 0, 0,   0, 0, 1.0001f, 1,   0, 0, -0.10001f, 0 };
+	Frustum frustum = FrustumFromMatrix(view * projection);
+
+	// Fixed seed so every run times the same bounds
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> coordinate(-2000.0f, 2000.0f);
+	std::uniform_real_distribution<float> size(0.5f, 50.0f);
+	std::vector<float> x(count), y(count), z(count), radius(count);
+	std::vector<float> minX(count), minY(count), minZ(count), maxX(count), maxY(count), maxZ(count);
+	std::vector<BoundingSphere> spheres(count);
+	std::vector<BoundingBox> boxes(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		x[i] = coordinate(generator);  y[i] = coordinate(generator) * 0.1f;  z[i] = coordinate(generator);  radius[i] = size(generator);
+		spheres[i] = { { x[i], y[i], z[i] }, radius[i] };
+		minX[i] = x[i] - size(generator);  minY[i] = y[i] - size(generator);  minZ[i] = z[i] - size(generator);
+		maxX[i] = x[i] + size(generator);  maxY[i] = y[i] + size(generator);  maxZ[i] = z[i] + size(generator);
+		boxes[i] = { { minX[i], minY[i], minZ[i] }, { maxX[i], maxY[i], maxZ[i] } };
+	}
+	SphereStreams sphereStreams = { x.data(), y.data(), z.data(), radius.data() };
+	BoxStreams boxStreams = { minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data() };
+
+	// Brute-force results: a sphere is outside if it is behind any plane, a box if all 8 of its corners are behind any plane
+	std::vector<unsigned char> sphereReference(count), boxReference(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		sphereReference[i] = 1;
+		boxReference[i] = 1;
+		for (auto& plane : frustum.planes)
+		{
+			if (plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w < -radius[i])  sphereReference[i] = 0;
+
+			bool allBehind = true;
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				float cornerX = (corner & 1) ? maxX[i] : minX[i];
+				float cornerY = (corner & 2) ? maxY[i] : minY[i];
+				float cornerZ = (corner & 4) ? maxZ[i] : minZ[i];
+				if (plane.x * cornerX + plane.y * cornerY + plane.z * cornerZ + plane.w >= 0)  allBehind = false;
+			}
+			if (allBehind)  boxReference[i] = 0;
+		}
+	}
+
+	// Check every pack width and the single tests against the brute-force results
+	std::vector<unsigned char> visible(count);
+	result.match = true;
+	for (int lanes : { 1, 4, 8 })
+	{
+		result.spheresVisible = CullSpheres(frustum, sphereStreams, count, visible.data(), lanes);
+		result.match = result.match && visible == sphereReference;
+		result.boxesVisible = CullBoxes(frustum, boxStreams, count, visible.data(), lanes);
+		result.match = result.match && visible == boxReference;
+	}
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		result.match = result.match && IsVisible(frustum, spheres[i]) == (sphereReference[i] != 0) &&
+		                               IsVisible(frustum, boxes[i]) == (boxReference[i] != 0);
+	}
+
+	// Millions of bounds per second running the given function
+	auto time = [&](auto cull)
+	{
+		cull(); // Warm up
+		auto start = Clock::now();
+		for (unsigned int repeat = 0; repeat < repeats; ++repeat)  cull();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		return seconds > 0 ? count * static_cast<double>(repeats) / (seconds * 1000000.0) : 0;
+	};
+
+	result.sphereSingleMPS = time([&]() { for (unsigned int i = 0; i < count; ++i)  visible[i] = IsVisible(frustum, spheres[i]); });
+	result.sphereScalarMPS = time([&]() { CullSpheres(frustum, sphereStreams, count, visible.data(), 1); });
+	result.sphereSIMDMPS   = time([&]() { CullSpheres(frustum, sphereStreams, count, visible.data()); });
+	result.boxSingleMPS    = time([&]() { for (unsigned int i = 0; i < count; ++i)  visible[i] = IsVisible(frustum, boxes[i]); });
+	result.boxScalarMPS    = time([&]() { CullBoxes(frustum, boxStreams, count, visible.data(), 1); });
+	result.boxSIMDMPS      = time([&]() { CullBoxes(frustum, boxStreams, count, visible.data()); });
+
+	return result;
+}
@@ -0,0 +1,141 @@
+//--------------------------------------------------------------------------------------
+// View frustum - the six planes bounding what a camera can see - and culling against it
+//--------------------------------------------------------------------------------------
+// Planes are extracted from a view-projection matrix, so they are in world space. Each plane is
+// held as (a, b, c, d) where points with a*x + b*y + c*z + d >= 0 are on the inside. (a, b, c) is
+// unit length, so the value is also the distance from the plane
+//
+// Bounding spheres and boxes are culled if they are entirely outside any one plane. That is
+// conservative: a few bounds near the corners of the frustum are kept when they can't be seen.
+// Many bounds can be culled at once from arrays of each component (structure of arrays), 8 at a
+// time with AVX2, 4 with SSE4.1 (see SIMDPack.h)
+
+#ifndef _FRUSTUM_H_DEFINED_
+#define _FRUSTUM_H_DEFINED_
+
+#include "CVector3.h"
+#include "CVector4.h"
+#include "CMatrix4x4.h"
+
+
+// Index of each plane in Frustum::planes
+enum FrustumPlane
+{
+	FrustumLeft,
+	FrustumRight,
+	FrustumBottom,
+	FrustumTop,
+	FrustumNear,
+	FrustumFar,
+	NumFrustumPlanes
+};
+
+struct Frustum
+{
+	CVector4 planes[NumFrustumPlanes];
+};
+
+
+// Return the frustum of the given view-projection matrix, for a projection giving depths 0 to 1 like MakeProjectionMatrix.
+// Pass a world-view-projection matrix to get the planes in model space instead
+Frustum FrustumFromMatrix(const CMatrix4x4& viewProjection);
+
+
+//--------------------------------------------------------------------------------------
+// Bounding volumes
+//--------------------------------------------------------------------------------------
+
+struct BoundingSphere
+{
+	CVector3 centre;
+	float    radius;
+};
+
+// Axis-aligned bounding box. A box with minimum above maximum is empty, see EmptyBox
+struct BoundingBox
+{
+	CVector3 minimum;
+	CVector3 maximum;
+};
+
+// Return a box holding nothing, which points and boxes can be added to
+BoundingBox EmptyBox();
+
+// True if the box holds nothing
+bool IsEmpty(const BoundingBox& box);
+
+// Return the box enlarged to hold the given point or box
+BoundingBox AddToBox(const BoundingBox& box, const CVector3& point);
+BoundingBox AddToBox(const BoundingBox& box, const BoundingBox& add);
+
+// Return the axis-aligned box holding the given box after transforming by an affine matrix. An empty box stays empty
+BoundingBox TransformBox(const BoundingBox& box, const CMatrix4x4& m);
+
+// Return a sphere holding the given box
+BoundingSphere SphereAroundBox(const BoundingBox& box);
+
+
+//--------------------------------------------------------------------------------------
+// Culling
+//--------------------------------------------------------------------------------------
+
+// True if any of the sphere or box may be inside the frustum. Empty boxes are never visible
+bool IsVisible(const Frustum& frustum, const BoundingSphere& sphere);
+bool IsVisible(const Frustum& frustum, const BoundingBox& box);
+
+
+// Pointers to the first of count sphere centres and radii
+struct SphereStreams
+{
+	const float* x      = nullptr;
+	const float* y      = nullptr;
+	const float* z      = nullptr;
+	const float* radius = nullptr;
+};
+
+// Pointers to the first of count box minimum and maximum corners
+struct BoxStreams
+{
+	const float* minX = nullptr;
+	const float* minY = nullptr;
+	const float* minZ = nullptr;
+	const float* maxX = nullptr;
+	const float* maxY = nullptr;
+	const float* maxZ = nullptr;
+};
+
+// Cull count spheres or boxes, setting visible[i] to 1 for those that may be inside the frustum and 0 for the others. Gives the
+// same results as calling IsVisible on each one (boxes that are empty must come from EmptyBox). The lanes parameter chooses the pack width: 8 (AVX2), 4 (SSE4.1) or 1 (plain
+// C++), any other value or one the CPU doesn't support uses the widest it does. Returns the number visible
+unsigned int CullSpheres(const Frustum& frustum, const SphereStreams& spheres, unsigned int count, unsigned char* visible,
+                         int lanes = 0);
+unsigned int CullBoxes(const Frustum& frustum, const BoxStreams& boxes, unsigned int count, unsigned char* visible,
+                       int lanes = 0);
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Results of BenchmarkCulling, all in millions of bounds per second on one thread
+struct CullingBenchmark
+{
+	unsigned int count = 0;
+
+	double sphereSingleMPS = 0; // IsVisible on each sphere
+	double sphereScalarMPS = 0; // CullSpheres, plain C++
+	double sphereSIMDMPS   = 0; // CullSpheres, widest pack the CPU supports
+	double boxSingleMPS    = 0; // The same for boxes
+	double boxScalarMPS    = 0;
+	double boxSIMDMPS      = 0;
+
+	unsigned int spheresVisible = 0;
+	unsigned int boxesVisible   = 0;
+	bool match = false; // True if all pack widths gave the same results as a brute-force test of every corner or plane
+};
+
+// Time culling the given number of random spheres and boxes around a camera, each repeats times. Also checks the results
+CullingBenchmark BenchmarkCulling(unsigned int count, unsigned int repeats);
+
+
+#endif // _FRUSTUM_H_DEFINED_
@@ -5,21 +5,22 @@
 #ifndef _MATH_HELPERS_H_DEFINED_
 #define _MATH_HELPERS_H_DEFINED_
 
+#include "CRandom.h"
 #include <cmath>
 #include <stdint.h>
 
 
 // Surprisingly, pi is not *officially* defined anywhere in C++
-const float PI = 3.14159265359f;
+constexpr float PI = 3.14159265359f;
 
 
 
 // Test if a float value is approximately 0
 // Epsilon value is the range around zero that is considered equal to zero
-const float EPSILON = 0.5e-6f; // For 32-bit floats, requires zero to 6 decimal places
-inline bool IsZero(const float x)
+constexpr float EPSILON = 0.5e-6f; // For 32-bit floats, requires zero to 6 decimal places
+constexpr bool IsZero(const float x)
 {
-    return std::abs(x) < EPSILON;
+    return x < EPSILON && x > -EPSILON;
 }
 
 
@@ -44,31 +45,58 @@ constexpr float ToDegrees(float r)
 
 
 
+// Choice of trigonometry for functions that can use either, such as MatrixRotationX. The fast versions are in FastTrig.h
+enum class TrigPolicy
+{
+    Precise, // Standard library
+    Fast,    // Polynomial approximations, within about one float step of the standard library and several times faster
+};
+
+
+// Compile-time sine, cosine and tangent of an angle in radians, for constants such as rotation matrices built from literal
+// angles (std::sin etc. can't be used in constexpr functions). Accurate to float precision, but much slower than std::sin
+// if called at run time
+constexpr double ConstexprSinDouble(double r)
+{
+	// Bring the angle into the range -pi to pi, then sum the Taylor series, which converges quickly over that range
+	const double pi = 3.14159265358979323846;
+	r -= 2 * pi * static_cast<long long>(r / (2 * pi));
+	if      (r >  pi)  r -= 2 * pi;
+	else if (r < -pi)  r += 2 * pi;
+
+	double term = r;
+	double sum  = r;
+	for (int n = 1; n < 15; ++n)
+	{
+		term *= -r * r / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr float ConstexprSin(float r)  { return static_cast<float>(ConstexprSinDouble(r)); }
+constexpr float ConstexprCos(float r)  { return static_cast<float>(ConstexprSinDouble(r + 1.57079632679489661923)); }
+constexpr float ConstexprTan(float r)  { return static_cast<float>(ConstexprSinDouble(r) / ConstexprSinDouble(r + 1.57079632679489661923)); }
+
+
+
 // Return random integer from a to b (inclusive)
-// Can only return up to RAND_MAX different values, spread evenly across the given range
-// RAND_MAX is defined in stdlib.h and is compiler-specific (32767 on VS-2005, higher elsewhere)
+// Uses the calling thread's own generator (see CRandom.h), so is safe to call from any thread
 inline uint32_t Random(const uint32_t a, const uint32_t b)
 {
-	// Could just use a + rand() % (b-a), but using a more complex form to allow range
-	// to exceed RAND_MAX and still return values spread across the range
-	uint32_t t = (b - a + 1) * rand();
-	return t == 0 ? a : a + (t - 1) / RAND_MAX;
+	return ThreadRandom().NextUInt(a, b);
 }
 
-// Return random 32-bit float from a to b (inclusive)
-// Can only return up to RAND_MAX different values, spread evenly across the given range
-// RAND_MAX is defined in stdlib.h and is compiler-specific (32767 on VS-2005, higher elsewhere)
+// Return random 32-bit float from a to b (excluding b), one of 2^24 values spread evenly across the range
 inline float Random(const float a, const float b)
 {
-	return a + (b - a) * (static_cast<float>(rand()) / RAND_MAX);
+	return ThreadRandom().NextFloat(a, b);
 }
 
-// Return random 64-bit float from a to b (inclusive)
-// Can only return up to RAND_MAX different values, spread evenly across the given range
-// RAND_MAX is defined in stdlib.h and is compiler-specific (32767 on VS-2005, higher elsewhere)
+// Return random 64-bit float from a to b (excluding b), one of 2^53 values spread evenly across the range
 inline double Random(const double a, const double b)
 {
-	return a + (b - a) * (static_cast<double>(rand()) / RAND_MAX);
+	return a + (b - a) * ThreadRandom().NextDouble();
 }
 
 // Find the minimum of three numbers (helper function for exercise below)
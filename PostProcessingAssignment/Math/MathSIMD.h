@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------
+// Compile-time choice of SIMD instruction set for the maths classes
+//--------------------------------------------------------------------------------------
+// MATH_SIMD is set to one of the values below from the compiler settings: AVX if the compiler
+// targets it (/arch:AVX or -mavx), otherwise SSE2 on x86 (always available on x64), NEON on
+// ARM, or plain C++ for anything else. To force a choice (e.g. MATH_SIMD_SCALAR to compare
+// against the SIMD code) define MATH_SIMD in the project's preprocessor definitions so every
+// file uses the same one.
+//
+// Unlike SIMDPack.h, which picks an instruction set at run time, these are fixed when compiling,
+// so they are only used for instruction sets the compiler already assumes the CPU supports
+
+#ifndef _MATH_SIMD_H_DEFINED_
+#define _MATH_SIMD_H_DEFINED_
+
+#include "FloatContraction.h" // The SIMD functions are checked bit for bit against plain C++
+
+#define MATH_SIMD_SCALAR 0 // Plain C++
+#define MATH_SIMD_SSE2   1 // 4 floats at a time
+#define MATH_SIMD_AVX    2 // SSE2 plus 8 floats at a time where it helps
+#define MATH_SIMD_NEON   3 // ARM, 4 floats at a time
+
+#ifndef MATH_SIMD
+	#if defined(__AVX__)
+		#define MATH_SIMD MATH_SIMD_AVX
+	#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define MATH_SIMD MATH_SIMD_SSE2
+	#elif defined(__ARM_NEON) || defined(_M_ARM64)
+		#define MATH_SIMD MATH_SIMD_NEON
+	#else
+		#define MATH_SIMD MATH_SIMD_SCALAR
+	#endif
+#endif
+
+#if MATH_SIMD == MATH_SIMD_AVX
+	#include <immintrin.h>
+#elif MATH_SIMD == MATH_SIMD_SSE2
+	#include <emmintrin.h>
+#elif MATH_SIMD == MATH_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
+
+// Return the name of the instruction set chosen, for display
+inline const char* MathSIMDName()
+{
+#if MATH_SIMD == MATH_SIMD_AVX
+	return "AVX";
+#elif MATH_SIMD == MATH_SIMD_SSE2
+	return "SSE2";
+#elif MATH_SIMD == MATH_SIMD_NEON
+	return "NEON";
+#else
+	return "Scalar";
+#endif
+}
+
+
+#endif // _MATH_SIMD_H_DEFINED_
@@ -0,0 +1,244 @@
+//--------------------------------------------------------------------------------------
+// Matrix benchmark - times the SIMD matrix operations against the scalar versions
+//--------------------------------------------------------------------------------------
+
+#include "MatrixBenchmark.h"
+#include "CMatrix4x4.h"
+
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <algorithm>
+
+
+// Time two versions of an operation run on every index from 0 to count-1, repeats times each, and compare their results
+template <typename Result, typename Scalar, typename SIMD>
+static MatrixOpBenchmark TimeOp(const char* name, unsigned int count, unsigned int repeats, Scalar scalarOp, SIMD simdOp)
+{
+	MatrixOpBenchmark result;
+	result.name = name;
+
+	std::vector<Result> scalarResults(count), simdResults(count);
+	auto time = [&](std::vector<Result>& results, auto op)
+	{
+		for (unsigned int i = 0; i < count; ++i)  results[i] = op(i); // Warm up
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+		{
+			for (unsigned int i = 0; i < count; ++i)  results[i] = op(i);
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return seconds * 1000000000.0 / (static_cast<double>(count) * repeats);
+	};
+	result.scalarNs = time(scalarResults, scalarOp);
+	result.simdNs   = time(simdResults, simdOp);
+	if (result.simdNs > 0)  result.speedup = result.scalarNs / result.simdNs;
+
+	// Compare the bits, so -0 against 0 or different NaNs count as differences
+	result.bitExact = std::memcmp(scalarResults.data(), simdResults.data(), count * sizeof(Result)) == 0;
+	return result;
+}
+
+
+// Time matrix-matrix multiplication, vector-matrix transforms and transposes on the given number of random matrices, with the
+// scalar and SIMD versions
+MatrixBenchmark BenchmarkMatrixOps(unsigned int count, unsigned int repeats)
+{
+	if (count == 0 || repeats == 0)  return {};
+
+	// Random values over a wide range of sizes and both signs, the same each run, plus a few special matrices
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> mantissa(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> exponent(-20, 20);
+	auto randomFloat = [&]() { return std::ldexp(mantissa(random), exponent(random)); };
+
+	std::vector<CMatrix4x4> matrices(count + 1);
+	std::vector<CVector4>   vectors(count);
+	for (auto& m : matrices)
+	{
+		float* values = &m.e00;
+		for (int i = 0; i < 16; ++i)  values[i] = randomFloat();
+	}
+	for (auto& v : vectors)  v = { randomFloat(), randomFloat(), randomFloat(), randomFloat() };
+	matrices[0] = MatrixIdentity();
+	if (count > 1)  matrices[1] = MatrixRotationY(1.0f) * MatrixTranslation({ 10.0f, -20.0f, 30.0f });
+	if (count > 2)  matrices[2] = MatrixScaling(-0.0f);
+
+	MatrixBenchmark benchmark;
+	benchmark.simd = MathSIMDName();
+
+	// Each matrix times the next one
+	benchmark.ops.push_back(TimeOp<CMatrix4x4>("Multiply", count, repeats,
+		[&](unsigned int i) { return MatrixMultiplyScalar(matrices[i], matrices[i + 1]); },
+		[&](unsigned int i) { return matrices[i] * matrices[i + 1]; }));
+
+	benchmark.ops.push_back(TimeOp<CVector4>("Transform", count, repeats,
+		[&](unsigned int i) { return MatrixTransformScalar(vectors[i], matrices[i]); },
+		[&](unsigned int i) { return vectors[i] * matrices[i]; }));
+
+	benchmark.ops.push_back(TimeOp<CMatrix4x4>("Transpose", count, repeats,
+		[&](unsigned int i) { return MatrixTransposeScalar(matrices[i]); },
+		[&](unsigned int i) { CMatrix4x4 m = matrices[i]; m.Transpose(); return m; }));
+
+	// In-place multiplication, including by itself. Both versions work on a copy that has just been written, the case where the
+	// SIMD version must wait for the stores to reach its loads
+	benchmark.ops.push_back(TimeOp<CMatrix4x4>("Multiply in place", count, repeats,
+		[&](unsigned int i) { CMatrix4x4 m = matrices[i]; m = MatrixMultiplyScalar(m, m); return m; },
+		[&](unsigned int i) { CMatrix4x4 m = matrices[i]; m *= m; return m; }));
+
+	// Matrices with no inverse are left unchanged by both. The scalar version makes the same checks as Inverse with no tolerance
+	benchmark.ops.push_back(TimeOp<CMatrix4x4>("Inverse", count, repeats,
+		[&](unsigned int i)
+		{
+			const CMatrix4x4& m = matrices[i];
+			CMatrix4x4 inverse = MatrixAdjugateScalar(m);
+			float det = m.e00*inverse.e00 + m.e01*inverse.e10 + m.e02*inverse.e20 + m.e03*inverse.e30;
+			if (det == 0 || !std::isfinite(det))  return m;
+
+			float invDet = 1.0f / det;
+			float* values = &inverse.e00;
+			for (int e = 0; e < 16; ++e)  values[e] *= invDet;
+			return inverse;
+		},
+		[&](unsigned int i) { CMatrix4x4 m = matrices[i]; Inverse(matrices[i], m, 0.0f); return m; }));
+
+	benchmark.bitExact = true;
+	for (auto& op : benchmark.ops)  benchmark.bitExact = benchmark.bitExact && op.bitExact;
+	return benchmark;
+}
+
+
+// Largest difference of any element of m1 from m2
+static float Difference(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+	const float* e1 = &m1.e00;
+	const float* e2 = &m2.e00;
+	float difference = 0;
+	for (int i = 0; i < 16; ++i)  difference = std::max(difference, std::abs(e1[i] - e2[i]));
+	return difference;
+}
+
+// Largest difference of any element of inverse from the inverse of m worked out in doubles (Gauss-Jordan elimination with
+// partial pivoting), relative to the largest element of that inverse
+static float InverseError(const CMatrix4x4& m, const CMatrix4x4& inverse)
+{
+	double a[4][8];
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			a[i][j] = (&m.e00)[i * 4 + j];
+			a[i][j + 4] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+	for (int column = 0; column < 4; ++column)
+	{
+		int pivot = column;
+		for (int i = column + 1; i < 4; ++i)
+		{
+			if (std::abs(a[i][column]) > std::abs(a[pivot][column]))  pivot = i;
+		}
+		for (int j = 0; j < 8; ++j)  std::swap(a[column][j], a[pivot][j]);
+		for (int i = 0; i < 4; ++i)
+		{
+			if (i == column)  continue;
+			double factor = a[i][column] / a[column][column];
+			for (int j = 0; j < 8; ++j)  a[i][j] -= factor * a[column][j];
+		}
+	}
+
+	double largest = 0, difference = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			double expected = a[i][j + 4] / a[i][i];
+			largest = std::max(largest, std::abs(expected));
+			difference = std::max(difference, std::abs((&inverse.e00)[i * 4 + j] - expected));
+		}
+	}
+	return static_cast<float>(difference / largest);
+}
+
+
+// Invert and decompose the given number of random matrices of each kind and check the results
+MatrixInverseAccuracy CheckMatrixInverses(unsigned int count)
+{
+	MatrixInverseAccuracy result;
+	result.singularRejected = true;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> angle(-3.1f, 3.1f);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	auto randomRotation = [&]() { return MatrixRotationZ(angle(random)) * MatrixRotationX(angle(random)) * MatrixRotationY(angle(random)); };
+	auto randomScale = [&](float largestPower)
+	{
+		std::uniform_real_distribution<float> power(-largestPower, largestPower);
+		return CVector3{ std::pow(10.0f, power(random)), std::pow(10.0f, power(random)), std::pow(10.0f, power(random)) };
+	};
+
+	for (unsigned int n = 0; n < count; ++n)
+	{
+		// Rotation, scale and translation
+		CMatrix4x4 m = MatrixScaling(randomScale(1.0f)) * randomRotation() * MatrixTranslation({ position(random), position(random), position(random) });
+		CMatrix4x4 inverse;
+		if (!Inverse(m, inverse))  return result;
+		result.wellConditionedError = std::max(result.wellConditionedError, InverseError(m, inverse));
+		result.affineDifference = std::max(result.affineDifference, InverseError(m, InverseAffine(m)));
+
+		// Very different scales after a rotation, then a shear
+		CMatrix4x4 shear = MatrixIdentity();
+		shear.e10 = unit(random);  shear.e20 = unit(random);  shear.e21 = unit(random);
+		CMatrix4x4 ill = MatrixScaling(randomScale(3.0f)) * randomRotation() * shear * MatrixTranslation({ position(random), position(random), position(random) });
+		if (!Inverse(ill, inverse))  return result;
+		result.illConditionedError = std::max(result.illConditionedError, InverseError(ill, inverse));
+
+		// Perspective projections as Camera makes them
+		std::uniform_real_distribution<float> fov(0.3f, 2.5f), nearPower(-2.0f, 0.0f), farPower(2.0f, 5.0f);
+		float scaleX = 1.0f / std::tan(fov(random) * 0.5f);
+		float nearClip = std::pow(10.0f, nearPower(random));
+		float farClip  = std::pow(10.0f, farPower(random));
+		float scaleZa = farClip / (farClip - nearClip);
+		CMatrix4x4 projection = { scaleX, 0, 0, 0,   0, scaleX * 1.7f, 0, 0,   0, 0, scaleZa, 1,   0, 0, -nearClip * scaleZa, 0 };
+		CMatrix4x4 viewProjection = randomRotation() * projection;
+		if (!Inverse(viewProjection, inverse))  return result;
+		result.projectionError = std::max(result.projectionError, InverseError(viewProjection, inverse));
+
+		// Polar decomposition of the sheared matrix, the two parts should rebuild it and the orthogonal part should be square
+		CMatrix4x4 stretch, orthogonal, transpose;
+		if (!PolarDecompose(ill, stretch, orthogonal))  return result;
+		ill.SetRow(3, { 0, 0, 0 });
+		float size = std::max({ Length(ill.GetXAxis()), Length(ill.GetYAxis()), Length(ill.GetZAxis()) });
+		transpose = orthogonal;
+		transpose.Transpose();
+		result.polarError = std::max({ result.polarError, Difference(stretch * orthogonal, ill) / size,
+		                               Difference(orthogonal * transpose, MatrixIdentity()) });
+
+		// Rotations with drift added, as after many small rotations
+		CMatrix4x4 drifted = randomRotation();
+		float* values = &drifted.e00;
+		for (int i = 0; i < 11; ++i)
+		{
+			if (i % 4 != 3)  values[i] += unit(random) * 0.01f;
+		}
+		drifted.Orthonormalise();
+		transpose = drifted;
+		transpose.Transpose();
+		result.orthonormaliseError = std::max(result.orthonormaliseError, Difference(drifted * transpose, MatrixIdentity()));
+
+		// Singular: a row that is a mix of two others, which is only singular to within float rounding, and a zero scale
+		CMatrix4x4 singular = m;
+		singular.SetRow(2, singular.GetXAxis() * unit(random) + singular.GetYAxis() * unit(random));
+		CMatrix4x4 flattened = m * MatrixScaling({ 1.0f, 0.0f, 1.0f });
+		bool rejected = !Inverse(singular, inverse) && !PolarDecompose(singular, stretch, orthogonal) &&
+		                !Inverse(flattened, inverse) && !PolarDecompose(flattened, stretch, orthogonal);
+		result.singularRejected = result.singularRejected && rejected;
+	}
+
+	// Float precision is about 6e-8, the inverse errors grow with the condition number of the matrix
+	result.passed = result.singularRejected && result.wellConditionedError < 1e-5f && result.affineDifference < 1e-5f &&
+	                result.illConditionedError < 1e-4f && result.projectionError < 1e-5f && result.polarError < 1e-5f &&
+	                result.orthonormaliseError < 2e-6f;
+	return result;
+}
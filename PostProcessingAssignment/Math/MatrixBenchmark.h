@@ -0,0 +1,53 @@
+//--------------------------------------------------------------------------------------
+// Matrix benchmark - times the SIMD matrix operations against the scalar versions
+//--------------------------------------------------------------------------------------
+// Also checks that every SIMD result is exactly the same as the scalar one
+
+#ifndef _MATRIX_BENCHMARK_H_DEFINED_
+#define _MATRIX_BENCHMARK_H_DEFINED_
+
+#include <vector>
+
+
+// Timings for one operation, in nanoseconds per operation averaged over all repeats
+struct MatrixOpBenchmark
+{
+	const char* name     = "";
+	double      scalarNs = 0; // Scalar version, e.g. MatrixMultiplyScalar
+	double      simdNs   = 0; // Version chosen by MATH_SIMD, e.g. operator*
+	double      speedup  = 0;
+	bool        bitExact = false; // True if every result was exactly the same as the scalar one
+};
+
+// Results of BenchmarkMatrixOps
+struct MatrixBenchmark
+{
+	const char*                    simd = ""; // Name of the instruction set chosen by MATH_SIMD
+	std::vector<MatrixOpBenchmark> ops;       // Matrix multiply, vector transform, transpose and inverse
+	bool                           bitExact = false; // True if all ops were bit exact
+};
+
+// Time matrix-matrix multiplication, vector-matrix transforms and transposes on the given number of random matrices, with the
+// scalar and SIMD versions
+MatrixBenchmark BenchmarkMatrixOps(unsigned int count, unsigned int repeats);
+
+
+// Results of CheckMatrixInverses: the largest errors found. Inverse errors are the largest difference of any element from the
+// inverse worked out in doubles, relative to the largest element of that inverse
+struct MatrixInverseAccuracy
+{
+	float wellConditionedError = 0; // Inverse of rotations, scales from 0.1 to 10 and translations
+	float illConditionedError  = 0; // Inverse with scales from 0.001 to 1000 and shear (condition numbers up to about 10^6)
+	float projectionError      = 0; // Inverse of view-projections with near clip 0.01 to 1 and far clip up to 100000
+	float affineDifference     = 0; // InverseAffine on the well-conditioned matrices, for comparison
+	float polarError           = 0; // stretch * orthogonal from m (relative to m), and orthogonal * its transpose from the identity
+	float orthonormaliseError  = 0; // Axes of rotation matrices with drift added, after Orthonormalise, from unit length and square
+	bool  singularRejected     = false; // True if Inverse and PolarDecompose returned false for every singular or nearly singular matrix
+	bool  passed               = false; // True if the above and all the errors are within those expected for floats
+};
+
+// Invert and decompose the given number of random matrices of each kind above and check the results
+MatrixInverseAccuracy CheckMatrixInverses(unsigned int count);
+
+
+#endif // _MATRIX_BENCHMARK_H_DEFINED_
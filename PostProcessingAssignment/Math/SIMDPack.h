@@ -0,0 +1,269 @@
+//--------------------------------------------------------------------------------------
+// SIMD packs - 1, 4 or 8 floats / ints processed together
+//--------------------------------------------------------------------------------------
+// Code written as a template on the pack type runs on a single value (Float1, plain C++), four
+// values with SSE4.1 (Float4) or eight with AVX2 (Float8). Each pack type has matching Int and
+// Mask types and the same set of operations, so the code reads like ordinary scalar maths.
+//
+// The SSE and AVX2 versions must only be used on CPUs that support them, see SupportsSSE41 and
+// SupportsAVX2. All code is in this header so the compiler can inline it
+
+#ifndef _SIMD_PACK_H_DEFINED_
+#define _SIMD_PACK_H_DEFINED_
+
+#include "FloatContraction.h" // Packs of each size must give exactly the same results
+#include <immintrin.h>
+#include <cmath>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// CPU support
+//--------------------------------------------------------------------------------------
+
+// Return true if the CPU supports SSE4.1 instructions
+inline bool SupportsSSE41()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 19)) != 0;
+#else
+	return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+// Return true if the CPU supports AVX2 instructions and the OS saves the AVX registers
+inline bool SupportsAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	bool osSavesAVX = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	if (!osSavesAVX)  return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Return the number of lanes in the widest pack the CPU supports: 8 (AVX2), 4 (SSE4.1) or 1. Checked once
+inline int BestPackLanes()
+{
+	static const int lanes = SupportsAVX2() ? 8 : SupportsSSE41() ? 4 : 1;
+	return lanes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Single value - plain C++
+//--------------------------------------------------------------------------------------
+
+struct Int1  { int   v; };
+struct Mask1 { bool  v; };
+struct Float1
+{
+	using Int  = Int1;
+	using Mask = Mask1;
+	static const int Lanes = 1;
+
+	float v;
+};
+
+inline Float1 Splat(float f, Float1)           { return { f }; }
+inline Float1 Ramp(Float1)                     { return { 0 }; } // Lane numbers 0, 1, 2...
+inline Float1 Load(const float* p, Float1)     { return { *p }; }
+inline void   Store(float* p, Float1 a)        { *p = a.v; }
+
+inline Float1 operator+(Float1 a, Float1 b)    { return { a.v + b.v }; }
+inline Float1 operator-(Float1 a, Float1 b)    { return { a.v - b.v }; }
+inline Float1 operator*(Float1 a, Float1 b)    { return { a.v * b.v }; }
+inline Float1 operator/(Float1 a, Float1 b)    { return { a.v / b.v }; }
+inline Float1 Min(Float1 a, Float1 b)          { return { std::min(a.v, b.v) }; }
+inline Float1 Max(Float1 a, Float1 b)          { return { std::max(a.v, b.v) }; }
+inline Float1 Floor(Float1 a)                  { return { std::floor(a.v) }; }
+inline Float1 Sqrt(Float1 a)                   { return { std::sqrt(a.v) }; }
+inline Float1 Sin(Float1 a)                    { return { std::sin(a.v) }; }
+inline Float1 Cos(Float1 a)                    { return { std::cos(a.v) }; }
+
+inline Mask1  operator<(Float1 a, Float1 b)    { return { a.v <  b.v }; }
+inline Mask1  operator<=(Float1 a, Float1 b)   { return { a.v <= b.v }; }
+inline Mask1  operator>=(Float1 a, Float1 b)   { return { a.v >= b.v }; }
+inline Float1 Select(Mask1 m, Float1 a, Float1 b) { return m.v ? a : b; } // a where the mask is set, otherwise b
+inline int    MaskBits(Mask1 m)                { return m.v ? 1 : 0; }   // One bit for each lane, lane 0 in the lowest bit
+
+inline Int1   ToInt(Float1 a)                  { return { static_cast<int>(a.v) }; } // Rounds towards zero
+inline Int1   operator+(Int1 a, Int1 b)        { return { a.v + b.v }; }
+inline Int1   operator*(Int1 a, Int1 b)        { return { a.v * b.v }; }
+inline Int1   Clamp(Int1 a, int lo, int hi)    { return { std::min(std::max(a.v, lo), hi) }; }
+inline Int1   SplatInt(int i, Float1)          { return { i }; }
+inline void   Store(int* p, Int1 a)            { *p = a.v; }
+inline Float1 Gather(const float* table, Int1 i) { return { table[i.v] }; } // table[i] for each lane
+
+
+//--------------------------------------------------------------------------------------
+// Four values - SSE4.1
+//--------------------------------------------------------------------------------------
+
+struct Int4  { __m128i v; };
+struct Mask4 { __m128  v; };
+struct Float4
+{
+	using Int  = Int4;
+	using Mask = Mask4;
+	static const int Lanes = 4;
+
+	__m128 v;
+};
+
+inline Float4 Splat(float f, Float4)           { return { _mm_set1_ps(f) }; }
+inline Float4 Ramp(Float4)                     { return { _mm_setr_ps(0, 1, 2, 3) }; }
+inline Float4 Load(const float* p, Float4)     { return { _mm_loadu_ps(p) }; }
+inline void   Store(float* p, Float4 a)        { _mm_storeu_ps(p, a.v); }
+
+inline Float4 operator+(Float4 a, Float4 b)    { return { _mm_add_ps(a.v, b.v) }; }
+inline Float4 operator-(Float4 a, Float4 b)    { return { _mm_sub_ps(a.v, b.v) }; }
+inline Float4 operator*(Float4 a, Float4 b)    { return { _mm_mul_ps(a.v, b.v) }; }
+inline Float4 operator/(Float4 a, Float4 b)    { return { _mm_div_ps(a.v, b.v) }; }
+inline Float4 Min(Float4 a, Float4 b)          { return { _mm_min_ps(a.v, b.v) }; }
+inline Float4 Max(Float4 a, Float4 b)          { return { _mm_max_ps(a.v, b.v) }; }
+inline Float4 Floor(Float4 a)                  { return { _mm_floor_ps(a.v) }; }
+inline Float4 Sqrt(Float4 a)                   { return { _mm_sqrt_ps(a.v) }; }
+
+// No sine instruction, so each lane uses the standard library. Gives exactly the same results as Float1. See FastSin in
+// FastTrig.h for a much faster polynomial version
+inline Float4 Sin(Float4 a)
+{
+	alignas(16) float f[4];
+	_mm_store_ps(f, a.v);
+	return { _mm_setr_ps(std::sin(f[0]), std::sin(f[1]), std::sin(f[2]), std::sin(f[3])) };
+}
+inline Float4 Cos(Float4 a)
+{
+	alignas(16) float f[4];
+	_mm_store_ps(f, a.v);
+	return { _mm_setr_ps(std::cos(f[0]), std::cos(f[1]), std::cos(f[2]), std::cos(f[3])) };
+}
+
+inline Mask4  operator<(Float4 a, Float4 b)    { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline Mask4  operator<=(Float4 a, Float4 b)   { return { _mm_cmple_ps(a.v, b.v) }; }
+inline Mask4  operator>=(Float4 a, Float4 b)   { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline Float4 Select(Mask4 m, Float4 a, Float4 b) { return { _mm_blendv_ps(b.v, a.v, m.v) }; }
+inline int    MaskBits(Mask4 m)                { return _mm_movemask_ps(m.v); }
+
+inline Int4   ToInt(Float4 a)                  { return { _mm_cvttps_epi32(a.v) }; }
+inline Int4   operator+(Int4 a, Int4 b)        { return { _mm_add_epi32(a.v, b.v) }; }
+inline Int4   operator*(Int4 a, Int4 b)        { return { _mm_mullo_epi32(a.v, b.v) }; }
+inline Int4   Clamp(Int4 a, int lo, int hi)    { return { _mm_min_epi32(_mm_max_epi32(a.v, _mm_set1_epi32(lo)), _mm_set1_epi32(hi)) }; }
+inline Int4   SplatInt(int i, Float4)          { return { _mm_set1_epi32(i) }; }
+inline void   Store(int* p, Int4 a)            { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a.v); }
+inline Float4 Gather(const float* table, Int4 i)
+{
+	alignas(16) int index[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(index), i.v);
+	return { _mm_setr_ps(table[index[0]], table[index[1]], table[index[2]], table[index[3]]) };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Eight values - AVX2
+//--------------------------------------------------------------------------------------
+
+struct Int8  { __m256i v; };
+struct Mask8 { __m256  v; };
+struct Float8
+{
+	using Int  = Int8;
+	using Mask = Mask8;
+	static const int Lanes = 8;
+
+	__m256 v;
+};
+
+inline Float8 Splat(float f, Float8)           { return { _mm256_set1_ps(f) }; }
+inline Float8 Ramp(Float8)                     { return { _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7) }; }
+inline Float8 Load(const float* p, Float8)     { return { _mm256_loadu_ps(p) }; }
+inline void   Store(float* p, Float8 a)        { _mm256_storeu_ps(p, a.v); }
+
+inline Float8 operator+(Float8 a, Float8 b)    { return { _mm256_add_ps(a.v, b.v) }; }
+inline Float8 operator-(Float8 a, Float8 b)    { return { _mm256_sub_ps(a.v, b.v) }; }
+inline Float8 operator*(Float8 a, Float8 b)    { return { _mm256_mul_ps(a.v, b.v) }; }
+inline Float8 operator/(Float8 a, Float8 b)    { return { _mm256_div_ps(a.v, b.v) }; }
+inline Float8 Min(Float8 a, Float8 b)          { return { _mm256_min_ps(a.v, b.v) }; }
+inline Float8 Max(Float8 a, Float8 b)          { return { _mm256_max_ps(a.v, b.v) }; }
+inline Float8 Floor(Float8 a)                  { return { _mm256_floor_ps(a.v) }; }
+inline Float8 Sqrt(Float8 a)                   { return { _mm256_sqrt_ps(a.v) }; }
+
+inline Float8 Sin(Float8 a)
+{
+	alignas(32) float f[8];
+	_mm256_store_ps(f, a.v);
+	for (auto& x : f)  x = std::sin(x);
+	return { _mm256_load_ps(f) };
+}
+inline Float8 Cos(Float8 a)
+{
+	alignas(32) float f[8];
+	_mm256_store_ps(f, a.v);
+	for (auto& x : f)  x = std::cos(x);
+	return { _mm256_load_ps(f) };
+}
+
+inline Mask8  operator<(Float8 a, Float8 b)    { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline Mask8  operator<=(Float8 a, Float8 b)   { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+inline Mask8  operator>=(Float8 a, Float8 b)   { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+inline Float8 Select(Mask8 m, Float8 a, Float8 b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+inline int    MaskBits(Mask8 m)                { return _mm256_movemask_ps(m.v); }
+
+inline Int8   ToInt(Float8 a)                  { return { _mm256_cvttps_epi32(a.v) }; }
+inline Int8   operator+(Int8 a, Int8 b)        { return { _mm256_add_epi32(a.v, b.v) }; }
+inline Int8   operator*(Int8 a, Int8 b)        { return { _mm256_mullo_epi32(a.v, b.v) }; }
+inline Int8   Clamp(Int8 a, int lo, int hi)    { return { _mm256_min_epi32(_mm256_max_epi32(a.v, _mm256_set1_epi32(lo)), _mm256_set1_epi32(hi)) }; }
+inline Int8   SplatInt(int i, Float8)          { return { _mm256_set1_epi32(i) }; }
+inline void   Store(int* p, Int8 a)            { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a.v); }
+inline Float8 Gather(const float* table, Int8 i) { return { _mm256_i32gather_ps(table, i.v, 4) }; }
+
+
+//--------------------------------------------------------------------------------------
+// Operations written once for all packs
+//--------------------------------------------------------------------------------------
+
+// Mixing packs and single floats. The unused template parameter limits these to pack types
+template <typename F, int = F::Lanes> inline F operator+(F a, float b)  { return a + Splat(b, F()); }
+template <typename F, int = F::Lanes> inline F operator-(F a, float b)  { return a - Splat(b, F()); }
+template <typename F, int = F::Lanes> inline F operator*(F a, float b)  { return a * Splat(b, F()); }
+template <typename F, int = F::Lanes> inline F operator/(F a, float b)  { return a / Splat(b, F()); }
+template <typename F, int = F::Lanes> inline F operator+(float a, F b)  { return Splat(a, F()) + b; }
+template <typename F, int = F::Lanes> inline F operator-(float a, F b)  { return Splat(a, F()) - b; }
+template <typename F, int = F::Lanes> inline F operator*(float a, F b)  { return Splat(a, F()) * b; }
+
+// As the HLSL functions of the same name
+template <typename F, int = F::Lanes> inline F Saturate(F a)            { return Min(Max(a, Splat(0.0f, F())), Splat(1.0f, F())); }
+template <typename F, int = F::Lanes> inline F Lerp(F a, F b, F t)      { return a + t * (b - a); }
+
+
+// Run process(pack, i) over count items, packs of F first then single items. process is a generic function taking F or Float1
+template <typename F, typename ProcessFn>
+inline void ForEachPack(unsigned int count, ProcessFn process)
+{
+	unsigned int i = 0;
+	for (; i + F::Lanes <= count; i += F::Lanes)  process(F(), i);
+	for (; i < count; ++i)                        process(Float1(), i);
+}
+
+// Call fn with a default-constructed pack of the given number of lanes, or the widest the CPU supports if it doesn't support that
+template <typename Fn>
+inline void WithPack(int lanes, Fn fn)
+{
+	if ((lanes != 1 && lanes != 4 && lanes != 8) || lanes > BestPackLanes())  lanes = BestPackLanes();
+	if      (lanes == 8)  fn(Float8());
+	else if (lanes == 4)  fn(Float4());
+	else                  fn(Float1());
+}
+
+#endif // _SIMD_PACK_H_DEFINED_
@@ -0,0 +1,336 @@
+//--------------------------------------------------------------------------------------
+// Batched transforms - many points or vectors through one matrix at a time
+//--------------------------------------------------------------------------------------
+
+#include "TransformBatch.h"
+#include "SIMDPack.h"
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Packs
+//--------------------------------------------------------------------------------------
+
+// The matrix elements used by the transforms, each splatted across a pack
+template <typename F>
+struct MatrixPack
+{
+	F e00, e01, e02, e03;
+	F e10, e11, e12, e13;
+	F e20, e21, e22, e23;
+	F e30, e31, e32, e33;
+
+	explicit MatrixPack(const CMatrix4x4& m)
+	{
+		e00 = Splat(m.e00, F());  e01 = Splat(m.e01, F());  e02 = Splat(m.e02, F());  e03 = Splat(m.e03, F());
+		e10 = Splat(m.e10, F());  e11 = Splat(m.e11, F());  e12 = Splat(m.e12, F());  e13 = Splat(m.e13, F());
+		e20 = Splat(m.e20, F());  e21 = Splat(m.e21, F());  e22 = Splat(m.e22, F());  e23 = Splat(m.e23, F());
+		e30 = Splat(m.e30, F());  e31 = Splat(m.e31, F());  e32 = Splat(m.e32, F());  e33 = Splat(m.e33, F());
+	}
+};
+
+// A pack of transformed points
+template <typename F>
+struct PointPack
+{
+	F x, y, z, w;
+};
+
+
+// Return the matrix pack to use for a pack of points, the packed matrix for packs of F and the single one for single points
+template <typename F>
+static const MatrixPack<F>& MatrixFor(F, const MatrixPack<F>& packMatrix, const MatrixPack<Float1>&)
+{
+	return packMatrix;
+}
+template <typename F>
+static const MatrixPack<Float1>& MatrixFor(Float1, const MatrixPack<F>&, const MatrixPack<Float1>& singleMatrix)
+{
+	return singleMatrix;
+}
+static const MatrixPack<Float1>& MatrixFor(Float1, const MatrixPack<Float1>&, const MatrixPack<Float1>& singleMatrix)
+{
+	return singleMatrix; // When F is Float1 too
+}
+
+
+// Transform the pack of points or vectors starting at index i. Sums are in the same order as CVector4 * CMatrix4x4
+template <bool HasZ, bool IsPoint, typename F>
+static inline PointPack<F> TransformPack(const MatrixPack<F>& m, const ConstPointStreams& in, unsigned int i)
+{
+	F x = Load(in.x + i, F());
+	F y = Load(in.y + i, F());
+	PointPack<F> out;
+	out.x = x * m.e00 + y * m.e10;
+	out.y = x * m.e01 + y * m.e11;
+	out.z = x * m.e02 + y * m.e12;
+	out.w = x * m.e03 + y * m.e13;
+	if (HasZ)
+	{
+		F z = Load(in.z + i, F());
+		out.x = out.x + z * m.e20;
+		out.y = out.y + z * m.e21;
+		out.z = out.z + z * m.e22;
+		out.w = out.w + z * m.e23;
+	}
+	if (IsPoint)
+	{
+		out.x = out.x + m.e30;
+		out.y = out.y + m.e31;
+		out.z = out.z + m.e32;
+		out.w = out.w + m.e33;
+	}
+	return out;
+}
+
+
+// Transform points or vectors with the given pack type
+template <bool IsPoint, typename F>
+static void TransformStreams(const CMatrix4x4& matrix, const ConstPointStreams& in, unsigned int count, const PointStreams& out)
+{
+	// The matrix is splatted before the loops, as the compiler can't tell the output doesn't overwrite it. Checking for z and w
+	// once here leaves no branches in the loops
+	MatrixPack<F> packMatrix(matrix);
+	MatrixPack<Float1> singleMatrix(matrix);
+	auto transform = [&](auto hasZ, auto hasW)
+	{
+		ForEachPack<F>(count, [&](auto pack, unsigned int i)
+		{
+			auto p = TransformPack<decltype(hasZ)::value, IsPoint>(MatrixFor(pack, packMatrix, singleMatrix), in, i);
+			Store(out.x + i, p.x);
+			Store(out.y + i, p.y);
+			Store(out.z + i, p.z);
+			if (decltype(hasW)::value)  Store(out.w + i, p.w);
+		});
+	};
+	if      (in.z && out.w)  transform(std::true_type(),  std::true_type());
+	else if (in.z)           transform(std::true_type(),  std::false_type());
+	else if (out.w)          transform(std::false_type(), std::true_type());
+	else                     transform(std::false_type(), std::false_type());
+}
+
+
+// Project points with the given pack type, return the number behind the near clip
+template <typename F>
+static unsigned int ProjectStreams(const CMatrix4x4& matrix, float nearClip, float viewportWidth, float viewportHeight,
+                                   const ConstPointStreams& in, unsigned int count, const PointStreams& out, unsigned char* behind)
+{
+	MatrixPack<F> packMatrix(matrix);
+	MatrixPack<Float1> singleMatrix(matrix);
+	unsigned int behindCount = 0;
+	auto project = [&](auto hasZ)
+	{
+		ForEachPack<F>(count, [&](auto pack, unsigned int i)
+		{
+			using G = decltype(pack);
+			auto p = TransformPack<decltype(hasZ)::value, true>(MatrixFor(pack, packMatrix, singleMatrix), in, i);
+
+			// Same calculation as Camera::PixelFromWorldPt. For a perspective projection w is the distance in front of the camera
+			auto isBehind = p.w < Splat(nearClip, G());
+			G zero = Splat(0.0f, G());
+			Store(out.x + i, Select(isBehind, zero, (p.x / p.w + 1.0f) * viewportWidth  * 0.5f));
+			Store(out.y + i, Select(isBehind, zero, (1.0f - p.y / p.w) * viewportHeight * 0.5f));
+			Store(out.z + i, p.w);
+
+			int bits = MaskBits(isBehind);
+			for (int lane = 0; lane < G::Lanes; ++lane)
+			{
+				behind[i + lane] = (bits >> lane) & 1;
+				behindCount += behind[i + lane];
+			}
+		});
+	};
+	if (in.z)  project(std::true_type());
+	else       project(std::false_type());
+	return behindCount;
+}
+
+
+// Unproject pixels with the given pack type. Same calculation as Camera::WorldPtFromPixel
+template <typename F>
+static void UnprojectStreams(const CMatrix4x4& matrix, float viewportWidth, float viewportHeight, const ConstPointStreams& in,
+                             unsigned int count, const PointStreams& out)
+{
+	MatrixPack<F> packMatrix(matrix);
+	MatrixPack<Float1> singleMatrix(matrix);
+	const float scaleX = 2.0f / viewportWidth;
+	const float scaleY = 2.0f / viewportHeight;
+	ForEachPack<F>(count, [&](auto pack, unsigned int i)
+	{
+		using G = decltype(pack);
+		const auto& m = MatrixFor(pack, packMatrix, singleMatrix);
+		G x = Load(in.x + i, G()) * scaleX - 1.0f;
+		G y = 1.0f - Load(in.y + i, G()) * scaleY;
+		G z = Load(in.z + i, G());
+
+		// The viewport point has w = 1 so the last row is added unscaled
+		G worldX = x * m.e00 + y * m.e10 + z * m.e20 + m.e30;
+		G worldY = x * m.e01 + y * m.e11 + z * m.e21 + m.e31;
+		G worldZ = x * m.e02 + y * m.e12 + z * m.e22 + m.e32;
+		G worldW = x * m.e03 + y * m.e13 + z * m.e23 + m.e33;
+		Store(out.x + i, worldX / worldW);
+		Store(out.y + i, worldY / worldW);
+		Store(out.z + i, worldZ / worldW);
+	});
+}
+
+
+//--------------------------------------------------------------------------------------
+// Transforms
+//--------------------------------------------------------------------------------------
+
+// Transform count points (w = 1) by the given matrix
+void TransformPoints(const CMatrix4x4& m, const ConstPointStreams& points, unsigned int count, const PointStreams& out,
+                     int lanes /*= 0*/)
+{
+	WithPack(lanes, [&](auto pack) { TransformStreams<true, decltype(pack)>(m, points, count, out); });
+}
+
+// Transform count vectors (w = 0) by the given matrix, i.e. the translation is ignored
+void TransformVectors(const CMatrix4x4& m, const ConstPointStreams& vectors, unsigned int count, const PointStreams& out,
+                      int lanes /*= 0*/)
+{
+	WithPack(lanes, [&](auto pack) { TransformStreams<false, decltype(pack)>(m, vectors, count, out); });
+}
+
+
+// Project count world points to the viewport as Camera::PixelFromWorldPt does. Returns the number of points behind the near clip
+unsigned int ProjectToViewport(const CMatrix4x4& worldMatrix, const CMatrix4x4& viewProjectionMatrix, float nearClip,
+                               unsigned int viewportWidth, unsigned int viewportHeight, const ConstPointStreams& points,
+                               unsigned int count, const PointStreams& out, unsigned char* behind, int lanes /*= 0*/)
+{
+	CMatrix4x4 worldViewProjection = worldMatrix * viewProjectionMatrix;
+	unsigned int behindCount = 0;
+	WithPack(lanes, [&](auto pack)
+	{
+		behindCount = ProjectStreams<decltype(pack)>(worldViewProjection, nearClip, static_cast<float>(viewportWidth),
+		                                             static_cast<float>(viewportHeight), points, count, out, behind);
+	});
+	return behindCount;
+}
+
+
+// Find the world points of count pixels with depths, the reverse of ProjectToViewport
+void UnprojectFromViewport(const CMatrix4x4& inverseViewProjectionMatrix, unsigned int viewportWidth, unsigned int viewportHeight,
+                           const ConstPointStreams& pixels, unsigned int count, const PointStreams& out, int lanes /*= 0*/)
+{
+	WithPack(lanes, [&](auto pack)
+	{
+		UnprojectStreams<decltype(pack)>(inverseViewProjectionMatrix, static_cast<float>(viewportWidth), static_cast<float>(viewportHeight),
+		                                 pixels, count, out);
+	});
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time transforming the given number of random points, each repeats times
+TransformBatchBenchmark BenchmarkTransformBatch(unsigned int count, unsigned int repeats)
+{
+	using Clock = std::chrono::steady_clock;
+	TransformBatchBenchmark result;
+	if (count == 0 || repeats == 0)  return result;
+
+	// Fixed seed so every run times the same points
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+	std::vector<float> x(count), y(count), z(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		x[i] = coordinate(generator);  y[i] = coordinate(generator);  z[i] = coordinate(generator);
+	}
+	ConstPointStreams points = { x.data(), y.data(), z.data() };
+
+	// A typical camera looking at the middle of the points
+	CMatrix4x4 world = MatrixRotationY(0.5f) * MatrixTranslation({ 10, 20, 30 });
+	CMatrix4x4 view = InverseAffine(MatrixRotationX(0.3f) * MatrixTranslation({ 0, 100, -800 }));
+	CMatrix4x4 projection = { 1.3f, 0, 0, 0,   0, 1.7f, 0, 0,   0, 0, 1.0001f, 1,   0, 0, -1.0001f, 0 };
+	CMatrix4x4 matrix = world * view * projection;
+
+	std::vector<float> outX(count), outY(count), outZ(count), outW(count);
+	std::vector<float> refX(count), refY(count), refZ(count), refW(count);
+	std::vector<unsigned char> behind(count);
+	PointStreams out = { outX.data(), outY.data(), outZ.data(), outW.data() };
+
+	// Millions of points per second running the given function
+	auto time = [&](auto transform)
+	{
+		transform(); // Warm up
+		auto start = Clock::now();
+		for (unsigned int repeat = 0; repeat < repeats; ++repeat)  transform();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		return seconds > 0 ? count * static_cast<double>(repeats) / (seconds * 1000000.0) : 0;
+	};
+
+	result.singleMPS = time([&]()
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			CVector4 p = CVector4(x[i], y[i], z[i], 1.0f) * matrix;
+			refX[i] = p.x;  refY[i] = p.y;  refZ[i] = p.z;  refW[i] = p.w;
+		}
+	});
+	auto matches = [&]()
+	{
+		return std::memcmp(outX.data(), refX.data(), count * sizeof(float)) == 0 &&
+		       std::memcmp(outY.data(), refY.data(), count * sizeof(float)) == 0 &&
+		       std::memcmp(outZ.data(), refZ.data(), count * sizeof(float)) == 0 &&
+		       std::memcmp(outW.data(), refW.data(), count * sizeof(float)) == 0;
+	};
+
+	result.match = true;
+	for (int lanes : { 1, 4, 8 })
+	{
+		std::fill(outX.begin(), outX.end(), 0.0f);
+		TransformPoints(matrix, points, count, out, lanes);
+		result.match = result.match && matches();
+	}
+
+	result.scalarMPS  = time([&]() { TransformPoints(matrix, points, count, out, 1); });
+	result.simdMPS    = time([&]() { TransformPoints(matrix, points, count, out); });
+	result.projectMPS = time([&]() { ProjectToViewport(world, view * projection, 0.1f, 1920, 1080, points, count, out, behind.data()); });
+
+	// Pixels and depths of the points, then back to the points with the inverse matrix. Single points are unprojected as
+	// Camera::WorldPtFromPixel does for the reference results
+	CMatrix4x4 inverse;
+	if (!Inverse(matrix, inverse))  return result;
+	std::vector<float> pixelX(count), pixelY(count), depth(count);
+	TransformPoints(matrix, points, count, out);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		pixelX[i] = (outX[i] / outW[i] + 1.0f) * 1920 * 0.5f;
+		pixelY[i] = (1.0f - outY[i] / outW[i]) * 1080 * 0.5f;
+		depth[i]  = outZ[i] / outW[i];
+
+		CVector4 p = CVector4(pixelX[i] * (2.0f / 1920) - 1.0f, 1.0f - pixelY[i] * (2.0f / 1080), depth[i], 1.0f) * inverse;
+		refX[i] = p.x / p.w;  refY[i] = p.y / p.w;  refZ[i] = p.z / p.w;  refW[i] = 0;
+	}
+	ConstPointStreams pixels = { pixelX.data(), pixelY.data(), depth.data() };
+	for (int lanes : { 1, 4, 8 })
+	{
+		std::fill(outX.begin(), outX.end(), 0.0f);
+		std::fill(outW.begin(), outW.end(), 0.0f);
+		UnprojectFromViewport(inverse, 1920, 1080, pixels, count, out, lanes);
+		result.match = result.match && matches();
+	}
+
+	// Points in front of the near clip (w = distance in front of the camera) should come back to where they started
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		CVector4 p = CVector4(x[i], y[i], z[i], 1.0f) * matrix;
+		if (p.w < 1.0f)  continue;
+		float distance = Length(CVector3(outX[i] - x[i], outY[i] - y[i], outZ[i] - z[i]));
+		result.unprojectError = std::max(result.unprojectError, distance / p.w);
+	}
+	result.unprojectMPS = time([&]() { UnprojectFromViewport(inverse, 1920, 1080, pixels, count, out); });
+
+	return result;
+}
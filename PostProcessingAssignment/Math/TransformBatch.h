@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------
+// Batched transforms - many points or vectors through one matrix at a time
+//--------------------------------------------------------------------------------------
+// Points are held as separate arrays of x, y and z values (structure of arrays) so a SIMD pack
+// can load the same component of several points at once. Matrices are combined once per batch,
+// then each point needs just one transformation. Points are processed 8 at a time with AVX2,
+// 4 with SSE4.1 (see SIMDPack.h), with any left over done one at a time.
+//
+// Points give exactly the same results as transforming them one by one with CVector4 * CMatrix4x4,
+// as the sums are done in the same order
+
+#ifndef _TRANSFORM_BATCH_H_DEFINED_
+#define _TRANSFORM_BATCH_H_DEFINED_
+
+#include "CMatrix4x4.h"
+
+
+//--------------------------------------------------------------------------------------
+// Point arrays
+//--------------------------------------------------------------------------------------
+
+// Pointers to the first of count x, y and z values. z can be null for points or vectors in the z = 0 plane
+struct ConstPointStreams
+{
+	const float* x = nullptr;
+	const float* y = nullptr;
+	const float* z = nullptr;
+};
+
+// Pointers to the first of count x, y, z and w values to write. w can be null if it is not needed
+struct PointStreams
+{
+	float* x = nullptr;
+	float* y = nullptr;
+	float* z = nullptr;
+	float* w = nullptr;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Transforms
+//--------------------------------------------------------------------------------------
+// The lanes parameter chooses the pack width: 8 (AVX2), 4 (SSE4.1) or 1 (plain C++). Any other
+// value, or a width the CPU doesn't support, uses the widest the CPU supports. The output must
+// not overlap the input
+
+// Transform count points (w = 1) by the given matrix
+void TransformPoints(const CMatrix4x4& m, const ConstPointStreams& points, unsigned int count, const PointStreams& out,
+                     int lanes = 0);
+
+// Transform count vectors (w = 0) by the given matrix, i.e. the translation is ignored
+void TransformVectors(const CMatrix4x4& m, const ConstPointStreams& vectors, unsigned int count, const PointStreams& out,
+                      int lanes = 0);
+
+
+// Project count world points to the viewport as Camera::PixelFromWorldPt does: writes pixel x and y to out.x and out.y and
+// the distance in front of the camera to out.z (out.w is not used). The world and view-projection matrices are combined
+// first. Points behind the near clip get pixel position (0, 0) and their behind flag set to 1, other flags are set to 0.
+// Returns the number of points behind the near clip
+unsigned int ProjectToViewport(const CMatrix4x4& worldMatrix, const CMatrix4x4& viewProjectionMatrix, float nearClip,
+                               unsigned int viewportWidth, unsigned int viewportHeight, const ConstPointStreams& points,
+                               unsigned int count, const PointStreams& out, unsigned char* behind, int lanes = 0);
+
+// Find the world points of count pixels, the reverse of ProjectToViewport as Camera::WorldPtFromPixel does: pixels.x and
+// pixels.y are pixel coordinates, pixels.z the depth buffer values (0 at the near clip, 1 at the far clip), e.g. to rebuild
+// positions from a depth buffer. Pass the inverse view-projection matrix (Camera::InverseViewProjectionMatrix, or see Inverse
+// in CMatrix4x4.h). Writes the world x, y and z to out (out.w is not used). One matrix multiply and divide per point
+void UnprojectFromViewport(const CMatrix4x4& inverseViewProjectionMatrix, unsigned int viewportWidth, unsigned int viewportHeight,
+                           const ConstPointStreams& pixels, unsigned int count, const PointStreams& out, int lanes = 0);
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Results of BenchmarkTransformBatch, all in millions of points per second on one thread
+struct TransformBatchBenchmark
+{
+	double singleMPS    = 0; // TransformPoints, done one point at a time with CVector4 * CMatrix4x4
+	double scalarMPS    = 0; // TransformPoints, plain C++
+	double simdMPS      = 0; // TransformPoints, widest pack the CPU supports
+	double projectMPS   = 0; // ProjectToViewport, widest pack
+	double unprojectMPS = 0; // UnprojectFromViewport, widest pack
+
+	float unprojectError = 0; // Largest distance from the original point after projecting and unprojecting, relative to its depth
+	bool match = false; // True if all the pack widths gave exactly the same results as CVector4 * CMatrix4x4
+};
+
+// Time transforming the given number of random points, each repeats times
+TransformBatchBenchmark BenchmarkTransformBatch(unsigned int count, unsigned int repeats);
+
+
+#endif // _TRANSFORM_BATCH_H_DEFINED_
@@ -6,29 +6,39 @@
 // expected to select these things. A later lab will introduce a more robust loader.
 
 #include "Mesh.h"
-#include "Shader.h" // Needed for helper function CreateSignatureForVertexLayout
+#include "GeometryPool.h"
+#include "Shader.h"
 #include "GraphicsHelpers.h" // Helper functions to unclutter the code here
+#include "MemoryUsage.h"
+#include "VertexPacking.h"
 #include "CVector2.h" 
 #include "CVector3.h" 
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
-#include <assimp/DefaultLogger.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
 
 
-// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
-// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
-// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
-{
-	Assimp::Importer importer;
+//--------------------------------------------------------------------------------------
+// Import settings
+//--------------------------------------------------------------------------------------
 
-	// Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
-	// and "Peek Definition" to see documention above each constant
-	unsigned int assimpFlags = aiProcess_MakeLeftHanded |
+// Flags for processing the mesh with assimp, and the mesh data to ignore. Both are part of the cache key, so a change here
+// (or to the other settings in ImportData) must come with a new MeshCacheVersion
+static void ImportSettings(bool requireTangents, unsigned int& assimpFlags, int& removeComponents)
+{
+	// Assimp provides a huge amount of control - right click any of these and "Peek Definition" to see documention above each constant
+	assimpFlags = aiProcess_MakeLeftHanded |
 		aiProcess_GenSmoothNormals |
 		aiProcess_FixInfacingNormals |
 		aiProcess_GenUVCoords |
@@ -50,7 +60,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		aiProcess_RemoveComponent;
 
 	// Flags to specify what mesh data to ignore
-	int removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS |
+	removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS |
 		aiComponent_ANIMATIONS | aiComponent_MATERIALS;
 
 	// Add / remove tangents as required by user
@@ -62,6 +72,258 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 	{
 		removeComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
 	}
+}
+
+
+// DirectX format for each vertex format
+static DXGI_FORMAT DXGIFormat(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Float2:  return DXGI_FORMAT_R32G32_FLOAT;
+	case VertexFormat::Float3:  return DXGI_FORMAT_R32G32B32_FLOAT;
+	case VertexFormat::Float4:  return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case VertexFormat::UByte4:  return DXGI_FORMAT_R8G8B8A8_UINT;
+
+	// Packed formats, the GPU turns them into floats from 0 to 1 (or -1 to 1 for signed) as it reads them
+	case VertexFormat::UShort4Norm:  return DXGI_FORMAT_R16G16B16A16_UNORM;
+	case VertexFormat::Short2Norm:   return DXGI_FORMAT_R16G16_SNORM;
+	case VertexFormat::UShort2Norm:  return DXGI_FORMAT_R16G16_UNORM;
+	case VertexFormat::UByte4Norm:   return DXGI_FORMAT_R8G8B8A8_UNORM;
+	default:                    return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Construction
+//--------------------------------------------------------------------------------------
+
+// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
+// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
+{
+	// Use the cache file in place if it is up to date, otherwise import the mesh and save the cache for next time
+	MeshCacheKey key = CacheKey(fileName, requireTangents);
+	std::string cacheFileName = MeshCacheFileName(fileName);
+	MeshCacheView view;
+	if (view.Open(cacheFileName, key))
+	{
+		Create(view);
+	}
+	else
+	{
+		MeshData data = ImportData(fileName, requireTangents);
+		SaveMeshCache(cacheFileName, key, data); // Not an error if the cache can't be written (e.g. read-only folder), it will just be imported again
+		Create(data);
+	}
+}
+
+
+// Create the GPU buffers for mesh data that has already been loaded. Will throw a std::runtime_error exception on failure
+Mesh::Mesh(const MeshData& data)
+{
+	Create(data);
+}
+
+// Create the GPU buffers straight from a mapped cache file. Will throw a std::runtime_error exception on failure
+Mesh::Mesh(const MeshCacheView& view)
+{
+	Create(view);
+}
+
+
+Mesh::~Mesh()
+{
+	for (auto& subMesh : mSubMeshes)
+	{
+		gGeometryPool.Remove(subMesh.geometry);
+	}
+}
+
+
+// Create the nodes and GPU buffers from loaded data
+void Mesh::Create(const MeshData& data)
+{
+	mNodes = data.nodes;
+	mHasBones = data.hasBones;
+
+	// A mesh is made of sub-meshes, each one can have a different material (texture)
+	// Each sub-mesh has its own part of the vertex / index buffers shared by all meshes with the same vertex layout (see GeometryPool.h)
+	mSubMeshes.resize(data.subMeshes.size());
+	for (unsigned int m = 0; m < data.subMeshes.size(); ++m)
+	{
+		auto& subMeshData = data.subMeshes[m];
+		auto& subMesh = mSubMeshes[m]; // Short name for the submesh we're currently preparing - makes code below more readable
+		subMesh.vertexSize  = subMeshData.vertexSize;
+		subMesh.numVertices = subMeshData.numVertices;
+		subMesh.numIndices  = static_cast<unsigned int>(subMeshData.indices.size());
+		subMesh.decode      = subMeshData.decode;
+
+		// Describe to DirectX what is data in each vertex of this mesh
+		D3D11_INPUT_ELEMENT_DESC vertexElements[D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT];
+		if (subMeshData.layout.size() > D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT)  throw std::runtime_error("Too many vertex elements in mesh");
+		for (unsigned int e = 0; e < subMeshData.layout.size(); ++e)
+		{
+			auto& element = subMeshData.layout[e];
+			vertexElements[e] = { element.semantic.c_str(), element.semanticIndex, DXGIFormat(element.format), 0, element.offset,
+			                      D3D11_INPUT_PER_VERTEX_DATA, 0 };
+		}
+
+		// Indices are held as 32-bit, the GPU gets 16-bit ones when they fit
+		unsigned int indexSize = IndexSize(subMesh.numVertices);
+		std::vector<uint16_t> smallIndices;
+		if (indexSize == 2)  smallIndices.assign(subMeshData.indices.begin(), subMeshData.indices.end());
+
+		CreateSubMesh(subMesh, vertexElements, static_cast<unsigned int>(subMeshData.layout.size()), subMeshData.vertices.data(),
+		              indexSize == 2 ? static_cast<const void*>(smallIndices.data()) : subMeshData.indices.data(), indexSize);
+	}
+}
+
+
+// Create the nodes and GPU buffers from a mapped cache file. The vertices, indices and semantic names are used where they are in the file
+void Mesh::Create(const MeshCacheView& view)
+{
+	mHasBones = view.HasBones();
+
+	mNodes.resize(view.NumNodes());
+	for (unsigned int n = 0; n < view.NumNodes(); ++n)
+	{
+		const MeshCacheNode& nodeRecord = view.Node(n);
+		auto& node = mNodes[n];
+		node.name          = view.NodeName(n);
+		node.defaultMatrix = nodeRecord.defaultMatrix;
+		node.offsetMatrix  = nodeRecord.offsetMatrix;
+		node.bounds        = nodeRecord.bounds;
+		node.parentIndex   = nodeRecord.parentIndex;
+		node.childNodes.assign(view.ChildNodes(n), view.ChildNodes(n) + nodeRecord.numChildren);
+		node.subMeshes.assign(view.NodeSubMeshes(n), view.NodeSubMeshes(n) + nodeRecord.numSubMeshes);
+	}
+
+	mSubMeshes.resize(view.NumSubMeshes());
+	for (unsigned int m = 0; m < view.NumSubMeshes(); ++m)
+	{
+		const MeshCacheSubMesh& subMeshRecord = view.SubMesh(m);
+		auto& subMesh = mSubMeshes[m];
+		subMesh.vertexSize  = subMeshRecord.vertexSize;
+		subMesh.numVertices = subMeshRecord.numVertices;
+		subMesh.numIndices  = subMeshRecord.numIndices;
+		subMesh.decode      = view.Decode(m);
+
+		D3D11_INPUT_ELEMENT_DESC vertexElements[D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT];
+		if (subMeshRecord.numElements > D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT)  throw std::runtime_error("Too many vertex elements in mesh");
+		const MeshCacheElement* layout = view.Layout(m);
+		for (unsigned int e = 0; e < subMeshRecord.numElements; ++e)
+		{
+			vertexElements[e] = { view.Semantic(layout[e]), layout[e].semanticIndex, DXGIFormat(layout[e].format), 0, layout[e].offset,
+			                      D3D11_INPUT_PER_VERTEX_DATA, 0 };
+		}
+
+		CreateSubMesh(subMesh, vertexElements, subMeshRecord.numElements, view.Vertices(m), view.Indices(m), subMeshRecord.indexSize);
+	}
+}
+
+
+// Copy the vertices and indices of a sub-mesh whose sizes have been set into the shared geometry buffers, which also provide the
+// input layout
+void Mesh::CreateSubMesh(SubMesh& subMesh, const D3D11_INPUT_ELEMENT_DESC* vertexElements, unsigned int numElements,
+                         const void* vertices, const void* indices, unsigned int indexSize)
+{
+	subMesh.geometry = gGeometryPool.Add(vertexElements, numElements, subMesh.vertexSize, vertices, subMesh.numVertices,
+	                                     indices, subMesh.numIndices, indexSize);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Loading and importing
+//--------------------------------------------------------------------------------------
+
+// The key for a mesh's cache file, from the mesh file's contents and the import settings. Will throw a std::runtime_error
+// exception if the file can't be read
+MeshCacheKey Mesh::CacheKey(const std::string& fileName, bool requireTangents /*= false*/)
+{
+	unsigned int assimpFlags;
+	int removeComponents;
+	ImportSettings(requireTangents, assimpFlags, removeComponents);
+
+	MeshCacheKey key;
+	if (!HashFile(fileName, key.sourceHash, key.sourceSize))  throw std::runtime_error("Error loading mesh (" + fileName + "). Cannot read file");
+	key.importFlags   = assimpFlags;
+	key.importOptions = static_cast<uint32_t>(removeComponents);
+	return key;
+}
+
+
+// Load mesh data without creating anything on the GPU. Uses the mesh's cache file if it is up to date, otherwise imports the
+// mesh with assimp and saves the cache for next time. Will throw a std::runtime_error exception on failure
+MeshData Mesh::LoadData(const std::string& fileName, bool requireTangents /*= false*/, bool* fromCache /*= nullptr*/)
+{
+	MeshCacheKey key = CacheKey(fileName, requireTangents);
+
+	MeshData data;
+	std::string cacheFileName = MeshCacheFileName(fileName);
+	bool cached = LoadMeshCache(cacheFileName, key, data);
+	if (!cached)
+	{
+		data = ImportData(fileName, requireTangents);
+		SaveMeshCache(cacheFileName, key, data); // Not an error if the cache can't be written (e.g. read-only folder), it will just be imported again
+	}
+
+	if (fromCache != nullptr)  *fromCache = cached;
+	return data;
+}
+
+
+// Count the number of nodes with given assimp node as root - recursive
+static unsigned int CountNodes(aiNode* assimpNode)
+{
+	unsigned int count = 1;
+	for (unsigned int child = 0; child < assimpNode->mNumChildren; ++child)
+		count += CountNodes(assimpNode->mChildren[child]);
+	return count;
+}
+
+
+// Help build the array of nodes from the assimp data - recursive
+static unsigned int ReadNodes(std::vector<MeshNode>& nodes, aiNode* assimpNode, unsigned int nodeIndex, unsigned int parentIndex)
+{
+	auto& node = nodes[nodeIndex];
+	node.parentIndex = parentIndex;
+	unsigned int thisIndex = nodeIndex;
+	++nodeIndex;
+
+	node.name = assimpNode->mName.C_Str();
+
+	node.defaultMatrix.SetValues(&assimpNode->mTransformation.a1);
+	node.defaultMatrix.Transpose(); // Assimp stores matrices differently to this app
+	node.offsetMatrix = MatrixIdentity(); // Set for bones when the sub-meshes are read
+
+	node.subMeshes.resize(assimpNode->mNumMeshes);
+	for (unsigned int i = 0; i < assimpNode->mNumMeshes; ++i)
+	{
+		node.subMeshes[i] = assimpNode->mMeshes[i];
+	}
+
+	node.childNodes.resize(assimpNode->mNumChildren);
+	for (unsigned int i = 0; i < assimpNode->mNumChildren; ++i)
+	{
+		node.childNodes[i] = nodeIndex;
+		nodeIndex = ReadNodes(nodes, assimpNode->mChildren[i], nodeIndex, thisIndex);
+	}
+
+	return nodeIndex;
+}
+
+
+// Import mesh data with assimp, ignoring the cache. Will throw a std::runtime_error exception on failure
+MeshData Mesh::ImportData(const std::string& fileName, bool requireTangents /*= false*/)
+{
+	Assimp::Importer importer;
+
+	unsigned int assimpFlags;
+	int removeComponents;
+	ImportSettings(requireTangents, assimpFlags, removeComponents);
 
 	// Other miscellaneous settings
 	importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
@@ -77,13 +339,15 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 
 	importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
 
-	// Import mesh with assimp given above requirements - log output
-	Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
+	// Import mesh with assimp given above requirements. No log output - assimp's logger is shared by every importer, so
+	// creating and destroying it here would break meshes imported on other threads at the same time (see AssetLoader.h)
 	const aiScene* scene = importer.ReadFile(fileName, assimpFlags);
-	Assimp::DefaultLogger::kill();
 	if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
 	if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
 
+	MeshData data;
+	auto& nodes = data.nodes; // Short name for the nodes, used throughout
+
 
 	//-----------------------------------
 
@@ -91,50 +355,50 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 	// Read node hierachy - each node has a matrix and contains sub-meshes //
 
 	// Uses recursive helper functions to build node hierarchy    
-	mNodes.resize(CountNodes(scene->mRootNode));
-	ReadNodes(scene->mRootNode, 0, 0);
+	nodes.resize(CountNodes(scene->mRootNode));
+	ReadNodes(nodes, scene->mRootNode, 0, 0);
 
 
 
 	//******************************************//
 	// Read geometry - multiple parts supported //
 
-	mHasBones = false;
+	data.hasBones = false;
 	for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
-		if (scene->mMeshes[m]->HasBones())  mHasBones = true;
+		if (scene->mMeshes[m]->HasBones())  data.hasBones = true;
 
 
 	// A mesh is made of sub-meshes, each one can have a different material (texture)
-	// Import each sub-mesh in the file to seperate index / vertex buffer (could share buffers between sub-meshes but that would make things more complex)
-	mSubMeshes.resize(scene->mNumMeshes);
+	// Import each sub-mesh in the file to seperate vertices and indices
+	data.subMeshes.resize(scene->mNumMeshes);
 	for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
 	{
 		aiMesh* assimpMesh = scene->mMeshes[m];
 		std::string subMeshName = assimpMesh->mName.C_Str();
-		auto& subMesh = mSubMeshes[m]; // Short name for the submesh we're currently preparing - makes code below more readable
+		auto& subMesh = data.subMeshes[m]; // Short name for the submesh we're currently preparing - makes code below more readable
 
 
 		//-----------------------------------
 
 		// Check for presence of position and normal data. Tangents and UVs are optional.
-		std::vector<D3D11_INPUT_ELEMENT_DESC> vertexElements;
+		auto& vertexElements = subMesh.layout;
 		unsigned int offset = 0;
 
 		if (!assimpMesh->HasPositions())  throw std::runtime_error("No position data for sub-mesh " + subMeshName + " in " + fileName);
 		unsigned int positionOffset = offset;
-		vertexElements.push_back({ "position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, positionOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+		vertexElements.push_back({ "position", 0, VertexFormat::Float3, positionOffset });
 		offset += 12;
 
 		if (!assimpMesh->HasNormals())  throw std::runtime_error("No normal data for sub-mesh " + subMeshName + " in " + fileName);
 		unsigned int normalOffset = offset;
-		vertexElements.push_back({ "normal", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, normalOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+		vertexElements.push_back({ "normal", 0, VertexFormat::Float3, normalOffset });
 		offset += 12;
 
 		unsigned int tangentOffset = offset;
 		if (requireTangents)
 		{
 			if (!assimpMesh->HasTangentsAndBitangents())  throw std::runtime_error("No tangent data for sub-mesh " + subMeshName + " in " + fileName);
-			vertexElements.push_back({ "tangent", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, tangentOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+			vertexElements.push_back({ "tangent", 0, VertexFormat::Float3, tangentOffset });
 			offset += 12;
 		}
 
@@ -142,40 +406,29 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
 		{
 			if (assimpMesh->mNumUVComponents[0] != 2)  throw std::runtime_error("Unsupported texture coordinates in " + subMeshName + " in " + fileName);
-			vertexElements.push_back({ "uv", 0, DXGI_FORMAT_R32G32_FLOAT, 0, uvOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+			vertexElements.push_back({ "uv", 0, VertexFormat::Float2, uvOffset });
 			offset += 8;
 		}
 
 		unsigned int bonesOffset = offset;
-		if (mHasBones)
+		if (data.hasBones)
 		{
-			vertexElements.push_back({ "bones"  , 0, DXGI_FORMAT_R8G8B8A8_UINT,      0, bonesOffset,     D3D11_INPUT_PER_VERTEX_DATA, 0 });
+			vertexElements.push_back({ "bones"  , 0, VertexFormat::UByte4, bonesOffset });
 			offset += 4;
-			vertexElements.push_back({ "weights", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, bonesOffset + 4, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+			vertexElements.push_back({ "weights", 0, VertexFormat::Float4, bonesOffset + 4 });
 			offset += 16;
 		}
 
 		subMesh.vertexSize = offset;
 
 
-		// Create a "vertex layout" to describe to DirectX what is data in each vertex of this mesh
-		auto shaderSignature = CreateSignatureForVertexLayout(vertexElements.data(), static_cast<int>(vertexElements.size()));
-		HRESULT hr = gD3DDevice->CreateInputLayout(vertexElements.data(), static_cast<UINT>(vertexElements.size()),
-			shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
-			&subMesh.vertexLayout);
-		if (shaderSignature)  shaderSignature->Release();
-		if (FAILED(hr))  throw std::runtime_error("Failure creating input layout for " + fileName);
-
-
-
 		//-----------------------------------
 
 		// Create CPU-side buffers to hold current mesh data - exact content is flexible so can't use a structure for a vertex - so just a block of bytes
-		// Note: for large arrays a unique_ptr is better than a vector because vectors default-initialise all the values which is a waste of time.
 		subMesh.numVertices = assimpMesh->mNumVertices;
-		subMesh.numIndices = assimpMesh->mNumFaces * 3;
-		auto vertices = std::make_unique<unsigned char[]>(subMesh.numVertices * subMesh.vertexSize);
-		auto indices  = std::make_unique<unsigned char[]>(subMesh.numIndices * 4); // Using 32 bit indexes (4 bytes) for each indeex
+		subMesh.vertices.resize(subMesh.numVertices * subMesh.vertexSize);
+		subMesh.indices.resize(assimpMesh->mNumFaces * 3); // Using 32 bit indexes (4 bytes) for each index
+		unsigned char* vertices = subMesh.vertices.data();
 
 
 		//-----------------------------------
@@ -183,7 +436,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		// Copy mesh data from assimp to our CPU-side vertex buffer
 
 		CVector3* assimpPosition = reinterpret_cast<CVector3*>(assimpMesh->mVertices);
-		unsigned char* position = vertices.get() + positionOffset;
+		unsigned char* position = vertices + positionOffset;
 		unsigned char* positionEnd = position + subMesh.numVertices * subMesh.vertexSize;
 		while (position != positionEnd)
 		{
@@ -193,7 +446,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		}
 
 		CVector3* assimpNormal = reinterpret_cast<CVector3*>(assimpMesh->mNormals);
-		unsigned char* normal = vertices.get() + normalOffset;
+		unsigned char* normal = vertices + normalOffset;
 		unsigned char* normalEnd = normal + subMesh.numVertices * subMesh.vertexSize;
 		while (normal != normalEnd)
 		{
@@ -205,7 +458,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		if (requireTangents)
 		{
 			CVector3* assimpTangent = reinterpret_cast<CVector3*>(assimpMesh->mTangents);
-			unsigned char* tangent = vertices.get() + tangentOffset;
+			unsigned char* tangent = vertices + tangentOffset;
 			unsigned char* tangentEnd = tangent + subMesh.numVertices * subMesh.vertexSize;
 			while (tangent != tangentEnd)
 			{
@@ -218,7 +471,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
 		{
 			aiVector3D* assimpUV = assimpMesh->mTextureCoords[0];
-			unsigned char* uv = vertices.get() + uvOffset;
+			unsigned char* uv = vertices + uvOffset;
 			unsigned char* uvEnd = uv + subMesh.numVertices * subMesh.vertexSize;
 			while (uv != uvEnd)
 			{
@@ -229,42 +482,30 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		}
 
 
-		if (mHasBones)
+		if (data.hasBones)
 		{
 			if (assimpMesh->HasBones())
 			{
-				// Set all bones and weights to 0 to start with
-				unsigned char* bones = vertices.get() + bonesOffset;
-				unsigned char* bonesEnd = bones + subMesh.numVertices * subMesh.vertexSize;
-				while (bones != bonesEnd)
-				{
-					memset(bones, 0, 20);
-					bones += subMesh.vertexSize;
-				}
-
-				for (auto& node : mNodes)
-				{
-					node.offsetMatrix = MatrixIdentity();
-				}
+				// Set all bones and weights to 0 to start with (already done by resizing the vertices)
 
 				// Go through each assimp bone
-				bones = vertices.get() + bonesOffset;
+				unsigned char* bones = vertices + bonesOffset;
 				for (unsigned int i = 0; i < assimpMesh->mNumBones; ++i)
 				{
 					// Get offset matrix for the bone (transform from skinned mesh root to bone root
 					aiBone* assimpBone = assimpMesh->mBones[i];
 					std::string boneName = assimpBone->mName.C_Str();
 					unsigned int nodeIndex;
-					for (nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+					for (nodeIndex = 0; nodeIndex < nodes.size(); ++nodeIndex)
 					{
-						if (mNodes[nodeIndex].name == boneName)
+						if (nodes[nodeIndex].name == boneName)
 						{
-							mNodes[nodeIndex].offsetMatrix.SetValues(&assimpBone->mOffsetMatrix.a1);
-							mNodes[nodeIndex].offsetMatrix.Transpose(); // Assimp stores matrices differently to this app
+							nodes[nodeIndex].offsetMatrix.SetValues(&assimpBone->mOffsetMatrix.a1);
+							nodes[nodeIndex].offsetMatrix.Transpose(); // Assimp stores matrices differently to this app
 							break;
 						}
 					}
-					if (nodeIndex == mNodes.size())  throw std::runtime_error("Bone with no matching node in " + fileName);
+					if (nodeIndex == nodes.size())  throw std::runtime_error("Bone with no matching node in " + fileName);
 
 					// Go through each weight of the bone and update the vertex it influences
 					// Find the first 0 weight on that vertex and put the new influence / weight there.
@@ -291,16 +532,16 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 			{
 				// In a mesh that uses skinning any sub-meshes that don't contain bones are given bones so the whole mesh can use one shader
 				unsigned int subMeshNode = 0;
-				for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+				for (unsigned int nodeIndex = 0; nodeIndex < nodes.size(); ++nodeIndex)
 				{
-					for (auto& subMeshIndex : mNodes[nodeIndex].subMeshes)
+					for (auto& subMeshIndex : nodes[nodeIndex].subMeshes)
 					{
 						if (subMeshIndex == m)
 							subMeshNode = nodeIndex;
 					}
 				}
 
-				unsigned char* bones = vertices.get() + bonesOffset;
+				unsigned char* bones = vertices + bonesOffset;
 				unsigned char* bonesEnd = bones + subMesh.numVertices * subMesh.vertexSize;
 				while (bones != bonesEnd)
 				{
@@ -320,78 +561,135 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
 		// Copy face data from assimp to our CPU-side index buffer
 		if (!assimpMesh->HasFaces())  throw std::runtime_error("No face data in " + subMeshName + " in " + fileName);
 
-		DWORD* index = reinterpret_cast<DWORD*>(indices.get());
+		uint32_t* index = subMesh.indices.data();
 		for (unsigned int face = 0; face < assimpMesh->mNumFaces; ++face)
 		{
 			*index++ = assimpMesh->mFaces[face].mIndices[0];
 			*index++ = assimpMesh->mFaces[face].mIndices[1];
 			*index++ = assimpMesh->mFaces[face].mIndices[2];
 		}
+	}
 
 
-		//-----------------------------------
-
-		D3D11_BUFFER_DESC bufferDesc;
-		D3D11_SUBRESOURCE_DATA initData;
+	//*********************************************//
+	// Bounding boxes - for culling models unseen //
 
-		// Create GPU-side vertex buffer and copy the vertices imported by assimp into it
-		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Indicate it is a vertex buffer
-		bufferDesc.Usage = D3D11_USAGE_DEFAULT;          // Default usage for this buffer - we'll see other usages later
-		bufferDesc.ByteWidth = subMesh.numVertices * subMesh.vertexSize; // Size of the buffer in bytes
-		bufferDesc.CPUAccessFlags = 0;
-		bufferDesc.MiscFlags = 0;
-		initData.pSysMem = vertices.get(); // Fill the new vertex buffer with data loaded by assimp
+	// Each node's box holds the vertices of its own sub-meshes, in the node's space. A skinned mesh's vertices are all relative to
+	// the mesh rather than any node, so its root node holds a box of the whole mesh in its default pose
+	for (auto& node : nodes)  node.bounds = EmptyBox();
+	for (unsigned int nodeIndex = 0; nodeIndex < nodes.size(); ++nodeIndex)
+	{
+		for (auto& subMeshIndex : nodes[nodeIndex].subMeshes)
+		{
+			aiMesh* assimpMesh = scene->mMeshes[subMeshIndex];
+			auto& bounds = nodes[data.hasBones ? 0 : nodeIndex].bounds;
+			for (unsigned int v = 0; v < assimpMesh->mNumVertices; ++v)
+			{
+				bounds = AddToBox(bounds, { assimpMesh->mVertices[v].x, assimpMesh->mVertices[v].y, assimpMesh->mVertices[v].z });
+			}
+		}
+	}
 
-		hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &subMesh.vertexBuffer);
-		if (FAILED(hr))  throw std::runtime_error("Failure creating vertex buffer for " + fileName);
 
+	//*********************************************//
+	// Vertex packing - to use less GPU memory //
 
-		// Create GPU-side index buffer and copy the vertices imported by assimp into it
-		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; // Indicate it is an index buffer
-		bufferDesc.Usage = D3D11_USAGE_DEFAULT;         // Default usage for this buffer - we'll see other usages later
-		bufferDesc.ByteWidth = subMesh.numIndices * sizeof(DWORD); // Size of the buffer in bytes
-		bufferDesc.CPUAccessFlags = 0;
-		bufferDesc.MiscFlags = 0;
-		initData.pSysMem = indices.get(); // Fill the new index buffer with data loaded by assimp
+	// Vertices are packed into smaller formats wherever the error that adds is too small to see, see VertexPacking.h
+	PackMeshData(data);
 
-		hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &subMesh.indexBuffer);
-		if (FAILED(hr))  throw std::runtime_error("Failure creating index buffer for " + fileName);
-	}
+	return data;
 }
 
 
-Mesh::~Mesh()
+// Time importing the given mesh file with assimp against loading it from its cache, and check they all give the same data
+MeshLoadBenchmark BenchmarkMeshLoad(const std::string& fileName, bool requireTangents /*= false*/)
 {
-	for (auto& subMesh : mSubMeshes)
+	using Clock = std::chrono::steady_clock;
+	MeshLoadBenchmark result;
+	PeakMemorySampler sampler;
+	try
 	{
-		if (subMesh.indexBuffer)   subMesh.indexBuffer ->Release();
-		if (subMesh.vertexBuffer)  subMesh.vertexBuffer->Release();
-		if (subMesh.vertexLayout)  subMesh.vertexLayout->Release();
+		Mesh::LoadData(fileName, requireTangents); // Make sure the cache is up to date
+
+		// Lightest first, so memory freed by one isn't reused by the next and hidden from its peak. Reading the mapped data
+		// stands in for creating the GPU buffers from it
+		size_t startBytes = ProcessMemoryBytes();
+		sampler.Start();
+		auto start = Clock::now();
+		MeshCacheView view;
+		bool opened = view.Open(MeshCacheFileName(fileName), Mesh::CacheKey(fileName, requireTangents));
+		uint64_t sum = 0;
+		for (unsigned int m = 0; opened && m < view.NumSubMeshes(); ++m)
+		{
+			const MeshCacheSubMesh& subMesh = view.SubMesh(m);
+			sum = std::accumulate(view.Vertices(m), view.Vertices(m) + static_cast<size_t>(subMesh.numVertices) * subMesh.vertexSize, sum);
+			auto indices = static_cast<const unsigned char*>(view.Indices(m));
+			sum = std::accumulate(indices, indices + static_cast<size_t>(subMesh.numIndices) * subMesh.indexSize, sum);
+		}
+		result.mappedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		result.mappedPeakMB = (sampler.Stop() - startBytes) / 1000000.0;
+		MeshData mapped = opened ? view.ToMeshData() : MeshData();
+		view.Close();
+
+		bool fromCache = false;
+		startBytes = ProcessMemoryBytes();
+		sampler.Start();
+		start = Clock::now();
+		MeshData cached = Mesh::LoadData(fileName, requireTangents, &fromCache);
+		result.cacheMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		result.cachePeakMB = (sampler.Stop() - startBytes) / 1000000.0;
+
+		startBytes = ProcessMemoryBytes();
+		sampler.Start();
+		start = Clock::now();
+		MeshData imported = Mesh::ImportData(fileName, requireTangents);
+		result.importMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		result.importPeakMB = (sampler.Stop() - startBytes) / 1000000.0;
+
+		result.match = opened && sum != 0 && fromCache && MeshDataEqual(imported, cached) && MeshDataEqual(imported, mapped);
+	}
+	catch (const std::runtime_error&)
+	{
+		sampler.Stop();
+		result.match = false;
 	}
+	return result;
 }
 
 
 //--------------------------------------------------------------------------------------
 
-// Helper function for Render function - renders a given sub-mesh. World matrices / textures / states etc. must already be set
-void Mesh::RenderSubMesh(const SubMesh& subMesh)
+// Helper function for Render function - put a sub-mesh's vertex decoding in the per-model constants. Returns true if they
+// changed, i.e. the constant buffer needs updating before rendering the sub-mesh
+static bool SetVertexDecodeConstants(PerModelConstants& constants, const VertexDecode& decode)
 {
-	// Set vertex buffer as next data source for GPU
-	UINT stride = subMesh.vertexSize;
-	UINT offset = 0;
-	gD3DContext->IASetVertexBuffers(0, 1, &subMesh.vertexBuffer, &stride, &offset);
-
-	// Indicate the layout of vertex buffer
-	gD3DContext->IASetInputLayout(subMesh.vertexLayout);
-
-	// Set index buffer as next data source for GPU, indicate it uses 32-bit integers
-	gD3DContext->IASetIndexBuffer(subMesh.indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	CVector3 positionScale  = decode.positionScale;
+	CVector3 positionOffset = decode.positionOffset;
+	CVector2 uvScale        = decode.uvScale;
+	CVector2 uvOffset       = decode.uvOffset;
+	float    octahedral     = decode.octahedral ? 1.0f : 0.0f;
+
+	bool changed = constants.positionScale.x  != positionScale.x  || constants.positionScale.y  != positionScale.y  ||
+	               constants.positionScale.z  != positionScale.z  || constants.positionOffset.x != positionOffset.x ||
+	               constants.positionOffset.y != positionOffset.y || constants.positionOffset.z != positionOffset.z ||
+	               constants.uvScale.x  != uvScale.x  || constants.uvScale.y  != uvScale.y ||
+	               constants.uvOffset.x != uvOffset.x || constants.uvOffset.y != uvOffset.y ||
+	               constants.octahedralNormals != octahedral;
+
+	constants.positionScale     = positionScale;
+	constants.positionOffset    = positionOffset;
+	constants.uvScale           = uvScale;
+	constants.uvOffset          = uvOffset;
+	constants.octahedralNormals = octahedral;
+	return changed;
+}
 
-	// Using triangle lists only in this class
-	gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// Render mesh
-	gD3DContext->DrawIndexed(subMesh.numIndices, 0, 0);
+// Helper function for Render function - renders a given sub-mesh. World matrices / textures / states etc. must already be set
+void Mesh::RenderSubMesh(const SubMesh& subMesh)
+{
+	// The pool only sets the buffers and input layout if the previous draw used different ones
+	gGeometryPool.Draw(subMesh.geometry);
 }
 
 
@@ -403,14 +701,8 @@ void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
 {
 	// Skinning needs all matrices available in the shader at the same time, so first calculate all the absolute
 	// matrices before rendering anything
-	std::vector<CMatrix4x4> absoluteMatrices(modelMatrices.size());
-	absoluteMatrices[0] = modelMatrices[0]; // First matrix for a model is the root matrix, already in world space
-	for (unsigned int nodeIndex = 1; nodeIndex < mNodes.size(); ++nodeIndex)
-	{
-		// Multiply each model matrix by its parent's absolute world matrix (already calculated earlier in this loop)
-		// Same process as for rigid bodies, simply done prior to rendering now
-		absoluteMatrices[nodeIndex] = modelMatrices[nodeIndex] * absoluteMatrices[mNodes[nodeIndex].parentIndex];
-	}
+	std::vector<CMatrix4x4> absoluteMatrices;
+	CalculateAbsoluteMatrices(modelMatrices, absoluteMatrices);
 
 	if (mHasBones) // Render a mesh that uses skinning
 	{
@@ -431,6 +723,7 @@ void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
 		{
 			gPerModelConstants.boneMatrices[nodeIndex] = absoluteMatrices[nodeIndex];
 		}
+		if (!mSubMeshes.empty())  SetVertexDecodeConstants(gPerModelConstants, mSubMeshes[0].decode); // Sent with the bones for the first sub-mesh
 		UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants); // Send to GPU
 
 		// Indicate that the constant buffer we just updated is for use in the vertex shader (VS), geometry shader (GS) and pixel shader (PS)
@@ -439,9 +732,10 @@ void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
 		gD3DContext->PSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
 
 		// Already sent over all the absolute matrices for the entire mesh so we can render sub-meshes directly
-		// rather than iterating through the nodes. 
+		// rather than iterating through the nodes. Only sub-meshes with different vertex decoding need the constants sent again
 		for (auto& subMesh : mSubMeshes)
 		{
+			if (SetVertexDecodeConstants(gPerModelConstants, subMesh.decode))  UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants);
 			RenderSubMesh(subMesh);
 		}
 	}
@@ -450,20 +744,25 @@ void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
 		// Render a mesh without skinning. Although slightly reorganised to use the matrices calculated
 		// above, this is basically the same code as the rigid body animation lab
 		// Iterate through each node
+		gD3DContext->VSSetConstantBuffers(1, 1, &gPerModelConstantBuffer); // First parameter must match constant buffer number in the shader
+		gD3DContext->GSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
+		gD3DContext->PSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
+
 		for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
 		{
-			// Send this node's matrix to the GPU via a constant buffer
+			// This node's matrix is sent to the GPU via the constant buffer with its first sub-mesh's vertex decoding, then again
+			// only for sub-meshes that decode differently. Nodes without sub-meshes have nothing to send
 			gPerModelConstants.worldMatrix = absoluteMatrices[nodeIndex];
-			UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants); // Send to GPU
-
-			// Indicate that the constant buffer we just updated is for use in the vertex shader (VS) and pixel shader (PS)
-			gD3DContext->VSSetConstantBuffers(1, 1, &gPerModelConstantBuffer); // First parameter must match constant buffer number in the shader
-			gD3DContext->GSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
-			gD3DContext->PSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
+			bool matrixSent = false;
 
 			// Render the sub-meshes attached to this node (no bones - rigid movement)
 			for (auto& subMeshIndex : mNodes[nodeIndex].subMeshes)
 			{
+				if (SetVertexDecodeConstants(gPerModelConstants, mSubMeshes[subMeshIndex].decode) || !matrixSent)
+				{
+					UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants); // Send to GPU
+					matrixSent = true;
+				}
 				RenderSubMesh(mSubMeshes[subMeshIndex]);
 			}
 		}
@@ -471,45 +770,210 @@ void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
 }
 
 
+// Return a world space box around the mesh when rendered with the given matrices. Skinned meshes use the box of their default
+// pose placed with the root matrix, so parts animated far from that pose may be outside it
+BoundingBox Mesh::WorldBounds(const std::vector<CMatrix4x4>& modelMatrices)
+{
+	if (mHasBones)  return TransformBox(mNodes[0].bounds, modelMatrices[0]);
+
+	std::vector<CMatrix4x4> absoluteMatrices;
+	CalculateAbsoluteMatrices(modelMatrices, absoluteMatrices);
+	BoundingBox bounds = EmptyBox();
+	for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+	{
+		bounds = AddToBox(bounds, TransformBox(mNodes[nodeIndex].bounds, absoluteMatrices[nodeIndex]));
+	}
+	return bounds;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Helper functions
 //--------------------------------------------------------------------------------------
 
-// Count the number of nodes with given assimp node as root - recursive
-unsigned int Mesh::CountNodes(aiNode* assimpNode)
+// Calculate the world matrix of each node from the model's matrices, which are relative to their parent node
+void Mesh::CalculateAbsoluteMatrices(const std::vector<CMatrix4x4>& modelMatrices, std::vector<CMatrix4x4>& absoluteMatrices)
 {
-	unsigned int count = 1;
-	for (unsigned int child = 0; child < assimpNode->mNumChildren; ++child)
-		count += CountNodes(assimpNode->mChildren[child]);
-	return count;
+	absoluteMatrices.resize(modelMatrices.size());
+	absoluteMatrices[0] = modelMatrices[0]; // First matrix for a model is the root matrix, already in world space
+	for (unsigned int nodeIndex = 1; nodeIndex < mNodes.size(); ++nodeIndex)
+	{
+		// Multiply each model matrix by its parent's absolute world matrix (already calculated earlier in this loop)
+		// Same process as for rigid bodies, simply done prior to rendering now
+		absoluteMatrices[nodeIndex] = modelMatrices[nodeIndex] * absoluteMatrices[mNodes[nodeIndex].parentIndex];
+	}
 }
 
 
-// Help build the arrays of submeshes and nodes from the assimp data - recursive
-unsigned int Mesh::ReadNodes(aiNode* assimpNode, unsigned int nodeIndex, unsigned int parentIndex)
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// A mesh laid out as Mesh.cpp imports it without tangents or bones, with two sub-meshes of different sizes and places. Each is
+// a bumpy grid of the given number of vertices (rounded down to a square) with random normals
+static MeshData RandomDecodeMesh(unsigned int vertices, std::mt19937& generator)
 {
-	auto& node = mNodes[nodeIndex];
-	node.parentIndex = parentIndex;
-	unsigned int thisIndex = nodeIndex;
-	++nodeIndex;
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	unsigned int side = std::max(static_cast<unsigned int>(std::sqrt(static_cast<double>(vertices))), 2u);
 
-	node.name = assimpNode->mName.C_Str();
+	MeshData data;
+	data.nodes.resize(1);
+	data.nodes[0].offsetMatrix = MatrixIdentity();
+	data.nodes[0].defaultMatrix = MatrixIdentity();
+	data.nodes[0].subMeshes = { 0, 1 };
 
-	node.defaultMatrix.SetValues(&assimpNode->mTransformation.a1);
-	node.defaultMatrix.Transpose(); // Assimp stores matrices differently to this app
+	data.subMeshes.resize(2);
+	for (size_t s = 0; s < data.subMeshes.size(); ++s)
+	{
+		MeshSubMeshData& subMesh = data.subMeshes[s];
+		subMesh.layout = { { "position", 0, VertexFormat::Float3, 0 }, { "normal", 0, VertexFormat::Float3, 12 }, { "uv", 0, VertexFormat::Float2, 24 } };
+		subMesh.vertexSize = 32;
+		subMesh.numVertices = side * side;
+		subMesh.vertices.resize(static_cast<size_t>(subMesh.numVertices) * subMesh.vertexSize);
+
+		float spacing = (s == 0) ? 0.5f : 3.0f;
+		CVector3 origin = { -100.0f * s, 20.0f, 7.0f * s };
+		for (unsigned int z = 0; z < side; ++z)
+		{
+			for (unsigned int x = 0; x < side; ++x)
+			{
+				unsigned char* vertex = subMesh.vertices.data() + static_cast<size_t>(z * side + x) * subMesh.vertexSize;
+				CVector3 position = origin + CVector3{ x * spacing, unit(generator) * spacing * 0.25f, z * spacing };
+				CVector3 normal = Normalise({ unit(generator), unit(generator), unit(generator) });
+				CVector2 uv = { 0.25f + (s + 1.0f) * x / (side - 1), 0.5f * z / (side - 1) - 0.75f };
+				std::memcpy(vertex,      &position.x, 12);
+				std::memcpy(vertex + 12, &normal.x,   12);
+				std::memcpy(vertex + 24, &uv.x,       8);
+			}
+		}
 
-	node.subMeshes.resize(assimpNode->mNumMeshes);
-	for (unsigned int i = 0; i < assimpNode->mNumMeshes; ++i)
+		for (unsigned int z = 0; z + 1 < side; ++z)
+		{
+			for (unsigned int x = 0; x + 1 < side; ++x)
+			{
+				uint32_t corner = z * side + x;
+				subMesh.indices.insert(subMesh.indices.end(), { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 });
+			}
+		}
+	}
+	return data;
+}
+
+
+// The first count values of a vertex element as the input assembler gives them to the vertex shader: normalised integers are
+// turned to floats and values the format doesn't have are 0
+static void ReadShaderInput(const MeshSubMeshData& subMesh, unsigned int vertex, const VertexElement& element, float* values, unsigned int count)
+{
+	const unsigned char* in = subMesh.vertices.data() + static_cast<size_t>(vertex) * subMesh.vertexSize + element.offset;
+	for (unsigned int i = 0; i < count; ++i)  values[i] = 0;
+
+	if (element.format == VertexFormat::UShort4Norm || element.format == VertexFormat::UShort2Norm)
 	{
-		node.subMeshes[i] = assimpNode->mMeshes[i];
+		uint16_t packed[4];
+		unsigned int size = VertexFormatSize(element.format) / sizeof(uint16_t);
+		std::memcpy(packed, in, size * sizeof(uint16_t));
+		for (unsigned int i = 0; i < std::min(count, size); ++i)  values[i] = packed[i] / 65535.0f;
+	}
+	else if (element.format == VertexFormat::Short2Norm)
+	{
+		int16_t packed[2];
+		std::memcpy(packed, in, sizeof(packed));
+		for (unsigned int i = 0; i < std::min(count, 2u); ++i)  values[i] = std::max(packed[i] / 32767.0f, -1.0f);
+	}
+	else
+	{
+		std::memcpy(values, in, std::min<size_t>(count * sizeof(float), VertexFormatSize(element.format)));
 	}
+}
 
-	node.childNodes.resize(assimpNode->mNumChildren);
-	for (unsigned int i = 0; i < assimpNode->mNumChildren; ++i)
+// The element of a sub-mesh with the given semantic
+static const VertexElement& FindElement(const MeshSubMeshData& subMesh, const char* semantic)
+{
+	for (auto& element : subMesh.layout)
 	{
-		node.childNodes[i] = nodeIndex;
-		nodeIndex = ReadNodes(assimpNode->mChildren[i], nodeIndex, thisIndex);
+		if (element.semantic == semantic)  return element;
 	}
+	throw std::runtime_error("Mesh is missing a vertex element");
+}
 
-	return nodeIndex;
+
+// Pack a random mesh, decode its vertices with the formulas of DecodePosition, DecodeUV and DecodeNormal in Common.hlsli using
+// the per-model constants Mesh sets for each sub-mesh, and compare with UnpackMeshData
+VertexDecodeCheck CheckVertexDecodeConstants(unsigned int vertices)
+{
+	VertexDecodeCheck result;
+	std::mt19937 generator(1);
+	const MeshData original = RandomDecodeMesh(vertices, generator);
+
+	// Packed as loading does, and with limits too tight to pack positions and normals, so the shaders' unpacked paths are used too
+	MeshData packed = original;
+	bool allPacked = PackMeshData(packed).normals;
+	VertexPackLimits tight;
+	tight.positionError = 1e-6f;
+	tight.normalError   = 1e-7f;
+	MeshData precise = original;
+	bool preciseUnpacked = !PackMeshData(precise, tight).normals;
+
+	// Setting the constants must report a change exactly when the decode values differ, or Render would draw sub-meshes with
+	// the previous sub-mesh's decoding
+	PerModelConstants constants = {};
+	result.changes = allPacked && preciseUnpacked &&
+	                 SetVertexDecodeConstants(constants, packed.subMeshes[0].decode) && !SetVertexDecodeConstants(constants, packed.subMeshes[0].decode) &&
+	                 SetVertexDecodeConstants(constants, packed.subMeshes[1].decode) && SetVertexDecodeConstants(constants, precise.subMeshes[0].decode);
+
+	for (const MeshData* mesh : { &packed, &precise })
+	{
+		MeshData unpacked = *mesh;
+		UnpackMeshData(unpacked);
+		for (size_t s = 0; s < mesh->subMeshes.size(); ++s)
+		{
+			const MeshSubMeshData& subMesh = mesh->subMeshes[s];
+			const MeshSubMeshData& expected = unpacked.subMeshes[s];
+			SetVertexDecodeConstants(constants, subMesh.decode);
+
+			// Float rounding of the decode formulas, with the scale and offset used
+			const float epsilon = std::numeric_limits<float>::epsilon();
+			float positionBound = 4 * epsilon * std::max({ std::abs(constants.positionOffset.x) + std::abs(constants.positionScale.x),
+			                                               std::abs(constants.positionOffset.y) + std::abs(constants.positionScale.y),
+			                                               std::abs(constants.positionOffset.z) + std::abs(constants.positionScale.z) });
+			float uvBound = 4 * epsilon * std::max(std::abs(constants.uvOffset.x) + std::abs(constants.uvScale.x),
+			                                       std::abs(constants.uvOffset.y) + std::abs(constants.uvScale.y));
+			float normalBound = 4 * epsilon;
+
+			for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+			{
+				CVector3 position, normal, expectedPosition, expectedNormal;
+				CVector2 uv, expectedUV;
+				ReadShaderInput(subMesh, v, FindElement(subMesh, "position"), &position.x, 3);
+				ReadShaderInput(subMesh, v, FindElement(subMesh, "normal"),   &normal.x,   3);
+				ReadShaderInput(subMesh, v, FindElement(subMesh, "uv"),       &uv.x,       2);
+				ReadShaderInput(expected, v, FindElement(expected, "position"), &expectedPosition.x, 3);
+				ReadShaderInput(expected, v, FindElement(expected, "normal"),   &expectedNormal.x,   3);
+				ReadShaderInput(expected, v, FindElement(expected, "uv"),       &expectedUV.x,       2);
+
+				// DecodePosition and DecodeUV
+				position = { position.x * constants.positionScale.x + constants.positionOffset.x,
+				             position.y * constants.positionScale.y + constants.positionOffset.y,
+				             position.z * constants.positionScale.z + constants.positionOffset.z };
+				uv = { uv.x * constants.uvScale.x + constants.uvOffset.x, uv.y * constants.uvScale.y + constants.uvOffset.y };
+
+				// DecodeNormal
+				if (constants.octahedralNormals != 0)
+				{
+					normal.z = 1 - std::abs(normal.x) - std::abs(normal.y);
+					float fold = std::min(std::max(-normal.z, 0.0f), 1.0f);
+					normal.x += (normal.x >= 0) ? -fold : fold;
+					normal.y += (normal.y >= 0) ? -fold : fold;
+					normal = Normalise(normal);
+				}
+
+				result.positionError = std::max(result.positionError, Length(position - expectedPosition) / positionBound);
+				result.normalError   = std::max(result.normalError,   Length(normal   - expectedNormal)   / normalBound);
+				result.uvError       = std::max({ result.uvError, std::abs(uv.x - expectedUV.x) / uvBound, std::abs(uv.y - expectedUV.y) / uvBound });
+			}
+		}
+	}
+
+	result.passed = result.changes && result.positionError <= 1 && result.normalError <= 1 && result.uvError <= 1;
+	return result;
 }
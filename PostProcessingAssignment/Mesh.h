@@ -6,9 +6,11 @@
 // expected to select these things
 
 #include "CMatrix4x4.h"
+#include "Frustum.h"
+#include "MeshData.h"
+#include "GeometryPool.h"
 #define NOMINMAX // Use this to stop Windows headers defining "min" and "max", which breaks some libraries (e.g. assimp)
 #include <d3d11.h>
-#include <assimp/scene.h>
 #include <string>
 #include <vector>
 
@@ -25,10 +27,32 @@ public:
     // Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
     // Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
     // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+    // Uses the mesh's cache file in place (see MeshCacheView in MeshData.h) if it is up to date, otherwise imports the mesh and
+    // saves the cache for next time
     Mesh(const std::string& fileName, bool requireTangents = false);
+
+    // Create the GPU buffers for mesh data that has already been loaded. Will throw a std::runtime_error exception on failure
+    Mesh(const MeshData& data);
+
+    // Create the GPU buffers straight from a mapped cache file, the vertices and indices are not copied anywhere else on the
+    // way. The view can be closed afterwards. Will throw a std::runtime_error exception on failure
+    Mesh(const MeshCacheView& view);
     ~Mesh();
 
 
+    // Load mesh data without creating anything on the GPU, so it needs no graphics device. Uses the mesh's cache file (see
+    // MeshData.h) if it is up to date, otherwise imports the mesh with assimp and saves the cache for next time. Optionally
+    // returns whether the cache was used. Will throw a std::runtime_error exception on failure
+    static MeshData LoadData(const std::string& fileName, bool requireTangents = false, bool* fromCache = nullptr);
+
+    // Import mesh data with assimp, ignoring the cache. Will throw a std::runtime_error exception on failure
+    static MeshData ImportData(const std::string& fileName, bool requireTangents = false);
+
+    // The key for a mesh's cache file, from the mesh file's contents and the import settings. Will throw a std::runtime_error
+    // exception if the file can't be read
+    static MeshCacheKey CacheKey(const std::string& fileName, bool requireTangents = false);
+
+
 	// How many nodes are in the hierarchy for this mesh. Nodes can control individual parts (rigid body animation),
 	// or bones (skinned animation), or they can be dummy nodes to create child parts in a more convenient way
 	unsigned int NumberNodes()  { return static_cast<unsigned int>(mNodes.size()); }
@@ -36,6 +60,12 @@ public:
     // The default matrix for a given node - used to set the initial position for a new model
     CMatrix4x4 GetNodeDefaultMatrix(unsigned int node) { return mNodes[node].defaultMatrix; }
 
+    // Bounding box of the geometry in a given node, in the node's own space. Empty for nodes with no geometry
+    BoundingBox GetNodeBounds(unsigned int node) { return mNodes[node].bounds; }
+
+    // Return a world space box around the mesh when rendered with the given matrices (the same as passed to Render)
+    BoundingBox WorldBounds(const std::vector<CMatrix4x4>& modelMatrices);
+
 
 	// Render the mesh with the given matrices
 	// Handles rigid body meshes (including single part meshes) as well as skinned meshes
@@ -50,18 +80,16 @@ public:
 private:
 
 	// A mesh is made of multiple sub-meshes. Each one uses a single material (texture).
-	// Each sub-mesh has a vertex / index buffer on the GPU. Could share buffers for performance but that would be complex.
+	// The vertices and indices of each sub-mesh are held in buffers shared by all meshes (see GeometryPool.h)
 	struct SubMesh
 	{
-		unsigned int       vertexSize = 0;         // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
-		ID3D11InputLayout* vertexLayout = nullptr; // DirectX specification of data held in a single vertex
+		unsigned int  vertexSize = 0;  // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
+		unsigned int  numVertices = 0;
+		unsigned int  numIndices = 0;
 
-		// GPU-side vertex and index buffers
-		unsigned int       numVertices = 0;
-		ID3D11Buffer*      vertexBuffer = nullptr;
+		GeometryRange geometry; // Where the vertices and indices are in gGeometryPool, and which input layout they use
 
-		unsigned int       numIndices = 0;
-		ID3D11Buffer*      indexBuffer  = nullptr;
+		VertexDecode  decode; // How the vertex shader gives back the values of packed vertices (see VertexPacking.h)
 	};
 
 
@@ -69,19 +97,8 @@ private:
 	// A node can contain several sub-meshes (because a single node might use multiple textures)
 	// A node can also have child nodes. The children will follow the motion of the parent node
 	// Each node has a default matrix which is it's initial/ default position. Models using this mesh are
-	// given these default matrices as a starting position.
-	struct Node
-	{
-		std::string  name;
-
-		CMatrix4x4   defaultMatrix; // Starting position/rotation/scale for this node. Relative to parent. Used when first creating a model from this mesh
-		CMatrix4x4   offsetMatrix;
-
-		unsigned int parentIndex;   // Index of the parent node (from the mNodes vector below). Root node refers to itself (0)
-
-		std::vector<unsigned int> childNodes; // Child nodes that are controlled by this node (indexes into the mNodes vector below)
-		std::vector<unsigned int> subMeshes;  // The geometry representing this node (indexes into the mSubMeshes vector below)
-	};
+	// given these default matrices as a starting position. Nodes are kept as loaded (see MeshNode in MeshData.h)
+	using Node = MeshNode;
 
 
 //--------------------------------------------------------------------------------------
@@ -89,15 +106,21 @@ private:
 //--------------------------------------------------------------------------------------
 private:
 
-	// Count the number of nodes with given assimp node as root
-	unsigned int CountNodes(aiNode* assimpNode);
+	// Create the nodes and GPU buffers from loaded data, for the constructors
+	void Create(const MeshData& data);
+	void Create(const MeshCacheView& view);
 
-	// Help build the arrays of submeshes and nodes from the assimp data - recursive
-	unsigned int ReadNodes(aiNode* assimpNode, unsigned int nodeIndex, unsigned int parentIndex);
+	// Copy the vertices and indices of a sub-mesh whose sizes have been set into the shared geometry buffers. Indices are
+	// indexSize bytes each, 2 or 4
+	void CreateSubMesh(SubMesh& subMesh, const D3D11_INPUT_ELEMENT_DESC* vertexElements, unsigned int numElements,
+	                   const void* vertices, const void* indices, unsigned int indexSize);
 
 	// Helper function for Render function - renders a given sub-mesh. World matrices / textures / states etc. must already be set
 	void RenderSubMesh(const SubMesh& subMesh);
 
+	// Calculate the world matrix of each node from the model's matrices, which are relative to their parent node
+	void CalculateAbsoluteMatrices(const std::vector<CMatrix4x4>& modelMatrices, std::vector<CMatrix4x4>& absoluteMatrices);
+
 
 
 //--------------------------------------------------------------------------------------
@@ -108,9 +131,49 @@ private:
     std::vector<SubMesh> mSubMeshes; // The mesh geometry. Nodes refer to sub-meshes in this vector
     std::vector<Node>    mNodes;     // The mesh hierarchy. First entry is root. remainder aree stored in depth-first order
 
-	bool mHasBones; // If any submesh has bones, then all submeshes are given bones - makes rendering easier (one shader for the whole mesh)
+	bool mHasBones = false; // If any submesh has bones, then all submeshes are given bones - makes rendering easier (one shader for the whole mesh)
+};
+
+
+// Results of BenchmarkMeshLoad
+struct MeshLoadBenchmark
+{
+	// Times, all with an up to date cache. Using the cache includes hashing the mesh file to check it
+	double importMs = 0; // Mesh::ImportData, i.e. assimp
+	double cacheMs  = 0; // Mesh::LoadData, copying the cache file into MeshData
+	double mappedMs = 0; // Opening the cache with MeshCacheView and reading every vertex and index in place, as Mesh does for the GPU
+
+	// Peak physical memory used by each of the above, above that in use when it started (see MemoryUsage.h)
+	double importPeakMB = 0;
+	double cachePeakMB  = 0;
+	double mappedPeakMB = 0;
+
+	bool match = false; // True if the cache was used and both ways of reading it gave exactly the same data as importing
 };
 
+// Time importing the given mesh file with assimp against loading it from its cache, and check they all give the same data.
+// Needs no graphics device
+MeshLoadBenchmark BenchmarkMeshLoad(const std::string& fileName, bool requireTangents = false);
+
+
+// Results of CheckVertexDecodeConstants
+struct VertexDecodeCheck
+{
+	// Largest differences between vertices decoded as the shaders do and as UnpackMeshData does, as fractions of the float
+	// rounding expected, so all should be at most 1
+	float positionError = 0;
+	float normalError   = 0;
+	float uvError       = 0;
+
+	bool changes = false; // True if setting the per-model constants reported a change exactly when the decode values differed
+	bool passed  = false; // True if the above and all errors were at most 1
+};
+
+// Pack a random mesh and decode its vertices with the formulas of DecodePosition, DecodeUV and DecodeNormal in Common.hlsli,
+// using the per-model constants Mesh sets for each sub-mesh, and check they give the same as UnpackMeshData. Needs no graphics
+// device
+VertexDecodeCheck CheckVertexDecodeConstants(unsigned int vertices);
+
 
 #endif //_MESH_H_INCLUDED_
 
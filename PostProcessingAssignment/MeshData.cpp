@@ -0,0 +1,714 @@
+//--------------------------------------------------------------------------------------
+// Mesh data held in CPU memory, and the binary mesh cache
+//--------------------------------------------------------------------------------------
+
+#include "MeshData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+// Values are written to the cache as they are held in memory
+static_assert(sizeof(unsigned int) == 4, "Cache files hold unsigned ints as 4 bytes");
+static_assert(sizeof(CMatrix4x4) == 16 * sizeof(float), "Cache files hold matrices as 16 floats");
+static_assert(sizeof(BoundingBox) == 6 * sizeof(float), "Cache files hold boxes as 6 floats");
+static_assert(sizeof(CVector3) == 3 * sizeof(float) && sizeof(CVector2) == 2 * sizeof(float), "Cache files hold vectors as floats");
+
+
+//--------------------------------------------------------------------------------------
+// Mesh data
+//--------------------------------------------------------------------------------------
+
+// Size in bytes of one value of the given format
+unsigned int VertexFormatSize(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Float2:  return 8;
+	case VertexFormat::Float3:  return 12;
+	case VertexFormat::Float4:  return 16;
+	case VertexFormat::UByte4:  return 4;
+
+	case VertexFormat::UShort4Norm:  return 8;
+	case VertexFormat::Short2Norm:   return 4;
+	case VertexFormat::UShort2Norm:  return 4;
+	case VertexFormat::UByte4Norm:   return 4;
+	default:                         return 0;
+	}
+}
+
+
+// Return true if two sub-meshes decode their vertices the same way (values compared bit for bit)
+static bool VertexDecodeEqual(const VertexDecode& a, const VertexDecode& b)
+{
+	return a.octahedral == b.octahedral &&
+	       std::memcmp(&a.positionScale,  &b.positionScale,  sizeof(CVector3)) == 0 &&
+	       std::memcmp(&a.positionOffset, &b.positionOffset, sizeof(CVector3)) == 0 &&
+	       std::memcmp(&a.uvScale,        &b.uvScale,        sizeof(CVector2)) == 0 &&
+	       std::memcmp(&a.uvOffset,       &b.uvOffset,       sizeof(CVector2)) == 0;
+}
+
+// Return true if two meshes hold exactly the same data (matrices, bounds and decode values compared bit for bit)
+bool MeshDataEqual(const MeshData& a, const MeshData& b)
+{
+	if (a.hasBones != b.hasBones || a.nodes.size() != b.nodes.size() || a.subMeshes.size() != b.subMeshes.size())  return false;
+
+	for (size_t i = 0; i < a.nodes.size(); ++i)
+	{
+		const MeshNode& nodeA = a.nodes[i];
+		const MeshNode& nodeB = b.nodes[i];
+		if (nodeA.name != nodeB.name || nodeA.parentIndex != nodeB.parentIndex ||
+		    nodeA.childNodes != nodeB.childNodes || nodeA.subMeshes != nodeB.subMeshes ||
+		    std::memcmp(&nodeA.defaultMatrix, &nodeB.defaultMatrix, sizeof(CMatrix4x4)) != 0 ||
+		    std::memcmp(&nodeA.offsetMatrix,  &nodeB.offsetMatrix,  sizeof(CMatrix4x4)) != 0 ||
+		    std::memcmp(&nodeA.bounds,        &nodeB.bounds,        sizeof(BoundingBox)) != 0)  return false;
+	}
+
+	for (size_t i = 0; i < a.subMeshes.size(); ++i)
+	{
+		const MeshSubMeshData& subMeshA = a.subMeshes[i];
+		const MeshSubMeshData& subMeshB = b.subMeshes[i];
+		if (subMeshA.vertexSize != subMeshB.vertexSize || subMeshA.numVertices != subMeshB.numVertices ||
+		    subMeshA.vertices != subMeshB.vertices || subMeshA.indices != subMeshB.indices ||
+		    subMeshA.layout.size() != subMeshB.layout.size() || !VertexDecodeEqual(subMeshA.decode, subMeshB.decode))  return false;
+
+		for (size_t e = 0; e < subMeshA.layout.size(); ++e)
+		{
+			const VertexElement& elementA = subMeshA.layout[e];
+			const VertexElement& elementB = subMeshB.layout[e];
+			if (elementA.semantic != elementB.semantic || elementA.semanticIndex != elementB.semanticIndex ||
+			    elementA.format != elementB.format || elementA.offset != elementB.offset)  return false;
+		}
+	}
+	return true;
+}
+
+
+// Return true if the node and sub-mesh indexes in the data are in range, each sub-mesh has the vertices and a whole number
+// of triangles its sizes say, and each element fits in a vertex
+bool MeshDataValid(const MeshData& data)
+{
+	const size_t numNodes = data.nodes.size();
+	const size_t numSubMeshes = data.subMeshes.size();
+	if (numNodes == 0 || numSubMeshes == 0 || data.nodes[0].parentIndex != 0)  return false;
+
+	// Parents must come before their children, absolute matrices are worked out in node order
+	for (size_t i = 0; i < numNodes; ++i)
+	{
+		const MeshNode& node = data.nodes[i];
+		if (i > 0 && node.parentIndex >= i)  return false;
+		for (auto child : node.childNodes)    if (child == 0 || child >= numNodes)  return false;
+		for (auto subMesh : node.subMeshes)   if (subMesh >= numSubMeshes)  return false;
+	}
+
+	for (auto& subMesh : data.subMeshes)
+	{
+		if (subMesh.vertexSize == 0 || subMesh.vertices.size() != static_cast<uint64_t>(subMesh.numVertices) * subMesh.vertexSize ||
+		    subMesh.indices.size() % 3 != 0)  return false;
+
+		for (auto& element : subMesh.layout)
+		{
+			unsigned int size = VertexFormatSize(element.format);
+			if (size == 0 || subMesh.vertexSize < size || element.offset > subMesh.vertexSize - size)  return false;
+		}
+
+		for (auto index : subMesh.indices)  if (index >= subMesh.numVertices)  return false;
+	}
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cache files
+//--------------------------------------------------------------------------------------
+
+// First four bytes of a cache file, "MSHC"
+static const uint32_t MeshCacheMagic = 0x4348534D;
+
+// Tables and sub-mesh data start on multiples of this many bytes
+static const uint64_t MeshCacheAlignment = 16;
+
+static_assert(sizeof(MeshCacheHeader)  == 64,  "Cache header must keep the tables after it aligned");
+static_assert(sizeof(MeshCacheNode)    == 192, "Cache node records must keep the matrices in them aligned");
+static_assert(sizeof(MeshCacheSubMesh) == 96,  "Cache sub-mesh records must keep the tables after them aligned");
+static_assert(sizeof(MeshCacheElement) == 20,  "Cache element records are 5 values");
+
+static uint64_t AlignCacheOffset(uint64_t offset)
+{
+	return (offset + MeshCacheAlignment - 1) & ~(MeshCacheAlignment - 1);
+}
+
+
+// Offsets of the tables in a cache file with the given header, and the end of the tables
+struct MeshCacheTables
+{
+	uint64_t nodes, subMeshes, elements, nodeIndexes, strings, end;
+};
+
+static MeshCacheTables CacheTableOffsets(const MeshCacheHeader& header)
+{
+	MeshCacheTables tables;
+	tables.nodes       = sizeof(MeshCacheHeader);
+	tables.subMeshes   = tables.nodes       + static_cast<uint64_t>(header.numNodes)       * sizeof(MeshCacheNode);
+	tables.elements    = tables.subMeshes   + static_cast<uint64_t>(header.numSubMeshes)   * sizeof(MeshCacheSubMesh);
+	tables.nodeIndexes = tables.elements    + static_cast<uint64_t>(header.numElements)    * sizeof(MeshCacheElement);
+	tables.strings     = tables.nodeIndexes + static_cast<uint64_t>(header.numNodeIndexes) * sizeof(uint32_t);
+	tables.end         = AlignCacheOffset(tables.strings + header.stringsSize);
+	return tables;
+}
+
+
+// Writes values to a cache file as they are held in memory, keeping track of the position for padding
+class MeshCacheWriter
+{
+public:
+	MeshCacheWriter(const std::string& fileName) : mFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc) {}
+
+	void Write(const void* data, size_t bytes)
+	{
+		if (bytes > 0)  mFile.write(static_cast<const char*>(data), bytes);
+		mPosition += bytes;
+	}
+
+	template <typename T>
+	void Write(const T& value)  { Write(&value, sizeof(T)); }
+
+	template <typename T>
+	void Write(const std::vector<T>& values)  { Write(values.data(), values.size() * sizeof(T)); }
+
+	// Write zeros up to the given offset
+	void PadTo(uint64_t offset)
+	{
+		static const char zeros[MeshCacheAlignment] = {};
+		while (mPosition < offset)  Write(zeros, static_cast<size_t>(std::min(offset - mPosition, MeshCacheAlignment)));
+	}
+
+	bool Close()  { mFile.close(); return !mFile.fail(); }
+	bool Good()   { return mFile.good(); }
+
+private:
+	std::ofstream mFile;
+	uint64_t      mPosition = 0;
+};
+
+
+// 64-bit FNV-1a hash of a whole file and its size in bytes. Returns false if the file can't be read
+bool HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size)
+{
+	std::ifstream file(fileName, std::ios::in | std::ios::binary);
+	if (!file)  return false;
+
+	hash = 14695981039346656037ull;
+	size = 0;
+	std::vector<char> buffer(1 << 16);
+	while (file)
+	{
+		file.read(buffer.data(), buffer.size());
+		auto bytes = static_cast<size_t>(file.gcount());
+		for (size_t i = 0; i < bytes; ++i)
+		{
+			hash ^= static_cast<unsigned char>(buffer[i]);
+			hash *= 1099511628211ull;
+		}
+		size += bytes;
+	}
+	return file.eof();
+}
+
+
+// Name of the cache file for a mesh file
+std::string MeshCacheFileName(const std::string& meshFileName)
+{
+	return meshFileName + ".meshcache";
+}
+
+
+// Save mesh data to a cache file with the given key. The file is written under a temporary name and then renamed, so a
+// partly written cache is never read. Returns false on failure, or if the data isn't valid
+bool SaveMeshCache(const std::string& cacheFileName, const MeshCacheKey& key, const MeshData& data)
+{
+	if (!MeshDataValid(data))  return false;
+
+	// Build the tables first, the vertices and indices are written straight from the data after them
+	MeshCacheHeader header = {};
+	header.magic         = MeshCacheMagic;
+	header.version       = MeshCacheVersion;
+	header.sourceHash    = key.sourceHash;
+	header.sourceSize    = key.sourceSize;
+	header.importFlags   = key.importFlags;
+	header.importOptions = key.importOptions;
+	header.hasBones      = data.hasBones ? 1 : 0;
+
+	std::vector<MeshCacheNode>    nodes(data.nodes.size());
+	std::vector<MeshCacheSubMesh> subMeshes(data.subMeshes.size());
+	std::vector<MeshCacheElement> elements;
+	std::vector<uint32_t>         nodeIndexes;
+	std::string                   strings;
+
+	auto addString = [&](const std::string& text, uint32_t& offset, uint32_t& length)
+	{
+		offset = static_cast<uint32_t>(strings.size());
+		length = static_cast<uint32_t>(text.size());
+		strings.append(text.c_str(), text.size() + 1); // Including the null
+	};
+	auto addIndexes = [&](const std::vector<unsigned int>& indexes, uint32_t& first, uint32_t& count)
+	{
+		first = static_cast<uint32_t>(nodeIndexes.size());
+		count = static_cast<uint32_t>(indexes.size());
+		nodeIndexes.insert(nodeIndexes.end(), indexes.begin(), indexes.end());
+	};
+
+	for (size_t i = 0; i < data.nodes.size(); ++i)
+	{
+		const MeshNode& node = data.nodes[i];
+		MeshCacheNode& record = nodes[i];
+		record.defaultMatrix = node.defaultMatrix;
+		record.offsetMatrix  = node.offsetMatrix;
+		record.bounds        = node.bounds;
+		record.parentIndex   = node.parentIndex;
+		addString(node.name, record.nameOffset, record.nameLength);
+		addIndexes(node.childNodes, record.firstChild, record.numChildren);
+		addIndexes(node.subMeshes, record.firstSubMesh, record.numSubMeshes);
+	}
+
+	for (size_t i = 0; i < data.subMeshes.size(); ++i)
+	{
+		const MeshSubMeshData& subMesh = data.subMeshes[i];
+		MeshCacheSubMesh& record = subMeshes[i];
+		record.vertexSize   = subMesh.vertexSize;
+		record.numVertices  = subMesh.numVertices;
+		record.numIndices   = static_cast<uint32_t>(subMesh.indices.size());
+		record.indexSize    = IndexSize(subMesh.numVertices);
+		record.firstElement = static_cast<uint32_t>(elements.size());
+		record.numElements  = static_cast<uint32_t>(subMesh.layout.size());
+		std::memcpy(record.positionScale,  &subMesh.decode.positionScale,  sizeof(record.positionScale));
+		std::memcpy(record.positionOffset, &subMesh.decode.positionOffset, sizeof(record.positionOffset));
+		std::memcpy(record.uvScale,        &subMesh.decode.uvScale,        sizeof(record.uvScale));
+		std::memcpy(record.uvOffset,       &subMesh.decode.uvOffset,       sizeof(record.uvOffset));
+		record.octahedral = subMesh.decode.octahedral ? 1 : 0;
+		for (auto& element : subMesh.layout)
+		{
+			MeshCacheElement elementRecord;
+			addString(element.semantic, elementRecord.semanticOffset, elementRecord.semanticLength);
+			elementRecord.semanticIndex = element.semanticIndex;
+			elementRecord.format        = element.format;
+			elementRecord.offset        = element.offset;
+			elements.push_back(elementRecord);
+		}
+	}
+
+	header.numNodes       = static_cast<uint32_t>(nodes.size());
+	header.numSubMeshes   = static_cast<uint32_t>(subMeshes.size());
+	header.numElements    = static_cast<uint32_t>(elements.size());
+	header.numNodeIndexes = static_cast<uint32_t>(nodeIndexes.size());
+	header.stringsSize    = static_cast<uint32_t>(strings.size());
+
+	// Place the vertices and indices of each sub-mesh after the tables
+	MeshCacheTables tables = CacheTableOffsets(header);
+	uint64_t offset = tables.end;
+	for (size_t i = 0; i < data.subMeshes.size(); ++i)
+	{
+		subMeshes[i].verticesOffset = offset;
+		offset = AlignCacheOffset(offset + data.subMeshes[i].vertices.size());
+		subMeshes[i].indicesOffset = offset;
+		offset = AlignCacheOffset(offset + data.subMeshes[i].indices.size() * subMeshes[i].indexSize);
+	}
+	header.fileSize = offset;
+
+
+	std::string tempFileName = cacheFileName + ".tmp";
+	MeshCacheWriter writer(tempFileName);
+	if (!writer.Good())  return false;
+
+	writer.Write(header);
+	writer.Write(nodes);
+	writer.Write(subMeshes);
+	writer.Write(elements);
+	writer.Write(nodeIndexes);
+	writer.Write(strings.data(), strings.size());
+	writer.PadTo(tables.end);
+	std::vector<uint16_t> smallIndices;
+	for (size_t i = 0; i < data.subMeshes.size(); ++i)
+	{
+		writer.Write(data.subMeshes[i].vertices);
+		writer.PadTo(subMeshes[i].indicesOffset);
+		if (subMeshes[i].indexSize == 2)
+		{
+			smallIndices.assign(data.subMeshes[i].indices.begin(), data.subMeshes[i].indices.end());
+			writer.Write(smallIndices);
+		}
+		else
+		{
+			writer.Write(data.subMeshes[i].indices);
+		}
+		writer.PadTo(i + 1 < subMeshes.size() ? subMeshes[i + 1].verticesOffset : header.fileSize);
+	}
+
+	if (!writer.Close())
+	{
+		std::remove(tempFileName.c_str());
+		return false;
+	}
+
+	// Replace any old cache (rename won't overwrite on Windows)
+	std::remove(cacheFileName.c_str());
+	if (std::rename(tempFileName.c_str(), cacheFileName.c_str()) != 0)
+	{
+		std::remove(tempFileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+// Load mesh data from a cache file into memory of its own. Returns false if the file is missing, has a different version or
+// key, or is damaged
+bool LoadMeshCache(const std::string& cacheFileName, const MeshCacheKey& key, MeshData& data)
+{
+	MeshCacheView view;
+	if (!view.Open(cacheFileName, key))  return false;
+	data = view.ToMeshData();
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cache view
+//--------------------------------------------------------------------------------------
+
+// Map a cache file and check it. Returns false if the file is missing, has a different version or key, or is damaged
+bool MeshCacheView::Open(const std::string& cacheFileName, const MeshCacheKey& key)
+{
+	Close();
+	if (!mFile.Open(cacheFileName))  return false;
+	if (!Check() || mHeader->sourceHash != key.sourceHash || mHeader->sourceSize != key.sourceSize ||
+	    mHeader->importFlags != key.importFlags || mHeader->importOptions != key.importOptions)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MeshCacheView::Close()
+{
+	mFile.Close();
+	mHeader      = nullptr;
+	mNodes       = nullptr;
+	mSubMeshes   = nullptr;
+	mElements    = nullptr;
+	mNodeIndexes = nullptr;
+	mStrings     = nullptr;
+}
+
+
+// Return true if the mapped file's tables and ranges are all consistent
+bool MeshCacheView::Check()
+{
+	const unsigned char* file = mFile.Data();
+	const uint64_t fileSize = mFile.Size();
+	if (fileSize < sizeof(MeshCacheHeader))  return false;
+
+	const MeshCacheHeader& header = *reinterpret_cast<const MeshCacheHeader*>(file);
+	if (header.magic != MeshCacheMagic || header.version != MeshCacheVersion || header.fileSize != fileSize)  return false;
+
+	MeshCacheTables tables = CacheTableOffsets(header);
+	if (tables.end > fileSize || header.numNodes == 0 || header.numSubMeshes == 0)  return false;
+
+	mHeader      = &header;
+	mNodes       = reinterpret_cast<const MeshCacheNode*>(file + tables.nodes);
+	mSubMeshes   = reinterpret_cast<const MeshCacheSubMesh*>(file + tables.subMeshes);
+	mElements    = reinterpret_cast<const MeshCacheElement*>(file + tables.elements);
+	mNodeIndexes = reinterpret_cast<const uint32_t*>(file + tables.nodeIndexes);
+	mStrings     = reinterpret_cast<const char*>(file + tables.strings);
+
+	// Strings must have their null inside the string table, ranges must be inside their tables
+	auto validString = [&](uint32_t offset, uint32_t length)
+	{
+		return static_cast<uint64_t>(offset) + length < header.stringsSize && mStrings[offset + length] == '\0';
+	};
+	auto validRange = [](uint32_t first, uint32_t count, uint32_t tableSize)
+	{
+		return static_cast<uint64_t>(first) + count <= tableSize;
+	};
+
+	// Parents must come before their children, absolute matrices are worked out in node order
+	for (uint32_t i = 0; i < header.numNodes; ++i)
+	{
+		const MeshCacheNode& node = mNodes[i];
+		if ((i == 0 ? node.parentIndex != 0 : node.parentIndex >= i) || !validString(node.nameOffset, node.nameLength) ||
+		    !validRange(node.firstChild, node.numChildren, header.numNodeIndexes) ||
+		    !validRange(node.firstSubMesh, node.numSubMeshes, header.numNodeIndexes))  return false;
+
+		for (uint32_t c = 0; c < node.numChildren; ++c)
+		{
+			uint32_t child = mNodeIndexes[node.firstChild + c];
+			if (child == 0 || child >= header.numNodes)  return false;
+		}
+		for (uint32_t s = 0; s < node.numSubMeshes; ++s)
+		{
+			if (mNodeIndexes[node.firstSubMesh + s] >= header.numSubMeshes)  return false;
+		}
+	}
+
+	// Vertices and indices must be aligned, after the tables and inside the file, and indices must be in range
+	for (uint32_t i = 0; i < header.numSubMeshes; ++i)
+	{
+		const MeshCacheSubMesh& subMesh = mSubMeshes[i];
+		if (subMesh.vertexSize == 0 || subMesh.numIndices % 3 != 0 || subMesh.indexSize != IndexSize(subMesh.numVertices) ||
+		    !validRange(subMesh.firstElement, subMesh.numElements, header.numElements) ||
+		    subMesh.verticesOffset % MeshCacheAlignment != 0 || subMesh.indicesOffset % MeshCacheAlignment != 0 ||
+		    subMesh.verticesOffset < tables.end || subMesh.indicesOffset < tables.end ||
+		    subMesh.verticesOffset > fileSize || fileSize - subMesh.verticesOffset < static_cast<uint64_t>(subMesh.numVertices) * subMesh.vertexSize ||
+		    subMesh.indicesOffset  > fileSize || fileSize - subMesh.indicesOffset  < static_cast<uint64_t>(subMesh.numIndices) * subMesh.indexSize)  return false;
+
+		for (uint32_t e = 0; e < subMesh.numElements; ++e)
+		{
+			const MeshCacheElement& element = mElements[subMesh.firstElement + e];
+			unsigned int size = VertexFormatSize(element.format);
+			if (!validString(element.semanticOffset, element.semanticLength) ||
+			    size == 0 || subMesh.vertexSize < size || element.offset > subMesh.vertexSize - size)  return false;
+		}
+
+		for (uint32_t index = 0; index < subMesh.numIndices; ++index)  if (Index(i, index) >= subMesh.numVertices)  return false;
+	}
+	return true;
+}
+
+
+// How the vertices of a sub-mesh are decoded
+VertexDecode MeshCacheView::Decode(unsigned int subMesh) const
+{
+	const MeshCacheSubMesh& record = mSubMeshes[subMesh];
+	VertexDecode decode;
+	decode.positionScale  = CVector3(record.positionScale);
+	decode.positionOffset = CVector3(record.positionOffset);
+	decode.uvScale        = CVector2(record.uvScale);
+	decode.uvOffset       = CVector2(record.uvOffset);
+	decode.octahedral     = record.octahedral != 0;
+	return decode;
+}
+
+
+// Copy the contents into mesh data of its own
+MeshData MeshCacheView::ToMeshData() const
+{
+	MeshData data;
+	data.hasBones = HasBones();
+
+	data.nodes.resize(NumNodes());
+	for (unsigned int i = 0; i < NumNodes(); ++i)
+	{
+		const MeshCacheNode& record = Node(i);
+		MeshNode& node = data.nodes[i];
+		node.name.assign(NodeName(i), record.nameLength);
+		node.defaultMatrix = record.defaultMatrix;
+		node.offsetMatrix  = record.offsetMatrix;
+		node.bounds        = record.bounds;
+		node.parentIndex   = record.parentIndex;
+		node.childNodes.assign(ChildNodes(i), ChildNodes(i) + record.numChildren);
+		node.subMeshes.assign(NodeSubMeshes(i), NodeSubMeshes(i) + record.numSubMeshes);
+	}
+
+	data.subMeshes.resize(NumSubMeshes());
+	for (unsigned int i = 0; i < NumSubMeshes(); ++i)
+	{
+		const MeshCacheSubMesh& record = SubMesh(i);
+		MeshSubMeshData& subMesh = data.subMeshes[i];
+		for (unsigned int e = 0; e < record.numElements; ++e)
+		{
+			const MeshCacheElement& element = Layout(i)[e];
+			subMesh.layout.push_back({ std::string(Semantic(element), element.semanticLength), element.semanticIndex, element.format, element.offset });
+		}
+		subMesh.vertexSize  = record.vertexSize;
+		subMesh.numVertices = record.numVertices;
+		subMesh.vertices.assign(Vertices(i), Vertices(i) + static_cast<size_t>(record.numVertices) * record.vertexSize);
+		if (record.indexSize == 2)
+		{
+			auto indices = static_cast<const uint16_t*>(Indices(i));
+			subMesh.indices.assign(indices, indices + record.numIndices);
+		}
+		else
+		{
+			auto indices = static_cast<const uint32_t*>(Indices(i));
+			subMesh.indices.assign(indices, indices + record.numIndices);
+		}
+		subMesh.decode = Decode(i);
+	}
+	return data;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+static std::vector<char> ReadWholeFile(const std::string& fileName)
+{
+	std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file)  return {};
+	std::vector<char> contents(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(contents.data(), contents.size());
+	return contents;
+}
+
+static void WriteWholeFile(const std::string& fileName, const char* contents, size_t size)
+{
+	std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(contents, size);
+}
+
+
+// Save and load a random skinned mesh with the given number of vertices in each of its sub-meshes, repeats times, to the given
+// cache file, then check stale and damaged files are rejected. The file is deleted afterwards
+MeshCacheCheck CheckMeshCache(const std::string& cacheFileName, unsigned int vertices, unsigned int repeats)
+{
+	using Clock = std::chrono::steady_clock;
+	MeshCacheCheck result;
+	if (vertices == 0 || repeats == 0)  return result;
+
+	// A root with two children, each with a sub-mesh laid out as Mesh.cpp does for skinned meshes with uvs. Random bytes
+	// are fine for the vertices and decode values as they are compared bit for bit. The first sub-mesh is small enough for
+	// 16-bit indices
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+	MeshData data;
+	data.hasBones = true;
+	data.nodes.resize(3);
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		MeshNode& node = data.nodes[i];
+		node.name = "Node" + std::to_string(i);
+		float values[16];
+		for (auto& v : values)  v = value(generator);
+		node.defaultMatrix.SetValues(values);
+		node.offsetMatrix = MatrixIdentity();
+		node.bounds = EmptyBox();
+		node.parentIndex = 0;
+		if (i > 0)
+		{
+			node.bounds = AddToBox(node.bounds, { value(generator), value(generator), value(generator) });
+			node.subMeshes = { i - 1 };
+			data.nodes[0].childNodes.push_back(i);
+		}
+	}
+
+	data.subMeshes.resize(2);
+	for (auto& subMesh : data.subMeshes)
+	{
+		unsigned int numVertices = (&subMesh == &data.subMeshes[0]) ? std::min(vertices, 1000u) : vertices;
+		subMesh.layout = { { "position", 0, VertexFormat::Float3,  0 }, { "normal",  0, VertexFormat::Float3, 12 },
+		                   { "uv",       0, VertexFormat::Float2, 24 }, { "bones",   0, VertexFormat::UByte4, 32 },
+		                   { "weights",  0, VertexFormat::Float4, 36 } };
+		subMesh.vertexSize = 52;
+		subMesh.numVertices = numVertices;
+		subMesh.vertices.resize(numVertices * subMesh.vertexSize);
+		for (auto& byte : subMesh.vertices)  byte = static_cast<unsigned char>(generator());
+		subMesh.indices.resize(numVertices * 6);
+		for (auto& index : subMesh.indices)  index = generator() % numVertices;
+		subMesh.decode.positionScale  = { value(generator), value(generator), value(generator) };
+		subMesh.decode.positionOffset = { value(generator), value(generator), value(generator) };
+		subMesh.decode.uvScale        = { value(generator), value(generator) };
+		subMesh.decode.uvOffset       = { value(generator), value(generator) };
+		subMesh.decode.octahedral     = (generator() % 2) != 0;
+	}
+
+	MeshCacheKey key;
+	key.sourceHash = 0x0123456789abcdefull;
+	key.sourceSize = 1000;
+	key.importFlags = 0x1234;
+	key.importOptions = 0x5678;
+
+	// Round trip, timed
+	MeshData loaded;
+	auto start = Clock::now();
+	bool saved = true;
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)  saved = SaveMeshCache(cacheFileName, key, data) && saved;
+	double saveSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	start = Clock::now();
+	bool read = true;
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)  read = LoadMeshCache(cacheFileName, key, loaded) && read;
+	double loadSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	start = Clock::now();
+	MeshCacheView view;
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)  read = view.Open(cacheFileName, key) && read;
+	view.Close();
+	double openSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::vector<char> contents = ReadWholeFile(cacheFileName);
+	double megabytes = contents.size() * static_cast<double>(repeats) / 1000000.0;
+	result.saveMBps = saveSeconds > 0 ? megabytes / saveSeconds : 0;
+	result.loadMBps = loadSeconds > 0 ? megabytes / loadSeconds : 0;
+	result.openMBps = openSeconds > 0 ? megabytes / openSeconds : 0;
+	result.roundTrip = saved && read && MeshDataEqual(data, loaded);
+
+	// Stale files: a different key, and a different version (the second value in the file)
+	MeshData unused;
+	result.staleRejected = true;
+	for (int field = 0; field < 4; ++field)
+	{
+		MeshCacheKey otherKey = key;
+		if (field == 0)  otherKey.sourceHash ^= 1;
+		if (field == 1)  otherKey.sourceSize += 1;
+		if (field == 2)  otherKey.importFlags ^= 1;
+		if (field == 3)  otherKey.importOptions ^= 1;
+		result.staleRejected = result.staleRejected && !LoadMeshCache(cacheFileName, otherKey, unused);
+	}
+	if (contents.size() > 8)
+	{
+		std::vector<char> otherVersion = contents;
+		otherVersion[4] ^= 1;
+		WriteWholeFile(cacheFileName, otherVersion.data(), otherVersion.size());
+		result.staleRejected = result.staleRejected && !LoadMeshCache(cacheFileName, key, unused);
+	}
+
+	// Damaged files: truncated at several points and extra bytes on the end
+	result.damagedRejected = true;
+	for (size_t size : { contents.size() / 8, contents.size() / 2, contents.size() - 1 })
+	{
+		WriteWholeFile(cacheFileName, contents.data(), size);
+		result.damagedRejected = result.damagedRejected && !LoadMeshCache(cacheFileName, key, unused);
+	}
+	contents.push_back(0);
+	WriteWholeFile(cacheFileName, contents.data(), contents.size());
+	result.damagedRejected = result.damagedRejected && !LoadMeshCache(cacheFileName, key, unused);
+
+	// Damaged tables, found using the file layout: an index out of range, a parent after its child and a name without its null
+	contents.pop_back();
+	MeshCacheHeader header;
+	MeshCacheSubMesh lastSubMesh;
+	std::memcpy(&header, contents.data(), sizeof(header));
+	MeshCacheTables tables = CacheTableOffsets(header);
+	std::memcpy(&lastSubMesh, contents.data() + tables.subMeshes + (header.numSubMeshes - 1) * sizeof(MeshCacheSubMesh), sizeof(lastSubMesh));
+	auto checkDamaged = [&](uint64_t offset, const void* value, size_t bytes)
+	{
+		std::vector<char> damaged = contents;
+		std::memcpy(damaged.data() + offset, value, bytes);
+		WriteWholeFile(cacheFileName, damaged.data(), damaged.size());
+		result.damagedRejected = result.damagedRejected && !LoadMeshCache(cacheFileName, key, unused);
+	};
+	const uint32_t badIndex = vertices, badParent = 2;
+	const uint16_t badSmallIndex = static_cast<uint16_t>(std::min(vertices, 65535u));
+	const char badNull = 'x';
+	if (lastSubMesh.indexSize == 2)
+		checkDamaged(lastSubMesh.indicesOffset + (lastSubMesh.numIndices - 1) * 2, &badSmallIndex, sizeof(badSmallIndex));
+	else
+		checkDamaged(lastSubMesh.indicesOffset + (lastSubMesh.numIndices - 1) * 4, &badIndex, sizeof(badIndex));
+	checkDamaged(tables.nodes + sizeof(MeshCacheNode) + 2 * sizeof(CMatrix4x4) + sizeof(BoundingBox), &badParent, sizeof(badParent));
+	checkDamaged(tables.strings + data.nodes[0].name.size(), &badNull, 1);
+
+	// Invalid data is not saved
+	MeshData invalid = data;
+	invalid.subMeshes[0].indices.back() = vertices;
+	result.damagedRejected = result.damagedRejected && !SaveMeshCache(cacheFileName, key, invalid);
+
+	std::remove(cacheFileName.c_str());
+	result.passed = result.roundTrip && result.staleRejected && result.damagedRejected;
+	return result;
+}
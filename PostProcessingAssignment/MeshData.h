@@ -0,0 +1,313 @@
+//--------------------------------------------------------------------------------------
+// Mesh data held in CPU memory, and the binary mesh cache
+//--------------------------------------------------------------------------------------
+// The Mesh class imports files with assimp into a MeshData - the final interleaved vertices,
+// indices, node hierarchy and a description of the vertex layout - then creates the GPU buffers
+// from it. Vertices are usually packed into smaller formats (see VertexPacking.h). Importing runs about twenty assimp post-processing steps, so the MeshData is
+// saved to a cache file next to the mesh the first time and loaded from there afterwards.
+//
+// A cache file is only used if it was written by the current version of this code from a
+// source file with the same contents and with the same import settings (see MeshCacheKey),
+// otherwise the mesh is imported again and the cache rewritten. Files hold fixed size values in
+// the byte order of the machine that wrote them.
+//
+// The file is laid out to be used where it is, without reading it into other structures: a
+// header, then tables of fixed size node, sub-mesh and vertex element records, lists of node
+// indexes, null-terminated names, and finally the vertices and indices of each sub-mesh ready
+// for the GPU. Records are aligned to 16 bytes so the matrices in them can be used directly.
+// MeshCacheView maps a file into memory and gives access to all of these in place, so a mesh
+// can be created with no copies apart from the one into the GPU buffers.
+//
+// Plain C++ with no DirectX or assimp
+
+#ifndef _MESH_DATA_H_INCLUDED_
+#define _MESH_DATA_H_INCLUDED_
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "Frustum.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Mesh data
+//--------------------------------------------------------------------------------------
+
+// Data types that can be held in a vertex. The Mesh class converts these to DXGI formats
+enum class VertexFormat : uint32_t
+{
+	Float2, // Two floats, e.g. uvs
+	Float3, // Three floats, e.g. positions and normals
+	Float4, // Four floats, e.g. bone weights
+	UByte4, // Four unsigned bytes, e.g. bone indexes
+
+	// Normalised integers, which the GPU reads as floats from 0 to 1 (unsigned) or -1 to 1 (signed)
+	UShort4Norm, // Four 16-bit unsigned, e.g. packed positions
+	Short2Norm,  // Two 16-bit signed, e.g. octahedral normals
+	UShort2Norm, // Two 16-bit unsigned, e.g. packed uvs
+	UByte4Norm,  // Four 8-bit unsigned, e.g. packed bone weights
+
+	NumFormats
+};
+
+// Size in bytes of one value of the given format
+unsigned int VertexFormatSize(VertexFormat format);
+
+
+// One element of a vertex, e.g. the position - the same as D3D11_INPUT_ELEMENT_DESC for a single vertex buffer
+struct VertexElement
+{
+	std::string  semantic;          // Name used in the vertex shader input, e.g. "position"
+	unsigned int semanticIndex = 0;
+	VertexFormat format = VertexFormat::Float3;
+	unsigned int offset = 0;        // Offset in bytes from the start of the vertex
+};
+
+
+// How the packed vertices of a sub-mesh give back the values they were made from (see VertexPacking.h). Positions are
+// position * positionScale + positionOffset and uvs are uv * uvScale + uvOffset. Normals and tangents are octahedral encoded if
+// octahedral is set. The defaults leave vertices that are not packed unchanged
+struct VertexDecode
+{
+	CVector3 positionScale  = { 1, 1, 1 };
+	CVector3 positionOffset = { 0, 0, 0 };
+	CVector2 uvScale        = { 1, 1 };
+	CVector2 uvOffset       = { 0, 0 };
+	bool     octahedral     = false;
+};
+
+
+// Geometry using a single material (texture). Vertices are interleaved, each vertex is vertexSize bytes holding the elements
+// in the layout
+struct MeshSubMeshData
+{
+	std::vector<VertexElement> layout;
+	unsigned int               vertexSize = 0;
+	unsigned int               numVertices = 0;
+	std::vector<unsigned char> vertices; // numVertices * vertexSize bytes
+	std::vector<uint32_t>      indices;  // Triangle list. Held as 16-bit values in cache files and on the GPU when they fit, see IndexSize
+	VertexDecode               decode;
+};
+
+// Size in bytes of each index of a sub-mesh with the given number of vertices on the GPU: 2 for under 65536 vertices, else 4
+inline unsigned int IndexSize(unsigned int numVertices)  { return numVertices < 65536 ? 2 : 4; }
+
+
+// A node in the mesh hierarchy. A node represents a seperate animatable part of the mesh, it can contain several sub-meshes
+// and can have child nodes that follow its motion
+struct MeshNode
+{
+	std::string  name;
+
+	CMatrix4x4   defaultMatrix; // Starting position/rotation/scale for this node. Relative to parent. Used when first creating a model from this mesh
+	CMatrix4x4   offsetMatrix;  // Transform from the skinned mesh root to this node when it is used as a bone
+	BoundingBox  bounds;        // Box around this node's sub-meshes in the node's space, worked out when loading
+
+	unsigned int parentIndex = 0; // Index of the parent node. Root node refers to itself (0)
+
+	std::vector<unsigned int> childNodes; // Child nodes that are controlled by this node (indexes into the nodes)
+	std::vector<unsigned int> subMeshes;  // The geometry representing this node (indexes into the sub-meshes)
+};
+
+
+// Everything the Mesh class needs to create its GPU buffers and render
+struct MeshData
+{
+	std::vector<MeshNode>        nodes;     // First entry is root, remainder are stored in depth-first order
+	std::vector<MeshSubMeshData> subMeshes;
+	bool                         hasBones = false; // If any sub-mesh has bones, then all sub-meshes have bone indexes and weights
+};
+
+
+// Return true if two meshes hold exactly the same data (matrices, bounds and decode values compared bit for bit)
+bool MeshDataEqual(const MeshData& a, const MeshData& b);
+
+// Return true if the node and sub-mesh indexes in the data are in range, each sub-mesh has the vertices and a whole number
+// of triangles its sizes say, and each element fits in a vertex. Data is checked with this before it is saved to a cache
+bool MeshDataValid(const MeshData& data);
+
+
+//--------------------------------------------------------------------------------------
+// Cache
+//--------------------------------------------------------------------------------------
+
+// Version of the cache file format and of the data that goes into it. Increase it when either changes (including the import
+// code or settings in Mesh.cpp) so old cache files are imported again
+const uint32_t MeshCacheVersion = 3;
+
+// Identifies the source a cache file was made from
+struct MeshCacheKey
+{
+	uint64_t sourceHash    = 0; // HashFile of the mesh file
+	uint64_t sourceSize    = 0; // Size of the mesh file in bytes
+	uint32_t importFlags   = 0; // assimp post-processing flags
+	uint32_t importOptions = 0; // Other settings that change the data, e.g. components removed by assimp
+};
+
+// 64-bit FNV-1a hash of a whole file and its size in bytes. Returns false if the file can't be read
+bool HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size);
+
+// Name of the cache file for a mesh file
+std::string MeshCacheFileName(const std::string& meshFileName);
+
+
+// Save mesh data to a cache file with the given key. The file is written under a temporary name and then renamed, so a
+// partly written cache is never read. Returns false on failure, or if the data isn't valid (see MeshDataValid)
+bool SaveMeshCache(const std::string& cacheFileName, const MeshCacheKey& key, const MeshData& data);
+
+// Load mesh data from a cache file into memory of its own (see MeshCacheView to use the file in place). Returns false if the
+// file is missing, has a different version or key, or is damaged - the data should then be imported from the source again
+bool LoadMeshCache(const std::string& cacheFileName, const MeshCacheKey& key, MeshData& data);
+
+
+//--------------------------------------------------------------------------------------
+// Cache file layout
+//--------------------------------------------------------------------------------------
+// Offsets are in bytes from the start of the file. The tables follow the header in the order
+// below, each list of node indexes is a range of the node index table and each name is a range
+// of the string table. Sub-mesh vertices and indices follow the tables, indices are the size
+// given by IndexSize
+
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;    // The MeshCacheKey used when saving
+	uint64_t sourceSize;
+	uint32_t importFlags;
+	uint32_t importOptions;
+	uint64_t fileSize;      // Whole file, so a truncated or extended file is rejected
+	uint32_t hasBones;
+	uint32_t numNodes;
+	uint32_t numSubMeshes;
+	uint32_t numElements;   // Vertex elements of all sub-meshes
+	uint32_t numNodeIndexes;
+	uint32_t stringsSize;   // Bytes, including the null after each string
+};
+
+struct MeshCacheNode
+{
+	CMatrix4x4  defaultMatrix;
+	CMatrix4x4  offsetMatrix;
+	BoundingBox bounds;
+	uint32_t    parentIndex;
+	uint32_t    nameOffset;   // In the string table
+	uint32_t    nameLength;   // Not including the null
+	uint32_t    firstChild;   // In the node index table
+	uint32_t    numChildren;
+	uint32_t    firstSubMesh; // In the node index table
+	uint32_t    numSubMeshes;
+	uint32_t    padding[3];
+};
+
+struct MeshCacheSubMesh
+{
+	uint64_t verticesOffset; // From the start of the file
+	uint64_t indicesOffset;
+	uint32_t vertexSize;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t indexSize;      // Bytes
+	uint32_t firstElement;   // In the element table
+	uint32_t numElements;
+	float    positionScale[3]; // The sub-mesh's VertexDecode
+	float    positionOffset[3];
+	float    uvScale[2];
+	float    uvOffset[2];
+	uint32_t octahedral;
+	uint32_t padding[3];
+};
+
+struct MeshCacheElement
+{
+	uint32_t     semanticOffset; // In the string table
+	uint32_t     semanticLength;
+	uint32_t     semanticIndex;
+	VertexFormat format;
+	uint32_t     offset;         // From the start of the vertex
+};
+
+
+// A cache file mapped into memory (see MappedFile.h), with its contents used in place. Open checks the whole file before any
+// of it is used, so every count, offset and index in it is safe to use
+class MeshCacheView
+{
+public:
+	// Map a cache file and check it. Returns false if the file is missing, has a different version or key, or is damaged
+	bool Open(const std::string& cacheFileName, const MeshCacheKey& key);
+	void Close();
+
+	bool   IsOpen()   const { return mHeader != nullptr; }
+	size_t FileSize() const { return mFile.Size(); }
+
+	bool HasBones() const { return mHeader->hasBones != 0; }
+
+	// Nodes, in the same order as MeshData::nodes. Names are null-terminated
+	unsigned int         NumNodes()                        const { return mHeader->numNodes; }
+	const MeshCacheNode& Node(unsigned int node)           const { return mNodes[node]; }
+	const char*          NodeName(unsigned int node)       const { return mStrings + mNodes[node].nameOffset; }
+	const uint32_t*      ChildNodes(unsigned int node)     const { return mNodeIndexes + mNodes[node].firstChild; }
+	const uint32_t*      NodeSubMeshes(unsigned int node)  const { return mNodeIndexes + mNodes[node].firstSubMesh; }
+
+	// Sub-meshes and their vertex layouts, vertices and indices. Semantic names are null-terminated. Each index is the sub-mesh
+	// record's indexSize bytes
+	unsigned int            NumSubMeshes()                         const { return mHeader->numSubMeshes; }
+	const MeshCacheSubMesh& SubMesh(unsigned int subMesh)          const { return mSubMeshes[subMesh]; }
+	const MeshCacheElement* Layout(unsigned int subMesh)           const { return mElements + mSubMeshes[subMesh].firstElement; }
+	const char*             Semantic(const MeshCacheElement& e)    const { return mStrings + e.semanticOffset; }
+	const unsigned char*    Vertices(unsigned int subMesh)         const { return mFile.Data() + mSubMeshes[subMesh].verticesOffset; }
+	const void*             Indices(unsigned int subMesh)          const { return mFile.Data() + mSubMeshes[subMesh].indicesOffset; }
+	VertexDecode            Decode(unsigned int subMesh)           const;
+
+	// Index number i of a sub-mesh, whatever its index size
+	uint32_t Index(unsigned int subMesh, uint32_t i) const
+	{
+		const void* indices = Indices(subMesh);
+		return mSubMeshes[subMesh].indexSize == 2 ? static_cast<const uint16_t*>(indices)[i] : static_cast<const uint32_t*>(indices)[i];
+	}
+
+	// Copy the contents into mesh data of its own
+	MeshData ToMeshData() const;
+
+private:
+	// Return true if the mapped file's tables and ranges are all consistent
+	bool Check();
+
+	MappedFile              mFile;
+	const MeshCacheHeader*  mHeader      = nullptr;
+	const MeshCacheNode*    mNodes       = nullptr;
+	const MeshCacheSubMesh* mSubMeshes   = nullptr;
+	const MeshCacheElement* mElements    = nullptr;
+	const uint32_t*         mNodeIndexes = nullptr;
+	const char*             mStrings     = nullptr;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckMeshCache
+struct MeshCacheCheck
+{
+	double saveMBps = 0; // Speed of SaveMeshCache in megabytes of cache file per second
+	double loadMBps = 0; // Speed of LoadMeshCache
+	double openMBps = 0; // Speed of MeshCacheView::Open, which checks the file in place without copying it
+
+	bool roundTrip        = false; // True if the loaded data was exactly the same as the saved data
+	bool staleRejected    = false; // True if files with a different version or key were not loaded
+	bool damagedRejected  = false; // True if truncated files and files with inconsistent tables or indexes were not loaded, and invalid data wasn't saved
+	bool passed           = false; // True if all of the above
+};
+
+// Save and load a random skinned mesh with the given number of vertices in each of its sub-meshes, repeats times, to the given
+// cache file, then check stale and damaged files are rejected. The file is deleted afterwards. Needs no graphics device
+MeshCacheCheck CheckMeshCache(const std::string& cacheFileName, unsigned int vertices, unsigned int repeats);
+
+
+#endif // _MESH_DATA_H_INCLUDED_
@@ -13,10 +13,12 @@
 Model::Model(Mesh* mesh, CVector3 position /*= { 0,0,0 }*/, CVector3 rotation /*= { 0,0,0 }*/, float scale /*= 1*/)
     : mMesh(mesh)
 {
-    // Set default matrices from mesh
+    // Set default matrices from mesh, and the transforms from them
+    mTransforms.resize(mesh->NumberNodes());
     mWorldMatrices.resize(mesh->NumberNodes());
+    mMatrixDirty.resize(mesh->NumberNodes());
     for (int i = 0; i < mWorldMatrices.size(); ++i)
-        mWorldMatrices[i] = mesh->GetNodeDefaultMatrix(i);
+        SetWorldMatrix(mesh->GetNodeDefaultMatrix(i), i);
 }
 
 
@@ -25,50 +27,93 @@ Model::Model(Mesh* mesh, CVector3 position /*= { 0,0,0 }*/, CVector3 rotation /*
 // All other per-frame constants must have been set already along with shaders, textures, samplers, states etc.
 void Model::Render()
 {
+    UpdateMatrices();
     mMesh->Render(mWorldMatrices);
 }
 
 
+// Return a world space box around the whole model. Only recalculated after the model moves
+BoundingBox Model::WorldBounds()
+{
+    if (mBoundsDirty)
+    {
+        UpdateMatrices();
+        mWorldBounds = mMesh->WorldBounds(mWorldMatrices);
+        mBoundsDirty = false;
+    }
+    return mWorldBounds;
+}
+
+
+// Rebuild the world matrix of a node if its transform has changed
+void Model::UpdateMatrix(int node)
+{
+    if (mMatrixDirty[node])
+    {
+        mWorldMatrices[node] = mTransforms[node].GetMatrix();
+        mMatrixDirty[node] = false;
+    }
+}
+
+// Rebuild the world matrices of all nodes whose transform has changed
+void Model::UpdateMatrices()
+{
+    if (!mAnyDirty)  return;
+    for (int i = 0; i < mWorldMatrices.size(); ++i)
+        UpdateMatrix(i);
+    mAnyDirty = false;
+}
+
+
 // Control a given node in the model using keys provided. Amount of motion performed depends on frame time
 void Model::Control(int node, float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
                                                KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward)
 {
-    auto& matrix = mWorldMatrices[node]; // Use reference to node matrix to make code below more readable
+    // Leave the world matrix as it is if there's nothing to do
+    if (!KeyHeld(turnUp) && !KeyHeld(turnDown) && !KeyHeld(turnLeft) && !KeyHeld(turnRight) &&
+        !KeyHeld(turnCW) && !KeyHeld(turnCCW) && !KeyHeld(moveForward) && !KeyHeld(moveBackward))  return;
 
+    auto& transform = mTransforms[node]; // Use reference to node transform to make code below more readable
+
+	// Rotations are around the node's own axes, so come before its current rotation. The angles are small and the rotation is
+	// normalised below, so the fast sine and cosine are plenty accurate
 	if (KeyHeld( turnUp ))
 	{
-		matrix = MatrixRotationX(ROTATION_SPEED * frameTime) * matrix;
+		transform.rotation = QuaternionRotationX(ROTATION_SPEED * frameTime, TrigPolicy::Fast) * transform.rotation;
 	}
 	if (KeyHeld( turnDown ))
 	{
-		matrix = MatrixRotationX(-ROTATION_SPEED * frameTime) * matrix;
+		transform.rotation = QuaternionRotationX(-ROTATION_SPEED * frameTime, TrigPolicy::Fast) * transform.rotation;
 	}
 	if (KeyHeld( turnRight ))
 	{
-		matrix = MatrixRotationY(ROTATION_SPEED * frameTime) * matrix;
+		transform.rotation = QuaternionRotationY(ROTATION_SPEED * frameTime, TrigPolicy::Fast) * transform.rotation;
 	}
 	if (KeyHeld( turnLeft ))
 	{
-		matrix = MatrixRotationY(-ROTATION_SPEED * frameTime) * matrix;
+		transform.rotation = QuaternionRotationY(-ROTATION_SPEED * frameTime, TrigPolicy::Fast) * transform.rotation;
 	}
 	if (KeyHeld( turnCW ))
 	{
-		matrix = MatrixRotationZ(ROTATION_SPEED * frameTime) * matrix;
+		transform.rotation = QuaternionRotationZ(ROTATION_SPEED * frameTime, TrigPolicy::Fast) * transform.rotation;
 	}
 	if (KeyHeld( turnCCW ))
 	{
-		matrix = MatrixRotationZ(-ROTATION_SPEED * frameTime) * matrix;
+		transform.rotation = QuaternionRotationZ(-ROTATION_SPEED * frameTime, TrigPolicy::Fast) * transform.rotation;
 	}
 
-	// Local Z movement - move in the direction of the Z axis, get axis from world matrix
-    CVector3 localZDir = Normalise(matrix.GetRow(2)); // normalise axis in case world matrix has scaling
+	// Local Z movement - move in the direction of the Z axis, get axis from rotation (it has no scaling)
+    CVector3 localZDir = transform.rotation.GetZAxis();
 	if (KeyHeld( moveForward ))
 	{
-
-		matrix.SetRow(3, matrix.GetRow(3) + localZDir * MOVEMENT_SPEED * frameTime);
+		transform.position += localZDir * MOVEMENT_SPEED * frameTime;
 	}
 	if (KeyHeld( moveBackward ))
 	{
-		matrix.SetRow(3, matrix.GetRow(3) - localZDir * MOVEMENT_SPEED * frameTime);
+		transform.position -= localZDir * MOVEMENT_SPEED * frameTime;
 	}
+
+	// Small rounding errors build up as rotations are combined each frame, so keep the quaternion unit length
+	transform.rotation = Normalise(transform.rotation);
+	SetDirty(node);
 }
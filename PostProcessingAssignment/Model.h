@@ -6,6 +6,9 @@
 
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "CQuaternion.h"
+#include "CTransform.h"
+#include "Frustum.h"
 #include "Input.h"
 
 #include <vector>
@@ -30,6 +33,12 @@ public:
     void Render();
 
 
+	// Return a world space box around the whole model, and whether any of it may be seen with the given frustum (see Frustum.h).
+	// The box is only recalculated after the model moves
+	BoundingBox WorldBounds();
+	bool IsVisible(const Frustum& frustum)  { return ::IsVisible(frustum, WorldBounds()); }
+
+
 	// Control a given node in the model using keys provided. Amount of motion performed depends on frame time
 	void Control(int node, float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,  
 				                            KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward );
@@ -43,48 +52,67 @@ public:
     // All functions now accept a "node" parameter which specifies which node in the hierarchy to use. Defaults to 0, the root.
     // The hierarchy is stored in depth-first order
 
-	// Getters - model only stores matrices. Position, rotation and scale are extracted if requested.
-	CVector3 Position(int node = 0)  { return mWorldMatrices[node].GetRow(3); }         // Position is on bottom row of matrix
-	CVector3 Rotation(int node = 0)  { return mWorldMatrices[node].GetEulerAngles(); }  // Getting angles from a matrix is complex - see .cpp file
-	CVector3 Scale(int node = 0)     { return { Length(mWorldMatrices[node].GetRow(0)),
-                                                Length(mWorldMatrices[node].GetRow(1)), 
-                                                Length(mWorldMatrices[node].GetRow(2)) }; } // Scale is length of rows 0-2 in matrix
-	CMatrix4x4 WorldMatrix(int node = 0)  { return mWorldMatrices[node]; }
-
-    // Setters - model only stores matricies , so if user sets position, rotation or scale, just update those aspects of the matrix
-	void SetPosition(CVector3 position, int node = 0)  { mWorldMatrices[node].SetRow(3, position); }
-
-	void SetRotation(CVector3 rotation, int node = 0)
-    {
-        // To put rotation angles into a matrix we need to build the matrix from scratch to make sure we retain existing scaling and position
-        mWorldMatrices[node] = MatrixScaling(Scale(node)) *
-                               MatrixRotationZ(rotation.z) * MatrixRotationX(rotation.x) * MatrixRotationY(rotation.y) *
-                               MatrixTranslation(Position(node));
-    }
+	// Getters - model stores a transform for each node (position, rotation and scale held separately, see CTransform.h), so these
+	// are quick. The world matrix is built from the transform when it is requested after a change
+	CVector3    Position(int node = 0)   { return mTransforms[node].position; }
+	CVector3    Rotation(int node = 0)   { return mTransforms[node].rotation.GetEulerAngles(); }
+	CQuaternion Quaternion(int node = 0) { return mTransforms[node].rotation; }
+	CVector3    Scale(int node = 0)      { return mTransforms[node].scale; }
+	CTransform  Transform(int node = 0)  { return mTransforms[node]; }
+	CMatrix4x4  WorldMatrix(int node = 0)  { UpdateMatrix(node); return mWorldMatrices[node]; }
+
+	// Setters - change the transform, the world matrix is rebuilt next time it is needed
+	void SetPosition(CVector3 position, int node = 0)  { mTransforms[node].position = position;  SetDirty(node); }
+
+	// Rotation angles are applied in the order Z, X, Y, as MatrixRotationZ(z) * MatrixRotationX(x) * MatrixRotationY(y)
+	void SetRotation(CVector3 rotation, int node = 0)       { mTransforms[node].rotation = QuaternionRotationEuler(rotation);  SetDirty(node); }
+	void SetRotation(CQuaternion rotation, int node = 0)    { mTransforms[node].rotation = rotation;  SetDirty(node); }
 
 	// Two ways to set scale: x,y,z separately, or all to the same value
-    // To set scale without affecting rotation, normalise each row, then multiply it by the scale value.
-	void SetScale(CVector3 scale, int node = 0)
-    {
-        mWorldMatrices[node].SetRow(0, Normalise(mWorldMatrices[node].GetRow(0)) * scale.x); 
-        mWorldMatrices[node].SetRow(1, Normalise(mWorldMatrices[node].GetRow(1)) * scale.y); 
-        mWorldMatrices[node].SetRow(2, Normalise(mWorldMatrices[node].GetRow(2)) * scale.z); 
-    }
+	void SetScale(CVector3 scale, int node = 0)  { mTransforms[node].scale = scale;  SetDirty(node); }
 	void SetScale(float scale)  { SetScale({ scale, scale, scale });}
 
-    void SetWorldMatrix(CMatrix4x4 matrix, int node = 0)  { mWorldMatrices[node] = matrix; }
+	void SetTransform(const CTransform& transform, int node = 0)  { mTransforms[node] = transform;  SetDirty(node); }
+
+	// Set the world matrix directly. The transform is extracted from it, shear in the matrix is lost from the transform but the
+	// matrix is kept as given until the transform is next changed
+	void SetWorldMatrix(CMatrix4x4 matrix, int node = 0)
+	{
+		mTransforms[node] = TransformFromMatrix(matrix);
+		mWorldMatrices[node] = matrix;
+		mMatrixDirty[node] = false;
+		mBoundsDirty = true;
+	}
 
 
 	//-------------------------------------
 	// Private data / members
 	//-------------------------------------
 private:
+	// Mark a node's world matrix as needing to be rebuilt from its transform
+	void SetDirty(int node)  { mMatrixDirty[node] = true;  mAnyDirty = true;  mBoundsDirty = true; }
+
+	// Rebuild the world matrix of a node, or all nodes, if its transform has changed
+	void UpdateMatrix(int node);
+	void UpdateMatrices();
+
+
     Mesh* mMesh;
 
-	// World matrices for the model
-    // Now that meshes have multiple parts, we need multiple matrices. The root matrix (the first one) is the world matrix
-    // for the entire model. The remaining matrices are relative to their parent part. The hierarchy is defined in the mesh (nodes)
+	// Transforms for the model, one for each node, kept in step with the world matrices below
+	// Now that meshes have multiple parts, we need multiple transforms. The root transform (the first one) is for the entire
+	// model. The remaining transforms are relative to their parent part. The hierarchy is defined in the mesh (nodes)
+	std::vector<CTransform> mTransforms;
+
+	// World matrices for the model, made from the transforms when needed. mMatrixDirty is true for the nodes whose transform has
+	// changed since their matrix was made, mAnyDirty is true if any are
 	std::vector<CMatrix4x4> mWorldMatrices;
+	std::vector<bool>       mMatrixDirty;
+	bool                    mAnyDirty = false;
+
+	// World space box around the model, recalculated when mBoundsDirty is set
+	BoundingBox mWorldBounds;
+	bool        mBoundsDirty = true;
 };
 
 
@@ -0,0 +1,272 @@
+//--------------------------------------------------------------------------------------
+// Bloom
+//--------------------------------------------------------------------------------------
+// Bloom planning and CPU version. See header file for details
+
+#include "PostProcessBloom.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+
+//--------------------------------------------------------------------------------------
+// Plans
+//--------------------------------------------------------------------------------------
+
+// Plan a bloom for an image of the given size
+BloomPlan PlanBloom(unsigned int width, unsigned int height, unsigned int smallestSize /*= 16*/)
+{
+	// Round to the nearest level so the smallest size is within a factor of root 2 of the one asked for
+	float size = static_cast<float>(std::min(width, height));
+	int levels = static_cast<int>(std::round(std::log2(size / std::max(smallestSize, 1u))));
+
+	BloomPlan plan;
+	plan.levels = static_cast<unsigned int>(std::min(std::max(levels, 1), 12));
+
+	// Pass p (p < levels) writes level p + 1, the bright pass being the first
+	plan.passes.push_back(BloomPass::BrightPass);
+	plan.passLevels.push_back(1);
+	plan.passAddInput.push_back(-1);
+	for (unsigned int level = 2; level <= plan.levels; ++level)
+	{
+		plan.passes.push_back(BloomPass::Downsample);
+		plan.passLevels.push_back(level);
+		plan.passAddInput.push_back(-1);
+	}
+
+	// Each upsample adds the downsample of the size it writes
+	for (unsigned int level = plan.levels - 1; level >= 1; --level)
+	{
+		plan.passes.push_back(BloomPass::Upsample);
+		plan.passLevels.push_back(level);
+		plan.passAddInput.push_back(level - 1);
+	}
+
+	plan.passes.push_back(BloomPass::Composite);
+	plan.passLevels.push_back(0);
+	plan.passAddInput.push_back(-1);
+	return plan;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CPU version
+//--------------------------------------------------------------------------------------
+// Each stage matches the same stage in Bloom_pp.hlsl. Offsets are in texels of the image being read
+
+// Add colour times weight to total
+static void AddWeighted(ColourRGBA& total, const ColourRGBA& colour, float weight)
+{
+	total.r += colour.r * weight;
+	total.g += colour.g * weight;
+	total.b += colour.b * weight;
+	total.a += colour.a * weight;
+}
+
+// Run the given function for every pixel of the output, passing the UV of the pixel centre and the size of a source texel
+template <typename PixelFn>
+static void ForEachPixel(const ImageRGBA& source, ImageRGBA& output, unsigned int width, unsigned int height, PixelFn pixelFn)
+{
+	output = ImageRGBA(width, height);
+	CVector2 texel = { 1.0f / source.Width(), 1.0f / source.Height() };
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			output.Pixel(x, y) = pixelFn(CVector2{ (x + 0.5f) / width, (y + 0.5f) / height }, texel);
+		}
+	}
+}
+
+
+// Average of 4 bilinear samples at the corners of a 2 texel square, i.e. a 4x4 texel box, then keep only the colour above
+// the threshold. The knee gives a curve into the cut-off rather than a sharp edge, which would flicker as pixels cross it
+static ColourRGBA BrightPassPixel(const ImageRGBA& source, const CVector2& uv, const CVector2& texel, const BloomSettings& settings)
+{
+	ColourRGBA colour = { 0, 0, 0, 0 };
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ -texel.x, -texel.y }), 0.25f);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{  texel.x, -texel.y }), 0.25f);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ -texel.x,  texel.y }), 0.25f);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{  texel.x,  texel.y }), 0.25f);
+
+	float brightness = std::max(std::max(colour.r, colour.g), colour.b);
+	float soft = std::min(std::max(brightness - settings.threshold + settings.knee, 0.0f), 2 * settings.knee);
+	soft = soft * soft / (4 * settings.knee + 0.0001f);
+	float contribution = std::max(soft, brightness - settings.threshold) / std::max(brightness, 0.0001f);
+	return { colour.r * contribution, colour.g * contribution, colour.b * contribution, 1 };
+}
+
+// Dual filter downsample: the centre (between 2x2 texels) and four diagonals a texel away, centre weighted 4 of 8
+static ColourRGBA DownsamplePixel(const ImageRGBA& source, const CVector2& uv, const CVector2& texel)
+{
+	ColourRGBA colour = { 0, 0, 0, 0 };
+	AddWeighted(colour, source.SampleBilinearClamp(uv), 0.5f);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ -texel.x, -texel.y }), 0.125f);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{  texel.x, -texel.y }), 0.125f);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ -texel.x,  texel.y }), 0.125f);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{  texel.x,  texel.y }), 0.125f);
+	return colour;
+}
+
+// Dual filter upsample: a diamond of four samples a texel away (weight 1) and four diagonals half a texel away (weight 2),
+// plus the image of the same size from the downsample chain
+static ColourRGBA UpsamplePixel(const ImageRGBA& source, const ImageRGBA& add, const CVector2& uv, const CVector2& texel)
+{
+	ColourRGBA colour = add.SampleBilinearClamp(uv);
+	const float w1 = 1.0f / 12;
+	const float w2 = 2.0f / 12;
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ -texel.x, 0 }), w1);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{  texel.x, 0 }), w1);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ 0, -texel.y }), w1);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ 0,  texel.y }), w1);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ -texel.x * 0.5f, -texel.y * 0.5f }), w2);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{  texel.x * 0.5f, -texel.y * 0.5f }), w2);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{ -texel.x * 0.5f,  texel.y * 0.5f }), w2);
+	AddWeighted(colour, source.SampleBilinearClamp(uv + CVector2{  texel.x * 0.5f,  texel.y * 0.5f }), w2);
+	return colour;
+}
+
+// Run the bright pass over a whole image, writing a half size image
+static void BrightPass(const ImageRGBA& source, ImageRGBA& output, const BloomSettings& settings)
+{
+	ForEachPixel(source, output, std::max(source.Width() / 2, 1u), std::max(source.Height() / 2, 1u),
+	             [&](const CVector2& uv, const CVector2& texel) { return BrightPassPixel(source, uv, texel, settings); });
+}
+
+// Time since the given start time in milliseconds
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Bloom the source image by running the passes of the plan with the same sampling as Bloom_pp.hlsl
+void CPUBloom(const BloomPlan& plan, const BloomSettings& settings, const ImageRGBA& source, ImageRGBA& output,
+              BloomTimings* timings /*= nullptr*/)
+{
+	BloomTimings times;
+	const float compositeScale = settings.intensity / std::max(plan.levels, 1u);
+
+	// Output of every pass is kept, upsample passes read downsamples from much earlier
+	std::vector<ImageRGBA> passOutputs(plan.passes.size());
+	const ImageRGBA* previous = &source;
+	for (unsigned int pass = 0; pass < plan.passes.size(); ++pass)
+	{
+		unsigned int width  = std::max(source.Width()  >> plan.passLevels[pass], 1u);
+		unsigned int height = std::max(source.Height() >> plan.passLevels[pass], 1u);
+		ImageRGBA& target = passOutputs[pass];
+		const ImageRGBA& input = *previous;
+
+		auto start = std::chrono::steady_clock::now();
+		switch (plan.passes[pass])
+		{
+		case BloomPass::BrightPass:
+			ForEachPixel(input, target, width, height,
+			             [&](const CVector2& uv, const CVector2& texel) { return BrightPassPixel(input, uv, texel, settings); });
+			times.brightPassMs += MillisecondsSince(start);
+			break;
+
+		case BloomPass::Downsample:
+			ForEachPixel(input, target, width, height,
+			             [&](const CVector2& uv, const CVector2& texel) { return DownsamplePixel(input, uv, texel); });
+			times.downsampleMs += MillisecondsSince(start);
+			break;
+
+		case BloomPass::Upsample:
+		{
+			const ImageRGBA& add = passOutputs[plan.passAddInput[pass]];
+			ForEachPixel(input, target, width, height,
+			             [&](const CVector2& uv, const CVector2& texel) { return UpsamplePixel(input, add, uv, texel); });
+			times.upsampleMs += MillisecondsSince(start);
+			break;
+		}
+
+		case BloomPass::Composite:
+			ForEachPixel(input, target, width, height, [&](const CVector2& uv, const CVector2&)
+			{
+				ColourRGBA colour = source.SampleBilinearClamp(uv);
+				AddWeighted(colour, input.SampleBilinearClamp(uv), compositeScale);
+				colour.a = 1;
+				return colour;
+			});
+			times.compositeMs += MillisecondsSince(start);
+			break;
+		}
+		previous = &target;
+	}
+
+	output = std::move(passOutputs.back());
+	if (timings)  *timings = times;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time CPUBloom on an image of the given size with bright spots scattered over a dark background
+BloomBenchmark BenchmarkBloom(unsigned int width, unsigned int height, unsigned int repeats, const BloomSettings& settings /*= {}*/)
+{
+	BloomBenchmark result;
+	result.width  = width;
+	result.height = height;
+
+	// Dim noise with bright squares of various sizes, so every level of the bloom has something to spread
+	ImageRGBA source(width, height);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> dim(0.0f, 0.4f);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			source.Pixel(x, y) = { dim(random), dim(random), dim(random), 1 };
+		}
+	}
+	std::uniform_int_distribution<unsigned int> spotX(0, width - 1), spotY(0, height - 1), spotSize(1, std::max(height / 40, 2u));
+	for (unsigned int spot = 0; spot < 200; ++spot)
+	{
+		unsigned int left = spotX(random), top = spotY(random), size = spotSize(random);
+		for (unsigned int y = top; y < std::min(top + size, height); ++y)
+		{
+			for (unsigned int x = left; x < std::min(left + size, width); ++x)
+			{
+				source.Pixel(x, y) = { 1, 0.9f, 0.7f, 1 };
+			}
+		}
+	}
+
+	BloomPlan plan = PlanBloom(width, height);
+	result.levels = plan.levels;
+
+	ImageRGBA output;
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+	{
+		BloomTimings timings;
+		CPUBloom(plan, settings, source, output, &timings);
+		result.timings.brightPassMs += timings.brightPassMs / repeats;
+		result.timings.downsampleMs += timings.downsampleMs / repeats;
+		result.timings.upsampleMs   += timings.upsampleMs   / repeats;
+		result.timings.compositeMs  += timings.compositeMs  / repeats;
+	}
+	result.totalMs = result.timings.brightPassMs + result.timings.downsampleMs + result.timings.upsampleMs + result.timings.compositeMs;
+
+	// Light added to the image against the light let through by the bright pass. Each bright pass pixel covers 2x2 source pixels
+	ImageRGBA bright;
+	BrightPass(source, bright, settings);
+	double added = 0, let = 0;
+	for (unsigned int i = 0; i < width * height; ++i)
+	{
+		const ColourRGBA& before = source.Data()[i];
+		const ColourRGBA& after  = output.Data()[i];
+		added += (after.r - before.r) + (after.g - before.g) + (after.b - before.b);
+	}
+	for (unsigned int i = 0; i < bright.Width() * bright.Height(); ++i)
+	{
+		const ColourRGBA& colour = bright.Data()[i];
+		let += 4.0 * (colour.r + colour.g + colour.b);
+	}
+	if (let > 0)  result.energyRatio = static_cast<float>(added / (let * settings.intensity));
+	return result;
+}
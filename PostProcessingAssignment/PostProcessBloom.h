@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------
+// Bloom
+//--------------------------------------------------------------------------------------
+// Bloom makes bright parts of the scene glow. It is done in stages, each a pass of Bloom_pp.hlsl:
+// - Bright pass: keep only the colour above a brightness threshold, at half size
+// - Downsample: halve the size repeatedly, each pass blurring a little ("dual filter" sampling,
+//   a few bilinear samples around each pixel)
+// - Upsample: double the size back up level by level, each pass blurring a little more and adding
+//   the downsampled image of the same size. Small levels give a wide glow, larger ones a tight glow
+// - Composite: add the glow to the scene
+//
+// The number of levels depends on the viewport height so the glow covers the same part of the
+// screen at any resolution, and each pass does a fixed amount of work per pixel. As each level has
+// a quarter of the pixels of the one above, the whole chain costs little more than the bright pass.
+//
+// This file is plain C++ with no DirectX. It plans the passes and has a CPU version of the same
+// pipeline, so its quality and the cost of each stage can be measured without a GPU
+
+#ifndef _POST_PROCESS_BLOOM_H_INCLUDED_
+#define _POST_PROCESS_BLOOM_H_INCLUDED_
+
+#include "ImageRGBA.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Plans
+//--------------------------------------------------------------------------------------
+
+// Settings for the bloom, also sent to Bloom_pp.hlsl
+struct BloomSettings
+{
+	float threshold = 0.7f; // Brightness (largest of red, green and blue) above which pixels glow
+	float knee      = 0.2f; // Width of the soft transition around the threshold, 0 for a hard cut-off
+	float intensity = 1.0f; // Strength of the glow. Divided by the number of levels, so doesn't depend on resolution
+};
+
+
+// The stages of the bloom
+enum class BloomPass
+{
+	BrightPass,
+	Downsample,
+	Upsample,
+	Composite,
+};
+
+
+// The passes needed for a bloom at a given size
+struct BloomPlan
+{
+	unsigned int levels = 0; // Number of reduced sizes, the smallest is 1/2^levels of full size
+
+	std::vector<BloomPass>    passes;     // Passes in order
+	std::vector<unsigned int> passLevels; // Size of the output of each pass, as a power of two below full size (0 = full, 1 = half...)
+
+	// Passes that read a second image: for upsample passes, the pass whose output of the same size is added, -1 for others. The
+	// composite pass reads the image being bloomed as well as the previous pass
+	std::vector<int> passAddInput;
+};
+
+// Plan a bloom for an image of the given size. Levels are added until the smallest is close to smallestSize pixels high (or wide,
+// if that is less) so the glow spreads the same distance relative to the image at any resolution
+BloomPlan PlanBloom(unsigned int width, unsigned int height, unsigned int smallestSize = 16);
+
+
+//--------------------------------------------------------------------------------------
+// CPU version
+//--------------------------------------------------------------------------------------
+
+// Time taken by each stage of CPUBloom
+struct BloomTimings
+{
+	double brightPassMs = 0;
+	double downsampleMs = 0; // All downsample passes
+	double upsampleMs   = 0; // All upsample passes
+	double compositeMs  = 0;
+};
+
+// Bloom the source image by running the passes of the plan with the same sampling as Bloom_pp.hlsl. Fills in the timings if given
+void CPUBloom(const BloomPlan& plan, const BloomSettings& settings, const ImageRGBA& source, ImageRGBA& output,
+              BloomTimings* timings = nullptr);
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Results of BenchmarkBloom, times are the average of all repeats
+struct BloomBenchmark
+{
+	unsigned int width   = 0;
+	unsigned int height  = 0;
+	unsigned int levels  = 0;
+	BloomTimings timings;
+	double       totalMs = 0;
+
+	// Glow added by the bloom compared to the light let through by the bright pass, should be close to 1. Lower means the
+	// filters lose light, higher that they add it
+	float energyRatio = 0;
+};
+
+// Time CPUBloom on an image of the given size with bright spots scattered randomly (but the same each run) over a dark background
+BloomBenchmark BenchmarkBloom(unsigned int width, unsigned int height, unsigned int repeats, const BloomSettings& settings = {});
+
+
+#endif //_POST_PROCESS_BLOOM_H_INCLUDED_
@@ -0,0 +1,778 @@
+//--------------------------------------------------------------------------------------
+// CPU post-processes
+//--------------------------------------------------------------------------------------
+// CPU versions of the post-process shaders. See header file for details
+
+#include "PostProcessCPU.h"
+#include "PostProcessBloom.h"
+#include "SIMDPack.h"
+#include "ColourPack.h"
+#include "FastTrig.h"
+#include "MathHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+
+//--------------------------------------------------------------------------------------
+// Names and kernel support
+//--------------------------------------------------------------------------------------
+
+// Return the name of an effect, for display
+const char* CPUEffectName(CPUEffect effect)
+{
+	static const char* names[NUM_CPU_EFFECTS] =
+		{ "Tint", "Underwater", "Blur", "Retro", "Gaussian", "Bloom", "Burn", "Distort", "Spiral", "HeatHaze", "GreyNoise" };
+	return names[static_cast<unsigned int>(effect)];
+}
+
+// Return the name of a kernel, for display
+const char* CPUKernelName(CPUKernel kernel)
+{
+	static const char* names[NUM_CPU_KERNELS] = { "Scalar", "SSE4.1", "AVX2" };
+	return names[static_cast<unsigned int>(kernel)];
+}
+
+// Return true if the CPU supports the given kernel. Checked once, the answer doesn't change
+bool CPUKernelSupported(CPUKernel kernel)
+{
+	static const bool sse41 = SupportsSSE41();
+	static const bool avx2  = SupportsAVX2();
+	if (kernel == CPUKernel::SSE41)  return sse41;
+	if (kernel == CPUKernel::AVX2)   return avx2;
+	return true;
+}
+
+// Return the fastest kernel the CPU supports
+CPUKernel BestCPUKernel()
+{
+	if (CPUKernelSupported(CPUKernel::AVX2))   return CPUKernel::AVX2;
+	if (CPUKernelSupported(CPUKernel::SSE41))  return CPUKernel::SSE41;
+	return CPUKernel::Scalar;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sampling
+//--------------------------------------------------------------------------------------
+// The same as the ImageRGBA sampling functions for each lane of a pack
+
+// An image to sample, which may be a tile of a larger frame. UVs go from 0->1 across the frame
+struct SampleImage
+{
+	const ColourRGBA* pixels = nullptr; // Pixel at (left, top)
+	int stride = 0;
+	int left = 0, top = 0, right = 0, bottom = 0;
+	int frameWidth = 0, frameHeight = 0;
+};
+
+static SampleImage ToSampleImage(const CPUSourceTile& tile)
+{
+	return { tile.pixels, static_cast<int>(tile.stride), tile.rect.left, tile.rect.top, tile.rect.right, tile.rect.bottom,
+	         static_cast<int>(tile.frameWidth), static_cast<int>(tile.frameHeight) };
+}
+
+// Texture maps are whole images, an empty SampleImage if not given
+static SampleImage ToSampleImage(const ImageRGBA* image)
+{
+	return image ? ToSampleImage(WholeImageTile(*image)) : SampleImage();
+}
+
+
+// Read the pixels at the given frame coordinates. Coordinates outside the part of the frame held read the nearest pixel held,
+// so a tile with too small a margin gives wrong colours rather than reading outside memory
+template <typename F>
+static Colour<F> Gather(const SampleImage& image, typename F::Int x, typename F::Int y)
+{
+	x = Clamp(x, image.left, image.right  - 1) + SplatInt(-image.left, F());
+	y = Clamp(y, image.top,  image.bottom - 1) + SplatInt(-image.top,  F());
+	return GatherPixels(image.pixels, y * SplatInt(image.stride, F()) + x);
+}
+
+// As ImageRGBA::SamplePoint
+template <typename F>
+static Colour<F> SamplePoint(const SampleImage& image, F u, F v)
+{
+	const int width  = image.frameWidth;
+	const int height = image.frameHeight;
+	auto x = Clamp(ToInt(Floor(u * static_cast<float>(width))),  0, width  - 1);
+	auto y = Clamp(ToInt(Floor(v * static_cast<float>(height))), 0, height - 1);
+	return Gather<F>(image, x, y);
+}
+
+// Find the two texels either side of a texel coordinate (already floored) wrapping around the edges. Uses floats as
+// there's no SIMD integer modulus, which is exact for any coordinate that fits in a float
+template <typename F>
+static void WrapTexels(F floorX, float size, typename F::Int& x0, typename F::Int& x1)
+{
+	F wrapped = floorX - Floor(floorX / size) * size;
+	wrapped = Select(wrapped >= Splat(size, F()), wrapped - size, wrapped); // Rounding in the division can leave it a whole size out
+	wrapped = Select(wrapped <  Splat(0.0f, F()), wrapped + size, wrapped);
+	F next = wrapped + 1.0f;
+	next = Select(next >= Splat(size, F()), next - size, next);
+	x0 = ToInt(wrapped);
+	x1 = ToInt(next);
+}
+
+// As ImageRGBA::SampleBilinearWrap (Wrap = true) or SampleBilinearClamp (Wrap = false)
+template <bool Wrap, typename F>
+static Colour<F> SampleBilinear(const SampleImage& image, F u, F v)
+{
+	const float width  = static_cast<float>(image.frameWidth);
+	const float height = static_cast<float>(image.frameHeight);
+	F fx = u * width  - 0.5f;
+	F fy = v * height - 0.5f;
+	F floorX = Floor(fx);
+	F floorY = Floor(fy);
+	F tx = fx - floorX;
+	F ty = fy - floorY;
+
+	typename F::Int x0, x1, y0, y1;
+	if (Wrap)
+	{
+		WrapTexels(floorX, width,  x0, x1);
+		WrapTexels(floorY, height, y0, y1);
+	}
+	else
+	{
+		auto ix = ToInt(floorX);
+		auto iy = ToInt(floorY);
+		const int maxX = image.frameWidth  - 1;
+		const int maxY = image.frameHeight - 1;
+		x0 = Clamp(ix,                    0, maxX);
+		x1 = Clamp(ix + SplatInt(1, F()), 0, maxX);
+		y0 = Clamp(iy,                    0, maxY);
+		y1 = Clamp(iy + SplatInt(1, F()), 0, maxY);
+	}
+
+	Colour<F> c00 = Gather<F>(image, x0, y0);
+	Colour<F> c10 = Gather<F>(image, x1, y0);
+	Colour<F> c01 = Gather<F>(image, x0, y1);
+	Colour<F> c11 = Gather<F>(image, x1, y1);
+
+	auto blend = [&](F a00, F a10, F a01, F a11)
+	{
+		F top    = a00 + (a10 - a00) * tx;
+		F bottom = a01 + (a11 - a01) * tx;
+		return top + (bottom - top) * ty;
+	};
+	return { blend(c00.r, c10.r, c01.r, c11.r), blend(c00.g, c10.g, c01.g, c11.g),
+	         blend(c00.b, c10.b, c01.b, c11.b), blend(c00.a, c10.a, c01.a, c11.a) };
+}
+
+template <typename F> static Colour<F> SampleBilinearWrap (const SampleImage& image, F u, F v) { return SampleBilinear<true> (image, u, v); }
+template <typename F> static Colour<F> SampleBilinearClamp(const SampleImage& image, F u, F v) { return SampleBilinear<false>(image, u, v); }
+
+
+//--------------------------------------------------------------------------------------
+// Effects
+//--------------------------------------------------------------------------------------
+// One function for each shader, following the shader code line by line. Samplers are replaced as follows:
+// - PointSample:    SamplePoint
+// - TrilinearWrap:  SampleBilinearWrap (maps are magnified so there's no mip-mapping)
+// - BilinearSample: SampleBilinearClamp
+
+// Settings and textures that are the same for every pixel
+struct EffectInputs
+{
+	const PostProcessingConstants& constants;
+	SampleImage source;
+	SampleImage noiseMap;
+	SampleImage burnMap;
+	SampleImage distortMap;
+	SampleImage addTexture;
+};
+
+// Shader inputs that vary per pixel, as PostProcessingInput in Common.hlsli. area2DRect is in the constants
+template <typename F>
+struct EffectPixels
+{
+	F sceneU, sceneV;
+	F areaU, areaV;
+};
+
+
+// Alpha for the area effects that fade out in a soft circle
+template <typename F>
+static F SoftCircleAlpha(const EffectPixels<F>& p, float softEdge)
+{
+	F centreX = p.areaU - 0.5f;
+	F centreY = p.areaV - 0.5f;
+	F centreLengthSq = centreX * centreX + centreY * centreY;
+	return 1.0f - Saturate((centreLengthSq - 0.25f + softEdge) / softEdge);
+}
+
+
+// Tint_pp.hlsl
+template <typename F>
+static Colour<F> TintEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const CVector3& tint1 = in.constants.tintColour1;
+	const CVector3& tint2 = in.constants.tintColour2;
+	Colour<F> colour = SamplePoint(in.source, p.sceneU, p.sceneV);
+	colour.r = colour.r * Lerp(Splat(tint1.x, F()), Splat(tint2.x, F()), p.sceneV);
+	colour.g = colour.g * Lerp(Splat(tint1.y, F()), Splat(tint2.y, F()), p.sceneV);
+	colour.b = colour.b * Lerp(Splat(tint1.z, F()), Splat(tint2.z, F()), p.sceneV);
+	colour.a = Splat(1.0f, F());
+	return colour;
+}
+
+
+// The sine waves used by the underwater and heat haze effects
+template <typename F>
+static void HazeWaves(const EffectInputs& in, const EffectPixels<F>& p, F& sinX, F& sinY)
+{
+	sinX = FastSin(p.areaU * ToRadians(1440.0f) + in.constants.heatHazeTimer * 3.0f);
+	sinY = FastSin(p.areaV * ToRadians(3600.0f) + in.constants.heatHazeTimer * 3.7f);
+}
+
+// Underwater_pp.hlsl
+template <typename F>
+static Colour<F> UnderwaterEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const float effectStrength = 0.01f;
+
+	F sinX, sinY;
+	HazeWaves(in, p, sinX, sinY);
+	F offsetU = sinY * effectStrength * in.constants.area2DSize.x;
+	F offsetV = sinX * effectStrength * in.constants.area2DSize.y;
+
+	Colour<F> colour = SamplePoint(in.source, p.sceneU + offsetU, p.sceneV + offsetV);
+	colour.r = colour.r * 0.0f;
+	colour.g = colour.g * 0.5f;
+	colour.a = Splat(1.0f, F());
+	return colour;
+}
+
+// HeatHaze_pp.hlsl
+template <typename F>
+static Colour<F> HeatHazeEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const float effectStrength = 0.01f;
+
+	F alpha = SoftCircleAlpha(p, 0.15f);
+	F sinX, sinY;
+	HazeWaves(in, p, sinX, sinY);
+	F offsetU = sinY * effectStrength * alpha * in.constants.area2DSize.x;
+	F offsetV = sinX * effectStrength * alpha * in.constants.area2DSize.y;
+
+	Colour<F> colour = SamplePoint(in.source, p.sceneU + offsetU, p.sceneV + offsetV);
+	colour.a = alpha * Saturate(sinX * sinY * 0.33f + 0.66f);
+	return colour;
+}
+
+
+// Blur_pp.hlsl - sixteen samples zooming towards the centre of the screen
+template <typename F>
+static Colour<F> BlurEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const float quality = 16;
+
+	Colour<F> colour = { Splat(0.0f, F()), Splat(0.0f, F()), Splat(0.0f, F()), Splat(0.0f, F()) };
+	for (float i = 0.0f; i < 1.0f; i += (1 / quality))
+	{
+		float v = 0.9f + i * 0.1f;
+		Colour<F> sample = SamplePoint(in.source, p.sceneU * v + 0.5f - 0.5f * v, p.sceneV * v + 0.5f - 0.5f * v);
+		colour.r = colour.r + sample.r;
+		colour.g = colour.g + sample.g;
+		colour.b = colour.b + sample.b;
+	}
+	colour.r = colour.r / quality;
+	colour.g = colour.g / quality;
+	colour.b = colour.b / quality;
+	colour.a = Splat(0.1f, F());
+	return colour;
+}
+
+
+// Retro_pp.hlsl
+template <typename F>
+static Colour<F> RetroEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	F u = Floor(p.sceneU * RETRO_PIXEL_SIZE.x) / RETRO_PIXEL_SIZE.x;
+	F v = Floor(p.sceneV * RETRO_PIXEL_SIZE.y) / RETRO_PIXEL_SIZE.y;
+	Colour<F> colour = SamplePoint(in.source, u, v);
+	colour.r = Floor(colour.r * RETRO_COLOUR_DEPTH.x) / RETRO_COLOUR_DEPTH.x;
+	colour.g = Floor(colour.g * RETRO_COLOUR_DEPTH.y) / RETRO_COLOUR_DEPTH.y;
+	colour.b = Floor(colour.b * RETRO_COLOUR_DEPTH.z) / RETRO_COLOUR_DEPTH.z;
+	colour.a = Splat(1.0f, F());
+	return colour;
+}
+
+
+// GaussianBlur_pp.hlsl - one direction of the blur, taps from the constants
+template <typename F>
+static Colour<F> GaussianEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const PostProcessingConstants& c = in.constants;
+	float directionU = c.horizontalBlur ? 1.0f / in.source.frameWidth  : 0.0f;
+	float directionV = c.horizontalBlur ? 0.0f : 1.0f / in.source.frameHeight;
+
+	Colour<F> centre = SampleBilinearClamp(in.source, p.sceneU, p.sceneV);
+	Colour<F> colour = { centre.r * c.gaussianTaps[0][1], centre.g * c.gaussianTaps[0][1], centre.b * c.gaussianTaps[0][1], Splat(0.1f, F()) };
+	for (unsigned int i = 1; i < std::min(c.gaussianTapCount, MAX_GAUSSIAN_TAPS); ++i)
+	{
+		float offsetU = directionU * c.gaussianTaps[i][0];
+		float offsetV = directionV * c.gaussianTaps[i][0];
+		float weight  = c.gaussianTaps[i][1];
+		Colour<F> plus  = SampleBilinearClamp(in.source, p.sceneU + offsetU, p.sceneV + offsetV);
+		Colour<F> minus = SampleBilinearClamp(in.source, p.sceneU - offsetU, p.sceneV - offsetV);
+		colour.r = colour.r + (plus.r + minus.r) * weight;
+		colour.g = colour.g + (plus.g + minus.g) * weight;
+		colour.b = colour.b + (plus.b + minus.b) * weight;
+	}
+	return colour;
+}
+
+
+// Add weighted bilinear samples at offsets in texels to a total, for the bloom stages
+template <typename F>
+static void AddBloomSample(Colour<F>& total, const SampleImage& image, const EffectPixels<F>& p, float texelX, float texelY, float weight)
+{
+	Colour<F> sample = SampleBilinearClamp(image, p.sceneU + texelX / image.frameWidth, p.sceneV + texelY / image.frameHeight);
+	total.r = total.r + sample.r * weight;
+	total.g = total.g + sample.g * weight;
+	total.b = total.b + sample.b * weight;
+}
+
+// Bloom_pp.hlsl - the stage is chosen by the constants
+template <typename F>
+static Colour<F> BloomEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const PostProcessingConstants& c = in.constants;
+	const SampleImage& add = in.addTexture.pixels ? in.addTexture : in.source;
+
+	Colour<F> colour = { Splat(0.0f, F()), Splat(0.0f, F()), Splat(0.0f, F()), Splat(1.0f, F()) };
+	switch (static_cast<BloomPass>(c.bloomStage))
+	{
+	case BloomPass::BrightPass:
+	{
+		AddBloomSample(colour, in.source, p, -1, -1, 0.25f);
+		AddBloomSample(colour, in.source, p,  1, -1, 0.25f);
+		AddBloomSample(colour, in.source, p, -1,  1, 0.25f);
+		AddBloomSample(colour, in.source, p,  1,  1, 0.25f);
+
+		F brightness = Max(Max(colour.r, colour.g), colour.b);
+		F soft = Min(Max(brightness - c.bloomThreshold + c.bloomKnee, Splat(0.0f, F())), Splat(2 * c.bloomKnee, F()));
+		soft = soft * soft / (4 * c.bloomKnee + 0.0001f);
+		F contribution = Max(soft, brightness - c.bloomThreshold) / Max(brightness, Splat(0.0001f, F()));
+		colour.r = colour.r * contribution;
+		colour.g = colour.g * contribution;
+		colour.b = colour.b * contribution;
+		break;
+	}
+	case BloomPass::Downsample:
+		AddBloomSample(colour, in.source, p,  0,  0, 4.0f / 8);
+		AddBloomSample(colour, in.source, p, -1, -1, 1.0f / 8);
+		AddBloomSample(colour, in.source, p,  1, -1, 1.0f / 8);
+		AddBloomSample(colour, in.source, p, -1,  1, 1.0f / 8);
+		AddBloomSample(colour, in.source, p,  1,  1, 1.0f / 8);
+		break;
+
+	case BloomPass::Upsample:
+		AddBloomSample(colour, in.source, p,    -1,     0, 1.0f / 12);
+		AddBloomSample(colour, in.source, p,     1,     0, 1.0f / 12);
+		AddBloomSample(colour, in.source, p,     0,    -1, 1.0f / 12);
+		AddBloomSample(colour, in.source, p,     0,     1, 1.0f / 12);
+		AddBloomSample(colour, in.source, p, -0.5f, -0.5f, 2.0f / 12);
+		AddBloomSample(colour, in.source, p,  0.5f, -0.5f, 2.0f / 12);
+		AddBloomSample(colour, in.source, p, -0.5f,  0.5f, 2.0f / 12);
+		AddBloomSample(colour, in.source, p,  0.5f,  0.5f, 2.0f / 12);
+		AddBloomSample(colour, add,       p,     0,     0, 1.0f);
+		break;
+
+	case BloomPass::Composite:
+		AddBloomSample(colour, in.source, p, 0, 0, 1.0f);
+		AddBloomSample(colour, add,       p, 0, 0, c.bloomIntensity);
+		colour.a = SoftCircleAlpha(p, 0.10f);
+		break;
+	}
+	return colour;
+}
+
+
+// Burn_pp.hlsl. The shader chooses between black, the scene or burning edges per pixel, here all three are
+// calculated and the right one selected for each lane
+template <typename F>
+static Colour<F> BurnEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const CVector3 burnColour = { 0.8f, 0.4f, 0.0f };
+	const CVector3 glowColour = { 1.0f, 0.8f, 0.0f };
+	const float glowAmount = 0.25f; // Thickness of glowing area
+	const float crinkle    = 0.15f; // Amount of texture crinkle at the edges
+
+	const float burnHeight   = in.constants.burnHeight;
+	const float burnLevelMax = burnHeight + glowAmount;
+	Colour<F> burnTexture = SampleBilinearWrap(in.burnMap, p.areaU, p.areaV);
+
+	// Burning edges
+	F glowLevel = 1.0f - (burnTexture.r - burnHeight) / glowAmount;
+	F crinkleU = burnTexture.g - 0.5f;
+	F crinkleV = burnTexture.b - 0.5f;
+	Colour<F> texColour = SamplePoint(in.source, p.sceneU - glowLevel * crinkle * crinkleU, p.sceneV - glowLevel * crinkle * crinkleV);
+	glowLevel = glowLevel * 2.0f;
+	auto burn = [&](F tex, float burnTint, float glow)
+	{
+		F burnt = tex * burnTint;
+		return Select(glowLevel < Splat(1.0f, F()), Lerp(tex, burnt, glowLevel), Lerp(burnt, Splat(glow, F()), glowLevel - 1.0f));
+	};
+	Colour<F> colour = { burn(texColour.r, burnColour.x, glowColour.x), burn(texColour.g, burnColour.y, glowColour.y),
+	                     burn(texColour.b, burnColour.z, glowColour.z), Splat(1.0f, F()) };
+
+	// Untouched scene above the burning range, black below it
+	Colour<F> scene = SamplePoint(in.source, p.sceneU, p.sceneV);
+	auto above = burnTexture.r >= Splat(burnLevelMax, F());
+	auto below = burnTexture.r <= Splat(burnHeight,   F());
+	colour.r = Select(below, Splat(0.0f, F()), Select(above, scene.r, colour.r));
+	colour.g = Select(below, Splat(0.0f, F()), Select(above, scene.g, colour.g));
+	colour.b = Select(below, Splat(0.0f, F()), Select(above, scene.b, colour.b));
+	return colour;
+}
+
+
+// Distort_pp.hlsl
+template <typename F>
+static Colour<F> DistortEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const float lightStrength = 0.015f;
+	const float glassDarken   = 0.8f;
+
+	Colour<F> distortTexture = SampleBilinearWrap(in.distortMap, p.areaU, p.areaV);
+	F distortU = distortTexture.g - 0.5f;
+	F distortV = distortTexture.b - 0.5f;
+
+	// Fake diffuse lighting from the top-left
+	F length = Sqrt(distortU * distortU + distortV * distortV);
+	F light = (distortU / length * 0.707f + distortV / length * 0.707f) * lightStrength;
+
+	const float level = in.constants.distortLevel;
+	Colour<F> colour = SamplePoint(in.source, p.sceneU + level * distortU, p.sceneV + level * distortV);
+	colour.r = light + colour.r * glassDarken;
+	colour.g = light + colour.g * glassDarken;
+	colour.b = light + colour.b * glassDarken;
+	colour.a = SoftCircleAlpha(p, 0.10f);
+	return colour;
+}
+
+
+// Spiral_pp.hlsl
+template <typename F>
+static Colour<F> SpiralEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const PostProcessingConstants& c = in.constants;
+	const float centreU = c.area2DTopLeft.x + c.area2DSize.x * 0.5f;
+	const float centreV = c.area2DTopLeft.y + c.area2DSize.y * 0.5f;
+	F offsetU = p.sceneU - centreU;
+	F offsetV = p.sceneV - centreV;
+	F centreDistance = Sqrt(offsetU * offsetU + offsetV * offsetV);
+
+	// Rotate the offset around the centre, more with distance (row vector times the shader's 2x2 matrix)
+	F angle = centreDistance * (c.spiralLevel * c.spiralLevel);
+	F s, cs;
+	FastSinCos(angle, s, cs);
+	F rotatedU = offsetU * cs - offsetV * s;
+	F rotatedV = offsetU * s  + offsetV * cs;
+
+	Colour<F> colour = SamplePoint(in.source, rotatedU + centreU, rotatedV + centreV);
+	colour.a = SoftCircleAlpha(p, 0.10f);
+	return colour;
+}
+
+
+// GreyNoise_pp.hlsl
+template <typename F>
+static Colour<F> GreyNoiseEffect(const EffectInputs& in, const EffectPixels<F>& p)
+{
+	const PostProcessingConstants& c = in.constants;
+	Colour<F> scene = SamplePoint(in.source, p.sceneU, p.sceneV);
+	F grey = (scene.r + scene.g + scene.b) / 3.0f;
+
+	F noiseU = p.sceneU * c.noiseScale.x + c.noiseOffset.x;
+	F noiseV = p.sceneV * c.noiseScale.y + c.noiseOffset.y;
+	grey = grey + NOISE_STRENGTH * (SampleBilinearWrap(in.noiseMap, noiseU, noiseV).r - 0.5f);
+
+	return { grey, grey, grey, SoftCircleAlpha(p, NOISE_SOFT_EDGE) };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Running effects
+//--------------------------------------------------------------------------------------
+
+// Return the pixels of an image of the given size inside the constants' area, those whose centres are inside it as when the GPU
+// draws the area quad
+PostProcessRect CPUEffectArea(const PostProcessingConstants& constants, unsigned int width, unsigned int height)
+{
+	auto firstPixel = [](float uv, unsigned int size)
+	{
+		return static_cast<int>(std::min(std::max(std::ceil(uv * size - 0.5f), 0.0f), static_cast<float>(size)));
+	};
+	const CVector2& topLeft = constants.area2DTopLeft;
+	const CVector2& size    = constants.area2DSize;
+	PostProcessRect area;
+	area.left   = firstPixel(topLeft.x,          width);
+	area.right  = firstPixel(topLeft.x + size.x, width);
+	area.top    = firstPixel(topLeft.y,          height);
+	area.bottom = firstPixel(topLeft.y + size.y, height);
+	return area;
+}
+
+
+// Run an effect on every pixel of the output tile inside the constants' area. Packs of F pixels are processed at once, with single
+// pixels at the end of each row. The effect is a generic function taking EffectPixels of any pack and returning a Colour of the same pack
+template <typename F, typename EffectFn>
+static void ForEachAreaPixel(const PostProcessingConstants& constants, bool alphaBlend, const CPUOutputTile& output, EffectFn effect)
+{
+	const float width  = static_cast<float>(output.frameWidth);
+	const float height = static_cast<float>(output.frameHeight);
+	const CVector2& topLeft = constants.area2DTopLeft;
+	const CVector2& size    = constants.area2DSize;
+	PostProcessRect pixels = Intersect(CPUEffectArea(constants, output.frameWidth, output.frameHeight), output.rect);
+	if (pixels.Empty())  return;
+
+	// Process some pixels along a row. G is F or Float1
+	auto processPixels = [&](auto pack, int x, int y)
+	{
+		using G = decltype(pack);
+		EffectPixels<G> pixels;
+		pixels.sceneU = (Ramp(G()) + (x + 0.5f)) / width;
+		pixels.sceneV = Splat((y + 0.5f) / height, G());
+		pixels.areaU  = (pixels.sceneU - topLeft.x) / size.x;
+		pixels.areaV  = (pixels.sceneV - topLeft.y) / size.y;
+
+		Colour<G> colour = effect(pixels);
+		ColourRGBA* destination = output.pixels + (y - output.rect.top) * output.stride + (x - output.rect.left);
+		if (alphaBlend)
+		{
+			// Colour is (source * alpha) + (destination * (1 - alpha)), alpha is the source alpha (see gAlphaBlendingState)
+			Colour<G> existing = LoadPixels(destination, G());
+			G inverseAlpha = 1.0f - colour.a;
+			colour.r = colour.r * colour.a + existing.r * inverseAlpha;
+			colour.g = colour.g * colour.a + existing.g * inverseAlpha;
+			colour.b = colour.b * colour.a + existing.b * inverseAlpha;
+		}
+		StorePixels(destination, colour);
+	};
+
+	for (int y = pixels.top; y < pixels.bottom; ++y)
+	{
+		int x = pixels.left;
+		for (; x + F::Lanes <= pixels.right; x += F::Lanes)  processPixels(F(), x, y);
+		for (; x < pixels.right; ++x)                        processPixels(Float1(), x, y);
+	}
+}
+
+
+// Run an effect with the given pack type
+template <typename F>
+static void RunEffect(CPUEffect effect, const EffectInputs& in, bool alphaBlend, const CPUOutputTile& output)
+{
+	const PostProcessingConstants& c = in.constants;
+	switch (effect)
+	{
+	case CPUEffect::Tint:       ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return TintEffect      (in, p); }); break;
+	case CPUEffect::Underwater: ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return UnderwaterEffect(in, p); }); break;
+	case CPUEffect::Blur:       ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return BlurEffect      (in, p); }); break;
+	case CPUEffect::Retro:      ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return RetroEffect     (in, p); }); break;
+	case CPUEffect::Gaussian:   ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return GaussianEffect  (in, p); }); break;
+	case CPUEffect::Bloom:      ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return BloomEffect     (in, p); }); break;
+	case CPUEffect::Burn:       ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return BurnEffect      (in, p); }); break;
+	case CPUEffect::Distort:    ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return DistortEffect   (in, p); }); break;
+	case CPUEffect::Spiral:     ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return SpiralEffect    (in, p); }); break;
+	case CPUEffect::HeatHaze:   ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return HeatHazeEffect  (in, p); }); break;
+	case CPUEffect::GreyNoise:  ForEachAreaPixel<F>(c, alphaBlend, output, [&](const auto& p) { return GreyNoiseEffect (in, p); }); break;
+	}
+}
+
+
+// Return a tile covering a whole image
+CPUSourceTile WholeImageTile(const ImageRGBA& image)
+{
+	CPUSourceTile tile;
+	tile.pixels      = image.Data();
+	tile.stride      = image.Width();
+	tile.rect.right  = static_cast<int>(image.Width());
+	tile.rect.bottom = static_cast<int>(image.Height());
+	tile.frameWidth  = image.Width();
+	tile.frameHeight = image.Height();
+	return tile;
+}
+
+CPUOutputTile WholeImageTile(ImageRGBA& image)
+{
+	CPUOutputTile tile;
+	tile.pixels      = image.Data();
+	tile.stride      = image.Width();
+	tile.rect.right  = static_cast<int>(image.Width());
+	tile.rect.bottom = static_cast<int>(image.Height());
+	tile.frameWidth  = image.Width();
+	tile.frameHeight = image.Height();
+	return tile;
+}
+
+
+// Run an effect on the pixels of the output tile inside the constants' area. See header for details
+void CPUPostProcessTile(CPUEffect effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                        const CPUSourceTile& source, const CPUOutputTile& output, bool alphaBlend /*= false*/,
+                        CPUKernel kernel /*= BestCPUKernel()*/)
+{
+	if (source.rect.Empty() || output.rect.Empty())  return;
+
+	// Effects that read a texture map do nothing without it, like a shader with no texture bound
+	if ((effect == CPUEffect::GreyNoise && !textures.noiseMap) || (effect == CPUEffect::Burn    && !textures.burnMap) ||
+	    (effect == CPUEffect::Distort   && !textures.distortMap))  return;
+
+	if (!CPUKernelSupported(kernel))  kernel = CPUKernel::Scalar;
+	EffectInputs in = { constants, ToSampleImage(source), ToSampleImage(textures.noiseMap), ToSampleImage(textures.burnMap),
+	                    ToSampleImage(textures.distortMap), ToSampleImage(textures.addTexture) };
+	if      (kernel == CPUKernel::AVX2)   RunEffect<Float8>(effect, in, alphaBlend, output);
+	else if (kernel == CPUKernel::SSE41)  RunEffect<Float4>(effect, in, alphaBlend, output);
+	else                                  RunEffect<Float1>(effect, in, alphaBlend, output);
+}
+
+// Run an effect over the area given in the constants. See header for details
+void CPUPostProcess(CPUEffect effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                    const ImageRGBA& source, ImageRGBA& output, bool alphaBlend /*= false*/, CPUKernel kernel /*= BestCPUKernel()*/)
+{
+	if (output.Width() == 0 || output.Height() == 0)  output = ImageRGBA(source.Width(), source.Height());
+	CPUPostProcessTile(effect, constants, textures, WholeImageTile(source), WholeImageTile(output), alphaBlend, kernel);
+}
+
+
+// Return how far from each output pixel an effect reads the source. See header for details
+bool CPUEffectMargin(CPUEffect effect, const PostProcessingConstants& constants, unsigned int width, unsigned int height,
+                     int& marginX, int& marginY)
+{
+	// Margin for reads up to the given UV distance away, plus one pixel for rounding and bilinear filtering
+	auto uvMargin = [](float uvDistance, unsigned int size) { return static_cast<int>(std::ceil(std::abs(uvDistance) * size)) + 1; };
+
+	marginX = marginY = 0;
+	switch (effect)
+	{
+	case CPUEffect::Tint:
+	case CPUEffect::GreyNoise:
+		return true; // Only the pixel being written
+
+	case CPUEffect::Retro: // Top-left of each large "pixel"
+		marginX = static_cast<int>(std::ceil(width  / RETRO_PIXEL_SIZE.x)) + 1;
+		marginY = static_cast<int>(std::ceil(height / RETRO_PIXEL_SIZE.y)) + 1;
+		return true;
+
+	case CPUEffect::Gaussian:
+	{
+		float furthest = 0;
+		for (unsigned int i = 0; i < std::min(constants.gaussianTapCount, MAX_GAUSSIAN_TAPS); ++i)
+		{
+			furthest = std::max(furthest, std::abs(constants.gaussianTaps[i][0]));
+		}
+		(constants.horizontalBlur ? marginX : marginY) = static_cast<int>(std::ceil(furthest)) + 1;
+		return true;
+	}
+
+	case CPUEffect::Bloom: // At most one and a half texels away, bilinear
+		marginX = marginY = 2;
+		return true;
+
+	case CPUEffect::Blur: // Zooms in by up to 10% towards the centre
+		marginX = uvMargin(0.05f, width);
+		marginY = uvMargin(0.05f, height);
+		return true;
+
+	case CPUEffect::Underwater:
+	case CPUEffect::HeatHaze: // Haze moves by up to 1% of the area size
+		marginX = uvMargin(0.01f * constants.area2DSize.x, width);
+		marginY = uvMargin(0.01f * constants.area2DSize.y, height);
+		return true;
+
+	case CPUEffect::Burn: // Crinkle of up to 0.15 times half a UV
+		marginX = uvMargin(0.15f * 0.5f, width);
+		marginY = uvMargin(0.15f * 0.5f, height);
+		return true;
+
+	case CPUEffect::Distort: // Distort level times up to half a UV
+		marginX = uvMargin(constants.distortLevel * 0.5f, width);
+		marginY = uvMargin(constants.distortLevel * 0.5f, height);
+		return true;
+
+	case CPUEffect::Spiral: // Rotates around the area centre, so can read anywhere
+		return false;
+	}
+	return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time each effect full screen on a random image with each supported kernel. See header for details
+std::vector<CPUPostProcessBenchmark> BenchmarkCPUPostProcesses(unsigned int width, unsigned int height, unsigned int repeats)
+{
+	// Random scene and texture maps, the same each run. Maps are smaller than the scene like the real ones
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> channel(0.0f, 1.0f);
+	auto randomImage = [&](unsigned int w, unsigned int h)
+	{
+		ImageRGBA image(w, h);
+		for (unsigned int i = 0; i < w * h; ++i)  image.Data()[i] = { channel(random), channel(random), channel(random), 1 };
+		return image;
+	};
+	ImageRGBA source = randomImage(width, height);
+	ImageRGBA noiseMap = randomImage(256, 256), burnMap = randomImage(512, 512), distortMap = randomImage(512, 512);
+	ImageRGBA addTexture = randomImage(width, height);
+	CPUPostProcessTextures textures;
+	textures.noiseMap   = &noiseMap;
+	textures.burnMap    = &burnMap;
+	textures.distortMap = &distortMap;
+	textures.addTexture = &addTexture;
+
+	// Typical settings, as Scene.cpp uses
+	PostProcessingConstants constants = {};
+	constants.area2DTopLeft  = { 0, 0 };
+	constants.area2DSize     = { 1, 1 };
+	constants.tintColour1    = { 1, 0, 0 };
+	constants.tintColour2    = { 0, 0, 1 };
+	constants.noiseScale     = { width / 256.0f, height / 256.0f };
+	constants.noiseOffset    = { 0.3f, 0.7f };
+	constants.burnHeight     = 0.4f;
+	constants.distortLevel   = 0.03f;
+	constants.spiralLevel    = 4.0f;
+	constants.heatHazeTimer  = 1.5f;
+	constants.horizontalBlur = true;
+	constants.gaussianTapCount = 4;
+	const float taps[4][2] = { { 0, 0.2f }, { 1.4f, 0.25f }, { 3.3f, 0.1f }, { 5.2f, 0.05f } };
+	std::copy(&taps[0][0], &taps[0][0] + 8, &constants.gaussianTaps[0][0]);
+	constants.bloomStage     = static_cast<unsigned int>(BloomPass::Upsample);
+	constants.bloomThreshold = 0.7f;
+	constants.bloomKnee      = 0.2f;
+	constants.bloomIntensity = 0.2f;
+
+	std::vector<CPUPostProcessBenchmark> results;
+	ImageRGBA scalarOutput, output;
+	for (unsigned int e = 0; e < NUM_CPU_EFFECTS; ++e)
+	{
+		CPUPostProcessBenchmark result;
+		result.effect = static_cast<CPUEffect>(e);
+		for (unsigned int k = 0; k < NUM_CPU_KERNELS; ++k)
+		{
+			CPUKernel kernel = static_cast<CPUKernel>(k);
+			if (!CPUKernelSupported(kernel))  continue;
+
+			ImageRGBA& kernelOutput = (kernel == CPUKernel::Scalar) ? scalarOutput : output;
+			CPUPostProcess(result.effect, constants, textures, source, kernelOutput, false, kernel); // Warm up
+			auto start = std::chrono::steady_clock::now();
+			for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+			{
+				CPUPostProcess(result.effect, constants, textures, source, kernelOutput, false, kernel);
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (seconds > 0)  result.megapixelsPerSecond[k] = width * height * static_cast<double>(repeats) / (seconds * 1000000.0);
+
+			if (kernel != CPUKernel::Scalar)  result.maxDifference = std::max(result.maxDifference, MaxColourDifference(scalarOutput, output));
+		}
+		results.push_back(result);
+	}
+	return results;
+}
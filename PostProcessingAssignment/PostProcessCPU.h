@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------
+// CPU post-processes
+//--------------------------------------------------------------------------------------
+// CPU versions of every single-pass post-process shader (*_pp.hlsl). Each uses the same maths
+// as its shader, reads the same PostProcessingConstants, and draws over the same area of the
+// output as 2DQuad_pp.hlsl would, including the soft-circle alpha of the area effects. They can
+// be used to check changes to a shader against a reference, or to time effects without a GPU.
+//
+// Each effect is written once as a template on the SIMD pack type (see Math/SIMDPack.h) and
+// compiled three ways: plain C++ on one pixel at a time, SSE4.1 on four pixels and AVX2 on eight.
+// All three give the same results, apart from tiny floating point differences in the sampling.
+//
+// Plain C++ with no DirectX, images are ImageRGBA
+
+#ifndef _POST_PROCESS_CPU_H_INCLUDED_
+#define _POST_PROCESS_CPU_H_INCLUDED_
+
+#include "PostProcessingConstants.h"
+#include "PostProcessRegions.h"
+#include "ImageRGBA.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// CPU post-processes
+//--------------------------------------------------------------------------------------
+
+// The effects, one for each post-process shader. Gaussian and Bloom are single passes, the constants say which direction
+// or stage (see PostProcessGaussian.h and PostProcessBloom.h for the whole multi-pass effects)
+enum class CPUEffect
+{
+	Tint,
+	Underwater,
+	Blur,
+	Retro,
+	Gaussian,
+	Bloom,
+	Burn,
+	Distort,
+	Spiral,
+	HeatHaze,
+	GreyNoise,
+};
+const unsigned int NUM_CPU_EFFECTS = 11;
+
+// Return the name of an effect, for display
+const char* CPUEffectName(CPUEffect effect);
+
+
+// Instruction sets the effects can use
+enum class CPUKernel
+{
+	Scalar, // Plain C++, one pixel at a time, runs anywhere
+	SSE41,  // Four pixels at a time
+	AVX2,   // Eight pixels at a time
+};
+const unsigned int NUM_CPU_KERNELS = 3;
+
+// Return the fastest kernel the CPU supports
+CPUKernel BestCPUKernel();
+
+// Return true if the CPU supports the given kernel
+bool CPUKernelSupported(CPUKernel kernel);
+
+// Return the name of a kernel, for display
+const char* CPUKernelName(CPUKernel kernel);
+
+
+// Texture maps used by some effects, only those used by the effect being run need to be set. Each as the
+// shader texture of the same name
+struct CPUPostProcessTextures
+{
+	const ImageRGBA* noiseMap   = nullptr; // GreyNoise
+	const ImageRGBA* burnMap    = nullptr; // Burn
+	const ImageRGBA* distortMap = nullptr; // Distort
+	const ImageRGBA* addTexture = nullptr; // Bloom upsample and composite stages
+};
+
+
+// Run an effect over the area given in the constants (area2DTopLeft and area2DSize, the whole image for full screen effects).
+// The source is the scene texture. The output can be a different size (e.g. for gaussian and bloom passes that change size), if
+// it is empty it is made the size of the source.
+//
+// With alphaBlend set, the effect is blended over the existing output using its alpha, as gAlphaBlendingState does for area
+// effects, otherwise the output is overwritten with the effect colour and alpha. Unsupported kernels fall back to Scalar
+void CPUPostProcess(CPUEffect effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                    const ImageRGBA& source, ImageRGBA& output, bool alphaBlend = false, CPUKernel kernel = BestCPUKernel());
+
+
+//--------------------------------------------------------------------------------------
+// Tiles
+//--------------------------------------------------------------------------------------
+// Effects can also be run on part of a frame at a time, e.g. to spread a frame over several threads
+// (see PostProcessTiles.h). The tile read must hold all the pixels the effect reads, see CPUEffectMargin
+
+// Part of a frame held in memory. Pixel is ColourRGBA for a tile being written, const ColourRGBA for one being read
+template <typename Pixel>
+struct CPUTile
+{
+	Pixel*          pixels      = nullptr; // Pixel at the top-left of rect
+	unsigned int    stride      = 0;       // Pixels from one row to the next
+	PostProcessRect rect;                  // Part of the frame held, in frame pixels
+	unsigned int    frameWidth  = 0;       // Size of the whole frame, UVs go from 0->1 across it
+	unsigned int    frameHeight = 0;
+};
+using CPUSourceTile = CPUTile<const ColourRGBA>;
+using CPUOutputTile = CPUTile<ColourRGBA>;
+
+// Return a tile covering a whole image
+CPUSourceTile WholeImageTile(const ImageRGBA& image);
+CPUOutputTile WholeImageTile(ImageRGBA& image);
+
+
+// Run an effect on the pixels of the output tile inside the constants' area. Reads outside the source tile read the nearest pixel
+// it holds, so give a source tile with a large enough margin. The source and output frames can be different sizes
+void CPUPostProcessTile(CPUEffect effect, const PostProcessingConstants& constants, const CPUPostProcessTextures& textures,
+                        const CPUSourceTile& source, const CPUOutputTile& output, bool alphaBlend = false,
+                        CPUKernel kernel = BestCPUKernel());
+
+// Return the pixels of an image of the given size that an effect with these constants writes
+PostProcessRect CPUEffectArea(const PostProcessingConstants& constants, unsigned int width, unsigned int height);
+
+// Get how far from each output pixel an effect reads the source, in pixels of a source of the given size (0 for effects that only
+// read the pixel they write). Returns false for effects that can read anywhere in the source (spiral)
+bool CPUEffectMargin(CPUEffect effect, const PostProcessingConstants& constants, unsigned int width, unsigned int height,
+                     int& marginX, int& marginY);
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Results of BenchmarkCPUPostProcesses for one effect
+struct CPUPostProcessBenchmark
+{
+	CPUEffect effect;
+
+	// Full screen throughput with each kernel in megapixels per second, 0 if the CPU doesn't support the kernel
+	double megapixelsPerSecond[NUM_CPU_KERNELS] = {};
+
+	// Largest difference in red, green or blue between the SIMD kernels and the scalar kernel
+	float maxDifference = 0;
+};
+
+// Time each effect full screen on a random image of the given size with each supported kernel. Results are the average of all repeats
+std::vector<CPUPostProcessBenchmark> BenchmarkCPUPostProcesses(unsigned int width, unsigned int height, unsigned int repeats);
+
+
+#endif //_POST_PROCESS_CPU_H_INCLUDED_
@@ -0,0 +1,316 @@
+//--------------------------------------------------------------------------------------
+// Post-processing chain
+//--------------------------------------------------------------------------------------
+// Runs a list of post-processes one after another, each effect reading the output of the
+// previous one. See header file for details
+
+#include "PostProcessChain.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+
+bool operator==(const PostProcessTarget& a, const PostProcessTarget& b)
+{
+	return a.kind == b.kind && (a.kind != PostProcessTarget::Kind::Transient || a.index == b.index);
+}
+
+bool operator!=(const PostProcessTarget& a, const PostProcessTarget& b)
+{
+	return !(a == b);
+}
+
+bool operator==(const PostProcessPassDesc& a, const PostProcessPassDesc& b)
+{
+	return a.level == b.level && a.highPrecision == b.highPrecision && a.inputs == b.inputs;
+}
+
+bool operator==(const PostProcessStep& a, const PostProcessStep& b)
+{
+	return a.effect == b.effect && a.numPasses == b.numPasses && a.access == b.access && a.passDescs == b.passDescs;
+}
+
+
+// Return the passes needed to run the given steps, fusing runs of per-pixel effects if requested
+std::vector<PostProcessChainPass> PostProcessChain::PlanPasses(const std::vector<PostProcessStep>& steps, bool fuse, unsigned int maxFusedEffects /*= 8*/)
+{
+	std::vector<PostProcessChainPass> passes;
+	bool runOpen = false; // True if the last pass in the list can have more effects fused onto it
+
+	for (auto& step : steps)
+	{
+		bool fusable = fuse && step.passDescs.empty() && step.numPasses == 1 && step.access != PostProcessAccess::Neighbourhood;
+
+		// Point-wise effects join the current run if there is room. A UV remap changes where the source is read
+		// for the whole pass, so it can't join a run that already has effects in it, it starts a new one instead
+		if (fusable && runOpen && step.access == PostProcessAccess::PointWise &&
+		    passes.back().effects.size() < maxFusedEffects)
+		{
+			passes.back().effects.push_back(step.effect);
+			continue;
+		}
+
+		for (unsigned int stepPass = 0; stepPass < step.numPasses; ++stepPass)
+		{
+			PostProcessPassDesc desc = (stepPass < step.passDescs.size()) ? step.passDescs[stepPass] : PostProcessPassDesc{};
+			passes.push_back({ { step.effect }, stepPass, desc });
+		}
+		runOpen = fusable;
+	}
+
+	return passes;
+}
+
+
+// Declare the steps as a graph and compile it. Each pass reads the texture written by the previous pass (or the textures
+// in its description) and writes a new transient texture of the pass's size and format, except the very last pass which
+// writes the back buffer
+void PostProcessChain::BuildGraph(const std::vector<PostProcessStep>& steps, const PostProcessTextureDesc& frameDesc)
+{
+	mGraph.Clear();
+	mPasses = PlanPasses(steps, mFuse, mMaxFusedEffects);
+	mSceneTexture = mGraph.ImportTexture("Scene", frameDesc);
+	mBackBuffer   = mGraph.ImportTexture("BackBuffer", frameDesc, true);
+
+	unsigned int source = mSceneTexture;
+	unsigned int stepInput = source;        // Texture the current step started from
+	std::vector<unsigned int> stepOutputs;  // Texture written by each pass of the current step so far
+	for (unsigned int pass = 0; pass < mPasses.size(); ++pass)
+	{
+		const auto& chainPass = mPasses[pass];
+		if (chainPass.pass == 0)
+		{
+			stepInput = source;
+			stepOutputs.clear();
+		}
+
+		std::string name = "Pass" + std::to_string(pass);
+		PostProcessTextureDesc desc = frameDesc;
+		desc.width  = std::max(frameDesc.width  >> chainPass.desc.level, 1u);
+		desc.height = std::max(frameDesc.height >> chainPass.desc.level, 1u);
+		if (chainPass.desc.highPrecision)  desc.format = PostProcessFormat::RGBA16F;
+		unsigned int target = (pass + 1 == mPasses.size()) ? mBackBuffer : mGraph.CreateTexture(name, desc);
+
+		std::vector<unsigned int> inputs = { source };
+		if (!chainPass.desc.inputs.empty())
+		{
+			inputs.clear();
+			for (auto input : chainPass.desc.inputs)
+			{
+				inputs.push_back((input == PostProcessPassDesc::StepInput) ? stepInput : stepOutputs[input]);
+			}
+		}
+
+		// The user data indexes mPasses
+		mGraph.AddPass(name, inputs, { target }, pass);
+		stepOutputs.push_back(target);
+		source = target;
+	}
+
+	// A straight chain always compiles, but leave the plan empty (just present) if something goes wrong
+	if (!mGraph.Compile(mPlan))  mPlan = {};
+
+	mSteps = steps;
+	mFrameDesc = frameDesc;
+	mGraphBuilt = true;
+	++mGraphCompiles;
+}
+
+
+// Return the target for the given graph texture
+PostProcessTarget PostProcessChain::GraphTarget(unsigned int texture)
+{
+	if (texture == mSceneTexture)  return { PostProcessTarget::Kind::Scene, 0 };
+	if (texture == mBackBuffer)    return { PostProcessTarget::Kind::BackBuffer, 0 };
+	return { PostProcessTarget::Kind::Transient, static_cast<unsigned int>(mPlan.texturePhysical[texture]) };
+}
+
+
+// Run the given steps from the scene texture to the back buffer then present once. If there are no steps
+// then the scene is expected to have been rendered directly to the back buffer, it is just presented
+void PostProcessChain::Execute(const std::vector<PostProcessStep>& steps, const PostProcessTextureDesc& frameDesc, PostProcessBackend& backend)
+{
+	mStats = {};
+
+	if (!mGraphBuilt || !(steps == mSteps) || frameDesc != mFrameDesc)  BuildGraph(steps, frameDesc);
+	mStats.graphCompiles     = mGraphCompiles;
+	mStats.transientTextures = static_cast<unsigned int>(mPlan.physicalTextures.size());
+	mStats.transientBytes    = mPlan.PhysicalBytes();
+	mStats.unaliasedBytes    = mPlan.unaliasedBytes;
+
+	bool texturesReady = backend.PrepareTextures(mPlan.physicalTextures);
+
+	// Track what is currently selected so redundant changes are skipped. Nothing is assumed
+	// selected at the start of the frame
+	bool targetSelected = false;
+	PostProcessTarget currentTarget;
+	std::vector<PostProcessTarget> currentSources; // Selected source in each slot
+
+	for (auto pass : mPlan.passes)
+	{
+		if (!texturesReady)  break; // No passes can run without their textures, but still present below
+
+		PostProcessTarget target = GraphTarget(mGraph.PassOutputs(pass)[0]);
+
+		// Select target before sources so the backend can unbind a texture before rendering to it. The backend may have
+		// unbound the sources to do that, so they are all selected again
+		if (!targetSelected || target != currentTarget)
+		{
+			backend.SetRenderTarget(target);
+			currentTarget = target;
+			targetSelected = true;
+			currentSources.clear();
+			++mStats.targetBinds;
+		}
+		const auto& inputs = mGraph.PassInputs(pass);
+		for (unsigned int slot = 0; slot < inputs.size(); ++slot)
+		{
+			PostProcessTarget source = GraphTarget(inputs[slot]);
+			if (slot < currentSources.size() && source == currentSources[slot])  continue;
+
+			backend.SetSourceTexture(source, slot);
+			if (slot >= currentSources.size())  currentSources.resize(slot + 1);
+			currentSources[slot] = source;
+			++mStats.sourceBinds;
+		}
+
+		const auto& chainPass = mPasses[mGraph.PassUserData(pass)];
+		if (chainPass.effects.size() == 1)
+		{
+			backend.RunPass(chainPass.effects[0], chainPass.pass);
+		}
+		else
+		{
+			backend.RunFusedPass(chainPass.effects);
+			++mStats.fusedPasses;
+			mStats.fusedEffects += static_cast<unsigned int>(chainPass.effects.size());
+		}
+		++mStats.passes;
+		for (auto input : inputs)  mStats.bandwidthBytes += mGraph.TextureDesc(input).Bytes();
+		mStats.bandwidthBytes += mGraph.TextureDesc(mGraph.PassOutputs(pass)[0]).Bytes();
+	}
+
+	// When drawing to the off-screen back buffer is complete, "present" the image to the front buffer (the screen)
+	backend.Present();
+	++mStats.presents;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Backend that runs nothing, only recording what the chain asks it to do
+class RecordingPostProcessBackend : public PostProcessBackend
+{
+public:
+	// A pass the chain ran and the textures selected for it
+	struct Pass
+	{
+		PostProcessTarget              target;
+		std::vector<PostProcessTarget> sources; // Selected source in each slot
+		std::vector<int>               effects;
+		unsigned int                   pass;
+	};
+
+	std::vector<Pass> passes;
+	unsigned int      textures     = 0;     // Number of textures requested by the last PrepareTextures
+	unsigned int      presents     = 0;
+	bool              failTextures = false; // Set to make PrepareTextures fail
+
+	bool PrepareTextures(const std::vector<PostProcessTextureDesc>& textureDescs) override
+	{
+		textures = static_cast<unsigned int>(textureDescs.size());
+		return !failTextures;
+	}
+
+	// Changing target unbinds the sources, as a DirectX backend would need to
+	void SetRenderTarget(PostProcessTarget target) override  { mTarget = target;  mSources.clear(); }
+
+	void SetSourceTexture(PostProcessTarget source, unsigned int slot) override
+	{
+		if (slot >= mSources.size())  mSources.resize(slot + 1);
+		mSources[slot] = source;
+	}
+
+	void RunPass(int effect, unsigned int pass) override         { passes.push_back({ mTarget, mSources, { effect }, pass }); }
+	void RunFusedPass(const std::vector<int>& effects) override  { passes.push_back({ mTarget, mSources, effects, 0 }); }
+	void Present() override                                      { ++presents; }
+
+private:
+	PostProcessTarget              mTarget;
+	std::vector<PostProcessTarget> mSources;
+};
+
+
+// Execute chains of 0 to maxSteps effects, some with two passes, for a few frames each on a backend that records what it is asked
+// to do, and check the passes, textures and presents it was given
+PostProcessChainCheck CheckPostProcessChain(unsigned int maxSteps)
+{
+	const PostProcessTextureDesc frameDesc = { 1280, 720, PostProcessFormat::RGBA8 };
+	const PostProcessTarget scene      = { PostProcessTarget::Kind::Scene, 0 };
+	const PostProcessTarget backBuffer = { PostProcessTarget::Kind::BackBuffer, 0 };
+
+	PostProcessChainCheck check;
+	check.onePresent = check.passCounts = check.pingPong = true;
+
+	PostProcessChain chain;
+	chain.SetFusion(false);
+	for (unsigned int numSteps = 0; numSteps <= maxSteps; ++numSteps)
+	{
+		// Every third effect has two passes (e.g. a separable blur). Expect each pass of each step in turn
+		std::vector<PostProcessStep> steps;
+		std::vector<std::pair<int, unsigned int>> expected; // Effect and pass number
+		for (unsigned int s = 0; s < numSteps; ++s)
+		{
+			PostProcessStep step = {};
+			step.effect    = static_cast<int>(s);
+			step.numPasses = (s % 3 == 1) ? 2 : 1;
+			steps.push_back(step);
+			for (unsigned int pass = 0; pass < step.numPasses; ++pass)  expected.push_back({ step.effect, pass });
+		}
+
+		// Later frames reuse the compiled graph, they must run the same way
+		for (int frame = 0; frame < 3; ++frame)
+		{
+			RecordingPostProcessBackend backend;
+			chain.Execute(steps, frameDesc, backend);
+			check.onePresent = check.onePresent && backend.presents == 1;
+			check.passCounts = check.passCounts && backend.passes.size() == expected.size();
+			check.pingPong   = check.pingPong && backend.textures == std::min<size_t>(expected.size() - (expected.empty() ? 0 : 1), 2);
+
+			for (unsigned int p = 0; p < backend.passes.size() && p < expected.size(); ++p)
+			{
+				const auto& pass = backend.passes[p];
+				check.passCounts = check.passCounts && pass.effects == std::vector<int>{ expected[p].first } && pass.pass == expected[p].second;
+
+				// Reads what the previous pass wrote and writes the other transient texture to the one two passes back
+				PostProcessTarget source = (p == 0) ? scene : backend.passes[p - 1].target;
+				bool alternates = (p + 1 == expected.size()) ? pass.target == backBuffer :
+				                  pass.target.kind == PostProcessTarget::Kind::Transient && pass.target.index < 2 && pass.target != source &&
+				                  (p < 2 || pass.target == backend.passes[p - 2].target);
+				check.pingPong = check.pingPong && pass.sources.size() == 1 && pass.sources[0] == source && alternates;
+			}
+		}
+	}
+
+	// If the textures can't be created no passes can run, but the frame is still presented
+	std::vector<PostProcessStep> steps(3);
+	for (unsigned int s = 0; s < steps.size(); ++s)  steps[s].effect = static_cast<int>(s);
+	RecordingPostProcessBackend failing;
+	failing.failTextures = true;
+	chain.Execute(steps, frameDesc, failing);
+	check.onePresent = check.onePresent && failing.presents == 1 && failing.passes.empty();
+
+	// With fusion a run of per-pixel effects is one pass from the scene to the back buffer
+	for (auto& step : steps)  step.access = PostProcessAccess::PointWise;
+	chain.SetFusion(true);
+	RecordingPostProcessBackend fusing;
+	chain.Execute(steps, frameDesc, fusing);
+	check.fused = fusing.presents == 1 && fusing.passes.size() == 1 && fusing.passes[0].effects == std::vector<int>{ 0, 1, 2 } &&
+	              fusing.passes[0].sources == std::vector<PostProcessTarget>{ scene } && fusing.passes[0].target == backBuffer;
+
+	check.passed = check.onePresent && check.passCounts && check.pingPong && check.fused;
+	return check;
+}
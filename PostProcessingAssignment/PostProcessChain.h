@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------------------
+// Post-processing chain
+//--------------------------------------------------------------------------------------
+// Runs a list of post-processes one after another, each effect reading the output of the
+// previous one. The last effect writes to the back buffer and the frame is presented exactly once.
+//
+// The chain is declared as a post-processing frame graph (see PostProcessGraph.h), which decides
+// which intermediate textures are needed. Intermediate textures that are not in use at the same
+// time share memory, so a chain of any length alternates between two textures.
+//
+// Runs of per-pixel effects (e.g. tint) can be fused into a single pass that reads each pixel once
+// and applies all the effects before writing, saving a full-screen read and write per effect.
+// Effects that read neighbouring pixels (e.g. blurs) can't be fused, and separate the runs.
+//
+// The chain itself knows nothing about DirectX. All the real work is done through the
+// PostProcessBackend interface, so the chain can be run without a GPU (e.g. to count passes)
+
+#ifndef _POST_PROCESS_CHAIN_H_INCLUDED_
+#define _POST_PROCESS_CHAIN_H_INCLUDED_
+
+#include "PostProcessGraph.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Chain data
+//--------------------------------------------------------------------------------------
+
+// Textures that the chain reads from / renders to
+struct PostProcessTarget
+{
+	enum class Kind
+	{
+		Scene,      // Texture holding the rendered scene - input to the first effect
+		Transient,  // Intermediate texture between effects, created by the backend (see PostProcessBackend::PrepareTextures)
+		BackBuffer, // Final output - no shader access
+	};
+
+	Kind         kind  = Kind::BackBuffer;
+	unsigned int index = 0; // Which transient texture, unused for the other kinds
+};
+
+bool operator==(const PostProcessTarget& a, const PostProcessTarget& b);
+bool operator!=(const PostProcessTarget& a, const PostProcessTarget& b);
+
+
+// How an effect reads its source texture, which decides if it can be fused with its neighbours in the chain
+enum class PostProcessAccess
+{
+	PointWise,     // Only reads the pixel it is writing - can be fused anywhere in a run
+	UVRemap,       // Reads a single pixel, but not the one it is writing (e.g. pixelation) - can only start a run
+	Neighbourhood, // Reads several pixels (e.g. blurs) - never fused
+};
+
+
+// Output and inputs of one pass of a multi-pass effect, for passes that are not simply full size reading the previous pass
+struct PostProcessPassDesc
+{
+	// Input number meaning the texture the effect started from, rather than the output of one of its passes
+	static const int StepInput = -1;
+
+	unsigned int     level         = 0;     // Size of the output as a power of two below the frame size (0 = full size, 1 = half...)
+	bool             highPrecision = false; // Output is RGBA16F even if the frame is not, for values outside 0->1 (e.g. light summed over several passes)
+
+	// Textures read, in order (the backend's source slots 0, 1...). Each is the number of an earlier pass of the same effect or
+	// StepInput. Empty to read only the output of the previous pass
+	std::vector<int> inputs;
+};
+
+bool operator==(const PostProcessPassDesc& a, const PostProcessPassDesc& b);
+
+
+// A single effect in the chain. Some effects need several passes (e.g. the separable gaussian
+// blur does a horizontal then a vertical pass). Each pass reads the output of the previous pass
+// unless its pass description says otherwise
+struct PostProcessStep
+{
+	int               effect;        // Effect identifier, only meaningful to the backend (e.g. a PostProcess enum value)
+	unsigned int      numPasses = 1;
+	PostProcessAccess access    = PostProcessAccess::Neighbourhood;
+
+	// Description of each pass, empty if all passes are full size and read the previous pass. The last pass of the chain always
+	// writes the back buffer so must be full size. Steps with pass descriptions are never fused
+	std::vector<PostProcessPassDesc> passDescs;
+};
+
+bool operator==(const PostProcessStep& a, const PostProcessStep& b);
+
+
+// A pass the chain will run: either a single pass of one effect, or several single-pass effects fused together
+struct PostProcessChainPass
+{
+	std::vector<int>    effects;  // Effects in the order they are applied, more than one if fused
+	unsigned int        pass = 0; // Pass number within the effect, always 0 for fused passes
+	PostProcessPassDesc desc;     // Output and inputs of the pass, see PostProcessStep::passDescs
+};
+
+
+// Counters updated by the chain, useful to check it is doing no more work than it should
+struct PostProcessChainStats
+{
+	unsigned int passes            = 0; // Number of effect passes run
+	unsigned int targetBinds       = 0; // Number of times a render target was selected
+	unsigned int sourceBinds       = 0; // Number of times a source texture was selected
+	unsigned int presents          = 0; // Number of presents (should be exactly 1 per frame)
+	unsigned int transientTextures = 0; // Number of intermediate textures needed after sharing memory
+	unsigned int transientBytes    = 0; // Memory used by those textures
+	unsigned int unaliasedBytes    = 0; // Memory the intermediate textures would use if none were shared
+	unsigned int graphCompiles     = 0; // Number of times the graph was rebuilt (only when the chain or frame size changes)
+	unsigned int fusedPasses       = 0; // Number of passes that ran more than one effect
+	unsigned int fusedEffects      = 0; // Number of effects run in those passes
+	unsigned int bandwidthBytes    = 0; // Estimated texture memory read and written by the passes (a full read of each source and write of the target)
+};
+
+
+//--------------------------------------------------------------------------------------
+// Backend interface
+//--------------------------------------------------------------------------------------
+// Implement this to run the chain on a particular API. The chain guarantees that the render target
+// is selected before the source textures for each pass, and selects all sources again after a change
+// of target, so a backend can unbind textures from the shaders before rendering to it
+
+class PostProcessBackend
+{
+public:
+	virtual ~PostProcessBackend() {}
+
+	// Make sure the given intermediate textures exist, transient target index N refers to textures[N]. Called at
+	// the start of each frame, the list rarely changes so textures should be kept from one call to the next.
+	// Return false if the textures could not be created, the chain will then skip all passes and just present
+	virtual bool PrepareTextures(const std::vector<PostProcessTextureDesc>& textures) = 0;
+
+	// Select the texture that the following passes will render to
+	virtual void SetRenderTarget(PostProcessTarget target) = 0;
+
+	// Select a texture that the following passes will read from. Slot 0 is the main source, passes with several inputs
+	// (see PostProcessPassDesc::inputs) also use slots 1 and up
+	virtual void SetSourceTexture(PostProcessTarget source, unsigned int slot) = 0;
+
+	// Run a single pass of the given effect (pass is 0 to numPasses-1 for the effect)
+	virtual void RunPass(int effect, unsigned int pass) = 0;
+
+	// Run several single-pass effects, in order, as a single pass. Only called with fusion enabled, see SetFusion
+	virtual void RunFusedPass(const std::vector<int>& effects) = 0;
+
+	// Show the back buffer
+	virtual void Present() = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Chain executor
+//--------------------------------------------------------------------------------------
+
+class PostProcessChain
+{
+public:
+	// Run the given steps from the scene texture to the back buffer then present once. The frame description gives
+	// the size and format of the scene texture / back buffer. If there are no steps then the scene is expected to
+	// have been rendered directly to the back buffer, it is just presented
+	void Execute(const std::vector<PostProcessStep>& steps, const PostProcessTextureDesc& frameDesc, PostProcessBackend& backend);
+
+	// Statistics from the most recent call to Execute
+	const PostProcessChainStats& Stats()  { return mStats; }
+
+	// Enable/disable fusing runs of per-pixel effects into single passes (enabled by default). Fused runs are
+	// limited to maxFusedEffects effects (e.g. by the size of a constant buffer)
+	void SetFusion(bool fuse, unsigned int maxFusedEffects = 8)  { mFuse = fuse; mMaxFusedEffects = maxFusedEffects; mGraphBuilt = false; }
+	bool Fusion()  { return mFuse; }
+
+	// Return the passes needed to run the given steps. If fuse is true, runs of single-pass PointWise effects (optionally
+	// started by a UVRemap effect) of up to maxFusedEffects are combined into one pass
+	static std::vector<PostProcessChainPass> PlanPasses(const std::vector<PostProcessStep>& steps, bool fuse, unsigned int maxFusedEffects = 8);
+
+	// The graph for the most recent call to Execute and the plan compiled from it
+	const PostProcessGraph&     Graph()  { return mGraph; }
+	const PostProcessGraphPlan& Plan()   { return mPlan;  }
+
+private:
+	// Declare the steps as a graph and compile it
+	void BuildGraph(const std::vector<PostProcessStep>& steps, const PostProcessTextureDesc& frameDesc);
+
+	// Return the target for the given graph texture
+	PostProcessTarget GraphTarget(unsigned int texture);
+
+	// Steps and frame size the graph was built for, the graph is only rebuilt when these change
+	std::vector<PostProcessStep> mSteps;
+	PostProcessTextureDesc       mFrameDesc;
+	bool                         mGraphBuilt = false;
+
+	PostProcessGraph     mGraph;
+	PostProcessGraphPlan mPlan;
+	unsigned int         mSceneTexture = 0;
+	unsigned int         mBackBuffer   = 0;
+
+	// Effects and pass number for each graph pass
+	std::vector<PostProcessChainPass> mPasses;
+
+	// Fusion settings, changing them rebuilds the graph
+	bool         mFuse            = true;
+	unsigned int mMaxFusedEffects = 8;
+
+	PostProcessChainStats mStats;
+	unsigned int          mGraphCompiles = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckPostProcessChain
+struct PostProcessChainCheck
+{
+	bool onePresent = false; // True if every frame presented exactly once, including frames with no steps or whose textures could not be created
+	bool passCounts = false; // True if every step ran each of its passes once and in order, so N single-pass steps ran N passes
+	bool pingPong   = false; // True if each pass read the previous pass's output and the passes alternated between two transient
+	                         // textures, with the first reading the scene and the last writing the back buffer
+	bool fused      = false; // True if a run of per-pixel effects ran as a single fused pass when fusion was enabled
+	bool passed     = false; // True if all of the above
+};
+
+// Execute chains of 0 to maxSteps effects, some with two passes, for a few frames each on a backend that records what it is asked
+// to do, and check the passes, textures and presents it was given
+PostProcessChainCheck CheckPostProcessChain(unsigned int maxSteps);
+
+
+#endif //_POST_PROCESS_CHAIN_H_INCLUDED_
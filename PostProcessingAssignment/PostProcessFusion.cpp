@@ -0,0 +1,197 @@
+//--------------------------------------------------------------------------------------
+// Fused per-pixel post-processes
+//--------------------------------------------------------------------------------------
+// CPU versions of the effects in Fused_pp.hlsl. See header file for details
+
+#include "PostProcessFusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+
+// How each fused effect reads the source texture
+PostProcessAccess FusedEffectAccess(FusedEffect effect)
+{
+	if (effect == FusedEffect::Retro)  return PostProcessAccess::UVRemap; // Pixelation reads the top-left of each large "pixel"
+	if (effect == FusedEffect::None)   return PostProcessAccess::Neighbourhood;
+	return PostProcessAccess::PointWise;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CPU versions
+//--------------------------------------------------------------------------------------
+
+// Run one pass applying the given effects in order, reading source and writing output
+void CPUFusedPass(const std::vector<FusedEffect>& effects, const PostProcessingConstants& constants,
+                  const ImageRGBA& noiseMap, const ImageRGBA& source, ImageRGBA& output)
+{
+	const unsigned int width  = source.Width();
+	const unsigned int height = source.Height();
+	if (output.Width() != width || output.Height() != height)  output = ImageRGBA(width, height);
+
+	bool retroFirst = !effects.empty() && effects[0] == FusedEffect::Retro;
+
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			// UV at the centre of the pixel, as the GPU gives for a full-screen quad
+			CVector2 uv = { (x + 0.5f) / width, (y + 0.5f) / height };
+
+			// Retro is only ever the first effect, it picks which source pixel is read for the whole pass
+			CVector2 sourceUV = uv;
+			if (retroFirst)
+			{
+				sourceUV.x = std::floor(uv.x * RETRO_PIXEL_SIZE.x) / RETRO_PIXEL_SIZE.x;
+				sourceUV.y = std::floor(uv.y * RETRO_PIXEL_SIZE.y) / RETRO_PIXEL_SIZE.y;
+			}
+			ColourRGBA sourceColour = source.SamplePoint(sourceUV);
+			CVector3 colour = { sourceColour.r, sourceColour.g, sourceColour.b };
+
+			for (auto effect : effects)
+			{
+				CVector3 result = colour;
+				float alpha = 1.0f;
+
+				if (effect == FusedEffect::Tint)
+				{
+					CVector3 tint = constants.tintColour1 + (constants.tintColour2 - constants.tintColour1) * uv.y;
+					result = { colour.x * tint.x, colour.y * tint.y, colour.z * tint.z };
+				}
+				else if (effect == FusedEffect::Retro)
+				{
+					result.x = std::floor(colour.x * RETRO_COLOUR_DEPTH.x) / RETRO_COLOUR_DEPTH.x;
+					result.y = std::floor(colour.y * RETRO_COLOUR_DEPTH.y) / RETRO_COLOUR_DEPTH.y;
+					result.z = std::floor(colour.z * RETRO_COLOUR_DEPTH.z) / RETRO_COLOUR_DEPTH.z;
+				}
+				else if (effect == FusedEffect::GreyNoise)
+				{
+					float grey = (colour.x + colour.y + colour.z) / 3.0f;
+					CVector2 noiseUV = { uv.x * constants.noiseScale.x + constants.noiseOffset.x,
+					                     uv.y * constants.noiseScale.y + constants.noiseOffset.y };
+					grey += NOISE_STRENGTH * (noiseMap.SampleBilinearWrap(noiseUV).r - 0.5f);
+					result = { grey, grey, grey };
+
+					// Soft circle - the area covers the whole image on the CPU
+					CVector2 centreVector = { uv.x - 0.5f, uv.y - 0.5f };
+					float centreLengthSq = centreVector.x * centreVector.x + centreVector.y * centreVector.y;
+					alpha = 1.0f - std::min(std::max((centreLengthSq - 0.25f + NOISE_SOFT_EDGE) / NOISE_SOFT_EDGE, 0.0f), 1.0f);
+				}
+
+				colour = constants.fusedAreaBlend ? colour + (result - colour) * alpha : result;
+			}
+
+			output.Pixel(x, y) = { colour.x, colour.y, colour.z, 1.0f };
+		}
+	}
+}
+
+
+// Run the given effects from source to output, either one pass per effect or with runs fused together
+void CPUPostProcessChain(const std::vector<FusedEffect>& effects, bool fuse, const PostProcessingConstants& constants,
+                         const ImageRGBA& noiseMap, const ImageRGBA& source, ImageRGBA& output,
+                         CPUPostProcessStats* stats /*= nullptr*/, unsigned int bytesPerPixel /*= 4*/)
+{
+	// Group the effects into passes with the same rules as the GPU chain, the effect identifier is the FusedEffect value
+	std::vector<PostProcessStep> steps;
+	for (auto effect : effects)
+	{
+		PostProcessStep step = {};
+		step.effect = static_cast<int>(effect);
+		step.access = FusedEffectAccess(effect);
+		steps.push_back(step);
+	}
+	auto passes = PostProcessChain::PlanPasses(steps, fuse, MAX_FUSED_EFFECTS);
+
+	// Alternate between two images, like the two textures the GPU chain uses
+	ImageRGBA intermediate[2];
+	const ImageRGBA* passSource = &source;
+	for (unsigned int pass = 0; pass < passes.size(); ++pass)
+	{
+		ImageRGBA& passOutput = (pass + 1 == passes.size()) ? output : intermediate[pass % 2];
+
+		std::vector<FusedEffect> passEffects;
+		for (auto effect : passes[pass].effects)  passEffects.push_back(static_cast<FusedEffect>(effect));
+		CPUFusedPass(passEffects, constants, noiseMap, *passSource, passOutput);
+
+		if (stats != nullptr)
+		{
+			unsigned long long imageBytes = static_cast<unsigned long long>(source.Width()) * source.Height() * bytesPerPixel;
+			++stats->passes;
+			stats->bytesRead    += imageBytes;
+			stats->bytesWritten += imageBytes;
+		}
+		passSource = &passOutput;
+	}
+
+	// Nothing to do is a plain copy
+	if (passes.empty())  output = source;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Run lists of fused effects fused and one pass per effect, and compare the output and memory traffic. See header for details
+PostProcessFusionCheck CheckPostProcessFusion(unsigned int width, unsigned int height)
+{
+	// Random scene and noise map, the same each run
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> channel(0.0f, 1.0f);
+	auto randomImage = [&](unsigned int w, unsigned int h)
+	{
+		ImageRGBA image(w, h);
+		for (unsigned int i = 0; i < w * h; ++i)  image.Data()[i] = { channel(random), channel(random), channel(random), 1 };
+		return image;
+	};
+	ImageRGBA source = randomImage(width, height);
+	ImageRGBA noiseMap = randomImage(256, 256);
+
+	PostProcessingConstants constants = {};
+	constants.tintColour1 = { 1, 0, 0 };
+	constants.tintColour2 = { 0, 0, 1 };
+	constants.noiseScale  = { width / 256.0f, height / 256.0f };
+	constants.noiseOffset = { 0.3f, 0.7f };
+
+	const FusedEffect Tint = FusedEffect::Tint, Retro = FusedEffect::Retro, GreyNoise = FusedEffect::GreyNoise;
+	const std::vector<std::vector<FusedEffect>> effectLists =
+	{
+		{ Tint },
+		{ Tint, GreyNoise },
+		{ Retro, Tint, GreyNoise },
+		{ Tint, Retro, GreyNoise }, // Retro starts a new run
+		{ GreyNoise, Tint, Tint, Retro, Tint },
+		std::vector<FusedEffect>(MAX_FUSED_EFFECTS + 2, Tint), // More than fit in one fused pass
+	};
+
+	PostProcessFusionCheck check;
+	check.saving = true;
+	ImageRGBA fusedOutput, unfusedOutput;
+	for (unsigned int areaBlend = 0; areaBlend < 2; ++areaBlend)
+	{
+		constants.fusedAreaBlend = areaBlend;
+		for (auto& effects : effectLists)
+		{
+			CPUPostProcessStats fused, unfused;
+			CPUPostProcessChain(effects, true,  constants, noiseMap, source, fusedOutput,   &fused);
+			CPUPostProcessChain(effects, false, constants, noiseMap, source, unfusedOutput, &unfused);
+
+			check.maxDifference = std::max(check.maxDifference, MaxColourDifference(fusedOutput, unfusedOutput));
+			check.saving = check.saving && unfused.passes == effects.size() && fused.passes <= unfused.passes &&
+			               fused.bytesRead + fused.bytesWritten <= unfused.bytesRead + unfused.bytesWritten;
+			check.fusedPasses   += fused.passes;
+			check.unfusedPasses += unfused.passes;
+			check.fusedBytes    += fused.bytesRead + fused.bytesWritten;
+			check.unfusedBytes  += unfused.bytesRead + unfused.bytesWritten;
+		}
+	}
+
+	// Both do exactly the same sums in the same order, only the fused version keeps the colour in a local between effects
+	check.match  = check.maxDifference == 0;
+	check.saving = check.saving && check.fusedPasses < check.unfusedPasses && check.fusedBytes < check.unfusedBytes;
+	check.passed = check.match && check.saving;
+	return check;
+}
@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// Fused per-pixel post-processes
+//--------------------------------------------------------------------------------------
+// Tint, the colour reduction in retro and grey noise only depend on the pixel being processed,
+// so several of them in a row can run as one pass (see Fused_pp.hlsl and PostProcessChain.h).
+//
+// This file has CPU versions of those effects, both fused and one pass per effect, so the
+// output and memory traffic of the two approaches can be compared without a GPU
+
+#ifndef _POST_PROCESS_FUSION_H_INCLUDED_
+#define _POST_PROCESS_FUSION_H_INCLUDED_
+
+#include "PostProcessingConstants.h"
+#include "PostProcessChain.h"
+#include "ImageRGBA.h"
+
+#include <vector>
+
+
+// How each fused effect reads the source texture, used to decide which effects can share a pass
+PostProcessAccess FusedEffectAccess(FusedEffect effect);
+
+
+//--------------------------------------------------------------------------------------
+// CPU versions
+//--------------------------------------------------------------------------------------
+
+// Counters updated when running post-processes on the CPU
+struct CPUPostProcessStats
+{
+	unsigned int       passes       = 0; // Number of passes over the image
+	unsigned long long bytesRead    = 0; // Source image memory read (noise map reads are not counted)
+	unsigned long long bytesWritten = 0; // Output image memory written
+};
+
+
+// Run one pass applying the given effects in order, reading source and writing output (which is resized to match).
+// Retro may only be the first effect. The noise map is only needed for grey noise. Full-screen effects ignore alpha,
+// set constants.fusedAreaBlend to fade each effect by its alpha as done for area effects
+void CPUFusedPass(const std::vector<FusedEffect>& effects, const PostProcessingConstants& constants,
+                  const ImageRGBA& noiseMap, const ImageRGBA& source, ImageRGBA& output);
+
+// Run the given effects from source to output, either one pass per effect or with runs fused together using the
+// same rules as the GPU chain (see PostProcessChain::PlanPasses). Memory traffic is counted in the stats using the
+// given number of bytes per pixel (4 for the RGBA8 textures used on the GPU)
+void CPUPostProcessChain(const std::vector<FusedEffect>& effects, bool fuse, const PostProcessingConstants& constants,
+                         const ImageRGBA& noiseMap, const ImageRGBA& source, ImageRGBA& output,
+                         CPUPostProcessStats* stats = nullptr, unsigned int bytesPerPixel = 4);
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckPostProcessFusion, totals are over all the effect lists tried
+struct PostProcessFusionCheck
+{
+	float              maxDifference = 0; // Largest difference of any channel between the fused and unfused output
+	unsigned int       fusedPasses   = 0;
+	unsigned int       unfusedPasses = 0;
+	unsigned long long fusedBytes    = 0; // Memory read and written by the passes
+	unsigned long long unfusedBytes  = 0;
+
+	bool match  = false; // True if fused and unfused output were the same for every effect list, full-screen and area blended
+	bool saving = false; // True if fusing never needed more passes than effects, or more passes or memory than not fusing, and needed fewer overall
+	bool passed = false; // True if both of the above
+};
+
+// Run lists of fused effects on a random image with CPUPostProcessChain, fused and one pass per effect, and compare the output
+// and memory traffic. The lists include Retro in the middle of a run and runs longer than MAX_FUSED_EFFECTS
+PostProcessFusionCheck CheckPostProcessFusion(unsigned int width, unsigned int height);
+
+
+#endif //_POST_PROCESS_FUSION_H_INCLUDED_
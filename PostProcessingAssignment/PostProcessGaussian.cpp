@@ -0,0 +1,245 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur kernels
+//--------------------------------------------------------------------------------------
+// Kernel generation, blur planning and CPU blurs. See header file for details
+
+#include "PostProcessGaussian.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+// Kernels
+//--------------------------------------------------------------------------------------
+
+// Return the number of texels either side of the centre needed for a gaussian with the given sigma (3 sigma, rounded up)
+unsigned int GaussianRadius(float sigma)
+{
+	if (sigma <= 0)  return 0;
+	return static_cast<unsigned int>(std::ceil(3 * sigma));
+}
+
+
+// Return the weights of a gaussian with the given sigma at whole texel offsets 0 to GaussianRadius(sigma), one side only
+std::vector<float> GaussianWeights(float sigma)
+{
+	unsigned int radius = GaussianRadius(sigma);
+	std::vector<float> weights(radius + 1);
+	if (radius == 0)
+	{
+		weights[0] = 1; // No blur, just the centre texel
+		return weights;
+	}
+
+	// The constant part of the gaussian formula is left out as the weights are scaled to add up to 1 anyway
+	float total = 0;
+	for (unsigned int i = 0; i <= radius; ++i)
+	{
+		weights[i] = std::exp(-static_cast<float>(i * i) / (2 * sigma * sigma));
+		total += (i == 0) ? weights[i] : 2 * weights[i];
+	}
+	for (auto& weight : weights)  weight /= total;
+	return weights;
+}
+
+
+// Return the taps for a gaussian with the given sigma using bilinear filtering
+std::vector<GaussianTap> GaussianLinearTaps(float sigma)
+{
+	std::vector<float> weights = GaussianWeights(sigma);
+
+	// The centre texel is sampled on its own as it is shared by both sides
+	std::vector<GaussianTap> taps;
+	taps.push_back({ 0, weights[0] });
+
+	// Texels i and i+1 sampled at offset i + t get weights (1-t) and t times the tap weight. So a tap weighted w[i] + w[i+1]
+	// at t = w[i+1] / (w[i] + w[i+1]) gives each texel exactly its own weight. An odd texel left at the end gets its own tap
+	for (unsigned int i = 1; i < weights.size(); i += 2)
+	{
+		float weight0 = weights[i];
+		float weight1 = (i + 1 < weights.size()) ? weights[i + 1] : 0.0f;
+		float weight = weight0 + weight1;
+		taps.push_back({ i + weight1 / weight, weight });
+	}
+	return taps;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Blur plans
+//--------------------------------------------------------------------------------------
+
+// Plan a gaussian blur with the given sigma
+GaussianBlurPlan PlanGaussianBlur(float sigma, unsigned int maxTaps /*= MAX_GAUSSIAN_TAPS*/, unsigned int maxLevel /*= 4*/)
+{
+	// Number of taps needed for a pass with a given sigma: the centre and one for each pair of texels on one side
+	auto tapCount = [](float levelSigma) { return 1 + (GaussianRadius(levelSigma) + 1) / 2; };
+
+	// Largest sigma with no more than maxTaps taps. The radius is 2 * (maxTaps - 1) so sigma is a third of that
+	const float maxSigma = 2.0f * (maxTaps - 1) / 3;
+
+	GaussianBlurPlan plan;
+	plan.sigma = std::max(sigma, 0.0f);
+
+	// Each level halves the size so halves sigma, use the first level where the taps fit
+	plan.level = 0;
+	plan.levelSigma = plan.sigma;
+	while (tapCount(plan.levelSigma) > maxTaps && plan.level < maxLevel)
+	{
+		++plan.level;
+		plan.levelSigma = plan.sigma / (1 << plan.level);
+	}
+
+	// Too big for the smallest level, limit sigma to fit
+	if (tapCount(plan.levelSigma) > maxTaps)
+	{
+		plan.levelSigma = maxSigma;
+		plan.sigma = maxSigma * (1 << plan.level);
+	}
+	plan.taps = GaussianLinearTaps(plan.levelSigma);
+
+	// Reduce size one level at a time, each pass averaging 2x2 texels of the last, so no texels are skipped
+	for (unsigned int level = 1; level <= plan.level; ++level)
+	{
+		plan.passes.push_back(GaussianPass::Downsample);
+		plan.passLevels.push_back(level);
+	}
+	plan.passes.push_back(GaussianPass::Horizontal);
+	plan.passLevels.push_back(plan.level);
+	plan.passes.push_back(GaussianPass::Vertical);
+	plan.passLevels.push_back(plan.level);
+
+	// Enlarging in one step is fine as the image is already blurred over a much wider area than the texels it is made of
+	if (plan.level > 0)
+	{
+		plan.passes.push_back(GaussianPass::Upsample);
+		plan.passLevels.push_back(0);
+	}
+	return plan;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CPU versions
+//--------------------------------------------------------------------------------------
+
+// Add colour times weight to total
+static void AddWeighted(ColourRGBA& total, const ColourRGBA& colour, float weight)
+{
+	total.r += colour.r * weight;
+	total.g += colour.g * weight;
+	total.b += colour.b * weight;
+	total.a += colour.a * weight;
+}
+
+
+// Blur with every weight from GaussianWeights at every texel, clamped at the edges
+void CPUGaussianBlurReference(const ImageRGBA& source, ImageRGBA& output, float sigma)
+{
+	std::vector<float> weights = GaussianWeights(sigma);
+	int radius = static_cast<int>(weights.size()) - 1;
+	int width  = static_cast<int>(source.Width());
+	int height = static_cast<int>(source.Height());
+
+	// Horizontal then vertical, as separable
+	ImageRGBA horizontal(width, height);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			ColourRGBA total = { 0, 0, 0, 0 };
+			for (int i = -radius; i <= radius; ++i)
+			{
+				int sampleX = std::min(std::max(x + i, 0), width - 1);
+				AddWeighted(total, source.Pixel(sampleX, y), weights[std::abs(i)]);
+			}
+			horizontal.Pixel(x, y) = total;
+		}
+	}
+
+	output = ImageRGBA(width, height);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			ColourRGBA total = { 0, 0, 0, 0 };
+			for (int i = -radius; i <= radius; ++i)
+			{
+				int sampleY = std::min(std::max(y + i, 0), height - 1);
+				AddWeighted(total, horizontal.Pixel(x, sampleY), weights[std::abs(i)]);
+			}
+			output.Pixel(x, y) = total;
+		}
+	}
+}
+
+
+// Resize an image to the given size with bilinear sampling at each output pixel centre, as the Resample passes in Scene.cpp do.
+// Halving the size samples exactly between 2x2 texels so averages them
+static void Resample(const ImageRGBA& source, ImageRGBA& output, unsigned int width, unsigned int height)
+{
+	output = ImageRGBA(width, height);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			CVector2 uv = { (x + 0.5f) / width, (y + 0.5f) / height };
+			output.Pixel(x, y) = source.SampleBilinearClamp(uv);
+		}
+	}
+}
+
+
+// One direction of a blur using the given taps, sampled as GaussianBlur_pp.hlsl does
+static void BlurPass(const std::vector<GaussianTap>& taps, bool horizontal, const ImageRGBA& source, ImageRGBA& output)
+{
+	unsigned int width  = source.Width();
+	unsigned int height = source.Height();
+	CVector2 texelStep = horizontal ? CVector2{ 1.0f / width, 0 } : CVector2{ 0, 1.0f / height };
+
+	output = ImageRGBA(width, height);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			CVector2 uv = { (x + 0.5f) / width, (y + 0.5f) / height };
+			ColourRGBA total = { 0, 0, 0, 0 };
+			AddWeighted(total, source.SampleBilinearClamp(uv), taps[0].weight);
+			for (unsigned int i = 1; i < taps.size(); ++i)
+			{
+				CVector2 offset = texelStep * taps[i].offset;
+				AddWeighted(total, source.SampleBilinearClamp(uv + offset), taps[i].weight);
+				AddWeighted(total, source.SampleBilinearClamp(uv - offset), taps[i].weight);
+			}
+			output.Pixel(x, y) = total;
+		}
+	}
+}
+
+
+// Blur by running the passes of the plan with the same sampling as the GPU
+void CPUGaussianBlur(const GaussianBlurPlan& plan, const ImageRGBA& source, ImageRGBA& output)
+{
+	ImageRGBA current = source;
+	ImageRGBA next;
+	for (unsigned int pass = 0; pass < plan.passes.size(); ++pass)
+	{
+		unsigned int level = plan.passLevels[pass];
+		switch (plan.passes[pass])
+		{
+		case GaussianPass::Downsample:
+		case GaussianPass::Upsample:
+			Resample(current, next, std::max(source.Width() >> level, 1u), std::max(source.Height() >> level, 1u));
+			break;
+		case GaussianPass::Horizontal:
+			BlurPass(plan.taps, true, current, next);
+			break;
+		case GaussianPass::Vertical:
+			BlurPass(plan.taps, false, current, next);
+			break;
+		}
+		std::swap(current, next);
+	}
+	output = std::move(current);
+}
@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// Gaussian blur kernels
+//--------------------------------------------------------------------------------------
+// The gaussian blur is separable: a horizontal pass then a vertical pass give the same result as
+// a full 2D blur. The amount of blur is set by sigma (the standard deviation of the gaussian, in
+// pixels), the kernel reaches 3 sigma either side of the centre.
+//
+// Bilinear filtering is used to halve the number of samples ("taps"): a sample between two texels
+// returns a weighted mix of both, so two neighbouring weights can be merged into one tap placed
+// between the texels at the point that gives each texel its own weight.
+//
+// Even so, the number of taps grows with sigma. Once a pass would need more than the shader allows,
+// the image is first reduced to half or quarter size (etc.), blurred there with a smaller sigma,
+// then enlarged back to full size. The cost then stays roughly the same however large the blur.
+//
+// This file is plain C++ with no DirectX. It builds the kernels for the shader and has CPU versions
+// of the blur, including a brute force version to check the others against
+
+#ifndef _POST_PROCESS_GAUSSIAN_H_INCLUDED_
+#define _POST_PROCESS_GAUSSIAN_H_INCLUDED_
+
+#include "PostProcessingConstants.h"
+#include "ImageRGBA.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Kernels
+//--------------------------------------------------------------------------------------
+
+// A single sample of a blur pass. The same tap is used either side of the centre
+struct GaussianTap
+{
+	float offset; // Distance from the centre in texels
+	float weight;
+};
+
+
+// Return the number of texels either side of the centre needed for a gaussian with the given sigma (3 sigma, rounded up)
+unsigned int GaussianRadius(float sigma);
+
+// Return the weights of a gaussian with the given sigma at whole texel offsets 0 to GaussianRadius(sigma), one side only.
+// They are scaled so the full kernel (both sides, centre counted once) adds up to 1
+std::vector<float> GaussianWeights(float sigma);
+
+// Return the taps for a gaussian with the given sigma using bilinear filtering. The first tap is the centre (offset 0),
+// the rest each merge the weights of two neighbouring texels
+std::vector<GaussianTap> GaussianLinearTaps(float sigma);
+
+
+//--------------------------------------------------------------------------------------
+// Blur plans
+//--------------------------------------------------------------------------------------
+
+// The kinds of pass in a gaussian blur
+enum class GaussianPass
+{
+	Downsample, // Halve the size of the image (bilinear filtering averages 2x2 texels)
+	Horizontal,
+	Vertical,
+	Upsample,   // Enlarge the image back to full size (bilinear filtering)
+};
+
+
+// The passes needed for a gaussian blur of a given sigma
+struct GaussianBlurPlan
+{
+	float                     sigma      = 0; // Sigma requested, in full size pixels
+	unsigned int              level      = 0; // Size the blur is done at, as a power of two below full size (0 = full, 1 = half...)
+	float                     levelSigma = 0; // Sigma at that size
+	std::vector<GaussianTap>  taps;           // Taps for the horizontal and vertical passes at that size
+
+	std::vector<GaussianPass> passes;         // Passes in order
+	std::vector<unsigned int> passLevels;     // Size of the output of each pass, as level above
+};
+
+// Plan a gaussian blur with the given sigma. The blur is done at full size if it needs no more than maxTaps taps per pass,
+// otherwise at the first smaller size (up to maxLevel) where it does. Sigma is limited to what maxTaps allows at maxLevel
+GaussianBlurPlan PlanGaussianBlur(float sigma, unsigned int maxTaps = MAX_GAUSSIAN_TAPS, unsigned int maxLevel = 4);
+
+
+//--------------------------------------------------------------------------------------
+// CPU versions
+//--------------------------------------------------------------------------------------
+
+// Blur with every weight from GaussianWeights at every texel, clamped at the edges. Slow, but has no approximations
+void CPUGaussianBlurReference(const ImageRGBA& source, ImageRGBA& output, float sigma);
+
+// Blur by running the passes of the plan with the same sampling as the GPU. Matches the reference closely for plans
+// at full size (only rounding differs), more loosely for smaller sizes
+void CPUGaussianBlur(const GaussianBlurPlan& plan, const ImageRGBA& source, ImageRGBA& output);
+
+
+#endif //_POST_PROCESS_GAUSSIAN_H_INCLUDED_
@@ -0,0 +1,317 @@
+//--------------------------------------------------------------------------------------
+// Post-processing frame graph
+//--------------------------------------------------------------------------------------
+// Declare post-processing passes and textures, then compile them into a plan that culls
+// unused passes and shares memory between temporary textures. See header file for details
+
+#include "PostProcessGraph.h"
+
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Texture description
+//--------------------------------------------------------------------------------------
+
+unsigned int PostProcessFormatSize(PostProcessFormat format)
+{
+	return (format == PostProcessFormat::RGBA16F) ? 8 : 4;
+}
+
+bool operator==(const PostProcessTextureDesc& a, const PostProcessTextureDesc& b)
+{
+	return a.width == b.width && a.height == b.height && a.format == b.format;
+}
+
+bool operator!=(const PostProcessTextureDesc& a, const PostProcessTextureDesc& b)
+{
+	return !(a == b);
+}
+
+
+unsigned int PostProcessGraphPlan::PhysicalBytes() const
+{
+	unsigned int bytes = 0;
+	for (auto& desc : physicalTextures)  bytes += desc.Bytes();
+	return bytes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Graph declaration
+//--------------------------------------------------------------------------------------
+
+// Remove all textures and passes
+void PostProcessGraph::Clear()
+{
+	mTextures.clear();
+	mPasses.clear();
+}
+
+
+// Declare a texture that exists outside the graph, e.g. the scene texture or back buffer
+unsigned int PostProcessGraph::ImportTexture(const std::string& name, const PostProcessTextureDesc& desc, bool isOutput /*= false*/)
+{
+	mTextures.push_back({ name, desc, true, isOutput });
+	return static_cast<unsigned int>(mTextures.size() - 1);
+}
+
+// Declare a temporary texture that only lives for part of the frame
+unsigned int PostProcessGraph::CreateTexture(const std::string& name, const PostProcessTextureDesc& desc)
+{
+	mTextures.push_back({ name, desc, false, false });
+	return static_cast<unsigned int>(mTextures.size() - 1);
+}
+
+
+// Declare a pass that reads the given input textures and writes the given output textures
+unsigned int PostProcessGraph::AddPass(const std::string& name, const std::vector<unsigned int>& inputs,
+                                       const std::vector<unsigned int>& outputs, int userData /*= 0*/)
+{
+	mPasses.push_back({ name, inputs, outputs, userData });
+	return static_cast<unsigned int>(mPasses.size() - 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Graph compilation
+//--------------------------------------------------------------------------------------
+
+// Cull, order and alias the graph into the given plan. Returns false on failure, plan.error will describe the problem
+bool PostProcessGraph::Compile(PostProcessGraphPlan& plan) const
+{
+	plan = {};
+	const unsigned int numTextures = NumTextures();
+	const unsigned int numPasses   = NumPasses();
+
+	////--------------- Find the pass that writes each texture ---------------////
+
+	const int NO_WRITER = -1;
+	std::vector<int> writer(numTextures, NO_WRITER);
+	for (unsigned int pass = 0; pass < numPasses; ++pass)
+	{
+		for (auto texture : mPasses[pass].inputs)
+		{
+			if (texture >= numTextures)
+			{
+				plan.error = "Post-process pass " + mPasses[pass].name + " reads an undeclared texture";
+				return false;
+			}
+		}
+		for (auto texture : mPasses[pass].outputs)
+		{
+			if (texture >= numTextures)
+			{
+				plan.error = "Post-process pass " + mPasses[pass].name + " writes an undeclared texture";
+				return false;
+			}
+			if (std::find(mPasses[pass].inputs.begin(), mPasses[pass].inputs.end(), texture) != mPasses[pass].inputs.end())
+			{
+				plan.error = "Post-process pass " + mPasses[pass].name + " reads and writes the same texture";
+				return false;
+			}
+			if (writer[texture] != NO_WRITER)
+			{
+				plan.error = "Post-process texture " + mTextures[texture].name + " is written by more than one pass";
+				return false;
+			}
+			writer[texture] = pass;
+		}
+	}
+
+
+	////--------------- Cull passes that don't contribute to an output ---------------////
+
+	// Start with the passes that write outputs, then work backwards through the textures each needed pass reads
+	std::vector<bool> needed(numPasses, false);
+	std::vector<unsigned int> toVisit;
+	for (unsigned int texture = 0; texture < numTextures; ++texture)
+	{
+		if (mTextures[texture].isOutput && writer[texture] != NO_WRITER)  toVisit.push_back(writer[texture]);
+	}
+	while (!toVisit.empty())
+	{
+		unsigned int pass = toVisit.back();
+		toVisit.pop_back();
+		if (needed[pass])  continue;
+		needed[pass] = true;
+
+		for (auto texture : mPasses[pass].inputs)
+		{
+			if (writer[texture] != NO_WRITER)  toVisit.push_back(writer[texture]);
+			else if (!mTextures[texture].imported)
+			{
+				plan.error = "Post-process pass " + mPasses[pass].name + " reads " + mTextures[texture].name + ", which is never written";
+				return false;
+			}
+		}
+	}
+
+
+	////--------------- Order the needed passes ---------------////
+
+	// A pass can run once all the passes writing its inputs have run. When several passes could run, pick the
+	// one declared first, so a graph declared in a sensible order runs in that order
+	std::vector<unsigned int> waitingOn(numPasses, 0); // Number of passes each pass is waiting on
+	for (unsigned int pass = 0; pass < numPasses; ++pass)
+	{
+		if (!needed[pass])  continue;
+		for (auto texture : mPasses[pass].inputs)
+		{
+			if (writer[texture] != NO_WRITER)  ++waitingOn[pass];
+		}
+	}
+
+	std::vector<bool> done(numPasses, false);
+	unsigned int numNeeded = static_cast<unsigned int>(std::count(needed.begin(), needed.end(), true));
+	while (plan.passes.size() < numNeeded)
+	{
+		unsigned int next = numPasses;
+		for (unsigned int pass = 0; pass < numPasses; ++pass)
+		{
+			if (needed[pass] && !done[pass] && waitingOn[pass] == 0)
+			{
+				next = pass;
+				break;
+			}
+		}
+		if (next == numPasses)
+		{
+			plan.error = "Post-process passes depend on each other in a loop";
+			return false;
+		}
+
+		done[next] = true;
+		plan.passes.push_back(next);
+
+		// Passes reading the outputs of this pass have one less pass to wait on
+		for (unsigned int pass = 0; pass < numPasses; ++pass)
+		{
+			if (!needed[pass] || done[pass])  continue;
+			for (auto texture : mPasses[pass].inputs)
+			{
+				if (writer[texture] == static_cast<int>(next))  --waitingOn[pass];
+			}
+		}
+	}
+
+
+	////--------------- Texture lifetimes ---------------////
+
+	plan.textureLifetimes.resize(numTextures);
+	for (unsigned int order = 0; order < plan.passes.size(); ++order)
+	{
+		const Pass& pass = mPasses[plan.passes[order]];
+		auto use = [&](unsigned int texture)
+		{
+			auto& lifetime = plan.textureLifetimes[texture];
+			if (lifetime.firstPass < 0)  lifetime.firstPass = order;
+			lifetime.lastPass = order;
+		};
+		for (auto texture : pass.inputs)   use(texture);
+		for (auto texture : pass.outputs)  use(texture);
+	}
+
+
+	////--------------- Alias transient textures ---------------////
+
+	// Take the transient textures in the order they are first used. Each one reuses a physical texture of the same
+	// size and format that is no longer in use, or a new physical texture is added if there isn't one
+	std::vector<unsigned int> transients;
+	for (unsigned int texture = 0; texture < numTextures; ++texture)
+	{
+		if (!mTextures[texture].imported && plan.textureLifetimes[texture].firstPass >= 0)  transients.push_back(texture);
+	}
+	std::stable_sort(transients.begin(), transients.end(), [&](unsigned int a, unsigned int b)
+	{
+		return plan.textureLifetimes[a].firstPass < plan.textureLifetimes[b].firstPass;
+	});
+
+	plan.texturePhysical.assign(numTextures, -1);
+	std::vector<int> physicalLastPass; // Last pass using each physical texture so far
+	for (auto texture : transients)
+	{
+		const auto& desc     = mTextures[texture].desc;
+		const auto& lifetime = plan.textureLifetimes[texture];
+		plan.unaliasedBytes += desc.Bytes();
+
+		// A physical texture last used by the pass that first uses this texture is still busy (it might be read
+		// by the pass that writes this texture), so it must have been finished with by an earlier pass
+		int physical = -1;
+		for (unsigned int i = 0; i < plan.physicalTextures.size(); ++i)
+		{
+			if (plan.physicalTextures[i] == desc && physicalLastPass[i] < lifetime.firstPass)
+			{
+				physical = i;
+				break;
+			}
+		}
+		if (physical < 0)
+		{
+			plan.physicalTextures.push_back(desc);
+			physicalLastPass.push_back(-1);
+			physical = static_cast<int>(plan.physicalTextures.size() - 1);
+		}
+
+		plan.texturePhysical[texture] = physical;
+		physicalLastPass[physical] = lifetime.lastPass;
+	}
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Compile a small graph with known results and check the plan matches what is expected
+PostProcessGraphCheck CheckPostProcessGraph()
+{
+	const PostProcessTextureDesc frameDesc = { 1280, 720, PostProcessFormat::RGBA8 };
+
+	// Scene -> A -> B -> C, then B and C -> back buffer. A is finished with before C is written so they can share, B is in use
+	// at the same time as both. The chain A -> Unused -> AlsoUnused never reaches an output so is culled
+	PostProcessGraph graph;
+	unsigned int scene      = graph.ImportTexture("Scene", frameDesc);
+	unsigned int backBuffer = graph.ImportTexture("BackBuffer", frameDesc, true);
+	unsigned int a          = graph.CreateTexture("A", frameDesc);
+	unsigned int b          = graph.CreateTexture("B", frameDesc);
+	unsigned int c          = graph.CreateTexture("C", frameDesc);
+	unsigned int unused     = graph.CreateTexture("Unused", frameDesc);
+	unsigned int alsoUnused = graph.CreateTexture("AlsoUnused", frameDesc);
+
+	// Declared out of order, compiling must put each pass after the passes writing its inputs
+	unsigned int makeA   = graph.AddPass("MakeA", { scene }, { a });
+	                       graph.AddPass("Dead", { a }, { unused });
+	unsigned int combine = graph.AddPass("Combine", { c, b }, { backBuffer });
+	unsigned int makeB   = graph.AddPass("MakeB", { a }, { b });
+	                       graph.AddPass("AlsoDead", { unused }, { alsoUnused });
+	unsigned int makeC   = graph.AddPass("MakeC", { b }, { c });
+
+	PostProcessGraphCheck check;
+	PostProcessGraphPlan plan;
+	check.compiled = graph.Compile(plan) && plan.texturePhysical.size() == graph.NumTextures() &&
+	                 plan.textureLifetimes.size() == graph.NumTextures();
+	if (!check.compiled)  return check;
+
+	check.culled = (plan.passes == std::vector<unsigned int>{ makeA, makeB, makeC, combine });
+
+	// Positions in the compiled order above
+	auto lifetimeIs = [&](unsigned int texture, int firstPass, int lastPass)
+	{
+		return plan.textureLifetimes[texture].firstPass == firstPass && plan.textureLifetimes[texture].lastPass == lastPass;
+	};
+	check.lifetimes = lifetimeIs(scene, 0, 0) && lifetimeIs(a, 0, 1) && lifetimeIs(b, 1, 3) && lifetimeIs(c, 2, 3) &&
+	                  lifetimeIs(backBuffer, 3, 3) && lifetimeIs(unused, -1, -1) && lifetimeIs(alsoUnused, -1, -1);
+
+	// Only the used transients get physical textures, and A and C need only one between them
+	const auto& physical = plan.texturePhysical;
+	check.shared = physical[a] >= 0 && physical[a] == physical[c] && plan.physicalTextures.size() == 2 &&
+	               plan.PhysicalBytes() == 2 * frameDesc.Bytes() && plan.unaliasedBytes == 3 * frameDesc.Bytes();
+	check.separate = physical[b] >= 0 && physical[b] != physical[a] && physical[b] != physical[c] &&
+	                 physical[scene] == -1 && physical[backBuffer] == -1 && physical[unused] == -1 && physical[alsoUnused] == -1;
+
+	check.passed = check.culled && check.lifetimes && check.shared && check.separate;
+	return check;
+}
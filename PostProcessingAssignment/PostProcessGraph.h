@@ -0,0 +1,176 @@
+//--------------------------------------------------------------------------------------
+// Post-processing frame graph
+//--------------------------------------------------------------------------------------
+// Post-processing passes are declared along with the textures they read and write, and the size
+// and format of those textures. The graph is then compiled into a plan:
+// - Passes that don't contribute to an output (e.g. the back buffer) are culled
+// - The remaining passes are put in an order where every texture is written before it is read
+// - The lifetime of each texture is found (the first and last pass that uses it)
+// - Temporary ("transient") textures whose lifetimes don't overlap share the same actual texture
+//
+// For example a chain of five full-screen effects needs four intermediate textures, but only two
+// of them are in use at any one time, so only two real textures are needed.
+//
+// Compilation is plain C++ with no DirectX, so the results can be examined without a GPU. Creating
+// the real textures from the plan is left to the caller.
+
+#ifndef _POST_PROCESS_GRAPH_H_INCLUDED_
+#define _POST_PROCESS_GRAPH_H_INCLUDED_
+
+#include <string>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Texture description
+//--------------------------------------------------------------------------------------
+
+// Texture formats available to post-processing textures
+enum class PostProcessFormat
+{
+	RGBA8,   // 8-bit unsigned normalised per channel (same as the scene texture)
+	RGBA16F, // 16-bit float per channel, for values outside the 0->1 range (e.g. bloom)
+};
+
+// Bytes per pixel for the formats above
+unsigned int PostProcessFormatSize(PostProcessFormat format);
+
+
+struct PostProcessTextureDesc
+{
+	unsigned int      width  = 0;
+	unsigned int      height = 0;
+	PostProcessFormat format = PostProcessFormat::RGBA8;
+
+	unsigned int Bytes() const  { return width * height * PostProcessFormatSize(format); }
+};
+
+bool operator==(const PostProcessTextureDesc& a, const PostProcessTextureDesc& b);
+bool operator!=(const PostProcessTextureDesc& a, const PostProcessTextureDesc& b);
+
+
+//--------------------------------------------------------------------------------------
+// Compiled plan
+//--------------------------------------------------------------------------------------
+
+// The first and last position in the compiled pass order that a texture is used
+struct PostProcessLifetime
+{
+	int firstPass = -1; // -1 if the texture is not used by any pass that survived culling
+	int lastPass  = -1;
+};
+
+
+// Result of compiling a graph
+struct PostProcessGraphPlan
+{
+	// Passes to run, as indexes of the passes added to the graph, in the order to run them
+	std::vector<unsigned int> passes;
+
+	// The real textures needed for transient graph textures after aliasing
+	std::vector<PostProcessTextureDesc> physicalTextures;
+
+	// For each texture in the graph (indexed as returned from ImportTexture/CreateTexture):
+	std::vector<int>                 texturePhysical;  // Index into physicalTextures above, -1 for imported or unused textures
+	std::vector<PostProcessLifetime> textureLifetimes; // First/last position in the passes list above that uses the texture
+
+	// Memory that the used transient textures would need if each had its own texture (i.e. without aliasing)
+	unsigned int unaliasedBytes = 0;
+
+	std::string error; // Reason for failure if Compile returns false
+
+
+	// Memory needed for the transient textures after aliasing
+	unsigned int PhysicalBytes() const;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Graph
+//--------------------------------------------------------------------------------------
+
+class PostProcessGraph
+{
+public:
+	// Remove all textures and passes
+	void Clear();
+
+
+	// Declare a texture that exists outside the graph, e.g. the scene texture or back buffer. Imported textures
+	// are never aliased. Set isOutput for textures that must be written (passes writing them are never culled)
+	// Returns an identifier for the texture
+	unsigned int ImportTexture(const std::string& name, const PostProcessTextureDesc& desc, bool isOutput = false);
+
+	// Declare a temporary texture that only lives for part of the frame. It may share memory with other transient
+	// textures. Returns an identifier for the texture
+	unsigned int CreateTexture(const std::string& name, const PostProcessTextureDesc& desc);
+
+	// Declare a pass that reads the given input textures and writes the given output textures. Each texture may
+	// only be written by one pass. The user data is not used by the graph (e.g. store an effect identifier in it)
+	// Returns an identifier for the pass
+	unsigned int AddPass(const std::string& name, const std::vector<unsigned int>& inputs,
+	                     const std::vector<unsigned int>& outputs, int userData = 0);
+
+
+	// Cull, order and alias the graph into the given plan. Returns false on failure (e.g. a texture with
+	// two writers or passes depending on each other in a loop), plan.error will describe the problem
+	bool Compile(PostProcessGraphPlan& plan) const;
+
+
+	// Data access
+	unsigned int NumTextures()  const { return static_cast<unsigned int>(mTextures.size()); }
+	unsigned int NumPasses()    const { return static_cast<unsigned int>(mPasses.size());   }
+
+	const PostProcessTextureDesc& TextureDesc(unsigned int texture) const { return mTextures[texture].desc; }
+	const std::string&            TextureName(unsigned int texture) const { return mTextures[texture].name; }
+	bool                          IsImported (unsigned int texture) const { return mTextures[texture].imported; }
+
+	const std::string&               PassName    (unsigned int pass) const { return mPasses[pass].name;     }
+	int                              PassUserData(unsigned int pass) const { return mPasses[pass].userData; }
+	const std::vector<unsigned int>& PassInputs  (unsigned int pass) const { return mPasses[pass].inputs;   }
+	const std::vector<unsigned int>& PassOutputs (unsigned int pass) const { return mPasses[pass].outputs;  }
+
+
+private:
+	struct Texture
+	{
+		std::string            name;
+		PostProcessTextureDesc desc;
+		bool                   imported = false;
+		bool                   isOutput = false;
+	};
+
+	struct Pass
+	{
+		std::string               name;
+		std::vector<unsigned int> inputs;
+		std::vector<unsigned int> outputs;
+		int                       userData = 0;
+	};
+
+	std::vector<Texture> mTextures;
+	std::vector<Pass>    mPasses;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckPostProcessGraph
+struct PostProcessGraphCheck
+{
+	bool compiled  = false; // True if the graph compiled
+	bool culled    = false; // True if exactly the passes not leading to the back buffer were culled, the rest in dependency order
+	bool lifetimes = false; // True if the first and last pass of every texture were as expected, -1 for unused textures
+	bool shared    = false; // True if two transient textures whose lifetimes don't overlap used the same physical texture
+	bool separate  = false; // True if transient textures whose lifetimes overlap used different physical textures
+	bool passed    = false; // True if all of the above
+};
+
+// Compile a small graph with known results: passes declared out of order, a chain of passes whose output is never used, and
+// transient textures that can and can't share memory. Check the plan matches what is expected
+PostProcessGraphCheck CheckPostProcessGraph();
+
+
+#endif //_POST_PROCESS_GRAPH_H_INCLUDED_
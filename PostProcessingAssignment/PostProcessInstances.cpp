@@ -0,0 +1,265 @@
+//--------------------------------------------------------------------------------------
+// Batches of area post-processes
+//--------------------------------------------------------------------------------------
+// Projection, culling and packing of many area effects at once. See header file for details
+
+#include "PostProcessInstances.h"
+
+#include <xmmintrin.h> // SSE instructions, available on every x86/x64 processor Direct3D 11 runs on
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+
+//--------------------------------------------------------------------------------------
+// Area lists
+//--------------------------------------------------------------------------------------
+
+void AreaEffectList::Clear()
+{
+	x.clear();  y.clear();  z.clear();
+	width.clear();  height.clear();
+}
+
+void AreaEffectList::Add(const CVector3& centre, const CVector2& size)
+{
+	x.push_back(centre.x);  y.push_back(centre.y);  z.push_back(centre.z);
+	width.push_back(size.x);  height.push_back(size.y);
+}
+
+void AreaEffectList::SetCentre(unsigned int index, const CVector3& centre)
+{
+	x[index] = centre.x;  y[index] = centre.y;  z[index] = centre.z;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Batching
+//--------------------------------------------------------------------------------------
+
+// Place a single area effect on the screen. Returns false if the area is culled.
+// The calculations are in the same order as the batched version so the results are identical
+bool ProjectAreaEffect(const CVector3& centre, const CVector2& size, const AreaEffectProjection& projection, AreaInstance& instance)
+{
+	const CMatrix4x4& m = projection.viewProjectionMatrix;
+	float clipX = centre.x * m.e00 + centre.y * m.e10 + centre.z * m.e20 + m.e30;
+	float clipY = centre.x * m.e01 + centre.y * m.e11 + centre.z * m.e21 + m.e31;
+	float clipZ = centre.x * m.e02 + centre.y * m.e12 + centre.z * m.e22 + m.e32;
+	float clipW = centre.x * m.e03 + centre.y * m.e13 + centre.z * m.e23 + m.e33; // Distance in front of the camera
+
+	if (clipW < projection.nearClip || clipW > projection.farClip)  return false;
+
+	// Centre in 0->1 coordinates with y down, size shrinks with distance (see AreaPostProcessPlacement in Scene.cpp)
+	float invW = 1.0f / clipW;
+	float centreX = (clipX * invW + 1.0f) * 0.5f;
+	float centreY = (1.0f - clipY * invW) * 0.5f;
+	float sizeX = size.x * projection.sizeScale.x * invW;
+	float sizeY = size.y * projection.sizeScale.y * invW;
+	float left = centreX - 0.5f * sizeX;
+	float top  = centreY - 0.5f * sizeY;
+
+	if (left >= 1.0f || left + sizeX <= 0.0f || top >= 1.0f || top + sizeY <= 0.0f)  return false;
+
+	instance.area2DTopLeft = { left, top };
+	instance.area2DSize    = { sizeX, sizeY };
+	instance.area2DDepth   = clipZ * invW;
+	instance.padding       = { 0, 0, 0 };
+	return true;
+}
+
+
+// Project all the areas in the list, cull those that can't be seen and pack the rest in list order, up to the given maximum
+const std::vector<AreaInstance>& AreaEffectBatcher::Batch(const AreaEffectList& areas, const AreaEffectProjection& projection,
+                                                          unsigned int maxInstances /*= MAX_AREA_INSTANCES*/)
+{
+	const unsigned int count = areas.Count();
+	mLeft.resize(count);  mTop.resize(count);  mWidth.resize(count);  mHeight.resize(count);  mDepth.resize(count);
+	mCull.resize(count);
+
+	//----
+	// Project and cull, four areas at a time. Each SSE register holds the same value for four different areas
+	const CMatrix4x4& m = projection.viewProjectionMatrix;
+	const __m128 e00 = _mm_set1_ps(m.e00), e10 = _mm_set1_ps(m.e10), e20 = _mm_set1_ps(m.e20), e30 = _mm_set1_ps(m.e30);
+	const __m128 e01 = _mm_set1_ps(m.e01), e11 = _mm_set1_ps(m.e11), e21 = _mm_set1_ps(m.e21), e31 = _mm_set1_ps(m.e31);
+	const __m128 e02 = _mm_set1_ps(m.e02), e12 = _mm_set1_ps(m.e12), e22 = _mm_set1_ps(m.e22), e32 = _mm_set1_ps(m.e32);
+	const __m128 e03 = _mm_set1_ps(m.e03), e13 = _mm_set1_ps(m.e13), e23 = _mm_set1_ps(m.e23), e33 = _mm_set1_ps(m.e33);
+	const __m128 nearClip   = _mm_set1_ps(projection.nearClip);
+	const __m128 farClip    = _mm_set1_ps(projection.farClip);
+	const __m128 sizeScaleX = _mm_set1_ps(projection.sizeScale.x);
+	const __m128 sizeScaleY = _mm_set1_ps(projection.sizeScale.y);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one  = _mm_set1_ps(1.0f);
+
+	unsigned int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&areas.x[i]);
+		__m128 y = _mm_loadu_ps(&areas.y[i]);
+		__m128 z = _mm_loadu_ps(&areas.z[i]);
+
+		__m128 clipX = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e00), _mm_mul_ps(y, e10)), _mm_mul_ps(z, e20)), e30);
+		__m128 clipY = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e01), _mm_mul_ps(y, e11)), _mm_mul_ps(z, e21)), e31);
+		__m128 clipZ = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e02), _mm_mul_ps(y, e12)), _mm_mul_ps(z, e22)), e32);
+		__m128 clipW = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e03), _mm_mul_ps(y, e13)), _mm_mul_ps(z, e23)), e33);
+
+		__m128 invW    = _mm_div_ps(one, clipW);
+		__m128 centreX = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(clipX, invW), one), half);
+		__m128 centreY = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(clipY, invW)), half);
+		__m128 sizeX   = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&areas.width[i]),  sizeScaleX), invW);
+		__m128 sizeY   = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&areas.height[i]), sizeScaleY), invW);
+		__m128 left    = _mm_sub_ps(centreX, _mm_mul_ps(half, sizeX));
+		__m128 top     = _mm_sub_ps(centreY, _mm_mul_ps(half, sizeY));
+
+		_mm_storeu_ps(&mLeft[i],   left);
+		_mm_storeu_ps(&mTop[i],    top);
+		_mm_storeu_ps(&mWidth[i],  sizeX);
+		_mm_storeu_ps(&mHeight[i], sizeY);
+		_mm_storeu_ps(&mDepth[i],  _mm_mul_ps(clipZ, invW));
+
+		// Comparisons give a mask per area, movemask packs the four masks into the bottom bits of an int
+		int behind = _mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(clipW, nearClip), _mm_cmpgt_ps(clipW, farClip)));
+		int offScreen = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(_mm_cmpge_ps(left, one), _mm_cmple_ps(_mm_add_ps(left, sizeX), zero)),
+		                                          _mm_or_ps(_mm_cmpge_ps(top,  one), _mm_cmple_ps(_mm_add_ps(top,  sizeY), zero))));
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			mCull[i + lane] = (behind & (1 << lane)) ? 1 : (offScreen & (1 << lane)) ? 2 : 0;
+		}
+	}
+	ProjectRange(areas, projection, i, count);
+
+	//----
+	// Pack the visible areas
+	mInstances.clear();
+	mIndices.clear();
+	mStats = {};
+	mStats.effects = count;
+	for (i = 0; i < count; ++i)
+	{
+		if      (mCull[i] == 1)  ++mStats.behind;
+		else if (mCull[i] == 2)  ++mStats.offScreen;
+		else if (mInstances.size() >= maxInstances)  ++mStats.dropped;
+		else
+		{
+			mInstances.push_back({ { mLeft[i], mTop[i] }, { mWidth[i], mHeight[i] }, mDepth[i], { 0, 0, 0 } });
+			mIndices.push_back(i);
+		}
+	}
+	mStats.packed = static_cast<unsigned int>(mInstances.size());
+
+	return mInstances;
+}
+
+
+// Project the areas from first up to (not including) last without SSE
+void AreaEffectBatcher::ProjectRange(const AreaEffectList& areas, const AreaEffectProjection& projection, unsigned int first, unsigned int last)
+{
+	for (unsigned int i = first; i < last; ++i)
+	{
+		AreaInstance instance;
+		CVector3 centre = { areas.x[i], areas.y[i], areas.z[i] };
+		if (ProjectAreaEffect(centre, { areas.width[i], areas.height[i] }, projection, instance))
+		{
+			mLeft[i]  = instance.area2DTopLeft.x;  mWidth[i]  = instance.area2DSize.x;
+			mTop[i]   = instance.area2DTopLeft.y;  mHeight[i] = instance.area2DSize.y;
+			mDepth[i] = instance.area2DDepth;
+			mCull[i]  = 0;
+		}
+		else
+		{
+			// Only the reason for culling is needed, so find the distance again
+			const CMatrix4x4& m = projection.viewProjectionMatrix;
+			float clipW = centre.x * m.e03 + centre.y * m.e13 + centre.z * m.e23 + m.e33;
+			mCull[i] = (clipW < projection.nearClip || clipW > projection.farClip) ? 1 : 2;
+		}
+	}
+}
+
+
+// Get the rectangle (0->1 coordinates) containing all packed instances. Returns false if there are none
+bool AreaEffectBatcher::Bounds(CVector2& topLeft, CVector2& bottomRight)
+{
+	if (mInstances.empty())  return false;
+
+	topLeft     = mInstances[0].area2DTopLeft;
+	bottomRight = mInstances[0].area2DTopLeft + mInstances[0].area2DSize;
+	for (auto& instance : mInstances)
+	{
+		topLeft.x     = std::min(topLeft.x,     instance.area2DTopLeft.x);
+		topLeft.y     = std::min(topLeft.y,     instance.area2DTopLeft.y);
+		bottomRight.x = std::max(bottomRight.x, instance.area2DTopLeft.x + instance.area2DSize.x);
+		bottomRight.y = std::max(bottomRight.y, instance.area2DTopLeft.y + instance.area2DSize.y);
+	}
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time placing the given number of areas spread randomly around the given point, one at a time and batched
+AreaEffectBenchmark BenchmarkAreaEffects(unsigned int effects, unsigned int repeats, const AreaEffectProjection& projection,
+                                         const CVector3& centre)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Fixed seed so every run times the same areas
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> offset(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> size(2.0f, 20.0f);
+	AreaEffectList areas;
+	for (unsigned int i = 0; i < effects; ++i)
+	{
+		CVector3 point = { centre.x + offset(generator), centre.y + offset(generator), centre.z + offset(generator) };
+		float areaSize = size(generator);
+		areas.Add(point, { areaSize, areaSize });
+	}
+	if (repeats == 0)  repeats = 1;
+
+	AreaEffectBenchmark result;
+	result.effects = effects;
+
+	// One at a time, as AreaPostProcess does
+	std::vector<AreaInstance> single;
+	single.reserve(effects);
+	auto start = Clock::now();
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+	{
+		single.clear();
+		for (unsigned int i = 0; i < effects; ++i)
+		{
+			AreaInstance instance;
+			if (ProjectAreaEffect({ areas.x[i], areas.y[i], areas.z[i] }, { areas.width[i], areas.height[i] }, projection, instance))
+			{
+				single.push_back(instance);
+			}
+		}
+	}
+	result.singleMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+	// Batched. No limit on the number of instances so the results can be compared
+	AreaEffectBatcher batcher;
+	start = Clock::now();
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+	{
+		batcher.Batch(areas, projection, effects);
+	}
+	result.batchedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+	// Check both approaches agree
+	auto& batched = batcher.Instances();
+	result.visible = static_cast<unsigned int>(batched.size());
+	result.match = (single.size() == batched.size());
+	for (unsigned int i = 0; result.match && i < batched.size(); ++i)
+	{
+		result.match = std::abs(single[i].area2DTopLeft.x - batched[i].area2DTopLeft.x) < 1e-5f &&
+		               std::abs(single[i].area2DTopLeft.y - batched[i].area2DTopLeft.y) < 1e-5f &&
+		               std::abs(single[i].area2DSize.x    - batched[i].area2DSize.x)    < 1e-5f &&
+		               std::abs(single[i].area2DSize.y    - batched[i].area2DSize.y)    < 1e-5f &&
+		               std::abs(single[i].area2DDepth     - batched[i].area2DDepth)     < 1e-5f;
+	}
+
+	return result;
+}
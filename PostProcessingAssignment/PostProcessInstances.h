@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// Batches of area post-processes
+//--------------------------------------------------------------------------------------
+// AreaPostProcess places one area effect per call: it projects the world point to the screen,
+// uploads the constant buffer and draws a quad. That is fine for one effect, but not for an
+// effect over every light or every window in a scene.
+//
+// Here a whole list of area effects is placed on screen at once:
+// - Project: the world points are held as separate x, y, z arrays (structure of arrays), so
+//   four can be transformed together with SSE instructions
+// - Cull: areas behind the camera, beyond the far clip or entirely off-screen are dropped
+// - Pack: the remaining areas are written in list order into an array of AreaInstance, which is
+//   the layout of the instance constant buffer used by 2DQuadInstanced_pp.hlsl
+// Each post-process then draws every area with one instanced draw call.
+//
+// This file is plain C++ with no DirectX, so the batching can be timed on its own (see BenchmarkAreaEffects)
+
+#ifndef _POST_PROCESS_INSTANCES_H_INCLUDED_
+#define _POST_PROCESS_INSTANCES_H_INCLUDED_
+
+#include "PostProcessingConstants.h"
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Area lists
+//--------------------------------------------------------------------------------------
+
+// World positions and sizes of a list of area effects, held in separate arrays so several can be processed at once
+struct AreaEffectList
+{
+	std::vector<float> x, y, z;       // Centre of each area in world space
+	std::vector<float> width, height; // Size of each area in world units
+
+	void Clear();
+	void Add(const CVector3& centre, const CVector2& size);
+	void SetCentre(unsigned int index, const CVector3& centre);
+
+	unsigned int Count() const  { return static_cast<unsigned int>(x.size()); }
+};
+
+
+// Camera settings needed to place area effects on the screen
+struct AreaEffectProjection
+{
+	CMatrix4x4 viewProjectionMatrix;
+	float      nearClip;
+	float      farClip;
+	CVector2   sizeScale; // Screen size (0->1) of an area 1 unit across at a distance of 1. Half of the x and y scales
+	                      // in the projection matrix, which are 1/tan(FOVx/2) and aspect ratio/tan(FOVx/2)
+};
+
+
+// Counters from batching a list of area effects
+struct AreaEffectStats
+{
+	unsigned int effects   = 0; // Number of areas in the list
+	unsigned int behind    = 0; // Culled for being behind the camera near clip or beyond the far clip
+	unsigned int offScreen = 0; // Culled for being entirely outside the viewport
+	unsigned int packed    = 0; // Number of instances packed
+	unsigned int dropped   = 0; // Visible areas left out because the maximum number of instances was reached
+};
+
+
+//--------------------------------------------------------------------------------------
+// Batching
+//--------------------------------------------------------------------------------------
+
+// Place a single area effect on the screen, one at a time as AreaPostProcess does. Returns false if the area is culled.
+// Gives the same results as AreaEffectBatcher, it is used to compare against
+bool ProjectAreaEffect(const CVector3& centre, const CVector2& size, const AreaEffectProjection& projection, AreaInstance& instance);
+
+
+class AreaEffectBatcher
+{
+public:
+	// Project all the areas in the list, cull those that can't be seen and pack the rest in list order, up to the given
+	// maximum. Returns the packed instances, which stay valid until the next call
+	const std::vector<AreaInstance>& Batch(const AreaEffectList& areas, const AreaEffectProjection& projection,
+	                                       unsigned int maxInstances = MAX_AREA_INSTANCES);
+
+	// Results of the most recent call to Batch. Indices gives the list entry each instance came from
+	const std::vector<AreaInstance>& Instances()  { return mInstances; }
+	const std::vector<unsigned int>& Indices()    { return mIndices; }
+	const AreaEffectStats&           Stats()      { return mStats; }
+
+	// Get the rectangle (0->1 coordinates) containing all packed instances. Returns false if there are none
+	bool Bounds(CVector2& topLeft, CVector2& bottomRight);
+
+private:
+	// Project the areas from first up to (not including) last without SSE - used for any left over after groups of four
+	void ProjectRange(const AreaEffectList& areas, const AreaEffectProjection& projection, unsigned int first, unsigned int last);
+
+	// Results of the projection stage, one entry per area in the list. Kept between calls to avoid reallocating
+	std::vector<float> mLeft, mTop, mWidth, mHeight, mDepth;
+	std::vector<int>   mCull; // 0 if visible, 1 if behind the camera / beyond far clip, 2 if off-screen
+
+	std::vector<AreaInstance> mInstances;
+	std::vector<unsigned int> mIndices;
+	AreaEffectStats           mStats;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Timings from BenchmarkAreaEffects, times are the average for one pass over all the areas
+struct AreaEffectBenchmark
+{
+	unsigned int effects   = 0;
+	unsigned int visible   = 0;     // Number that survived culling
+	double       singleMs  = 0;     // Placing the areas one at a time with ProjectAreaEffect
+	double       batchedMs = 0;     // Placing the areas with AreaEffectBatcher
+	bool         match     = false; // True if both approaches gave the same instances
+};
+
+// Time placing the given number of areas spread randomly (but the same each run) in a cube 400 units across around
+// the given point, one at a time and batched. Each approach is repeated the given number of times
+AreaEffectBenchmark BenchmarkAreaEffects(unsigned int effects, unsigned int repeats, const AreaEffectProjection& projection,
+                                         const CVector3& centre);
+
+
+#endif //_POST_PROCESS_INSTANCES_H_INCLUDED_
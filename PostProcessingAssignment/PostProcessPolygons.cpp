@@ -0,0 +1,349 @@
+//--------------------------------------------------------------------------------------
+// Polygon post-process regions
+//--------------------------------------------------------------------------------------
+// Triangulation and batching of post-process polygons. See header file for details
+
+#include "PostProcessPolygons.h"
+#include "TransformBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+
+//--------------------------------------------------------------------------------------
+// Triangulation
+//--------------------------------------------------------------------------------------
+
+// Twice the signed area of triangle abc, positive if anticlockwise. Also tells which side of line ab point c is on
+static float Cross(const CVector2& a, const CVector2& b, const CVector2& c)
+{
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+
+// Return the area of a polygon given as points in order around its edge. Positive if the points go anticlockwise
+float PolygonArea(const std::vector<CVector2>& points)
+{
+	// Shoelace formula
+	float area = 0;
+	for (unsigned int i = 0, j = static_cast<unsigned int>(points.size()) - 1; i < points.size(); j = i++)
+	{
+		area += points[j].x * points[i].y - points[i].x * points[j].y;
+	}
+	return area * 0.5f;
+}
+
+
+// Split a polygon into triangles using ear clipping. An "ear" is a corner whose triangle with its two neighbours is inside
+// the polygon and contains no other points. Cutting off an ear leaves a smaller polygon, repeat until one triangle is left
+bool TriangulatePolygon(const std::vector<CVector2>& points, std::vector<unsigned int>& indices)
+{
+	if (points.size() < 3)  return false;
+	float area = PolygonArea(points);
+	if (area == 0)  return false;
+
+	// Corners that turn the same way as the polygon goes around are convex, only they can be ears
+	const float orientation = (area > 0) ? 1.0f : -1.0f;
+	const float collinear = std::abs(area) * 1e-6f; // Corners turning less than this are treated as straight
+
+	std::vector<unsigned int> remaining(points.size());
+	std::iota(remaining.begin(), remaining.end(), 0);
+
+	unsigned int corner = 0;
+	unsigned int sinceLastEar = 0;
+	while (remaining.size() > 3)
+	{
+		unsigned int count = static_cast<unsigned int>(remaining.size());
+		unsigned int prev = remaining[(corner + count - 1) % count];
+		unsigned int curr = remaining[corner];
+		unsigned int next = remaining[(corner + 1) % count];
+		const CVector2& a = points[prev];
+		const CVector2& b = points[curr];
+		const CVector2& c = points[next];
+		float turn = Cross(a, b, c) * orientation;
+
+		// A straight corner adds no area, remove it without a triangle
+		bool ear = false;
+		bool remove = std::abs(turn) <= collinear;
+		if (!remove && turn > 0)
+		{
+			// Convex corner - an ear if no other point is inside or on the edge of its triangle. Points at the same position as a
+			// corner of the triangle are ignored, they occur where a polygon touches itself
+			ear = true;
+			for (auto other : remaining)
+			{
+				const CVector2& p = points[other];
+				if ((p.x == a.x && p.y == a.y) || (p.x == b.x && p.y == b.y) || (p.x == c.x && p.y == c.y))  continue;
+				if (Cross(a, b, p) * orientation >= 0 && Cross(b, c, p) * orientation >= 0 && Cross(c, a, p) * orientation >= 0)
+				{
+					ear = false;
+					break;
+				}
+			}
+		}
+
+		if (ear || remove)
+		{
+			if (ear)
+			{
+				indices.push_back(prev);
+				indices.push_back(curr);
+				indices.push_back(next);
+			}
+			remaining.erase(remaining.begin() + corner);
+			if (corner >= remaining.size())  corner = 0;
+			sinceLastEar = 0;
+		}
+		else
+		{
+			// Once every corner has been tried without finding an ear the edges must cross
+			corner = (corner + 1) % count;
+			if (++sinceLastEar > count)  return false;
+		}
+	}
+
+	// Last triangle
+	if (std::abs(Cross(points[remaining[0]], points[remaining[1]], points[remaining[2]])) > collinear)
+	{
+		indices.insert(indices.end(), remaining.begin(), remaining.end());
+	}
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Batching
+//--------------------------------------------------------------------------------------
+
+// Add a polygon given as points in its own XY plane. Returns an index to use with SetWorldMatrix, or -1 if it can't be triangulated
+int PolygonRegionBatcher::Add(const std::vector<CVector2>& points, const CMatrix4x4& worldMatrix)
+{
+	std::vector<unsigned int> triangles;
+	if (!TriangulatePolygon(points, triangles))  return -1;
+
+	Polygon polygon;
+	polygon.firstPoint  = static_cast<unsigned int>(mPointX.size());
+	polygon.pointCount  = static_cast<unsigned int>(points.size());
+	polygon.firstIndex  = static_cast<unsigned int>(mIndices.size());
+	polygon.indexCount  = static_cast<unsigned int>(triangles.size());
+	polygon.worldMatrix = worldMatrix;
+	mPolygons.push_back(polygon);
+	for (auto& point : points)
+	{
+		mPointX.push_back(point.x);
+		mPointY.push_back(point.y);
+	}
+	mIndices.insert(mIndices.end(), triangles.begin(), triangles.end());
+
+	// Area UVs go from 0 to 1 across the polygon's bounding rectangle, with v going down (y in the polygon goes up)
+	CVector2 minPoint = points[0];
+	CVector2 maxPoint = points[0];
+	for (auto& point : points)
+	{
+		minPoint.x = std::min(minPoint.x, point.x);  maxPoint.x = std::max(maxPoint.x, point.x);
+		minPoint.y = std::min(minPoint.y, point.y);  maxPoint.y = std::max(maxPoint.y, point.y);
+	}
+	CVector2 size = maxPoint - minPoint;
+	for (auto& point : points)
+	{
+		mAreaUVs.push_back({ size.x > 0 ? (point.x - minPoint.x) / size.x : 0.5f, size.y > 0 ? (maxPoint.y - point.y) / size.y : 0.5f });
+	}
+
+	return static_cast<int>(mPolygons.size()) - 1;
+}
+
+
+// Move a polygon previously added
+void PolygonRegionBatcher::SetWorldMatrix(int polygon, const CMatrix4x4& worldMatrix)
+{
+	mPolygons[polygon].worldMatrix = worldMatrix;
+}
+
+
+// Remove all polygons
+void PolygonRegionBatcher::Clear()
+{
+	mPolygons.clear();
+	mPointX.clear();
+	mPointY.clear();
+	mAreaUVs.clear();
+	mIndices.clear();
+	mVertices.clear();
+	mStats = {};
+}
+
+
+// Transform all the polygons to 2D and put them into one list of triangles
+const std::vector<PolygonVertex>& PolygonRegionBatcher::Batch(const CMatrix4x4& viewProjectionMatrix, unsigned int maxVertices)
+{
+	mVertices.clear();
+	mStats = {};
+	mStats.polygons = static_cast<unsigned int>(mPolygons.size());
+
+	for (auto& polygon : mPolygons)
+	{
+		// Combine the matrices so each point needs one transformation. Points have z = 0, so no z is given (see TransformBatch.h)
+		CMatrix4x4 m = polygon.worldMatrix * viewProjectionMatrix;
+		mProjectedX.resize(polygon.pointCount);  mProjectedY.resize(polygon.pointCount);
+		mProjectedZ.resize(polygon.pointCount);  mProjectedW.resize(polygon.pointCount);
+		TransformPoints(m, { &mPointX[polygon.firstPoint], &mPointY[polygon.firstPoint], nullptr }, polygon.pointCount,
+		                { mProjectedX.data(), mProjectedY.data(), mProjectedZ.data(), mProjectedW.data() });
+
+		// Cull the polygon if all its points are outside the same side of the view (in 2D viewport space, visible points
+		// have -w <= x <= w, -w <= y <= w and 0 <= z <= w). Each bit of the outcode is one side
+		unsigned int allOutside = 0x3f;
+		for (unsigned int i = 0; i < polygon.pointCount; ++i)
+		{
+			float x = mProjectedX[i], y = mProjectedY[i], z = mProjectedZ[i], w = mProjectedW[i];
+			unsigned int outside = (x < -w ? 0x01 : 0) | (x > w ? 0x02 : 0) |
+			                       (y < -w ? 0x04 : 0) | (y > w ? 0x08 : 0) |
+			                       (z < 0  ? 0x10 : 0) | (z > w ? 0x20 : 0);
+			allOutside &= outside;
+		}
+		mStats.points += polygon.pointCount;
+		if (allOutside != 0)
+		{
+			++mStats.culled;
+			continue;
+		}
+
+		if (mVertices.size() + polygon.indexCount > maxVertices)
+		{
+			++mStats.dropped;
+			continue;
+		}
+
+		// Write the triangles
+		for (unsigned int i = 0; i < polygon.indexCount; ++i)
+		{
+			unsigned int point = mIndices[polygon.firstIndex + i];
+			CVector4 projected = { mProjectedX[point], mProjectedY[point], mProjectedZ[point], mProjectedW[point] };
+			mVertices.push_back({ projected, mAreaUVs[polygon.firstPoint + point] });
+		}
+		mStats.triangles += polygon.indexCount / 3;
+	}
+
+	return mVertices;
+}
+
+
+// Get the rectangle (0->1 coordinates) containing all batched triangles. Returns false if there are none
+bool PolygonRegionBatcher::Bounds(CVector2& topLeft, CVector2& bottomRight)
+{
+	if (mVertices.empty())  return false;
+
+	topLeft     = { 1, 1 };
+	bottomRight = { 0, 0 };
+	for (auto& vertex : mVertices)
+	{
+		const CVector4& position = vertex.projectedPosition;
+		if (position.w <= 0)
+		{
+			topLeft     = { 0, 0 };
+			bottomRight = { 1, 1 };
+			return true;
+		}
+
+		// Viewport coordinates (-1 -> 1, y up) to 0->1 coordinates with y down
+		float x = ( position.x / position.w + 1.0f) * 0.5f;
+		float y = (-position.y / position.w + 1.0f) * 0.5f;
+		topLeft.x     = std::min(topLeft.x,     x);  topLeft.y     = std::min(topLeft.y,     y);
+		bottomRight.x = std::max(bottomRight.x, x);  bottomRight.y = std::max(bottomRight.y, y);
+	}
+	topLeft     = { std::max(topLeft.x, 0.0f),     std::max(topLeft.y, 0.0f) };
+	bottomRight = { std::min(bottomRight.x, 1.0f), std::min(bottomRight.y, 1.0f) };
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time triangulating and batching the given number of star-shaped polygons
+PolygonBenchmark BenchmarkPolygonRegions(unsigned int polygons, unsigned int pointsPerPolygon, unsigned int repeats,
+                                         const CMatrix4x4& viewProjectionMatrix, const CVector3& centre)
+{
+	using Clock = std::chrono::steady_clock;
+	if (repeats == 0)  repeats = 1;
+	pointsPerPolygon = std::max(pointsPerPolygon, 4u) & ~1u; // Stars need an even number of points, alternating outer and inner
+
+	// Fixed seed so every run times the same polygons
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> offset(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 2 * PI);
+	std::uniform_real_distribution<float> innerRadius(0.3f, 0.8f);
+	std::vector<std::vector<CVector2>> shapes;
+	std::vector<CMatrix4x4> worldMatrices;
+	for (unsigned int p = 0; p < polygons; ++p)
+	{
+		std::vector<CVector2> shape;
+		float inner = innerRadius(generator);
+		for (unsigned int i = 0; i < pointsPerPolygon; ++i)
+		{
+			float pointAngle = 2 * PI * i / pointsPerPolygon;
+			float radius = (i % 2 == 0) ? 1.0f : inner;
+			shape.push_back({ radius * std::cos(pointAngle), radius * std::sin(pointAngle) });
+		}
+		shapes.push_back(shape);
+		worldMatrices.push_back(MatrixScaling(10.0f) * MatrixRotationX(angle(generator)) * MatrixRotationY(angle(generator)) *
+		                        MatrixTranslation({ centre.x + offset(generator), centre.y + offset(generator), centre.z + offset(generator) }));
+	}
+
+	PolygonBenchmark result;
+	result.polygons = polygons;
+	result.points   = polygons * pointsPerPolygon;
+
+	// Triangulation, also check the triangles of each polygon add up to its area
+	std::vector<unsigned int> indices;
+	auto start = Clock::now();
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+	{
+		for (auto& shape : shapes)
+		{
+			indices.clear();
+			TriangulatePolygon(shape, indices);
+		}
+	}
+	result.triangulateMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+	result.areasMatch = true;
+	for (auto& shape : shapes)
+	{
+		indices.clear();
+		if (!TriangulatePolygon(shape, indices))
+		{
+			result.areasMatch = false;
+			break;
+		}
+		float triangleArea = 0;
+		for (unsigned int i = 0; i < indices.size(); i += 3)
+		{
+			triangleArea += 0.5f * std::abs(Cross(shape[indices[i]], shape[indices[i + 1]], shape[indices[i + 2]]));
+		}
+		if (std::abs(triangleArea - std::abs(PolygonArea(shape))) > 1e-4f * std::abs(PolygonArea(shape)))
+		{
+			result.areasMatch = false;
+			break;
+		}
+		result.triangles += static_cast<unsigned int>(indices.size() / 3);
+	}
+
+	// Transformation and batching
+	PolygonRegionBatcher batcher;
+	for (unsigned int p = 0; p < polygons; ++p)
+	{
+		batcher.Add(shapes[p], worldMatrices[p]);
+	}
+	start = Clock::now();
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+	{
+		batcher.Batch(viewProjectionMatrix, result.triangles * 3);
+	}
+	result.batchMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+	return result;
+}
@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------
+// Polygon post-process regions
+//--------------------------------------------------------------------------------------
+// Polygon post-processes used to be limited to one four-point polygon, sent to the GPU in the
+// constant buffer and drawn as a triangle strip. Here there can be any number of polygons with
+// any number of points, convex or concave, each with its own world matrix:
+// - Each polygon is split into triangles once, when it is added (ear clipping)
+// - Each frame all the polygons are transformed to 2D together and written as one list of
+//   triangles, which the caller copies to a dynamic vertex buffer
+// - Each post-process then draws every polygon with a single draw call (see 2DPolygon_pp.hlsl)
+//
+// This file is plain C++ with no DirectX, so the triangulation and transformation can be checked
+// and timed on their own (see BenchmarkPolygonRegions)
+
+#ifndef _POST_PROCESS_POLYGONS_H_INCLUDED_
+#define _POST_PROCESS_POLYGONS_H_INCLUDED_
+
+#include "CVector2.h"
+#include "CVector4.h"
+#include "CMatrix4x4.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Triangulation
+//--------------------------------------------------------------------------------------
+
+// Return the area of a polygon given as points in order around its edge. Positive if the points go anticlockwise
+float PolygonArea(const std::vector<CVector2>& points);
+
+// Split a polygon into triangles. The polygon is given as points in order around its edge, in either direction. It can be
+// convex or concave but not have holes or edges that cross. Three indices into the points are added to the indices list
+// for each triangle. Returns false if the polygon has fewer than three points, no area or crossing edges
+bool TriangulatePolygon(const std::vector<CVector2>& points, std::vector<unsigned int>& indices);
+
+
+//--------------------------------------------------------------------------------------
+// Batching
+//--------------------------------------------------------------------------------------
+
+// Vertex of the triangles drawn for polygon post-processes - must match the input to 2DPolygon_pp.hlsl
+struct PolygonVertex
+{
+	CVector4 projectedPosition; // 2D viewport position, world and view-projection matrices already applied
+	CVector2 areaUV;            // 0->1 over the polygon's bounding rectangle, for effects that fade out at the edges
+};
+
+
+// Counters from batching the polygons
+struct PolygonStats
+{
+	unsigned int polygons  = 0; // Number of polygons
+	unsigned int culled    = 0; // Number left out for being entirely outside the view
+	unsigned int dropped   = 0; // Number left out because the maximum number of vertices was reached
+	unsigned int triangles = 0; // Number of triangles in the batch
+	unsigned int points    = 0; // Number of polygon points transformed
+};
+
+
+class PolygonRegionBatcher
+{
+public:
+	// Add a polygon given as points in its own XY plane, in order around its edge. The world matrix places it in the scene.
+	// Returns an index to use with SetWorldMatrix, or -1 if the polygon can't be triangulated (see TriangulatePolygon)
+	int Add(const std::vector<CVector2>& points, const CMatrix4x4& worldMatrix);
+
+	// Move a polygon previously added
+	void SetWorldMatrix(int polygon, const CMatrix4x4& worldMatrix);
+
+	// Remove all polygons
+	void Clear();
+
+	unsigned int Count()  { return static_cast<unsigned int>(mPolygons.size()); }
+
+
+	// Transform all the polygons to 2D and put them into one list of triangles, three vertices each. Polygons entirely outside
+	// the view are left out, as are any that would take the list over the given maximum number of vertices. Returns the
+	// vertices, which stay valid until the next call
+	const std::vector<PolygonVertex>& Batch(const CMatrix4x4& viewProjectionMatrix, unsigned int maxVertices);
+
+	// Results of the most recent call to Batch
+	const std::vector<PolygonVertex>& Vertices()  { return mVertices; }
+	const PolygonStats&               Stats()     { return mStats; }
+
+	// Get the rectangle (0->1 coordinates) containing all batched triangles. Returns false if there are none. Points behind the
+	// camera can end up anywhere on screen, so the whole screen is returned if there are any
+	bool Bounds(CVector2& topLeft, CVector2& bottomRight);
+
+private:
+	// A polygon refers to a range of the point and index lists below
+	struct Polygon
+	{
+		unsigned int firstPoint;
+		unsigned int pointCount;
+		unsigned int firstIndex;
+		unsigned int indexCount;
+		CMatrix4x4   worldMatrix;
+	};
+	std::vector<Polygon>      mPolygons;
+	std::vector<float>        mPointX;  // Points of all polygons, x and y in separate lists for TransformPoints
+	std::vector<float>        mPointY;
+	std::vector<CVector2>     mAreaUVs; // One for each point
+	std::vector<unsigned int> mIndices; // Triangles, indices are relative to the polygon's first point
+
+	// Points of the polygon being batched after transformation, kept to avoid reallocating
+	std::vector<float>         mProjectedX, mProjectedY, mProjectedZ, mProjectedW;
+	std::vector<PolygonVertex> mVertices;
+	PolygonStats               mStats;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Timings from BenchmarkPolygonRegions, times are the average for all the polygons
+struct PolygonBenchmark
+{
+	unsigned int polygons      = 0;
+	unsigned int points        = 0;     // Total points in all polygons
+	unsigned int triangles     = 0;     // Triangles from triangulation
+	double       triangulateMs = 0;     // Time to triangulate all polygons
+	double       batchMs       = 0;     // Time to transform and batch all polygons
+	bool         areasMatch    = false; // True if each polygon's triangles cover the same area as the polygon
+};
+
+// Time triangulating and batching the given number of star-shaped (concave) polygons with the given number of points each,
+// spread randomly (but the same each run) in a cube 400 units across around the given point. Each is repeated the given number of times
+PolygonBenchmark BenchmarkPolygonRegions(unsigned int polygons, unsigned int pointsPerPolygon, unsigned int repeats,
+                                         const CMatrix4x4& viewProjectionMatrix, const CVector3& centre);
+
+
+#endif //_POST_PROCESS_POLYGONS_H_INCLUDED_
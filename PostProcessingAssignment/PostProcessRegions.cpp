@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------
+// Copy-once area / polygon post-processing
+//--------------------------------------------------------------------------------------
+// Decides which parts of the output each area/polygon effect must snapshot before drawing.
+// See header file for details
+
+#include "PostProcessRegions.h"
+
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Rectangles
+//--------------------------------------------------------------------------------------
+
+// Return the overlapping part of two rectangles (empty if they don't overlap)
+PostProcessRect Intersect(const PostProcessRect& a, const PostProcessRect& b)
+{
+	PostProcessRect result;
+	result.left   = std::max(a.left,   b.left);
+	result.top    = std::max(a.top,    b.top);
+	result.right  = std::min(a.right,  b.right);
+	result.bottom = std::min(a.bottom, b.bottom);
+	if (result.Empty())  return {};
+	return result;
+}
+
+// Return true if two rectangles overlap
+bool Overlaps(const PostProcessRect& a, const PostProcessRect& b)
+{
+	return !Intersect(a, b).Empty();
+}
+
+// Return the rectangle grown by the given number of pixels on each side
+PostProcessRect Expand(const PostProcessRect& rect, int marginX, int marginY)
+{
+	return { rect.left - marginX, rect.top - marginY, rect.right + marginX, rect.bottom + marginY };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Planning
+//--------------------------------------------------------------------------------------
+
+// Plan a frame of effects in the order given, on a screen of the given size
+std::vector<RegionPass> PostProcessRegionPlanner::Plan(const std::vector<RegionEffect>& effects, unsigned int width, unsigned int height,
+                                                       unsigned int bytesPerPixel /*= 4*/)
+{
+	mStats = {};
+	const PostProcessRect screen = { 0, 0, static_cast<int>(width), static_cast<int>(height) };
+	const unsigned long long screenPixels = screen.Pixels();
+
+	// The output starts as a copy of the scene (read and write the whole screen)
+	mStats.bytes = 2 * screenPixels * bytesPerPixel;
+
+	// Footprints drawn so far - pixels in these no longer match the scene texture
+	std::vector<PostProcessRect> dirty;
+
+	std::vector<RegionPass> passes;
+	for (auto& effect : effects)
+	{
+		RegionPass pass = { Intersect(effect.footprint, screen), false, {} };
+		++mStats.effects;
+
+		// The chain's approach copies the whole screen for every effect, whether it is visible or not
+		mStats.copyEachBytes += 2 * (screenPixels + pass.footprint.Pixels()) * bytesPerPixel;
+
+		if (!pass.footprint.Empty())
+		{
+			// Pixels the effect reads - only pixels it draws count, so the read area comes from the clipped footprint
+			PostProcessRect readRect = Intersect(Expand(pass.footprint, effect.marginX, effect.marginY), screen);
+
+			// Snapshot if any of those pixels have been drawn over by earlier effects
+			for (auto& rect : dirty)
+			{
+				if (Overlaps(readRect, rect))
+				{
+					pass.snapshot = true;
+					pass.snapshotRect = readRect;
+					break;
+				}
+			}
+			if (pass.snapshot)
+			{
+				++mStats.snapshots;
+				mStats.snapshotPixels += readRect.Pixels();
+				mStats.bytes += 2 * readRect.Pixels() * bytesPerPixel;
+			}
+
+			++mStats.drawn;
+			mStats.effectPixels += pass.footprint.Pixels();
+			mStats.bytes += 2 * pass.footprint.Pixels() * bytesPerPixel;
+			dirty.push_back(pass.footprint);
+		}
+
+		passes.push_back(pass);
+	}
+
+	return passes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+static bool SameRect(const PostProcessRect& a, const PostProcessRect& b)
+{
+	return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+// Plan small frames of effects whose results are known and check the passes and stats
+PostProcessRegionsCheck CheckPostProcessRegions()
+{
+	PostProcessRegionsCheck result;
+	PostProcessRegionPlanner planner;
+	const unsigned int width = 200, height = 100;
+
+	// Effects side by side read pixels still holding the scene
+	auto passes = planner.Plan({ { { 10, 10, 50, 50 } }, { { 100, 10, 150, 50 } } }, width, height);
+	result.separate = passes.size() == 2 && !passes[0].snapshot && !passes[1].snapshot && passes[1].snapshotRect.Empty();
+
+	// The second effect reads pixels the first drew, so copies what it reads. Checked against the stats, all 4 bytes per pixel
+	// read and written: the scene copy, the snapshot and both footprints
+	passes = planner.Plan({ { { 10, 10, 60, 60 } }, { { 40, 40, 90, 90 } } }, width, height);
+	result.overlapping = passes.size() == 2 && !passes[0].snapshot && passes[1].snapshot && SameRect(passes[1].snapshotRect, { 40, 40, 90, 90 });
+	const RegionStats& stats = planner.Stats();
+	result.stats = stats.effects == 2 && stats.drawn == 2 && stats.snapshots == 1 && stats.snapshotPixels == 2500 &&
+	               stats.effectPixels == 5000 && stats.bytes == 8 * (20000ull + 2500 + 5000) &&
+	               stats.copyEachBytes == 8 * (2 * 20000ull + 5000) && stats.bytes < stats.copyEachBytes;
+
+	// Footprints 5 pixels apart only need a snapshot when the second effect reads more than 5 pixels outside its own
+	passes = planner.Plan({ { { 10, 10, 50, 50 } }, { { 55, 10, 95, 50 }, 5, 5 } }, width, height);
+	result.margin = passes.size() == 2 && !passes[1].snapshot;
+	passes = planner.Plan({ { { 10, 10, 50, 50 } }, { { 55, 10, 95, 50 }, 8, 8 } }, width, height);
+	result.margin = result.margin && passes.size() == 2 && passes[1].snapshot && SameRect(passes[1].snapshotRect, { 47, 2, 103, 58 });
+
+	// Off the edges, footprints are clipped and so are the rectangles read: the second effect's read rectangle stops short of the
+	// first's footprint, the third reads past the right edge over the second's
+	passes = planner.Plan({ { { -20, -10, 30, 40 } }, { { 35, 45, 250, 150 }, 3, 3 }, { { 190, 20, 230, 70 }, 5, 5 } }, width, height);
+	result.clipped = passes.size() == 3 && SameRect(passes[0].footprint, { 0, 0, 30, 40 }) && SameRect(passes[1].footprint, { 35, 45, 200, 100 }) &&
+	                 !passes[1].snapshot && passes[2].snapshot && SameRect(passes[2].snapshotRect, { 185, 15, 200, 75 });
+	passes = planner.Plan({ { { 150, 60, 250, 150 }, 10, 10 }, { { 120, 40, 170, 70 } } }, width, height);
+	result.clipped = result.clipped && passes.size() == 2 && passes[1].snapshot && SameRect(passes[1].snapshotRect, { 120, 40, 170, 70 });
+
+	// Effects of no size or wholly off screen draw nothing, so don't stop later effects reading the scene
+	passes = planner.Plan({ { { 50, 50, 50, 80 } }, { { 300, 0, 400, 50 }, 20, 20 }, { { -60, 20, -10, 80 } }, { { 40, 40, 60, 90 }, 30, 30 } }, width, height);
+	result.empty = passes.size() == 4 && passes[0].footprint.Empty() && passes[1].footprint.Empty() && passes[2].footprint.Empty() &&
+	               !passes[0].snapshot && !passes[1].snapshot && !passes[2].snapshot && !passes[3].snapshot &&
+	               planner.Stats().drawn == 1 && planner.Stats().effects == 4 && planner.Stats().bytes == 8 * (20000ull + 1000);
+
+	// A frame like the scene's: five effects over the same quarter of a 720p screen, the pixelation reading a margin
+	std::vector<RegionEffect> frame(5, { { 320, 180, 960, 540 }, 0, 0 });
+	frame[2].marginX = 1280 / 144 + 1;
+	frame[2].marginY = 720  / 81  + 1;
+	planner.Plan(frame, 1280, 720);
+	result.bytes         = planner.Stats().bytes;
+	result.copyEachBytes = planner.Stats().copyEachBytes;
+
+	result.passed = result.separate && result.overlapping && result.margin && result.clipped && result.empty && result.stats &&
+	                result.bytes < result.copyEachBytes;
+	return result;
+}
@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// Copy-once area / polygon post-processing
+//--------------------------------------------------------------------------------------
+// Area and polygon post-processes only change part of the screen. Run through the chain, every
+// effect first copies the entire screen then draws its area, so N effects cost N full-screen copies.
+//
+// Instead, the scene is copied to the output once per frame and each effect only draws over its
+// own footprint (its rectangle on screen). An effect can't read the texture it is writing, so:
+// - If nothing has been drawn yet where the effect reads, it reads the original scene texture
+// - Otherwise the part of the output it reads is first copied ("snapshotted") to another texture
+//   and the effect reads that. Only the rectangle read is copied, not the whole screen
+// Effects that read neighbouring pixels (e.g. blurs) read outside their footprint, so they
+// give a margin that is added to the footprint when deciding what they read.
+//
+// This file is plain C++ with no DirectX: it decides what to copy, the caller does the copying
+
+#ifndef _POST_PROCESS_REGIONS_H_INCLUDED_
+#define _POST_PROCESS_REGIONS_H_INCLUDED_
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Rectangles
+//--------------------------------------------------------------------------------------
+
+// Rectangle in pixels. Right and bottom are exclusive, so width = right - left
+struct PostProcessRect
+{
+	int left   = 0;
+	int top    = 0;
+	int right  = 0;
+	int bottom = 0;
+
+	int  Width()  const { return right - left; }
+	int  Height() const { return bottom - top; }
+	bool Empty()  const { return right <= left || bottom <= top; }
+	unsigned long long Pixels() const { return Empty() ? 0 : static_cast<unsigned long long>(Width()) * Height(); }
+};
+
+// Return the overlapping part of two rectangles (empty if they don't overlap)
+PostProcessRect Intersect(const PostProcessRect& a, const PostProcessRect& b);
+
+// Return true if two rectangles overlap
+bool Overlaps(const PostProcessRect& a, const PostProcessRect& b);
+
+// Return the rectangle grown by the given number of pixels on each side
+PostProcessRect Expand(const PostProcessRect& rect, int marginX, int marginY);
+
+
+//--------------------------------------------------------------------------------------
+// Planning
+//--------------------------------------------------------------------------------------
+
+// An area/polygon effect pass to plan
+struct RegionEffect
+{
+	PostProcessRect footprint;   // Pixels the effect may write
+	int             marginX = 0; // How far outside the footprint the effect reads, in pixels (0 for per-pixel effects)
+	int             marginY = 0;
+};
+
+// What to do for each effect pass
+struct RegionPass
+{
+	PostProcessRect footprint;            // Footprint clipped to the screen, nothing to draw if empty
+	bool            snapshot = false;     // If true, copy snapshotRect from the output to the snapshot texture and read that,
+	PostProcessRect snapshotRect = {};    // otherwise read the original scene texture (snapshotRect is then empty)
+};
+
+// Counters from planning a frame, bytes use the bytes per pixel given to Plan
+struct RegionStats
+{
+	unsigned int       effects        = 0; // Number of effect passes planned
+	unsigned int       drawn          = 0; // Number with something on screen to draw
+	unsigned int       snapshots      = 0; // Number of snapshots needed
+	unsigned long long snapshotPixels = 0; // Total size of the snapshots
+	unsigned long long effectPixels   = 0; // Total size of the footprints drawn
+
+	unsigned long long bytes          = 0; // Estimated memory traffic: one full-screen copy, snapshot copies and footprint draws
+	unsigned long long copyEachBytes  = 0; // The same estimate if each effect copied the whole screen first (the chain's approach)
+};
+
+
+class PostProcessRegionPlanner
+{
+public:
+	// Plan a frame of effects in the order given, on a screen of the given size. The output is expected to start as a
+	// copy of the scene. A pixel read and written counts bytesPerPixel each in the stats (4 for RGBA8 textures)
+	std::vector<RegionPass> Plan(const std::vector<RegionEffect>& effects, unsigned int width, unsigned int height,
+	                             unsigned int bytesPerPixel = 4);
+
+	// Statistics from the most recent call to Plan
+	const RegionStats& Stats() const { return mStats; }
+
+private:
+	RegionStats mStats;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckPostProcessRegions
+struct PostProcessRegionsCheck
+{
+	bool separate    = false; // True if effects that don't overlap all read the scene
+	bool overlapping = false; // True if an effect over an earlier one snapshotted just the rectangle it reads
+	bool margin      = false; // True if an effect next to an earlier one snapshotted only when its read margin reached it
+	bool clipped     = false; // True if footprints and read rectangles off the edge of the screen were clipped to it
+	bool empty       = false; // True if effects with nothing on screen were given nothing to draw and no snapshot
+	bool stats       = false; // True if the counters and traffic estimates matched the passes planned
+
+	// Estimated memory traffic of a frame of area effects at 720p, copying once against copying for every effect
+	unsigned long long bytes         = 0;
+	unsigned long long copyEachBytes = 0;
+
+	bool passed = false; // True if all of the above, and copying once used less traffic
+};
+
+// Plan small frames of effects whose results are known and check the passes and stats
+PostProcessRegionsCheck CheckPostProcessRegions();
+
+
+#endif //_POST_PROCESS_REGIONS_H_INCLUDED_
@@ -0,0 +1,376 @@
+//--------------------------------------------------------------------------------------
+// Tiled multi-threaded CPU post-processing
+//--------------------------------------------------------------------------------------
+// See header file for details
+
+#include "PostProcessTiles.h"
+#include "PostProcessGaussian.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+
+// Return the pass whose output the given pass reads as its scene texture, ChainSource for the chain source
+static int SceneInput(const std::vector<CPUChainPass>& passes, unsigned int pass)
+{
+	return (passes[pass].sceneInput == CPUChainPass::PreviousPass) ? static_cast<int>(pass) - 1 : passes[pass].sceneInput;
+}
+
+// Return true if every pass only reads the chain source or passes before it
+static bool InputsValid(const std::vector<CPUChainPass>& passes)
+{
+	for (unsigned int pass = 0; pass < passes.size(); ++pass)
+	{
+		int scene = SceneInput(passes, pass);
+		if (scene < CPUChainPass::ChainSource || scene >= static_cast<int>(pass))  return false;
+
+		int add = passes[pass].addInput;
+		if (passes[pass].effect == CPUEffect::Bloom && (add < CPUChainPass::ChainSource || add >= static_cast<int>(pass)))  return false;
+	}
+	return true;
+}
+
+// Return an image size at a level (power of two below full size)
+static unsigned int LevelSize(unsigned int size, unsigned int level)
+{
+	return std::max(size >> level, 1u);
+}
+
+// Return the texture maps for a pass, with the add texture for bloom passes. Outputs holds the output of each pass
+static CPUPostProcessTextures PassTextures(const CPUPostProcessTextures& textures, const CPUChainPass& pass,
+                                           const ImageRGBA& source, const std::vector<ImageRGBA>& outputs)
+{
+	CPUPostProcessTextures passTextures = textures;
+	if (pass.effect == CPUEffect::Bloom)  passTextures.addTexture = (pass.addInput < 0) ? &source : &outputs[pass.addInput];
+	return passTextures;
+}
+
+// Return a tile holding part of an image
+static CPUOutputTile ImageTile(ImageRGBA& image, const PostProcessRect& rect)
+{
+	CPUOutputTile tile = WholeImageTile(image);
+	tile.pixels += rect.top * image.Width() + rect.left;
+	tile.rect    = rect;
+	return tile;
+}
+
+
+// Run one pass writing the output tile. Pixels of the tile outside the pass's area (and under it when blending) start as the
+// scene input, or black if the scene input is a different size
+static void RunPass(const CPUChainPass& pass, const CPUPostProcessTextures& textures, const CPUSourceTile& source,
+                    const CPUOutputTile& output, CPUKernel kernel)
+{
+	const PostProcessRect& rect = output.rect;
+	PostProcessRect area = Intersect(CPUEffectArea(pass.constants, output.frameWidth, output.frameHeight), rect);
+	bool coversTile = area.left == rect.left && area.top == rect.top && area.right == rect.right && area.bottom == rect.bottom;
+	if (pass.alphaBlend || !coversTile)
+	{
+		bool sameSize = source.frameWidth == output.frameWidth && source.frameHeight == output.frameHeight;
+		for (int y = rect.top; y < rect.bottom; ++y)
+		{
+			ColourRGBA* row = output.pixels + (y - rect.top) * output.stride;
+			if (sameSize)
+			{
+				const ColourRGBA* sourceRow = source.pixels + (y - source.rect.top) * source.stride + (rect.left - source.rect.left);
+				std::copy(sourceRow, sourceRow + rect.Width(), row);
+			}
+			else
+			{
+				std::fill(row, row + rect.Width(), ColourRGBA(0, 0, 0, 1));
+			}
+		}
+	}
+	CPUPostProcessTile(pass.effect, pass.constants, textures, source, output, pass.alphaBlend, kernel);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Chains
+//--------------------------------------------------------------------------------------
+
+// Run a chain of passes one after another on whole images on the calling thread. See header for details
+bool RunCPUChain(const std::vector<CPUChainPass>& passes, const CPUPostProcessTextures& textures, const ImageRGBA& source,
+                 ImageRGBA& output, CPUKernel kernel /*= BestCPUKernel()*/)
+{
+	if (!InputsValid(passes))  return false;
+	if (passes.empty())
+	{
+		output = source;
+		return true;
+	}
+
+	std::vector<ImageRGBA> outputs(passes.size());
+	for (unsigned int pass = 0; pass < passes.size(); ++pass)
+	{
+		int scene = SceneInput(passes, pass);
+		const ImageRGBA& input = (scene < 0) ? source : outputs[scene];
+
+		unsigned int width  = LevelSize(source.Width(),  passes[pass].level);
+		unsigned int height = LevelSize(source.Height(), passes[pass].level);
+		ImageRGBA& passOutput = (pass == passes.size() - 1) ? output : outputs[pass];
+		if (passOutput.Width() != width || passOutput.Height() != height)  passOutput = ImageRGBA(width, height);
+
+		RunPass(passes[pass], PassTextures(textures, passes[pass], source, outputs), WholeImageTile(input), WholeImageTile(passOutput), kernel);
+	}
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Tiled chains
+//--------------------------------------------------------------------------------------
+
+// Group the passes of a chain into stages. See header for details
+CPUTilePlan PlanCPUTiles(const std::vector<CPUChainPass>& passes, unsigned int width, unsigned int height, const CPUTileSettings& settings)
+{
+	CPUTilePlan plan;
+	plan.passMarginX.resize(passes.size());
+	plan.passMarginY.resize(passes.size());
+
+	// Outputs read by anything other than the next pass must be finished for the whole frame before they are read
+	std::vector<bool> readLater(passes.size(), false);
+	for (unsigned int pass = 0; pass < passes.size(); ++pass)
+	{
+		int scene = SceneInput(passes, pass);
+		if (scene >= 0 && scene != static_cast<int>(pass) - 1)  readLater[scene] = true;
+		if (passes[pass].effect == CPUEffect::Bloom && passes[pass].addInput >= 0)  readLater[passes[pass].addInput] = true;
+	}
+
+	for (unsigned int pass = 0; pass < passes.size(); ++pass)
+	{
+		// Margins are in pixels of the scene input
+		int scene = SceneInput(passes, pass);
+		unsigned int inputLevel = (scene < 0) ? 0 : passes[scene].level;
+		int& marginX = plan.passMarginX[pass];
+		int& marginY = plan.passMarginY[pass];
+		bool bounded = CPUEffectMargin(passes[pass].effect, passes[pass].constants,
+		                               LevelSize(width, inputLevel), LevelSize(height, inputLevel), marginX, marginY);
+
+		// Add the pass to the current stage if it can work on the tiles of the pass before
+		if (!plan.stages.empty() && bounded && scene == static_cast<int>(pass) - 1 && !readLater[scene] &&
+		    passes[pass].level == passes[scene].level)
+		{
+			CPUTileStage& stage = plan.stages.back();
+			if (stage.marginX + marginX <= settings.maxMargin && stage.marginY + marginY <= settings.maxMargin)
+			{
+				++stage.numPasses;
+				stage.marginX += marginX;
+				stage.marginY += marginY;
+				continue;
+			}
+		}
+
+		CPUTileStage stage;
+		stage.firstPass = pass;
+		stage.numPasses = 1;
+		plan.stages.push_back(stage);
+	}
+	return plan;
+}
+
+
+// Executor with the given number of threads including the calling thread, 0 for one per hardware thread
+CPUTileExecutor::CPUTileExecutor(unsigned int numThreads /*= 0*/)
+	: mPool(numThreads)
+{
+	mScratch.resize(mPool.NumThreads() * 2);
+}
+
+
+// Run a chain in tiles. See header for details
+bool CPUTileExecutor::Run(const std::vector<CPUChainPass>& passes, const CPUPostProcessTextures& textures, const ImageRGBA& source,
+                          ImageRGBA& output, const CPUTileSettings& settings /*= {}*/, CPUTileStats* stats /*= nullptr*/)
+{
+	if (!InputsValid(passes))  return false;
+	if (passes.empty())
+	{
+		output = source;
+		return true;
+	}
+
+	CPUTilePlan plan = PlanCPUTiles(passes, source.Width(), source.Height(), settings);
+	const int tileSize = static_cast<int>(std::max(settings.tileSize, 1u));
+	unsigned long long stealsBefore = mPool.Steals();
+	std::atomic<unsigned long long> pixels{ 0 }, marginPixels{ 0 };
+	unsigned int tiles = 0;
+
+	mOutputs.resize(passes.size());
+	for (auto& stage : plan.stages)
+	{
+		const unsigned int lastPass = stage.firstPass + stage.numPasses - 1;
+		const int width  = static_cast<int>(LevelSize(source.Width(),  passes[lastPass].level));
+		const int height = static_cast<int>(LevelSize(source.Height(), passes[lastPass].level));
+		ImageRGBA& stageOutput = (lastPass == passes.size() - 1) ? output : mOutputs[lastPass];
+		if (stageOutput.Width() != static_cast<unsigned int>(width) || stageOutput.Height() != static_cast<unsigned int>(height))
+		{
+			stageOutput = ImageRGBA(width, height);
+		}
+
+		int scene = SceneInput(passes, stage.firstPass);
+		const ImageRGBA& stageInput = (scene < 0) ? source : mOutputs[scene];
+
+		// Scratch buffers hold a tile and its margin for the passes before the last
+		size_t scratchSize = static_cast<size_t>(tileSize + 2 * stage.marginX) * (tileSize + 2 * stage.marginY);
+		for (auto& scratch : mScratch)  if (scratch.size() < scratchSize)  scratch.resize(scratchSize);
+
+		const int tilesX = (width  + tileSize - 1) / tileSize;
+		const int tilesY = (height + tileSize - 1) / tileSize;
+		tiles += tilesX * tilesY;
+		mPool.ParallelFor(tilesX * tilesY, [&](unsigned int tile, unsigned int thread)
+		{
+			PostProcessRect frame;
+			frame.right  = width;
+			frame.bottom = height;
+			PostProcessRect tileRect;
+			tileRect.left   = (tile % tilesX) * tileSize;
+			tileRect.top    = (tile / tilesX) * tileSize;
+			tileRect.right  = std::min(tileRect.left + tileSize, width);
+			tileRect.bottom = std::min(tileRect.top  + tileSize, height);
+
+			// Each pass writes the tile grown by the margins of the passes after it in the stage
+			std::vector<PostProcessRect> regions(stage.numPasses);
+			regions.back() = tileRect;
+			for (unsigned int i = stage.numPasses - 1; i > 0; --i)
+			{
+				unsigned int pass = stage.firstPass + i;
+				regions[i - 1] = Intersect(Expand(regions[i], plan.passMarginX[pass], plan.passMarginY[pass]), frame);
+			}
+
+			CPUSourceTile passSource = WholeImageTile(stageInput);
+			unsigned long long tilePixels = 0;
+			for (unsigned int i = 0; i < stage.numPasses; ++i)
+			{
+				const CPUChainPass& pass = passes[stage.firstPass + i];
+
+				// The last pass writes the stage output, the others alternate between this thread's scratch buffers
+				CPUOutputTile passOutput;
+				if (i == stage.numPasses - 1)
+				{
+					passOutput = ImageTile(stageOutput, tileRect);
+				}
+				else
+				{
+					passOutput.pixels      = mScratch[thread * 2 + i % 2].data();
+					passOutput.stride      = regions[i].Width();
+					passOutput.rect        = regions[i];
+					passOutput.frameWidth  = width;
+					passOutput.frameHeight = height;
+				}
+				RunPass(pass, PassTextures(textures, pass, source, mOutputs), passSource, passOutput, settings.kernel);
+				tilePixels += regions[i].Pixels();
+
+				passSource.pixels      = passOutput.pixels;
+				passSource.stride      = passOutput.stride;
+				passSource.rect        = passOutput.rect;
+				passSource.frameWidth  = passOutput.frameWidth;
+				passSource.frameHeight = passOutput.frameHeight;
+			}
+			pixels += tilePixels;
+			marginPixels += tilePixels - tileRect.Pixels() * stage.numPasses;
+		});
+	}
+
+	if (stats)
+	{
+		stats->stages       = static_cast<unsigned int>(plan.stages.size());
+		stats->tiles        = tiles;
+		stats->pixels       = pixels;
+		stats->marginPixels = marginPixels;
+		stats->steals       = mPool.Steals() - stealsBefore;
+	}
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Time a typical chain untiled and in tiles on an increasing number of threads. See header for details
+CPUTileBenchmark BenchmarkCPUTiles(unsigned int width, unsigned int height, unsigned int repeats)
+{
+	CPUTileBenchmark result;
+	result.width  = width;
+	result.height = height;
+
+	// Random scene and noise, the same each run
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> channel(0.0f, 1.0f);
+	ImageRGBA source(width, height), noiseMap(256, 256);
+	for (unsigned int i = 0; i < width * height; ++i)  source.Data()[i]   = { channel(random), channel(random), channel(random), 1 };
+	for (unsigned int i = 0; i < 256 * 256; ++i)       noiseMap.Data()[i] = { channel(random), channel(random), channel(random), 1 };
+	CPUPostProcessTextures textures;
+	textures.noiseMap = &noiseMap;
+
+	// Tint, gaussian blur and grey noise over the middle of the screen are pipelined in one stage. At large sizes the retro effect
+	// reads too far from each pixel to join them so starts a new stage, with the final tint
+	auto pass = [](CPUEffect effect)
+	{
+		CPUChainPass chainPass;
+		chainPass.effect = effect;
+		PostProcessingConstants& c = chainPass.constants;
+		c.area2DTopLeft = { 0, 0 };
+		c.area2DSize    = { 1, 1 };
+		c.tintColour1   = { 1, 0.8f, 0.6f };
+		c.tintColour2   = { 0.6f, 0.8f, 1 };
+		c.noiseScale    = { 4, 3 };
+		c.noiseOffset   = { 0.3f, 0.7f };
+		return chainPass;
+	};
+	GaussianBlurPlan gaussian = PlanGaussianBlur(3.0f, MAX_GAUSSIAN_TAPS, 0);
+	auto gaussianPass = [&](bool horizontal)
+	{
+		CPUChainPass chainPass = pass(CPUEffect::Gaussian);
+		chainPass.constants.horizontalBlur   = horizontal;
+		chainPass.constants.gaussianTapCount = static_cast<unsigned int>(gaussian.taps.size());
+		for (unsigned int i = 0; i < gaussian.taps.size(); ++i)
+		{
+			chainPass.constants.gaussianTaps[i][0] = gaussian.taps[i].offset;
+			chainPass.constants.gaussianTaps[i][1] = gaussian.taps[i].weight;
+		}
+		return chainPass;
+	};
+	CPUChainPass noise = pass(CPUEffect::GreyNoise);
+	noise.constants.area2DTopLeft = { 0.25f, 0.25f };
+	noise.constants.area2DSize    = { 0.5f, 0.5f };
+	noise.alphaBlend = true;
+	std::vector<CPUChainPass> passes = { pass(CPUEffect::Tint), gaussianPass(true), gaussianPass(false), noise,
+	                                     pass(CPUEffect::Retro), pass(CPUEffect::Tint) };
+
+	auto millisecondsSince = [](std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	ImageRGBA reference;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat)  RunCPUChain(passes, textures, source, reference);
+	result.untiledMs = millisecondsSince(start) / repeats;
+
+	unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)  result.threads.push_back(threads);
+	result.threads.push_back(maxThreads);
+
+	result.match = true;
+	for (unsigned int threads : result.threads)
+	{
+		CPUTileExecutor executor(threads);
+		ImageRGBA output;
+		CPUTileStats stats;
+		executor.Run(passes, textures, source, output, {}, &stats); // Warm up, and creates the intermediate images
+		result.stages = stats.stages;
+		result.match = result.match && MaxColourDifference(output, reference) == 0;
+
+		start = std::chrono::steady_clock::now();
+		for (unsigned int repeat = 0; repeat < repeats; ++repeat)  executor.Run(passes, textures, source, output);
+		result.tiledMs.push_back(millisecondsSince(start) / repeats);
+		result.speedup.push_back(result.tiledMs.front() / result.tiledMs.back());
+	}
+	return result;
+}
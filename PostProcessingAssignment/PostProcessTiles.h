@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------------------
+// Tiled multi-threaded CPU post-processing
+//--------------------------------------------------------------------------------------
+// Runs a chain of CPU post-processes (see PostProcessCPU.h) over several threads. Each pass is
+// split into square tiles, small enough to stay in the CPU's L2 cache, and the tiles are run on a
+// work-stealing thread pool (see ThreadPool.h).
+//
+// Passes are grouped into stages. Within a stage each tile is taken through every pass before the
+// next tile is started, so the pixels stay in cache from one effect to the next instead of each pass
+// streaming the whole frame through memory. A pass that reads neighbouring pixels (e.g. a gaussian
+// blur) needs the previous pass for a margin ("halo") around its tile, so the earlier passes of the
+// stage work on the tile grown by the margins of the passes after them. Neighbouring tiles compute
+// the overlaps twice, so a pass with a large margin starts a new stage instead, which waits for
+// every tile of the previous stage to finish. Passes that change size or read the output of
+// anything but the pass before also start a new stage.
+//
+// Plain C++ with no DirectX
+
+#ifndef _POST_PROCESS_TILES_H_INCLUDED_
+#define _POST_PROCESS_TILES_H_INCLUDED_
+
+#include "PostProcessCPU.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Chains
+//--------------------------------------------------------------------------------------
+
+// One pass of a CPU post-process chain
+struct CPUChainPass
+{
+	static const int ChainSource  = -1; // Input meaning the image the chain started from
+	static const int PreviousPass = -2; // Input meaning the output of the pass before (the chain source for the first pass)
+
+	CPUEffect               effect     = CPUEffect::Tint;
+	PostProcessingConstants constants  = {};
+	bool                    alphaBlend = false;        // Blend the effect over its scene input using its alpha, as area effects are drawn
+	unsigned int            level      = 0;            // Output size as a power of two below the chain source (0 = full, 1 = half...)
+	int                     sceneInput = PreviousPass; // Pass whose output is the scene texture
+	int                     addInput   = ChainSource;  // Pass whose output is the add texture, only used by bloom passes
+};
+
+// Run a chain of passes one after another on whole images on the calling thread, the simplest way. Pixels outside a pass's area
+// keep the colour of its scene input. Returns false if a pass reads a pass that is not before it
+bool RunCPUChain(const std::vector<CPUChainPass>& passes, const CPUPostProcessTextures& textures, const ImageRGBA& source,
+                 ImageRGBA& output, CPUKernel kernel = BestCPUKernel());
+
+
+//--------------------------------------------------------------------------------------
+// Tiled chains
+//--------------------------------------------------------------------------------------
+
+// Settings for running a chain in tiles
+struct CPUTileSettings
+{
+	unsigned int tileSize  = 128; // Width and height of each tile. A 128x128 tile of float colours is 256KB
+	int          maxMargin = 32;  // Largest total margin (in pixels) computed around a tile by the passes of one stage
+	CPUKernel    kernel    = BestCPUKernel();
+};
+
+
+// A group of passes run one tile at a time
+struct CPUTileStage
+{
+	unsigned int firstPass = 0;
+	unsigned int numPasses = 0;
+	int          marginX   = 0; // Total margin the first pass of the stage computes around each tile
+	int          marginY   = 0;
+};
+
+// How a chain will be run in tiles
+struct CPUTilePlan
+{
+	std::vector<CPUTileStage> stages;
+	std::vector<int>          passMarginX; // How far each pass reads around the pixel it writes
+	std::vector<int>          passMarginY;
+};
+
+// Group the passes of a chain into stages for a chain source of the given size
+CPUTilePlan PlanCPUTiles(const std::vector<CPUChainPass>& passes, unsigned int width, unsigned int height, const CPUTileSettings& settings);
+
+
+// Counters from a tiled run
+struct CPUTileStats
+{
+	unsigned int       stages       = 0;
+	unsigned int       tiles        = 0; // Tiles run, summed over stages
+	unsigned long long pixels       = 0; // Pixels written by all passes
+	unsigned long long marginPixels = 0; // Of those, pixels written in the margins around tiles, which other tiles write too
+	unsigned long long steals       = 0; // Tiles one thread took from another's share
+};
+
+
+// Runs chains in tiles on a pool of threads. Keeps its threads and intermediate images between runs
+class CPUTileExecutor
+{
+public:
+	// Executor with the given number of threads including the calling thread, 0 for one per hardware thread
+	explicit CPUTileExecutor(unsigned int numThreads = 0);
+
+	// Run a chain, giving the same result as RunCPUChain. The output must not be the source. Fills in the stats if given.
+	// Returns false if a pass reads a pass that is not before it
+	bool Run(const std::vector<CPUChainPass>& passes, const CPUPostProcessTextures& textures, const ImageRGBA& source,
+	         ImageRGBA& output, const CPUTileSettings& settings = {}, CPUTileStats* stats = nullptr);
+
+	unsigned int NumThreads() const { return mPool.NumThreads(); }
+
+private:
+	ThreadPool                           mPool;
+	std::vector<ImageRGBA>               mOutputs; // Output of the last pass of each stage, except the final one which is the chain output
+	std::vector<std::vector<ColourRGBA>> mScratch; // Two buffers per thread for the passes within a stage
+};
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Results of BenchmarkCPUTiles, times are the average of all repeats
+struct CPUTileBenchmark
+{
+	unsigned int width  = 0;
+	unsigned int height = 0;
+	unsigned int stages = 0;
+
+	double untiledMs = 0; // RunCPUChain, one thread
+
+	std::vector<unsigned int> threads;  // Thread counts tested, from 1 up to the number of hardware threads
+	std::vector<double>       tiledMs;  // Time for each thread count
+	std::vector<double>       speedup;  // Against the tiled chain on one thread
+
+	bool match = false; // True if every tiled run gave exactly the same image as RunCPUChain
+};
+
+// Time a typical chain (tint, two-pass gaussian blur, grey noise area, retro, tint) on a random image of the given size, untiled
+// and in tiles on an increasing number of threads
+CPUTileBenchmark BenchmarkCPUTiles(unsigned int width, unsigned int height, unsigned int repeats);
+
+
+#endif //_POST_PROCESS_TILES_H_INCLUDED_
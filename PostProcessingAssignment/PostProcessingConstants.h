@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// Post-processing settings
+//--------------------------------------------------------------------------------------
+// The constant buffer structure for post-processes. Kept separate from Common.h because it
+// has no DirectX content, so CPU versions of the post-processes can use the same settings
+
+#ifndef _POST_PROCESSING_CONSTANTS_H_INCLUDED_
+#define _POST_PROCESSING_CONSTANTS_H_INCLUDED_
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CVector4.h"
+
+
+// Maximum number of per-pixel effects that can be combined into a single fused pass (see Fused_pp.hlsl)
+const unsigned int MAX_FUSED_EFFECTS = 8;
+
+// Per-pixel effects understood by the fused post-process. Values must match the constants in Common.hlsli
+enum class FusedEffect : unsigned int
+{
+	None      = 0,
+	Tint      = 1,
+	Retro     = 2, // Must be the first effect in a fused pass as it changes where the source texture is sampled
+	GreyNoise = 3,
+};
+
+
+// Maximum number of samples each side of the centre (including the centre) taken by one pass of the gaussian blur (see GaussianBlur_pp.hlsl)
+const unsigned int MAX_GAUSSIAN_TAPS = 16;
+
+// Fixed effect settings that are not in the constant buffer - must match Common.hlsli
+const CVector2 RETRO_PIXEL_SIZE   = { 144.0f, 81.0f };
+const CVector3 RETRO_COLOUR_DEPTH = { 32.0f, 64.0f, 32.0f };
+const float    NOISE_STRENGTH     = 0.5f;
+const float    NOISE_SOFT_EDGE    = 0.20f;
+
+// Maximum number of area post-processes drawn by a single instanced draw call (see 2DQuadInstanced_pp.hlsl)
+const unsigned int MAX_AREA_INSTANCES = 1024;
+
+
+// Placement on screen of one instance of an area post-process - must match the AreaInstance structure in Common.hlsli
+struct AreaInstance
+{
+	CVector2 area2DTopLeft; // As area2DTopLeft, area2DSize and area2DDepth in the constants below, for this instance
+	CVector2 area2DSize;
+	float    area2DDepth;
+	CVector3 padding;
+};
+
+// Placements of instanced area post-processes - must match the AreaInstanceConstants buffer in Common.hlsli
+struct AreaInstanceConstants
+{
+	AreaInstance areaInstances[MAX_AREA_INSTANCES];
+};
+
+
+// Settings used by post-processes - must match the similar structure in the Common.hlsli shader file
+struct PostProcessingConstants
+{
+	CVector2 area2DTopLeft; // Top-left of post-process area on screen, provided as coordinate from 0.0->1.0 not as a pixel coordinate
+	CVector2 area2DSize;    // Size of post-process area on screen, provided as sizes from 0.0->1.0 (1 = full screen) not as a size in pixels
+	float    area2DDepth;   // Depth buffer value for area (0.0 nearest to 1.0 furthest). Full screen post-processing uses 0.0f
+	CVector3 paddingA;      // Pad things to collections of 4 floats (see notes in earlier labs to read about padding)
+
+	// Tint post-process settings
+	CVector3 tintColour1;
+	float	 paddingB;
+	CVector3 tintColour2;
+	float    paddingC;
+
+	// Grey noise post-process settings
+    CVector2 noiseScale;
+	CVector2 noiseOffset;
+
+	// Burn post-process settings
+	float    burnHeight;
+	CVector3 paddingD;
+
+	// Distort post-process settings
+	float    distortLevel;
+	CVector3 paddingE;
+
+	// Spiral post-process settings
+	float    spiralLevel;
+	CVector3 paddingF;
+
+	// Heat haze post-process settings
+	float    heatHazeTimer;
+	CVector3 paddingG;
+
+	bool	 horizontalBlur;
+
+	// Fused post-process settings. Bools are 4 bytes in shaders so these line up with the HLSL after the bool above
+	unsigned int fusedEffectCount;                     // Number of effects in the fusedEffects list
+	unsigned int fusedAreaBlend;                       // Non-zero to fade each effect by its alpha, as alpha blending does for unfused area effects
+	float        paddingH;
+	unsigned int fusedEffects[MAX_FUSED_EFFECTS];      // FusedEffect values, applied in order
+
+	// Gaussian blur settings (see PostProcessGaussian.h)
+	unsigned int gaussianTapCount;                     // Number of taps below, the first is the centre
+	CVector3     paddingI;
+	float        gaussianTaps[MAX_GAUSSIAN_TAPS][2];   // Offset in texels and weight of each tap, taps are mirrored either side of the centre
+
+	// Bloom settings (see PostProcessBloom.h)
+	unsigned int bloomStage;                           // BloomPass value, which stage of the bloom the pass is
+	float        bloomThreshold;
+	float        bloomKnee;
+	float        bloomIntensity;                       // Already divided by the number of levels
+};
+
+
+#endif //_POST_PROCESSING_CONSTANTS_H_INCLUDED_
@@ -5,12 +5,10 @@ SamplerState PointSample  : register(s0);
 
 float4 main(PostProcessingInput input) : SV_Target
 {
-	float2 pixelSize = float2(144.0f, 81.0f);
-	float3 colourDepth = float3(32.0f, 64.0f, 32.0f);
-
-	float2 uv = floor(input.sceneUV * pixelSize) / pixelSize;
+	// Pixel size and colour depth are in Common.hlsli as the fused post-process uses them too
+	float2 uv = floor(input.sceneUV * gRetroPixelSize) / gRetroPixelSize;
 	float3 colour = SceneTexture.Sample(PointSample, uv).rgb;
-	colour = floor(colour * colourDepth) / colourDepth;
+	colour = floor(colour * gRetroColourDepth) / gRetroColourDepth;
 
 	// Got the RGB from the scene texture
 	return float4(colour, 1.0f);
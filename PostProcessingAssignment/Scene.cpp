@@ -5,23 +5,37 @@
 
 #include "Scene.h"
 #include "Mesh.h"
+#include "GeometryPool.h"
+#include "AssetLoader.h"
 #include "Model.h"
 #include "Camera.h"
 #include "State.h"
 #include "Shader.h"
 #include "Input.h"
 #include "Common.h"
+#include "PostProcessChain.h"
+#include "PostProcessFusion.h"
+#include "PostProcessRegions.h"
+#include "PostProcessInstances.h"
+#include "PostProcessPolygons.h"
+#include "PostProcessGaussian.h"
+#include "PostProcessBloom.h"
+#include "ColourConversion.h"
 
 #include "CVector2.h" 
 #include "CVector3.h" 
 #include "CMatrix4x4.h"
+#include "FastTrig.h"
 #include "MathHelpers.h"     // Helper functions for maths
 #include "GraphicsHelpers.h" // Helper functions to unclutter the code here
 #include "ColourRGBA.h" 
 
 #include <array>
+#include <chrono>
 #include <sstream>
 #include <memory>
+#include <algorithm>
+#include <iterator>
 
 
 //--------------------------------------------------------------------------------------
@@ -39,7 +53,11 @@ enum class PostProcess
 	Blur,
 	Retro,
 	Gaussian,
+	GreyNoise,
+	Bloom,
 
+	Fused,    // Several per-pixel post-processes in one pass, chosen by the post-processing chain - not selected directly
+	Resample, // Resize to the render target with bilinear filtering, used by the passes of a downsampled gaussian blur - not selected directly
 };
 
 std::vector<PostProcess> gPostProcesses = {};
@@ -54,6 +72,43 @@ enum class PostProcessMode
 auto gCurrentPostProcess     = PostProcess::None;
 auto gCurrentPostProcessMode = PostProcessMode::Fullscreen;
 
+// Runs the selected post-processes one after another (see PostProcessChain.h)
+PostProcessChain gPostProcessChain;
+
+// In area and polygon modes, copy the scene to the back buffer once then draw each effect over just its area, rather
+// than a full-screen copy per effect (see PostProcessRegions.h). Press 'c' to toggle
+bool gCopyOnceRegions = true;
+bool gRegionsUsed = false; // True if the last frame used the planner, so its memory traffic is shown in the window title
+PostProcessRegionPlanner gRegionPlanner;
+
+// Where area post-processes are placed. Area effects are centred on the first light
+const CVector2 gAreaEffectSize = { 10, 10 }; // Size of area effects in world units
+// In area mode each post-process can instead be drawn over many areas with a single instanced draw call (see PostProcessInstances.h).
+// The first areas are over the lights, the rest are a grid over the ground to show many at once. Press 'i' to toggle
+bool gInstancedAreas = false;
+AreaEffectList    gAreaEffects;
+AreaEffectBatcher gAreaEffectBatcher;
+std::string       gStartupTimes;    // Time taken by each stage of InitGeometry, shown in the window title
+
+// Size of the gaussian blur (sigma, in pixels) and the passes used for it (see PostProcessGaussian.h). Larger blurs are done on a
+// smaller copy of the scene in full-screen mode. Area and polygon modes blur at full size, a smaller copy would blur pixels outside
+// the area too. Press '+' / '-' to change the size
+float            gGaussianSigma = 4.0f;
+GaussianBlurPlan gGaussianPlan;
+unsigned int     gGaussianMaxLevel = 0; // Smallest size allowed when gGaussianPlan was made
+
+// Bloom settings and passes (see PostProcessBloom.h). The passes depend on the viewport size, so are planned in InitScene
+BloomSettings gBloomSettings;
+BloomPlan     gBloomPlan;
+
+// Number of models drawn by the last RenderSceneFromCamera, the rest were outside the camera's view
+unsigned int gModelsDrawn = 0;
+unsigned int gModelsInScene = 0;
+
+// Polygon post-processes are drawn within all these polygons (see PostProcessPolygons.h). Set up in InitScene
+PolygonRegionBatcher gPolygonRegions;
+int gSpinningPolygon = -1; // Index of a polygon that is rotated in UpdateScene
+
 //********************
 
 
@@ -122,6 +177,14 @@ ID3D11Buffer*     gPerModelConstantBuffer; // --"--
 //**************************
 PostProcessingConstants gPostProcessingConstants;       // As above, but constants (settings) for each post-process
 ID3D11Buffer*           gPostProcessingConstantBuffer; // --"--
+
+AreaInstanceConstants gAreaInstanceConstants;      // Placements of instanced area post-processes
+ID3D11Buffer*         gAreaInstanceConstantBuffer; // --"--
+
+// Triangles of the polygon post-processes, updated every frame. Vertex buffers can't grow, so there is a maximum size
+const unsigned int MAX_POLYGON_VERTICES = 16384;
+ID3D11Buffer*      gPolygonVertexBuffer = nullptr;
+ID3D11InputLayout* gPolygonVertexLayout = nullptr;
 //**************************
 
 
@@ -154,6 +217,23 @@ ID3D11Texture2D*          gSceneTexture      = nullptr; // This object represent
 ID3D11RenderTargetView*   gSceneRenderTarget = nullptr; // This object is used when we want to render to the texture above
 ID3D11ShaderResourceView* gSceneTextureSRV   = nullptr; // This object is used to give shaders access to the texture above (SRV = shader resource view)
 
+// Intermediate textures used when several post-processes are chained, each effect renders into one of these and the next
+// effect reads from it. The post-processing frame graph (see PostProcessGraph.h) decides how many are needed and their
+// size/format - textures that are not in use at the same time are shared. Created when first needed (see PrepareTextures below)
+struct PostProcessTexture
+{
+	PostProcessTextureDesc    desc;
+	ID3D11Texture2D*          texture      = nullptr;
+	ID3D11RenderTargetView*   renderTarget = nullptr;
+	ID3D11ShaderResourceView* textureSRV   = nullptr;
+};
+std::vector<PostProcessTexture> gPostProcessTextures;
+
+// Copy-once area/polygon effects can't read the back buffer they draw to, so parts of the back buffer are copied here first
+ID3D11Texture2D*          gSnapshotTexture      = nullptr;
+ID3D11RenderTargetView*   gSnapshotRenderTarget = nullptr;
+ID3D11ShaderResourceView* gSnapshotTextureSRV   = nullptr;
+
 
 // Additional textures used for specific post-processes
 ID3D11Resource*           gNoiseMap = nullptr;
@@ -176,62 +256,61 @@ ID3D11ShaderResourceView* gDistortMapSRV = nullptr;
 // Returns true on success
 bool InitGeometry()
 {
-	////--------------- Load meshes ---------------////
-
-	// Load mesh geometry data, just like TL-Engine this doesn't create anything in the scene. Create a Model for that.
-	try
+	auto initStart = std::chrono::steady_clock::now();
+	auto msSince = [](std::chrono::steady_clock::time_point start)
 	{
-		gStarsMesh  = new Mesh("Stars.x");
-		gGroundMesh = new Mesh("Hills.x");
-		gCubeMesh   = new Mesh("Cube.x");
-		gCrateMesh  = new Mesh("CargoContainer.x");
-		gWallMesh	= new Mesh("Wall1.x");
-		gLightMesh  = new Mesh("Light.x");
-	}
-	catch (std::runtime_error e)  // Constructors cannot return error messages so use exceptions to catch mesh errors (fairly standard approach this)
-	{
-		gLastError = e.what(); // This picks up the error message put in the exception (see Mesh.cpp)
-		return false;
-	}
-
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
 
-	////--------------- Load / prepare textures & GPU states ---------------////
-
-	// Load textures and create DirectX objects for them
-	// The LoadTexture function requires you to pass a ID3D11Resource* (e.g. &gCubeDiffuseMap), which manages the GPU memory for the
-	// texture and also a ID3D11ShaderResourceView* (e.g. &gCubeDiffuseMapSRV), which allows us to use the texture in shaders
-	// The function will fill in these pointers with usable data. The variables used here are globals found near the top of the file.
-	if (!LoadTexture("Stars.jpg",                &gStarsDiffuseSpecularMap,  &gStarsDiffuseSpecularMapSRV) ||
-		!LoadTexture("GrassDiffuseSpecular.dds", &gGroundDiffuseSpecularMap, &gGroundDiffuseSpecularMapSRV) ||
-		!LoadTexture("StoneDiffuseSpecular.dds", &gCubeDiffuseSpecularMap,   &gCubeDiffuseSpecularMapSRV) ||
-		!LoadTexture("CargoA.dds",               &gCrateDiffuseSpecularMap,  &gCrateDiffuseSpecularMapSRV) ||
-		!LoadTexture("Flare.jpg",                &gLightDiffuseMap,          &gLightDiffuseMapSRV) ||
-		!LoadTexture("Noise.png",                &gNoiseMap,   &gNoiseMapSRV) ||
-		!LoadTexture("Burn.png",                 &gBurnMap,    &gBurnMapSRV) ||
-		!LoadTexture("Distort.png",              &gDistortMap, &gDistortMapSRV) ||
-		!LoadTexture("brick_35.jpg",			 &gWallDiffuseSpecularMap,	 &gWallDiffuseSpecularMapSRV))
-	{
-		gLastError = "Error loading textures";
-		return false;
-	}
+	////--------------- Start loading meshes & textures ---------------////
 
+	// Load mesh geometry data, just like TL-Engine this doesn't create anything in the scene. Create a Model for that.
+	// Meshes and textures are read and decoded on other threads while the states, shaders and buffers are created below, then
+	// taken at the end of this function (see AssetLoader.h)
+	AssetLoader assets;
+	MeshHandle starsMesh  = assets.LoadMesh("Stars.x");
+	MeshHandle groundMesh = assets.LoadMesh("Hills.x");
+	MeshHandle cubeMesh   = assets.LoadMesh("Cube.x");
+	MeshHandle crateMesh  = assets.LoadMesh("CargoContainer.x");
+	MeshHandle wallMesh   = assets.LoadMesh("Wall1.x");
+	MeshHandle lightMesh  = assets.LoadMesh("Light.x");
+
+	// Each texture is taken into a ID3D11Resource* (e.g. &gCubeDiffuseMap), which manages the GPU memory for the texture and
+	// also a ID3D11ShaderResourceView* (e.g. &gCubeDiffuseMapSRV), which allows us to use the texture in shaders
+	TextureHandle starsMap   = assets.LoadTexture("Stars.jpg");
+	TextureHandle groundMap  = assets.LoadTexture("GrassDiffuseSpecular.dds");
+	TextureHandle cubeMap    = assets.LoadTexture("StoneDiffuseSpecular.dds");
+	TextureHandle crateMap   = assets.LoadTexture("CargoA.dds");
+	TextureHandle lightMap   = assets.LoadTexture("Flare.jpg");
+	TextureHandle noiseMap   = assets.LoadTexture("Noise.png");
+	TextureHandle burnMap    = assets.LoadTexture("Burn.png");
+	TextureHandle distortMap = assets.LoadTexture("Distort.png");
+	TextureHandle wallMap    = assets.LoadTexture("brick_35.jpg");
+
+
+	////--------------- Prepare GPU states ---------------////
 
 	// Create all filtering modes, blending modes etc. used by the app (see State.cpp/.h)
+	auto stageStart = std::chrono::steady_clock::now();
 	if (!CreateStates())
 	{
 		gLastError = "Error creating states";
 		return false;
 	}
+	double statesMs = msSince(stageStart);
 
 
 	////--------------- Prepare shaders and constant buffers to communicate with them ---------------////
 
 	// Load the shaders required for the geometry we will use (see Shader.cpp / .h)
+	stageStart = std::chrono::steady_clock::now();
 	if (!LoadShaders())
 	{
 		gLastError = "Error loading shaders";
 		return false;
 	}
+	double shadersMs = msSince(stageStart);
+	stageStart = std::chrono::steady_clock::now();
 
 	// Create GPU-side constant buffers to receive the gPerFrameConstants and gPerModelConstants structures above
 	// These allow us to pass data from CPU to shaders such as lighting information or matrices
@@ -239,13 +318,48 @@ bool InitGeometry()
 	gPerFrameConstantBuffer       = CreateConstantBuffer(sizeof(gPerFrameConstants));
 	gPerModelConstantBuffer       = CreateConstantBuffer(sizeof(gPerModelConstants));
 	gPostProcessingConstantBuffer = CreateConstantBuffer(sizeof(gPostProcessingConstants));
-	if (gPerFrameConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr || gPostProcessingConstantBuffer == nullptr)
+	gAreaInstanceConstantBuffer   = CreateConstantBuffer(sizeof(gAreaInstanceConstants));
+	if (gPerFrameConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr || gPostProcessingConstantBuffer == nullptr ||
+	    gAreaInstanceConstantBuffer == nullptr)
 	{
 		gLastError = "Error creating constant buffers";
 		return false;
 	}
 
 
+	// Dynamic vertex buffer for the polygon post-processes, the CPU writes new triangles into it every frame
+	D3D11_BUFFER_DESC polygonBufferDesc = {};
+	polygonBufferDesc.ByteWidth = MAX_POLYGON_VERTICES * sizeof(PolygonVertex);
+	polygonBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	polygonBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	polygonBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(gD3DDevice->CreateBuffer(&polygonBufferDesc, nullptr, &gPolygonVertexBuffer)))
+	{
+		gLastError = "Error creating polygon vertex buffer";
+		return false;
+	}
+
+	// Layout of a PolygonVertex, see Mesh.cpp for the use of CreateSignatureForVertexLayout
+	D3D11_INPUT_ELEMENT_DESC polygonVertexElements[] =
+	{
+		{ "position", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "uv",       0, DXGI_FORMAT_R32G32_FLOAT,       0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	auto polygonSignature = CreateSignatureForVertexLayout(polygonVertexElements, 2);
+	HRESULT hr = E_FAIL;
+	if (polygonSignature)
+	{
+		hr = gD3DDevice->CreateInputLayout(polygonVertexElements, 2, polygonSignature->GetBufferPointer(),
+		                                   polygonSignature->GetBufferSize(), &gPolygonVertexLayout);
+		polygonSignature->Release();
+	}
+	if (FAILED(hr))
+	{
+		gLastError = "Error creating polygon vertex layout";
+		return false;
+	}
+
+
 
 	//********************************************
 	//**** Create Scene Texture
@@ -293,11 +407,86 @@ bool InitGeometry()
 		return false;
 	}
 
+	// Snapshot texture for copy-once area/polygon post-processing, same size and format as the scene (helper function in GraphicsHelpers.cpp)
+	if (!CreateRenderTexture(gViewportWidth, gViewportHeight, sceneTextureDesc.Format, &gSnapshotTexture, &gSnapshotRenderTarget, &gSnapshotTextureSRV))
+	{
+		gLastError = "Error creating snapshot texture";
+		return false;
+	}
+
+	double buffersMs = msSince(stageStart);
+
+
+	////--------------- Take loaded meshes & textures ---------------////
+
+	// Each of these waits for its asset if it isn't ready yet, and creates its GPU resources
+	stageStart = std::chrono::steady_clock::now();
+	try
+	{
+		gStarsMesh  = assets.TakeMesh(starsMesh);
+		gGroundMesh = assets.TakeMesh(groundMesh);
+		gCubeMesh   = assets.TakeMesh(cubeMesh);
+		gCrateMesh  = assets.TakeMesh(crateMesh);
+		gWallMesh   = assets.TakeMesh(wallMesh);
+		gLightMesh  = assets.TakeMesh(lightMesh);
+	}
+	catch (std::runtime_error e)  // Constructors cannot return error messages so use exceptions to catch mesh errors (fairly standard approach this)
+	{
+		gLastError = e.what(); // This picks up the error message put in the exception (see Mesh.cpp)
+		return false;
+	}
+
+	if (!assets.TakeTexture(starsMap,   &gStarsDiffuseSpecularMap,  &gStarsDiffuseSpecularMapSRV) ||
+		!assets.TakeTexture(groundMap,  &gGroundDiffuseSpecularMap, &gGroundDiffuseSpecularMapSRV) ||
+		!assets.TakeTexture(cubeMap,    &gCubeDiffuseSpecularMap,   &gCubeDiffuseSpecularMapSRV) ||
+		!assets.TakeTexture(crateMap,   &gCrateDiffuseSpecularMap,  &gCrateDiffuseSpecularMapSRV) ||
+		!assets.TakeTexture(lightMap,   &gLightDiffuseMap,          &gLightDiffuseMapSRV) ||
+		!assets.TakeTexture(noiseMap,   &gNoiseMap,   &gNoiseMapSRV) ||
+		!assets.TakeTexture(burnMap,    &gBurnMap,    &gBurnMapSRV) ||
+		!assets.TakeTexture(distortMap, &gDistortMap, &gDistortMapSRV) ||
+		!assets.TakeTexture(wallMap,    &gWallDiffuseSpecularMap,   &gWallDiffuseSpecularMapSRV))
+	{
+		gLastError = assets.LastError();
+		return false;
+	}
+	double takeMs = msSince(stageStart);
+
+
+	// Startup times by stage. The asset threads run alongside the states, shaders and buffers, so their times overlap those
+	auto load = assets.Stats();
+	std::ostringstream startup;
+	startup.precision(1);
+	startup << std::fixed << ", Startup (ms): " << msSince(initStart) << " total, states " << statesMs << ", shaders " << shadersMs
+	        << ", buffers " << buffersMs << ", taking assets " << takeMs << " (waiting " << load.waitMs << ", upload " << load.uploadMs
+	        << "), " << load.meshes << " meshes (" << load.cached << " cached) & " << load.textures << " textures in " << load.wallMs
+	        << " (threads: read " << load.readMs << ", decode " << load.decodeMs << ")";
+	gStartupTimes = startup.str();
 
 	return true;
 }
 
 
+// The points of a star around the origin in the XY plane, in order around its edge. The tips are at radius 1 and the
+// points between them at innerRadius. constexpr so a fixed star is made at compile time
+template <int Tips>
+struct StarPoints
+{
+	CVector2 points[Tips * 2];
+};
+
+template <int Tips>
+static constexpr StarPoints<Tips> MakeStar(float innerRadius)
+{
+	StarPoints<Tips> star{};
+	for (int i = 0; i < Tips * 2; ++i)
+	{
+		float radius = (i % 2 == 0) ? 1.0f : innerRadius;
+		star.points[i] = { radius * ConstexprSin(i * PI / Tips), radius * ConstexprCos(i * PI / Tips) };
+	}
+	return star;
+}
+
+
 // Prepare the scene
 // Returns true on success
 bool InitScene()
@@ -338,6 +527,40 @@ bool InitScene()
 	gLights[1].model->SetScale(pow(gLights[1].strength, 1.0f));
 
 
+	////--------------- Polygon effects ---------------////
+
+	// Polygons are given as points in order around their edge in their own XY plane, placed with a world matrix
+	// A rectangle on the wall
+	gPolygonRegions.Add({ {-0.2f,0.4f}, {-0.2f,0.1f}, {0.2f,0.1f}, {0.2f,0.4f} }, gWall->WorldMatrix());
+
+	// A star (concave) floating in front of the crate, spun around in UpdateScene. Its points and matrix are made at compile time
+	constexpr StarPoints<5> starPoints = MakeStar<5>(0.4f);
+	constexpr CMatrix4x4 starMatrix = MatrixMultiplyScalar(MatrixScaling(8.0f), MatrixTranslation({ -10, 25, 80 }));
+	std::vector<CVector2> star(std::begin(starPoints.points), std::end(starPoints.points));
+	gSpinningPolygon = gPolygonRegions.Add(star, starMatrix);
+
+	// An L-shape (concave) on the ground
+	constexpr CMatrix4x4 lShapeMatrix = MatrixMultiplyScalar(MatrixMultiplyScalar(MatrixScaling(6.0f), ConstexprMatrixRotationX(ToRadians(90.0f))),
+	                                                         MatrixTranslation({ 60, 0.5f, 30 }));
+	gPolygonRegions.Add({ {0,0}, {2,0}, {2,1}, {1,1}, {1,3}, {0,3} }, lShapeMatrix);
+
+
+	////--------------- Instanced area effects ---------------////
+
+	// An area over each light (moved with the lights in UpdateScene), then a 16x16 grid of areas a little above the ground
+	for (int i = 0; i < NUM_LIGHTS; ++i)
+	{
+		gAreaEffects.Add(gLights[i].model->Position(), gAreaEffectSize);
+	}
+	for (int z = 0; z < 16; ++z)
+	{
+		for (int x = 0; x < 16; ++x)
+		{
+			gAreaEffects.Add({ -100.0f + x * 15.0f, 4.0f, -20.0f + z * 15.0f }, { 6, 6 });
+		}
+	}
+
+
 	////--------------- Set up camera ---------------////
 
 	gCamera = new Camera();
@@ -345,6 +568,12 @@ bool InitScene()
 	gCamera->SetRotation({ ToRadians(10.0f), ToRadians(7.0f), 0.0f });
 
 
+	// Fused passes are limited by the size of the effect list in the constant buffer
+	gPostProcessChain.SetFusion(true, MAX_FUSED_EFFECTS);
+
+	// Bloom levels depend on the viewport size, so the glow covers the same part of the screen at any resolution
+	gBloomPlan = PlanBloom(gViewportWidth, gViewportHeight);
+
 	gPostProcessingConstants.tintColour1 = { 0, 0, 1 };
 	gPostProcessingConstants.tintColour2 = { 1, 1, 0 };
 
@@ -352,11 +581,28 @@ bool InitScene()
 }
 
 
+// Release the intermediate post-processing textures
+void ReleasePostProcessTextures()
+{
+	for (auto& texture : gPostProcessTextures)
+	{
+		if (texture.textureSRV)    texture.textureSRV->Release();
+		if (texture.renderTarget)  texture.renderTarget->Release();
+		if (texture.texture)       texture.texture->Release();
+	}
+	gPostProcessTextures.clear();
+}
+
+
 // Release the geometry and scene resources created above
 void ReleaseResources()
 {
 	ReleaseStates();
 
+	ReleasePostProcessTextures();
+	if (gSnapshotTextureSRV)           gSnapshotTextureSRV->Release();
+	if (gSnapshotRenderTarget)         gSnapshotRenderTarget->Release();
+	if (gSnapshotTexture)              gSnapshotTexture->Release();
 	if (gSceneTextureSRV)              gSceneTextureSRV->Release();
 	if (gSceneRenderTarget)            gSceneRenderTarget->Release();
 	if (gSceneTexture)                 gSceneTexture->Release();
@@ -382,6 +628,9 @@ void ReleaseResources()
 	if (gWallDiffuseSpecularMap)       gWallDiffuseSpecularMap->Release();
 
 	if (gPostProcessingConstantBuffer)  gPostProcessingConstantBuffer->Release();
+	if (gAreaInstanceConstantBuffer)    gAreaInstanceConstantBuffer  ->Release();
+	if (gPolygonVertexLayout)           gPolygonVertexLayout         ->Release();
+	if (gPolygonVertexBuffer)           gPolygonVertexBuffer         ->Release();
 	if (gPerModelConstantBuffer)        gPerModelConstantBuffer->Release();
 	if (gPerFrameConstantBuffer)        gPerFrameConstantBuffer->Release();
 
@@ -405,6 +654,8 @@ void ReleaseResources()
 	delete gGroundMesh;  gGroundMesh = nullptr;
 	delete gStarsMesh;   gStarsMesh = nullptr;
 	delete gWallMesh;	 gWallMesh = nullptr;
+
+	gGeometryPool.Release(); // After the meshes, which give back their geometry
 }
 
 
@@ -423,6 +674,11 @@ void RenderSceneFromCamera(Camera* camera)
 	gPerFrameConstants.viewProjectionMatrix = camera->ViewProjectionMatrix();
 	UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
 
+	// Post-processing has changed the vertex buffers, input layout and topology since the pool last drew, so it must set them all
+	// again. Its counts are for this frame
+	gGeometryPool.ForgetBindings();
+	gGeometryPool.ResetStats();
+
 	// Indicate that the constant buffer we just updated is for use in the vertex shader (VS), geometry shader (GS) and pixel shader (PS)
 	gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer); // First parameter must match constant buffer number in the shader 
 	gD3DContext->GSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
@@ -446,17 +702,22 @@ void RenderSceneFromCamera(Camera* camera)
 	// Render lit models, only change textures for each onee
 	gD3DContext->PSSetSamplers(0, 1, &gAnisotropic4xSampler);
 
-	gD3DContext->PSSetShaderResources(0, 1, &gGroundDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
-	gGround->Render();
-
-	gD3DContext->PSSetShaderResources(0, 1, &gCrateDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
-	gCrate->Render();
-
-	gD3DContext->PSSetShaderResources(0, 1, &gCubeDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
-	gCube->Render();
+	// Models entirely outside the camera's view are skipped (see Frustum.h). Their world bounds are only recalculated when they move
+	Frustum frustum = camera->ViewFrustum();
+	gModelsDrawn = gModelsInScene = 0;
+	auto renderIfVisible = [&](Model* model, ID3D11ShaderResourceView* texture)
+	{
+		++gModelsInScene;
+		if (!model->IsVisible(frustum))  return;
+		++gModelsDrawn;
+		if (texture)  gD3DContext->PSSetShaderResources(0, 1, &texture); // First parameter must match texture slot number in the shader
+		model->Render();
+	};
 
-	gD3DContext->PSSetShaderResources(0, 1, &gWallDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
-	gWall->Render();
+	renderIfVisible(gGround, gGroundDiffuseSpecularMapSRV);
+	renderIfVisible(gCrate,  gCrateDiffuseSpecularMapSRV);
+	renderIfVisible(gCube,   gCubeDiffuseSpecularMapSRV);
+	renderIfVisible(gWall,   gWallDiffuseSpecularMapSRV);
 
 
 	////--------------- Render sky ---------------////
@@ -472,8 +733,7 @@ void RenderSceneFromCamera(Camera* camera)
 	gD3DContext->RSSetState(gCullNoneState);
 
 	// Render sky
-	gD3DContext->PSSetShaderResources(0, 1, &gStarsDiffuseSpecularMapSRV);
-	gStars->Render();
+	renderIfVisible(gStars, gStarsDiffuseSpecularMapSRV);
 
 
 
@@ -495,7 +755,7 @@ void RenderSceneFromCamera(Camera* camera)
 	for (int i = 0; i < NUM_LIGHTS; ++i)
 	{
 		gPerModelConstants.objectColour = gLights[i].colour; // Set any per-model constants apart from the world matrix just before calling render (light colour here)
-		gLights[i].model->Render();
+		renderIfVisible(gLights[i].model, nullptr);
 	}
 }
 
@@ -532,23 +792,36 @@ void SelectPostProcessShaderAndTextures(PostProcess postProcess)
 		gD3DContext->PSSetShader(gRetroPostProcess, nullptr, 0);
 	}
 
-	else if (postProcess == PostProcess::Gaussian)
+	else if (postProcess == PostProcess::Gaussian || postProcess == PostProcess::Resample)
+	{
+		// Resampling is just a copy, the bilinear sampler does the work. The gaussian taps also rely on bilinear filtering
+		gD3DContext->PSSetShader(postProcess == PostProcess::Gaussian ? gGaussianPostProcess : gCopyPostProcess, nullptr, 0);
+		gD3DContext->PSSetSamplers(0, 1, &gBilinearSampler);
+	}
+
+	else if (postProcess == PostProcess::Bloom)
+	{
+		// Bloom samples between texels to blur as it resizes
+		gD3DContext->PSSetShader(gBloomPostProcess, nullptr, 0);
+		gD3DContext->PSSetSamplers(0, 1, &gBilinearSampler);
+	}
+
+	else if (postProcess == PostProcess::GreyNoise || postProcess == PostProcess::Fused)
 	{
-		gD3DContext->PSSetShader(gGaussianPostProcess, nullptr, 0);
+		gD3DContext->PSSetShader(postProcess == PostProcess::GreyNoise ? gGreyNoisePostProcess : gFusedPostProcess, nullptr, 0);
+
+		// Give pixel shader access to the noise texture (the fused shader only uses it for grey noise)
+		gD3DContext->PSSetShaderResources(1, 1, &gNoiseMapSRV);
+		gD3DContext->PSSetSamplers(1, 1, &gTrilinearSampler);
 	}
 }
 
 
 
-// Perform a full-screen post process from "scene texture" to back buffer
-void FullScreenPostProcess(PostProcess postProcess)
+// Select the sampler, vertex shader and states shared by all post-processes. Area and polygon post-processes
+// change some of these afterwards (e.g. blending)
+void PreparePostProcessState()
 {
-	// Select the back buffer to use for rendering. Not going to clear the back-buffer because we're going to overwrite it all
-	gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
-
-	
-	// Give the pixel shader (post-processing shader) access to the scene texture 
-	gD3DContext->PSSetShaderResources(0, 1, &gSceneTextureSRV);
 	gD3DContext->PSSetSamplers(0, 1, &gPointSampler); // Use point sampling (no bilinear, trilinear, mip-mapping etc. for most post-processes)
 
 
@@ -557,9 +830,9 @@ void FullScreenPostProcess(PostProcess postProcess)
 	gD3DContext->GSSetShader(nullptr, nullptr, 0);  // Switch off geometry shader when not using it (pass nullptr for first parameter)
 
 
-	// States
-	gD3DContext->OMSetBlendState(gAlphaBlendingState, nullptr, 0xffffff);
-	
+	// States - no blending, every pixel of the target is overwritten. The target may hold an old frame or the output
+	// of an earlier effect in the chain, so blending with it would leave ghosts of stale images
+	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
 	gD3DContext->OMSetDepthStencilState(gDepthReadOnlyState, 0);
 	gD3DContext->RSSetState(gCullNoneState);
 
@@ -567,8 +840,16 @@ void FullScreenPostProcess(PostProcess postProcess)
 	// No need to set vertex/index buffer (see 2D quad vertex shader), just indicate that the quad will be created as a triangle strip
 	gD3DContext->IASetInputLayout(NULL); // No vertex data
 	gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+}
 
 
+// Perform a full-screen post process from the current source texture to the current render target
+// The post-processing chain (see RenderScene) selects the source and target before calling this function
+void FullScreenPostProcess(PostProcess postProcess)
+{
+	// Not going to clear the render target because we're going to overwrite it all
+	PreparePostProcessState();
+
 	// Select shader and textures needed for the required post-processes (helper function above)
 	SelectPostProcessShaderAndTextures(postProcess);
 
@@ -589,34 +870,17 @@ void FullScreenPostProcess(PostProcess postProcess)
 }
 
 
-// Perform an area post process from "scene texture" to back buffer at a given point in the world, with a given size (world units)
-void AreaPostProcess(PostProcess postProcess, CVector3 worldPoint, CVector2 areaSize)
+// Find where an area post-process at a given point in the world with a given size (world units) appears on screen. Gets the
+// top-left and size in 0->1 coordinates and the depth buffer value for the area. Returns false if the point is behind the camera
+bool AreaPostProcessPlacement(CVector3 worldPoint, CVector2 areaSize, CVector2& area2DTopLeft, CVector2& area2DSize, float& area2DDepth)
 {
-	// First perform a full-screen copy of the scene to back-buffer
-	FullScreenPostProcess(PostProcess::Copy);
-	
-
-	// Now perform a post-process of a portion of the scene to the back-buffer (overwriting some of the copy above)
-	// Note: The following code relies on many of the settings that were prepared in the FullScreenPostProcess call above, it only
-	//       updates a few things that need to be changed for an area process. If you tinker with the code structure you need to be
-	//       aware of all the work that the above function did that was also preparation for this post-process area step
-
-	// Select shader/textures needed for required post-process
-	SelectPostProcessShaderAndTextures(postProcess);
-
-	// Enable alpha blending - area effects need to fade out at the edges or the hard edge of the area is visible
-	// A couple of the shaders have been updated to put the effect into a soft circle
-	// Alpha blending isn't enabled for fullscreen and polygon effects so it doesn't affect those (except heat-haze, which works a bit differently)
-	gD3DContext->OMSetBlendState(gAlphaBlendingState, nullptr, 0xffffff);
-
-
 	// Use picking methods to find the 2D position of the 3D point at the centre of the area effect
 	auto worldPointTo2D = gCamera->PixelFromWorldPt(worldPoint, gViewportWidth, gViewportHeight);
 	CVector2 area2DCentre = { worldPointTo2D.x, worldPointTo2D.y };
 	float areaDistance = worldPointTo2D.z;
 	
 	// Nothing to do if given 3D point is behind the camera
-	if (areaDistance < gCamera->NearClip())  return;
+	if (areaDistance < gCamera->NearClip())  return false;
 	
 	// Convert pixel coordinates to 0->1 coordinates as used by the shader
 	area2DCentre.x /= gViewportWidth;
@@ -627,23 +891,51 @@ void AreaPostProcess(PostProcess postProcess, CVector3 worldPoint, CVector2 area
 	// Using new helper function here - it calculates the world space units covered by a pixel at a certain distance from the camera.
 	// Use this to find the size of the 2D area we need to cover the world space size requested
 	CVector2 pixelSizeAtPoint = gCamera->PixelSizeInWorldSpace(areaDistance, gViewportWidth, gViewportHeight);
-	CVector2 area2DSize = { areaSize.x / pixelSizeAtPoint.x, areaSize.y / pixelSizeAtPoint.y };
+	area2DSize = { areaSize.x / pixelSizeAtPoint.x, areaSize.y / pixelSizeAtPoint.y };
 
 	// Again convert the result in pixels to a result to 0->1 coordinates
 	area2DSize.x /= gViewportWidth;
 	area2DSize.y /= gViewportHeight;
 
+	// Top-left of area is centre - half the size
+	area2DTopLeft = area2DCentre - 0.5f * area2DSize;
 
+	// Depth buffer value of the 3D point, 0->1, is its projected z divided by w, exactly what the GPU does to the vertices
+	// Having the depth allows us to have area effects behind normal objects
+	CVector4 projectedPoint = CVector4(worldPoint, 1.0f) * gCamera->ViewProjectionMatrix();
+	area2DDepth = projectedPoint.z / projectedPoint.w;
 
-	// Send the area top-left and size into the constant buffer - the 2DQuad vertex shader will use this to create a quad in the right place
-	gPostProcessingConstants.area2DTopLeft = area2DCentre - 0.5f * area2DSize; // Top-left of area is centre - half the size
-	gPostProcessingConstants.area2DSize = area2DSize;
+	return true;
+}
 
-	// Manually calculate depth buffer value from Z distance to the 3D point and camera near/far clip values. Result is 0->1 depth value
-	// We've never seen this full calculation before, it's occasionally useful. It is derived from the material in the Picking lecture
-	// Having the depth allows us to have area effects behind normal objects
-	gPostProcessingConstants.area2DDepth = gCamera->FarClip() * (areaDistance - gCamera->NearClip()) / (gCamera->FarClip() - gCamera->NearClip());
-	gPostProcessingConstants.area2DDepth /= areaDistance;
+
+// Perform an area post process from the current source texture to the current render target at a given point in the world, with a given size (world units)
+// If copySource is false the render target is expected to already hold a copy of the source (see RegionPostProcesses)
+void AreaPostProcess(PostProcess postProcess, CVector3 worldPoint, CVector2 areaSize, bool copySource = true)
+{
+	// First perform a full-screen copy of the source to the render target. If that's not needed the states it prepares still are
+	if (copySource)  FullScreenPostProcess(PostProcess::Copy);
+	else             PreparePostProcessState();
+	
+
+	// Now perform a post-process of a portion of the source to the render target (overwriting some of the copy above)
+	// Note: The following code relies on many of the settings that were prepared in the FullScreenPostProcess call above, it only
+	//       updates a few things that need to be changed for an area process. If you tinker with the code structure you need to be
+	//       aware of all the work that the above function did that was also preparation for this post-process area step
+
+	// Select shader/textures needed for required post-process
+	SelectPostProcessShaderAndTextures(postProcess);
+
+	// Enable alpha blending - area effects need to fade out at the edges or the hard edge of the area is visible
+	// A couple of the shaders have been updated to put the effect into a soft circle
+	// Alpha blending isn't enabled for fullscreen and polygon effects so it doesn't affect those (except heat-haze, which works a bit differently)
+	gD3DContext->OMSetBlendState(gAlphaBlendingState, nullptr, 0xffffff);
+
+
+	// Send the area top-left, size and depth into the constant buffer - the 2DQuad vertex shader will use this to create a quad in the right place
+	// Nothing to do if given 3D point is behind the camera
+	if (!AreaPostProcessPlacement(worldPoint, areaSize, gPostProcessingConstants.area2DTopLeft,
+	                              gPostProcessingConstants.area2DSize, gPostProcessingConstants.area2DDepth))  return;
 
 	// Pass over this post-processing area to shaders (also sends the per-process settings prepared in UpdateScene function below)
 	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
@@ -656,14 +948,78 @@ void AreaPostProcess(PostProcess postProcess, CVector3 worldPoint, CVector2 area
 }
 
 
-// Perform an post process from "scene texture" to back buffer within the given four-point polygon and a world matrix to position/rotate/scale the polygon
-void PolygonPostProcess(PostProcess postProcess, const std::array<CVector3, 4>& points, const CMatrix4x4& worldMatrix)
+// Camera settings needed to place area effects with PostProcessInstances.h
+AreaEffectProjection AreaEffectCameraProjection()
+{
+	CMatrix4x4 projectionMatrix = gCamera->ProjectionMatrix();
+	return { gCamera->ViewProjectionMatrix(), gCamera->NearClip(), gCamera->FarClip(),
+	         { projectionMatrix.e00 * 0.5f, projectionMatrix.e11 * 0.5f } };
+}
+
+
+// Place all the instanced area effects on screen and send the placements of those that can be seen to the GPU.
+// Done once per frame, every post-process then uses the same placements
+void BatchAreaPostProcesses()
+{
+	auto& instances = gAreaEffectBatcher.Batch(gAreaEffects, AreaEffectCameraProjection(), MAX_AREA_INSTANCES);
+	std::copy(instances.begin(), instances.end(), gAreaInstanceConstants.areaInstances);
+	UpdateConstantBuffer(gAreaInstanceConstantBuffer, gAreaInstanceConstants);
+}
+
+
+// Perform an area post process from the current source texture to the current render target over every area placed by
+// BatchAreaPostProcesses, using one instanced draw call. If copySource is false the render target is expected to already
+// hold a copy of the source (see RegionPostProcesses)
+void AreaPostProcessInstanced(PostProcess postProcess, bool copySource = true)
+{
+	// Same preparation as AreaPostProcess, see that function for details
+	if (copySource)  FullScreenPostProcess(PostProcess::Copy);
+	else             PreparePostProcessState();
+
+	SelectPostProcessShaderAndTextures(postProcess);
+	gD3DContext->OMSetBlendState(gAlphaBlendingState, nullptr, 0xffffff);
+
+	unsigned int instanceCount = gAreaEffectBatcher.Stats().packed;
+	if (instanceCount == 0)  return;
+
+	// The instanced vertex shader reads each area's placement from the instance constant buffer rather than gArea2DTopLeft etc.
+	gD3DContext->VSSetShader(g2DQuadInstancedVertexShader, nullptr, 0);
+	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
+	gD3DContext->VSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
+	gD3DContext->PSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
+	gD3DContext->VSSetConstantBuffers(2, 1, &gAreaInstanceConstantBuffer);
+
+	// Draw a quad for each area
+	gD3DContext->DrawInstanced(4, instanceCount, 0, 0);
+}
+
+
+// Transform all the post-process polygons to 2D and copy the triangles to the polygon vertex buffer (see PostProcessPolygons.h).
+// Done once per frame, every post-process then draws the same triangles
+void BatchPolygonPostProcesses()
+{
+	auto& vertices = gPolygonRegions.Batch(gCamera->ViewProjectionMatrix(), MAX_POLYGON_VERTICES);
+	if (vertices.empty())  return;
+
+	// The vertex buffer is dynamic, its contents are replaced every frame
+	D3D11_MAPPED_SUBRESOURCE mappedBuffer;
+	if (FAILED(gD3DContext->Map(gPolygonVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer)))  return;
+	memcpy(mappedBuffer.pData, vertices.data(), vertices.size() * sizeof(PolygonVertex));
+	gD3DContext->Unmap(gPolygonVertexBuffer, 0);
+}
+
+
+// Perform an post process from the current source texture to the current render target within every polygon placed by
+// BatchPolygonPostProcesses, using one draw call
+// If copySource is false the render target is expected to already hold a copy of the source (see RegionPostProcesses)
+void PolygonPostProcess(PostProcess postProcess, bool copySource = true)
 {
-	// First perform a full-screen copy of the scene to back-buffer
-	FullScreenPostProcess(PostProcess::Copy);
+	// First perform a full-screen copy of the source to the render target. If that's not needed the states it prepares still are
+	if (copySource)  FullScreenPostProcess(PostProcess::Copy);
+	else             PreparePostProcessState();
 
 
-	// Now perform a post-process of a portion of the scene to the back-buffer (overwriting some of the copy above)
+	// Now perform a post-process of a portion of the source to the render target (overwriting some of the copy above)
 	// Note: The following code relies on many of the settings that were prepared in the FullScreenPostProcess call above, it only
 	//       updates a few things that need to be changed for an area process. If you tinker with the code structure you need to be
 	//       aware of all the work that the above function did that was also preparation for this post-process area step
@@ -671,24 +1027,414 @@ void PolygonPostProcess(PostProcess postProcess, const std::array<CVector3, 4>&
 	// Select shader/textures needed for required post-process
 	SelectPostProcessShaderAndTextures(postProcess);
 	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
-	// Loop through the given points, transform each to 2D (this is what the vertex shader normally does in most labs)
-	for (unsigned int i = 0; i < points.size(); ++i)
-	{
-		CVector4 modelPosition = CVector4(points[i], 1);
-		CVector4 worldPosition = modelPosition * worldMatrix;
-		CVector4 viewportPosition = worldPosition * gCamera->ViewProjectionMatrix();
 
-		gPostProcessingConstants.polygon2DPoints[i] = viewportPosition;
-	}
+	unsigned int vertexCount = static_cast<unsigned int>(gPolygonRegions.Vertices().size());
+	if (vertexCount == 0)  return;
 
-	// Pass over the polygon points to the shaders (also sends the per-process settings prepared in UpdateScene function below)
+	// Send the per-process settings prepared in UpdateScene function below
 	UpdateConstantBuffer(gPostProcessingConstantBuffer, gPostProcessingConstants);
 	gD3DContext->VSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
 	gD3DContext->PSSetConstantBuffers(1, 1, &gPostProcessingConstantBuffer);
 
-	// Select the special 2D polygon post-processing vertex shader and draw the polygon
+	// Unlike the other post-processes the polygons come from a vertex buffer, a list of separate triangles
+	UINT vertexSize = sizeof(PolygonVertex);
+	UINT offset = 0;
+	gD3DContext->IASetInputLayout(gPolygonVertexLayout);
+	gD3DContext->IASetVertexBuffers(0, 1, &gPolygonVertexBuffer, &vertexSize, &offset);
+	gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// Select the special 2D polygon post-processing vertex shader and draw all the polygons
 	gD3DContext->VSSetShader(g2DPolygonVertexShader, nullptr, 0);
-	gD3DContext->Draw(4, 0);
+	gD3DContext->Draw(vertexCount, 0);
+}
+
+
+// Number of passes needed by a post-process. The gaussian blur is separable, so it is done as a horizontal then a vertical pass,
+// with extra passes to resize the image for larger blurs (see gGaussianPlan). Bloom has a pass for each stage (see gBloomPlan)
+unsigned int PostProcessPassCount(PostProcess postProcess)
+{
+	if (postProcess == PostProcess::Gaussian)  return static_cast<unsigned int>(gGaussianPlan.passes.size());
+	if (postProcess == PostProcess::Bloom)     return static_cast<unsigned int>(gBloomPlan.passes.size());
+	return 1;
+}
+
+// Size and inputs of each pass of a post-process (see PostProcessStep::passDescs). Empty for post-processes whose passes are all
+// full size and read the previous pass
+std::vector<PostProcessPassDesc> PostProcessPassDescs(PostProcess postProcess)
+{
+	std::vector<PostProcessPassDesc> descs;
+	if (postProcess == PostProcess::Gaussian)
+	{
+		for (auto level : gGaussianPlan.passLevels)  descs.push_back({ level, false, {} });
+	}
+	else if (postProcess == PostProcess::Bloom)
+	{
+		// The glow is summed over several passes so can go over 1. Upsample passes also read the downsample of the same size,
+		// the composite reads the scene (first, so area and polygon modes copy the scene around the area) and the glow
+		for (unsigned int pass = 0; pass < gBloomPlan.passes.size(); ++pass)
+		{
+			PostProcessPassDesc desc = { gBloomPlan.passLevels[pass], true, {} };
+			int previous = static_cast<int>(pass) - 1;
+			if (gBloomPlan.passes[pass] == BloomPass::Upsample)
+			{
+				desc.inputs = { previous, gBloomPlan.passAddInput[pass] };
+			}
+			else if (gBloomPlan.passes[pass] == BloomPass::Composite)
+			{
+				desc.highPrecision = false;
+				desc.inputs = { PostProcessPassDesc::StepInput, previous };
+			}
+			descs.push_back(desc);
+		}
+	}
+	return descs;
+}
+
+// Plan the gaussian blur for the current sigma and mode and put its taps into the post-processing constants
+void UpdateGaussianBlur()
+{
+	unsigned int maxLevel = (gCurrentPostProcessMode == PostProcessMode::Fullscreen) ? 4 : 0;
+	if (!gGaussianPlan.passes.empty() && gGaussianPlan.sigma == gGaussianSigma && gGaussianMaxLevel == maxLevel)  return;
+
+	gGaussianPlan = PlanGaussianBlur(gGaussianSigma, MAX_GAUSSIAN_TAPS, maxLevel);
+	gGaussianSigma = gGaussianPlan.sigma; // Limited to the largest blur possible
+	gGaussianMaxLevel = maxLevel;
+
+	gPostProcessingConstants.gaussianTapCount = static_cast<unsigned int>(gGaussianPlan.taps.size());
+	for (unsigned int i = 0; i < gGaussianPlan.taps.size(); ++i)
+	{
+		gPostProcessingConstants.gaussianTaps[i][0] = gGaussianPlan.taps[i].offset;
+		gPostProcessingConstants.gaussianTaps[i][1] = gGaussianPlan.taps[i].weight;
+	}
+}
+
+// The effect used by the fused post-process for a per-pixel post-process, or None if the post-process can't be fused
+// (e.g. the blurs, which read neighbouring pixels)
+FusedEffect PostProcessFusedEffect(PostProcess postProcess)
+{
+	if (postProcess == PostProcess::Tint)       return FusedEffect::Tint;
+	if (postProcess == PostProcess::Retro)      return FusedEffect::Retro;
+	if (postProcess == PostProcess::GreyNoise)  return FusedEffect::GreyNoise;
+	return FusedEffect::None;
+}
+
+
+// Put the given list of post-processes into the constants for the fused post-process
+void SetFusedPostProcesses(const std::vector<int>& effects)
+{
+	// Area effects are alpha blended, which the fused shader has to do itself between effects
+	gPostProcessingConstants.fusedEffectCount = static_cast<unsigned int>(effects.size());
+	gPostProcessingConstants.fusedAreaBlend   = (gCurrentPostProcessMode == PostProcessMode::Area);
+	for (unsigned int i = 0; i < effects.size(); ++i)
+	{
+		gPostProcessingConstants.fusedEffects[i] = static_cast<unsigned int>(PostProcessFusedEffect(static_cast<PostProcess>(effects[i])));
+	}
+}
+
+
+// Run a post-process in the current mode. If copySource is false, area and polygon post-processes expect the render target
+// to already hold a copy of the source (see RegionPostProcesses)
+void ModePostProcess(PostProcess process, bool copySource = true)
+{
+	if (gCurrentPostProcessMode == PostProcessMode::Fullscreen)
+	{
+		FullScreenPostProcess(process);
+	}
+
+	else if (gCurrentPostProcessMode == PostProcessMode::Area)
+	{
+		// Pass a 3D point for the centre of the affected area and the size of the (rectangular) area in world units
+		if (gInstancedAreas)  AreaPostProcessInstanced(process, copySource);
+		else                  AreaPostProcess(process, gLights[0].model->Position(), gAreaEffectSize, copySource);
+	}
+
+	else if (gCurrentPostProcessMode == PostProcessMode::Polygon)
+	{
+		// Draws all the polygons in gPolygonRegions
+		PolygonPostProcess(process, copySource);
+	}
+}
+
+
+// Run one pass of a post-process in the current mode. The gaussian blur's passes are either a resize or one direction of the blur.
+// Bloom builds the glow full-screen whatever the mode, only the composite is limited to the area or polygons
+void RunPostProcessPass(PostProcess process, unsigned int pass, bool copySource = true)
+{
+	if (process == PostProcess::Bloom && pass < gBloomPlan.passes.size())
+	{
+		gPostProcessingConstants.bloomStage     = static_cast<unsigned int>(gBloomPlan.passes[pass]);
+		gPostProcessingConstants.bloomThreshold = gBloomSettings.threshold;
+		gPostProcessingConstants.bloomKnee      = gBloomSettings.knee;
+		gPostProcessingConstants.bloomIntensity = gBloomSettings.intensity / gBloomPlan.levels;
+		if (gBloomPlan.passes[pass] != BloomPass::Composite)
+		{
+			FullScreenPostProcess(process);
+			return;
+		}
+	}
+
+	if (process == PostProcess::Gaussian && pass < gGaussianPlan.passes.size())
+	{
+		GaussianPass gaussianPass = gGaussianPlan.passes[pass];
+		if (gaussianPass == GaussianPass::Downsample || gaussianPass == GaussianPass::Upsample)
+		{
+			ModePostProcess(PostProcess::Resample, copySource);
+			return;
+		}
+		gPostProcessingConstants.horizontalBlur = (gaussianPass == GaussianPass::Horizontal);
+	}
+	ModePostProcess(process, copySource);
+}
+
+
+// Runs the post-processing chain (see PostProcessChain.h) with DirectX. The chain decides which textures each
+// pass reads and writes, this class selects them and calls the post-processing functions above
+class PostProcessDirect3DBackend : public PostProcessBackend
+{
+public:
+	bool PrepareTextures(const std::vector<PostProcessTextureDesc>& textures) override
+	{
+		// Usually the same textures as last frame, only recreate them if the graph has changed
+		bool same = (textures.size() == gPostProcessTextures.size());
+		for (unsigned int i = 0; same && i < textures.size(); ++i)
+		{
+			same = (textures[i] == gPostProcessTextures[i].desc);
+		}
+		if (same)  return true;
+
+		// Unbind everything first, one of the textures being released may still be selected
+		ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
+		gD3DContext->PSSetShaderResources(0, 2, nullSRVs);
+		gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
+		ReleasePostProcessTextures();
+
+		for (auto& desc : textures)
+		{
+			PostProcessTexture texture;
+			texture.desc = desc;
+			DXGI_FORMAT format = (desc.format == PostProcessFormat::RGBA16F) ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+			bool created = CreateRenderTexture(desc.width, desc.height, format, &texture.texture, &texture.renderTarget, &texture.textureSRV);
+			gPostProcessTextures.push_back(texture); // Keep partially created textures so they are released
+			if (!created)
+			{
+				gLastError = "Error creating post-processing chain texture";
+				ReleasePostProcessTextures();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void SetRenderTarget(PostProcessTarget target) override
+	{
+		// Unbind the current source textures first - a texture cannot be rendered to while the shaders can also read it
+		ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
+		gD3DContext->PSSetShaderResources(0, 2, nullSRVs);
+
+		ID3D11RenderTargetView* renderTarget = gBackBufferRenderTarget;
+		unsigned int width  = gViewportWidth;
+		unsigned int height = gViewportHeight;
+		if (target.kind == PostProcessTarget::Kind::Scene)
+		{
+			renderTarget = gSceneRenderTarget;
+		}
+		else if (target.kind == PostProcessTarget::Kind::Transient)
+		{
+			renderTarget = gPostProcessTextures[target.index].renderTarget;
+			width  = gPostProcessTextures[target.index].desc.width;
+			height = gPostProcessTextures[target.index].desc.height;
+		}
+		// The depth buffer must be the same size as the render target, smaller targets (see PostProcessPassDesc::level) go without.
+		// Full-screen post-processes don't need it, area and polygon post-processes are always full size
+		bool fullSize = (width == static_cast<unsigned int>(gViewportWidth) && height == static_cast<unsigned int>(gViewportHeight));
+		gD3DContext->OMSetRenderTargets(1, &renderTarget, fullSize ? gDepthStencil : nullptr);
+
+		// Graph textures may be a different size to the screen, so match the viewport to the target
+		D3D11_VIEWPORT vp;
+		vp.Width  = static_cast<FLOAT>(width);
+		vp.Height = static_cast<FLOAT>(height);
+		vp.MinDepth = 0.0f;
+		vp.MaxDepth = 1.0f;
+		vp.TopLeftX = 0;
+		vp.TopLeftY = 0;
+		gD3DContext->RSSetViewports(1, &vp);
+	}
+
+	void SetSourceTexture(PostProcessTarget source, unsigned int slot) override
+	{
+		ID3D11ShaderResourceView* sourceSRV = gSceneTextureSRV; // The back buffer can't be a source
+		if (source.kind == PostProcessTarget::Kind::Transient)  sourceSRV = gPostProcessTextures[source.index].textureSRV;
+		gD3DContext->PSSetShaderResources(slot, 1, &sourceSRV); // Slots match the shader's texture registers
+	}
+
+	void RunPass(int effect, unsigned int pass) override
+	{
+		RunPostProcessPass(static_cast<PostProcess>(effect), pass);
+	}
+
+	void RunFusedPass(const std::vector<int>& effects) override
+	{
+		SetFusedPostProcesses(effects);
+		ModePostProcess(PostProcess::Fused);
+	}
+
+	void Present() override
+	{
+		// This line unbinds the last source texture from the pixel shader to stop DirectX issuing a warning when we try to render to it again next frame
+		ID3D11ShaderResourceView* nullSRV = nullptr;
+		gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
+
+		// When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
+		// Set first parameter to 1 to lock to vsync
+		gSwapChain->Present(lockFPS ? 1 : 0, 0);
+	}
+};
+
+
+//**************************
+// Copy-once area and polygon post-processing (see PostProcessRegions.h)
+
+// Return the rectangle of pixels that area or polygon post-processes are drawn to in the current mode. Empty if nothing is drawn
+PostProcessRect ModePostProcessFootprint()
+{
+	const float width  = static_cast<float>(gViewportWidth);
+	const float height = static_cast<float>(gViewportHeight);
+	const PostProcessRect screen = { 0, 0, gViewportWidth, gViewportHeight };
+
+	if (gCurrentPostProcessMode == PostProcessMode::Area)
+	{
+		CVector2 topLeft, size;
+		float depth;
+		if (gInstancedAreas)
+		{
+			// Rectangle containing all the instanced areas
+			CVector2 bottomRight;
+			if (!gAreaEffectBatcher.Bounds(topLeft, bottomRight))  return {};
+			size = bottomRight - topLeft;
+		}
+		else if (!AreaPostProcessPlacement(gLights[0].model->Position(), gAreaEffectSize, topLeft, size, depth))  return {};
+		return { static_cast<int>(std::floor(topLeft.x * width)),             static_cast<int>(std::floor(topLeft.y * height)),
+		         static_cast<int>(std::ceil((topLeft.x + size.x) * width)),  static_cast<int>(std::ceil((topLeft.y + size.y) * height)) };
+	}
+
+	else if (gCurrentPostProcessMode == PostProcessMode::Polygon)
+	{
+		// Bounding rectangle of all the polygons. The rectangle is only used to decide what to copy, so being too large is safe
+		CVector2 topLeft, bottomRight;
+		if (!gPolygonRegions.Bounds(topLeft, bottomRight))  return {};
+		return { static_cast<int>(std::floor(topLeft.x * width)),      static_cast<int>(std::floor(topLeft.y * height)),
+		         static_cast<int>(std::ceil(bottomRight.x * width)),  static_cast<int>(std::ceil(bottomRight.y * height)) };
+	}
+
+	return screen;
+}
+
+
+// How far outside the pixels it draws a post-process reads, in pixels. Depends on the sample offsets in each shader
+void PostProcessReadMargin(PostProcess postProcess, const PostProcessRect& footprint, int& marginX, int& marginY)
+{
+	marginX = marginY = 0;
+	if (postProcess == PostProcess::Retro || postProcess == PostProcess::Fused)
+	{
+		// Pixelation reads the top-left of each large "pixel" (see gRetroPixelSize in Common.hlsli). Fused passes only
+		// read outside their pixels if they start with retro, but use the margin anyway as it is small
+		marginX = gViewportWidth  / 144 + 1;
+		marginY = gViewportHeight / 81  + 1;
+	}
+	else if (postProcess == PostProcess::Gaussian)
+	{
+		// Furthest sample is the kernel radius away, in either direction depending on the pass. Texels are larger if the blur is done
+		// on a smaller copy of the scene
+		marginX = marginY = static_cast<int>(GaussianRadius(gGaussianPlan.levelSigma) << gGaussianPlan.level) + 1;
+	}
+	else if (postProcess == PostProcess::Blur)
+	{
+		// Zoom blur samples up to 10% of the way towards the centre of the screen
+		marginX = gViewportWidth  / 20 + 1;
+		marginY = gViewportHeight / 20 + 1;
+	}
+	else if (postProcess == PostProcess::Underwater)
+	{
+		// Wobble is up to 1% of the size of the area
+		marginX = footprint.Width()  / 100 + 1;
+		marginY = footprint.Height() / 100 + 1;
+	}
+}
+
+
+// Return true if RegionPostProcesses can run the given steps. It draws every pass over the back buffer, so can't run passes that
+// are smaller than the screen or that read more than the previous pass (e.g. bloom), the chain is used for those instead
+bool RegionPostProcessesSupported(const std::vector<PostProcessStep>& steps)
+{
+	for (auto& step : steps)
+	{
+		for (auto& desc : step.passDescs)
+		{
+			if (desc.level != 0 || desc.highPrecision || !desc.inputs.empty())  return false;
+		}
+	}
+	return true;
+}
+
+
+// Run the post-processes in area or polygon mode, copying the scene to the back buffer once then drawing each effect over
+// just its own area. Where an effect needs to read pixels that earlier effects have drawn over, those pixels are copied to
+// the snapshot texture first. The backend is used to select the back buffer and to present
+void RegionPostProcesses(const std::vector<PostProcessStep>& steps, PostProcessBackend& backend)
+{
+	// Same passes as the chain would run, including fusion
+	auto passes = PostProcessChain::PlanPasses(steps, gPostProcessChain.Fusion(), MAX_FUSED_EFFECTS);
+
+	// Every pass in this app covers the same area, but the planner handles them being different
+	PostProcessRect footprint = ModePostProcessFootprint();
+	std::vector<RegionEffect> regionEffects;
+	for (auto& pass : passes)
+	{
+		RegionEffect effect = { footprint, 0, 0 };
+		PostProcess process = (pass.effects.size() > 1) ? PostProcess::Fused : static_cast<PostProcess>(pass.effects[0]);
+		PostProcessReadMargin(process, footprint, effect.marginX, effect.marginY);
+		regionEffects.push_back(effect);
+	}
+	auto regionPasses = gRegionPlanner.Plan(regionEffects, gViewportWidth, gViewportHeight);
+
+	// Copy the scene to the back buffer once. Textures of the same size and format can be copied without drawing anything
+	ID3D11Resource* backBuffer = nullptr;
+	gBackBufferRenderTarget->GetResource(&backBuffer);
+	backend.SetRenderTarget({ PostProcessTarget::Kind::BackBuffer, 0 });
+	gD3DContext->CopyResource(backBuffer, gSceneTexture);
+
+	for (unsigned int i = 0; i < passes.size(); ++i)
+	{
+		auto& regionPass = regionPasses[i];
+		if (regionPass.footprint.Empty())  continue;
+
+		// Copy the part of the back buffer this effect reads if earlier effects have drawn there, otherwise read the scene
+		ID3D11ShaderResourceView* sourceSRV = gSceneTextureSRV;
+		if (regionPass.snapshot)
+		{
+			ID3D11ShaderResourceView* nullSRV = nullptr;
+			gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
+
+			const auto& rect = regionPass.snapshotRect;
+			D3D11_BOX box = { static_cast<UINT>(rect.left), static_cast<UINT>(rect.top), 0, static_cast<UINT>(rect.right), static_cast<UINT>(rect.bottom), 1 };
+			gD3DContext->CopySubresourceRegion(gSnapshotTexture, 0, rect.left, rect.top, 0, backBuffer, 0, &box);
+			sourceSRV = gSnapshotTextureSRV;
+		}
+		gD3DContext->PSSetShaderResources(0, 1, &sourceSRV);
+
+		if (passes[i].effects.size() > 1)
+		{
+			SetFusedPostProcesses(passes[i].effects);
+			ModePostProcess(PostProcess::Fused, false);
+		}
+		else
+		{
+			RunPostProcessPass(static_cast<PostProcess>(passes[i].effects[0]), passes[i].pass, false);
+		}
+	}
+
+	backBuffer->Release();
+	backend.Present();
 }
 
 
@@ -744,64 +1490,38 @@ void RenderScene()
 	// Render the scene from the main camera
 	RenderSceneFromCamera(gCamera);
 
+	////--------------- Scene completion ---------------////
+
+	// Run any post-processing steps as a chain: each effect reads the output of the previous one, and the last
+	// one writes to the back buffer. The chain presents the frame once at the end (even if there are no effects)
+	// Runs of per-pixel effects are fused into single passes if fusion is enabled (see PostProcessChain.h)
+	std::vector<PostProcessStep> postProcessSteps;
 	for (auto process : gPostProcesses)
 	{
-		////--------------- Scene completion ---------------////
-
-		// Run any post-processing steps
-		if (!gPostProcesses.empty())
-		{
-			gPostProcessingConstants.horizontalBlur = true;
-			if (gCurrentPostProcessMode == PostProcessMode::Fullscreen)
-			{
-				if (process == PostProcess::Gaussian)
-				{
-					FullScreenPostProcess(process);
-					gPostProcessingConstants.horizontalBlur = false;
-				}
-				FullScreenPostProcess(process);
-			}
-
-			else if (gCurrentPostProcessMode == PostProcessMode::Area)
-			{
-				// Pass a 3D point for the centre of the affected area and the size of the (rectangular) area in world units
-				if (process == PostProcess::Gaussian)
-				{
-					AreaPostProcess(process, gLights[0].model->Position(), { 10, 10 });
-					gPostProcessingConstants.horizontalBlur = false;
-				}
-				AreaPostProcess(process, gLights[0].model->Position(), { 10, 10 });
-
-			}
-
-			else if (gCurrentPostProcessMode == PostProcessMode::Polygon)
-			{
-				// An array of four points in world space - a tapered square centred at the origin
-				const std::array<CVector3, 4> points = { { {-0.2,0.4,0}, {-0.2,0.1,0}, {0.2,0.4,0}, {0.2,0.1,0} } }; // C++ strangely needs an extra pair of {} here... only for std:array...
-
-				// Pass an array of 4 points and a matrix. Only supports 4 points.
-				if (process == PostProcess::Gaussian)
-				{
-					PolygonPostProcess(process, points, gWall->WorldMatrix());
-					gPostProcessingConstants.horizontalBlur = false;
-				}
-				PolygonPostProcess(process, points, gWall->WorldMatrix());
+		postProcessSteps.push_back({ static_cast<int>(process), PostProcessPassCount(process), FusedEffectAccess(PostProcessFusedEffect(process)),
+		                             PostProcessPassDescs(process) });
+	}
 
-			}
+	// The intermediate textures are the same size and format as the scene texture
+	PostProcessTextureDesc frameDesc;
+	frameDesc.width  = gViewportWidth;
+	frameDesc.height = gViewportHeight;
+	frameDesc.format = PostProcessFormat::RGBA8;
 
-			// These lines unbind the scene texture from the pixel shader to stop DirectX issuing a warning when we try to render to it again next frame
-			ID3D11ShaderResourceView* nullSRV = nullptr;
-			gD3DContext->PSSetShaderResources(0, 1, &nullSRV);
-		}
+	// Instanced area effects and polygons are placed once for all post-processes
+	if (gInstancedAreas && gCurrentPostProcessMode == PostProcessMode::Area)  BatchAreaPostProcesses();
+	if (gCurrentPostProcessMode == PostProcessMode::Polygon)  BatchPolygonPostProcesses();
 
-		// When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
-		// Set first parameter to 1 to lock to vsync
-		gSwapChain->Present(lockFPS ? 1 : 0, 0);
+	PostProcessDirect3DBackend backend;
+	gRegionsUsed = gCopyOnceRegions && gCurrentPostProcessMode != PostProcessMode::Fullscreen && !postProcessSteps.empty() &&
+	               RegionPostProcessesSupported(postProcessSteps);
+	if (gRegionsUsed)
+	{
+		RegionPostProcesses(postProcessSteps, backend);
 	}
-	
-	if (gPostProcesses.empty())
+	else
 	{
-		gSwapChain->Present(lockFPS ? 1 : 0, 0);
+		gPostProcessChain.Execute(postProcessSteps, frameDesc, backend);
 	}
 }
 
@@ -819,6 +1539,13 @@ void UpdateScene(float frameTime)
 	// Select post process on keys
 	if (KeyHit(Key_F1))  gCurrentPostProcessMode = PostProcessMode::Fullscreen;
 	if (KeyHit(Key_F2))  gCurrentPostProcessMode = PostProcessMode::Polygon;
+	if (KeyHit(Key_F3))  gCurrentPostProcessMode = PostProcessMode::Area;
+
+	// Toggle copying the scene once for all area/polygon post-processes, rather than once per post-process
+	if (KeyHit(Key_C))  gCopyOnceRegions = !gCopyOnceRegions;
+
+	// Toggle drawing area post-processes over many areas with instancing
+	if (KeyHit(Key_I))  gInstancedAreas = !gInstancedAreas;
 
 	if (KeyHit(Key_0)) gPostProcesses = {}; //Reset
 
@@ -827,25 +1554,27 @@ void UpdateScene(float frameTime)
 	if (KeyHit(Key_3)) gPostProcesses.push_back(PostProcess::Underwater);
 	if (KeyHit(Key_4)) gPostProcesses.push_back(PostProcess::Retro);
 	if (KeyHit(Key_5)) gPostProcesses.push_back(PostProcess::Gaussian);
+	if (KeyHit(Key_6)) gPostProcesses.push_back(PostProcess::GreyNoise);
+	if (KeyHit(Key_7)) gPostProcesses.push_back(PostProcess::Bloom);
+
+	// Toggle fusing of per-pixel post-processes (tint, retro, grey noise) into single passes
+	if (KeyHit(Key_F)) gPostProcessChain.SetFusion(!gPostProcessChain.Fusion(), MAX_FUSED_EFFECTS);
+
+	// Change the size of the gaussian blur. The passes and taps are only recalculated when the size or mode changes
+	if (KeyHit(Key_Plus))   gGaussianSigma *= 1.25f;
+	if (KeyHit(Key_Minus))  gGaussianSigma = std::max(gGaussianSigma / 1.25f, 0.5f);
+	UpdateGaussianBlur();
 
 	// Post processing settings - all data for post-processes is updated every frame whether in use or not (minimal cost)
 	
-	// Colour for tint shader
-	CVector3 HSLColour = RGBToHSL(gPostProcessingConstants.tintColour1);
-	HSLColour.x += 0.3f;
-	if (HSLColour.x >= 360.0f)
+	// Colour for tint shader, rotate the hue of both colours slowly
+	for (CVector3* tint : { &gPostProcessingConstants.tintColour1, &gPostProcessingConstants.tintColour2 })
 	{
-		HSLColour.x = 0.0f;
+		ColourRGBA hsl = RGBToHSL(ColourRGBA{ tint->x, tint->y, tint->z, 1.0f });
+		hsl.r = std::fmod(hsl.r + 0.3f, 360.0f);
+		ColourRGBA rgb = HSLToRGB(hsl);
+		*tint = { rgb.r, rgb.g, rgb.b };
 	}
-	gPostProcessingConstants.tintColour1 = HSLToRGB(HSLColour);
-
-	HSLColour = RGBToHSL(gPostProcessingConstants.tintColour2);
-	HSLColour.x += 0.3f;
-	if (HSLColour.x >= 360.0f)
-	{
-		HSLColour.x = 0.0f;
-	}
-	gPostProcessingConstants.tintColour2 = HSLToRGB(HSLColour);
 
 	// Noise scaling adjusts how fine the grey noise is.
 	const float grainSize = 140; // Fineness of the noise grain
@@ -864,7 +1593,7 @@ void UpdateScene(float frameTime)
 	// Set and increase the amount of spiral - use a tweaked cos wave to animate
 	static float wiggle = 0.0f;
 	const float wiggleSpeed = 1.0f;
-	gPostProcessingConstants.spiralLevel = ((1.0f - cos(wiggle)) * 4.0f );
+	gPostProcessingConstants.spiralLevel = ((1.0f - Cos(wiggle, TrigPolicy::Fast)) * 4.0f );
 	wiggle += wiggleSpeed * frameTime;
 
 	// Update heat haze timer
@@ -876,7 +1605,15 @@ void UpdateScene(float frameTime)
 	// Orbit one light - a bit of a cheat with the static variable [ask the tutor if you want to know what this is]
 	static float lightRotate = 0.0f;
 	static bool go = true;
-	gLights[0].model->SetPosition({ 20 + cos(lightRotate) * gLightOrbitRadius, 10, 20 + sin(lightRotate) * gLightOrbitRadius });
+	float sinLight, cosLight;
+	FastSinCos(lightRotate, sinLight, cosLight);
+	gLights[0].model->SetPosition({ 20 + cosLight * gLightOrbitRadius, 10, 20 + sinLight * gLightOrbitRadius });
+	gAreaEffects.SetCentre(0, gLights[0].model->Position());
+
+	// Spin one of the polygon post-processes
+	static float polygonRotate = 0.0f;
+	gPolygonRegions.SetWorldMatrix(gSpinningPolygon, MatrixRotationZ(polygonRotate, TrigPolicy::Fast) * MatrixScaling(8.0f) * MatrixTranslation({ -10, 25, 80 }));
+	polygonRotate += 0.5f * frameTime;
 	if (go)  lightRotate -= gLightOrbitSpeed * frameTime;
 	if (KeyHit(Key_L))  go = !go;
 
@@ -894,14 +1631,34 @@ void UpdateScene(float frameTime)
 	++frameCount;
 	if (totalFrameTime > fpsUpdateTime)
 	{
+		// Number of times the camera matrices were rebuilt since the last update, zero while the camera is still
+		static unsigned int lastCameraUpdates = 0;
+		unsigned int cameraUpdates = gCamera->UpdateCounts().viewProjection;
+
 		// Displays FPS rounded to nearest int, and frame time (more useful for developers) in milliseconds to 2 decimal places
 		float avgFrameTime = totalFrameTime / frameCount;
 		std::ostringstream frameTimeMs;
 		frameTimeMs.precision(2);
 		frameTimeMs << std::fixed << avgFrameTime * 1000;
+
+		// Estimated memory traffic of copying the scene once for area and polygon effects, against a copy for every effect
+		std::ostringstream regionTraffic;
+		regionTraffic.precision(1);
+		regionTraffic << std::fixed << gRegionPlanner.Stats().bytes / 1048576.0 << "MB (copying each " << gRegionPlanner.Stats().copyEachBytes / 1048576.0 << "MB)";
 		std::string windowTitle = "CO3303 Week 14: Area Post Processing - Frame Time: " + frameTimeMs.str() +
-			"ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f));
+			"ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f)) +
+			", Post-process passes: " + std::to_string(gPostProcessChain.Stats().passes) +
+			(gPostProcessChain.Fusion() ? " (fused)" : "") +
+			(gRegionsUsed ? ", Copy-once traffic: " + regionTraffic.str() + ", Snapshots: " + std::to_string(gRegionPlanner.Stats().snapshots) : "") +
+			", Gaussian sigma: " + std::to_string(static_cast<int>(gGaussianSigma + 0.5f)) +
+			(gGaussianPlan.level > 0 ? " (1/" + std::to_string(1 << gGaussianPlan.level) + " size)" : "") +
+			(gInstancedAreas ? ", Areas drawn: " + std::to_string(gAreaEffectBatcher.Stats().packed) + "/" + std::to_string(gAreaEffects.Count()) : "") +
+			", Camera updates: " + std::to_string(cameraUpdates - lastCameraUpdates) +
+			", Models drawn: " + std::to_string(gModelsDrawn) + "/" + std::to_string(gModelsInScene) +
+			", Mesh draws: " + std::to_string(gGeometryPool.Stats().draws) + " (" + std::to_string(gGeometryPool.Stats().bindings) + " IA binds)" +
+			gStartupTimes;
 		SetWindowTextA(gHWnd, windowTitle.c_str());
+		lastCameraUpdates = cameraUpdates;
 		totalFrameTime = 0;
 		frameCount = 0;
 	}
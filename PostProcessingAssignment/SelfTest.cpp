@@ -0,0 +1,250 @@
+//--------------------------------------------------------------------------------------
+// Self test - runs every check and benchmark in the project
+//--------------------------------------------------------------------------------------
+
+#include "SelfTest.h"
+#include "Mesh.h"
+#include "VertexPacking.h"
+#include "Camera.h"
+#include "PostProcessChain.h"
+#include "PostProcessFusion.h"
+#include "PostProcessRegions.h"
+#include "PostProcessInstances.h"
+#include "PostProcessPolygons.h"
+#include "PostProcessBloom.h"
+#include "PostProcessCPU.h"
+#include "PostProcessTiles.h"
+#include "ColourConversion.h"
+#include "RangeAllocator.h"
+#include "GeometryPool.h"
+
+#include "MatrixBenchmark.h"
+#include "TransformBatch.h"
+#include "CTransform.h"
+#include "Frustum.h"
+#include "FastTrig.h"
+#include "CRandom.h"
+#include "MathHelpers.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+
+//--------------------------------------------------------------------------------------
+// Report
+//--------------------------------------------------------------------------------------
+
+// The report being written: each test writes its results to Line then calls End
+class SelfTestReport
+{
+public:
+	SelfTestReport()  { mText.precision(3);  mText << std::fixed << std::boolalpha; }
+
+	std::ostream& Line()  { return mText; }
+
+	// Finish the current line, marking it with the given word if its check failed
+	void End(bool passed, const char* failure = "FAILED")
+	{
+		if (!passed)  mText << " (" << failure << ")";
+		mText << "\n";
+		mPassed = mPassed && passed;
+	}
+
+	std::string Text()   const { return mText.str(); }
+	bool        Passed() const { return mPassed; }
+
+private:
+	std::ostringstream mText;
+	bool               mPassed = true;
+};
+
+
+// Full path of a file with the given name in the temp folder, or just the name if there is no temp folder
+static std::string TempFileName(const std::string& name)
+{
+	char path[MAX_PATH + 1];
+	DWORD length = GetTempPathA(MAX_PATH + 1, path);
+	if (length == 0 || length > MAX_PATH)  return name;
+	return std::string(path, length) + name;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Tests
+//--------------------------------------------------------------------------------------
+
+// Post-processing chain, graph and fusion, post-processing on the CPU and placing area and polygon effects
+static void TestPostProcessing(SelfTestReport& report)
+{
+	auto chain = CheckPostProcessChain(12);
+	report.Line() << "Post-process chain: one present " << chain.onePresent << ", pass counts " << chain.passCounts << ", ping-pong "
+	              << chain.pingPong << ", fused " << chain.fused;
+	report.End(chain.passed);
+
+	auto regions = CheckPostProcessRegions();
+	report.Line() << "Post-process regions: separate " << regions.separate << ", overlapping " << regions.overlapping << ", margin "
+	              << regions.margin << ", clipped " << regions.clipped << ", empty " << regions.empty << ", stats " << regions.stats
+	              << ", traffic " << regions.bytes / 1048576.0 << "/" << regions.copyEachBytes / 1048576.0 << "MB copying each";
+	report.End(regions.passed);
+
+	auto graph = CheckPostProcessGraph();
+	report.Line() << "Post-process graph: compiled " << graph.compiled << ", culled " << graph.culled << ", lifetimes " << graph.lifetimes
+	              << ", shared " << graph.shared << ", separate " << graph.separate;
+	report.End(graph.passed);
+
+	auto fusion = CheckPostProcessFusion(1280, 720);
+	report.Line() << "Fused effects 720p: passes " << fusion.fusedPasses << "/" << fusion.unfusedPasses << " unfused, memory "
+	              << fusion.fusedBytes / 1048576.0 << "/" << fusion.unfusedBytes / 1048576.0 << "MB (diff " << fusion.maxDifference << ")";
+	report.End(fusion.passed, fusion.match ? "FAILED" : "MISMATCH");
+
+	// Same camera as the scene starts with (see InitScene)
+	Camera camera({ 25, 18, -45 }, { ToRadians(10.0f), ToRadians(7.0f), 0.0f });
+	CMatrix4x4 projectionMatrix = camera.ProjectionMatrix();
+	AreaEffectProjection projection = { camera.ViewProjectionMatrix(), camera.NearClip(), camera.FarClip(),
+	                                    { projectionMatrix.e00 * 0.5f, projectionMatrix.e11 * 0.5f } };
+
+	auto areas = BenchmarkAreaEffects(10000, 100, projection, camera.Position());
+	report.Line() << "Area placement (" << areas.effects << "): single " << areas.singleMs << "ms, batched " << areas.batchedMs << "ms";
+	report.End(areas.match, "MISMATCH");
+
+	auto polygons = BenchmarkPolygonRegions(500, 8, 100, camera.ViewProjectionMatrix(), camera.Position());
+	report.Line() << "Polygons (" << polygons.points << " points): triangulate " << polygons.triangulateMs << "ms, batch " << polygons.batchMs << "ms";
+	report.End(polygons.areasMatch, "MISMATCH");
+
+	auto bloom1080 = BenchmarkBloom(1920, 1080, 1, BloomSettings{});
+	auto bloom4K   = BenchmarkBloom(3840, 2160, 1, BloomSettings{});
+	report.Line() << "CPU bloom: 1080p " << bloom1080.totalMs << "ms, 4K " << bloom4K.totalMs << "ms (energy " << bloom4K.energyRatio << ")";
+	report.End(true);
+
+	// Throughput of all CPU effects together for each kernel (total pixels over total time), and whether the SIMD kernels match
+	auto effects = BenchmarkCPUPostProcesses(1280, 720, 1);
+	double effectsMPS[NUM_CPU_KERNELS] = {};
+	float effectsDifference = 0;
+	for (unsigned int k = 0; k < NUM_CPU_KERNELS; ++k)
+	{
+		double secondsPerMegapixel = 0;
+		for (auto& effect : effects)  secondsPerMegapixel += (effect.megapixelsPerSecond[k] > 0) ? 1 / effect.megapixelsPerSecond[k] : 0;
+		if (secondsPerMegapixel > 0)  effectsMPS[k] = effects.size() / secondsPerMegapixel;
+	}
+	for (auto& effect : effects)  effectsDifference = std::max(effectsDifference, effect.maxDifference);
+	report.Line() << "CPU effects 720p: " << CPUKernelName(CPUKernel::Scalar) << " " << effectsMPS[0] << "MP/s, " << CPUKernelName(CPUKernel::SSE41)
+	              << " " << effectsMPS[1] << "MP/s, " << CPUKernelName(CPUKernel::AVX2) << " " << effectsMPS[2] << "MP/s (diff " << effectsDifference << ")";
+	report.End(true);
+
+	auto tiles = BenchmarkCPUTiles(3840, 2160, 1);
+	report.Line() << "CPU tiles 4K: untiled " << tiles.untiledMs << "ms, " << tiles.threads.front() << " thread " << tiles.tiledMs.front()
+	              << "ms, " << tiles.threads.back() << " threads " << tiles.tiledMs.back() << "ms (x" << tiles.speedup.back() << ")";
+	report.End(tiles.match, "MISMATCH");
+
+	auto colours = BenchmarkColourConversions(1280, 720, 5);
+	report.Line() << "Colour 720p (MP/s, scalar/SIMD, copy " << colours.copyMPS << "):";
+	for (int c = 0; c < static_cast<int>(ColourConversion::NumConversions); ++c)
+	{
+		report.Line() << " " << ColourConversionName(static_cast<ColourConversion>(c)) << " " << colours.scalarMPS[c] << "/" << colours.simdMPS[c];
+	}
+	report.End(colours.passed);
+}
+
+
+// Maths library
+static void TestMaths(SelfTestReport& report)
+{
+	auto matrices = BenchmarkMatrixOps(1000, 1000);
+	report.Line() << "Matrix " << matrices.simd << ":";
+	for (auto& op : matrices.ops)  report.Line() << " " << op.name << " x" << op.speedup;
+	report.End(matrices.bitExact, "MISMATCH");
+
+	auto inverses = CheckMatrixInverses(10000);
+	report.Line() << "Inverse error: ill-conditioned " << std::scientific << inverses.illConditionedError << ", projection "
+	              << inverses.projectionError << std::fixed;
+	report.End(inverses.passed, "INACCURATE");
+
+	auto transforms = BenchmarkTransformBatch(1024, 10000);
+	report.Line() << "Point transforms: single " << transforms.singleMPS << "M/s, batch " << transforms.scalarMPS << "M/s, SIMD "
+	              << transforms.simdMPS << "M/s, project " << transforms.projectMPS << "M/s, unproject " << transforms.unprojectMPS << "M/s";
+	report.End(transforms.match, "MISMATCH");
+
+	auto trs = BenchmarkTransforms(1000, 1000);
+	report.Line() << "Transform vs matrix (ns): get rotation " << trs.getRotationNs << "/" << trs.getRotationMatrixNs << ", set rotation "
+	              << trs.setRotationNs << "/" << trs.setRotationMatrixNs << ", combine " << trs.combineNs << "/" << trs.combineMatrixNs
+	              << ", to matrix " << trs.toMatrixNs;
+	report.End(trs.passed, "INACCURATE");
+
+	auto culling = BenchmarkCulling(100000, 20);
+	report.Line() << "Culling " << culling.count << " (M/s): spheres " << culling.sphereSingleMPS << "/" << culling.sphereSIMDMPS << ", boxes "
+	              << culling.boxSingleMPS << "/" << culling.boxSIMDMPS;
+	report.End(culling.match, "MISMATCH");
+
+	auto trig = BenchmarkTrig(100000, 20);
+	report.Line() << "Trig (M/s, std/fast/SIMD): sincos " << trig.sinCosPreciseMPS << "/" << trig.sinCosScalarMPS << "/" << trig.sinCosSIMDMPS
+	              << ", atan2 " << trig.atan2PreciseMPS << "/" << trig.atan2ScalarMPS << "/" << trig.atan2SIMDMPS;
+	report.End(trig.passed, "INACCURATE");
+
+	auto random = BenchmarkRandom(1 << 20, 10);
+	report.Line() << "Random (M/s): rand " << random.randMPS << ", mt19937 " << random.mt19937MPS << ", CRandom " << random.scalarMPS
+	              << ", fill " << random.fillMPS << " (chi2 " << random.chiSquared << ")";
+	report.End(random.passed);
+}
+
+
+// Mesh loading, caching, packing and the geometry buffers
+static void TestMeshes(SelfTestReport& report)
+{
+	auto meshCache = CheckMeshCache(TempFileName("SelfTest.meshcache"), 100000, 5);
+	report.Line() << "Mesh cache (MB/s): save " << meshCache.saveMBps << ", load " << meshCache.loadMBps << ", open " << meshCache.openMBps;
+	report.End(meshCache.passed);
+
+	auto packing = CheckVertexPacking(10000);
+	report.Line() << "Vertex packing: size x" << packing.sizeRatio << ", error/bound position " << packing.positionError << ", normal "
+	              << packing.normalError << ", uv " << packing.uvError << ", weight " << packing.weightError;
+	report.End(packing.passed);
+
+	auto decode = CheckVertexDecodeConstants(10000);
+	report.Line() << "Vertex decode constants: changes " << decode.changes << ", error/bound position " << decode.positionError << ", normal "
+	              << decode.normalError << ", uv " << decode.uvError;
+	report.End(decode.passed);
+
+	auto allocator = CheckRangeAllocator(1000000);
+	report.Line() << "Geometry allocator: " << allocator.allocationsPerSecond / 1000000 << "M/s, fragmentation " << allocator.fragmentation
+	              << ", full at " << allocator.utilisation * 100 << "%";
+	report.End(allocator.passed);
+
+	auto pool = CheckGeometryPool(200);
+	report.Line() << "Geometry pool: grows vertex " << pool.vertexGrows << ", index " << pool.indexGrows << ", contents " << pool.contents
+	              << ", empty ranges " << pool.emptyRanges;
+	report.End(pool.passed);
+
+	for (const char* fileName : { "Troll.x", "Hills.x" })
+	{
+		auto load = BenchmarkMeshLoad(fileName);
+		report.Line() << fileName << " (ms/peak MB): assimp " << load.importMs << "/" << load.importPeakMB << ", cache " << load.cacheMs
+		              << "/" << load.cachePeakMB << ", mapped " << load.mappedMs << "/" << load.mappedPeakMB;
+		report.End(load.match, "MISMATCH");
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Self test
+//--------------------------------------------------------------------------------------
+
+// Run all the checks and benchmarks, writing the results to the given file. Returns true if every check passed
+bool RunSelfTests(const std::string& reportFileName)
+{
+	SelfTestReport report;
+	TestPostProcessing(report);
+	TestMaths(report);
+	TestMeshes(report);
+	report.Line() << (report.Passed() ? "All checks passed" : "Some checks FAILED") << "\n";
+
+	// Also shown in the debugger's output window
+	std::string text = report.Text();
+	OutputDebugStringA(text.c_str());
+
+	std::ofstream reportFile(reportFileName);
+	reportFile << text;
+	return report.Passed() && reportFile.good();
+}
@@ -0,0 +1,20 @@
+//--------------------------------------------------------------------------------------
+// Self test - runs every check and benchmark in the project
+//--------------------------------------------------------------------------------------
+// Started by running the program with -selftest on the command line (see Main.cpp) instead of
+// the scene. The tests take several seconds so are not run while the scene is running. Results
+// are written to a report file, one line per test, with the failures marked.
+//
+// Direct3D must be initialised for the tests that use the GPU, the scene need not be. Files the
+// tests create are put in the temp folder
+
+#ifndef _SELF_TEST_H_INCLUDED_
+#define _SELF_TEST_H_INCLUDED_
+
+#include <string>
+
+// Run all the checks and benchmarks, writing the results to the given file. Returns true if every check passed
+bool RunSelfTests(const std::string& reportFileName);
+
+
+#endif // _SELF_TEST_H_INCLUDED_
@@ -27,6 +27,7 @@ ID3D11PixelShader*    gPixelLightingPixelShader   = nullptr;
 // These are also added to Shader.h
 ID3D11VertexShader* g2DQuadVertexShader    = nullptr;
 ID3D11VertexShader* g2DPolygonVertexShader = nullptr;
+ID3D11VertexShader* g2DQuadInstancedVertexShader = nullptr;
 ID3D11PixelShader*  gCopyPostProcess       = nullptr;
 ID3D11PixelShader*  gTintPostProcess       = nullptr;
 ID3D11PixelShader*  gGreyNoisePostProcess  = nullptr;
@@ -39,6 +40,7 @@ ID3D11PixelShader*  gBlurPostProcess	   = nullptr;
 ID3D11PixelShader* gRetroPostProcess	   = nullptr;
 ID3D11PixelShader* gBloomPostProcess	   = nullptr;
 ID3D11PixelShader* gGaussianPostProcess	   = nullptr;
+ID3D11PixelShader* gFusedPostProcess	   = nullptr;
 
 
 
@@ -62,6 +64,7 @@ bool LoadShaders()
 
 	g2DPolygonVertexShader = LoadVertexShader("2DPolygon_pp");
 	g2DQuadVertexShader    = LoadVertexShader("2DQuad_pp");
+	g2DQuadInstancedVertexShader = LoadVertexShader("2DQuadInstanced_pp");
 	gCopyPostProcess       = LoadPixelShader ("Copy_pp");
 	gTintPostProcess       = LoadPixelShader ("Tint_pp");
 	gGreyNoisePostProcess  = LoadPixelShader ("GreyNoise_pp");
@@ -74,6 +77,7 @@ bool LoadShaders()
 	gRetroPostProcess = LoadPixelShader("Retro_pp");
 	gBloomPostProcess = LoadPixelShader("Bloom_pp");
 	gGaussianPostProcess = LoadPixelShader("GaussianBlur_pp");
+	gFusedPostProcess = LoadPixelShader("Fused_pp");
 
 	if (gBasicTransformVertexShader == nullptr || gPixelLightingVertexShader == nullptr ||
 		gTintedTexturePixelShader   == nullptr || gPixelLightingPixelShader  == nullptr ||
@@ -83,7 +87,8 @@ bool LoadShaders()
 		gDistortPostProcess         == nullptr || gSpiralPostProcess         == nullptr ||
 		g2DPolygonVertexShader      == nullptr || gUnderwaterPostProcess	 == nullptr ||
 		gBlurPostProcess			== nullptr || gRetroPostProcess			 == nullptr ||
-		gBloomPostProcess			== nullptr || gGaussianPostProcess		 == nullptr)
+		gBloomPostProcess			== nullptr || gGaussianPostProcess		 == nullptr ||
+		gFusedPostProcess			== nullptr || g2DQuadInstancedVertexShader == nullptr)
 	{
 		gLastError = "Error loading shaders";
 		return false;
@@ -104,6 +109,7 @@ void ReleaseShaders()
 	if (gCopyPostProcess)             gCopyPostProcess           ->Release();
 	if (g2DPolygonVertexShader)       g2DPolygonVertexShader     ->Release();
 	if (g2DQuadVertexShader)          g2DQuadVertexShader        ->Release();
+	if (g2DQuadInstancedVertexShader) g2DQuadInstancedVertexShader->Release();
 	if (gPixelLightingPixelShader)    gPixelLightingPixelShader  ->Release();
 	if (gTintedTexturePixelShader)    gTintedTexturePixelShader  ->Release();
 	if (gPixelLightingVertexShader)   gPixelLightingVertexShader ->Release();
@@ -113,6 +119,7 @@ void ReleaseShaders()
 	if (gRetroPostProcess)			  gRetroPostProcess			 ->Release();
 	if (gBloomPostProcess)			  gBloomPostProcess			 ->Release();
 	if (gGaussianPostProcess)		  gGaussianPostProcess->Release();
+	if (gFusedPostProcess)			  gFusedPostProcess			 ->Release();
 }
 
 
@@ -274,6 +281,10 @@ ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLa
 		else if (format == DXGI_FORMAT_R32G32_FLOAT)       shaderSource += "float2";
 		else if (format == DXGI_FORMAT_R32_FLOAT)          shaderSource += "float";
 		else if (format == DXGI_FORMAT_R8G8B8A8_UINT)      shaderSource += "uint4";
+		else if (format == DXGI_FORMAT_R16G16B16A16_UNORM) shaderSource += "float4"; // Normalised formats are read as floats
+		else if (format == DXGI_FORMAT_R16G16_UNORM)       shaderSource += "float2";
+		else if (format == DXGI_FORMAT_R16G16_SNORM)       shaderSource += "float2";
+		else if (format == DXGI_FORMAT_R8G8B8A8_UNORM)     shaderSource += "float4";
 		else return nullptr; // Unsupported type in layout
 
 		uint8_t index = static_cast<uint8_t>(vertexLayout[elt].SemanticIndex);
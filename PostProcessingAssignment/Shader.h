@@ -25,6 +25,7 @@ extern ID3D11PixelShader*    gPixelLightingPixelShader;
 //**** Post-processing shader DirectX objects
 extern ID3D11VertexShader* g2DQuadVertexShader;
 extern ID3D11VertexShader* g2DPolygonVertexShader;
+extern ID3D11VertexShader* g2DQuadInstancedVertexShader;
 extern ID3D11PixelShader*  gCopyPostProcess;
 extern ID3D11PixelShader*  gTintPostProcess;
 extern ID3D11PixelShader*  gGreyNoisePostProcess;
@@ -37,6 +38,7 @@ extern ID3D11PixelShader*  gBlurPostProcess;
 extern ID3D11PixelShader*  gRetroPostProcess;
 extern ID3D11PixelShader*  gBloomPostProcess;
 extern ID3D11PixelShader*  gGaussianPostProcess;
+extern ID3D11PixelShader*  gFusedPostProcess;
 
 
 
@@ -24,7 +24,7 @@ SamplerState PointSample  : register(s0); // We don't usually want to filter (bi
 float4 main(PostProcessingInput input) : SV_Target
 {
 	// Get vector from post-processing area centre to pixel UV
-	const float2 centreUV = gArea2DTopLeft + gArea2DSize * 0.5f;
+	const float2 centreUV = input.area2DRect.xy + input.area2DRect.zw * 0.5f;
 	float2 centreOffsetUV = input.sceneUV - centreUV;
 	float centreDistance = length(centreOffsetUV); // Distance of pixel from screen centre
 	
@@ -19,6 +19,7 @@
 
 // GPU "States" //
 extern ID3D11SamplerState* gPointSampler;
+extern ID3D11SamplerState* gBilinearSampler;
 extern ID3D11SamplerState* gTrilinearSampler;
 extern ID3D11SamplerState* gAnisotropic4xSampler;
 
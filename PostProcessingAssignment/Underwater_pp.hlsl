@@ -33,7 +33,7 @@ float4 main(PostProcessingInput input) : SV_Target
 
 	// Offset for scene texture UV based on haze effect
 	// Adjust size of UV offset based on the constant EffectStrength, the overall size of area being processed, and the alpha value calculated above
-	float2 hazeOffset = float2(SinY, SinX) * effectStrength * 1.0f * gArea2DSize;
+	float2 hazeOffset = float2(SinY, SinX) * effectStrength * 1.0f * input.area2DRect.zw;
 
 	// Get pixel from scene texture, offset using haze
 	float3 colour = SceneTexture.Sample(PointSample, input.sceneUV + hazeOffset).rgb * tintColour;
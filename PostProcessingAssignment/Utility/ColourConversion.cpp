@@ -0,0 +1,210 @@
+//--------------------------------------------------------------------------------------
+// Colour conversions - HSL, HSV, sRGB / linear and luminance, for single colours and images
+//--------------------------------------------------------------------------------------
+
+#include "ColourConversion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// sRGB tables
+//--------------------------------------------------------------------------------------
+
+// Return a table of SRGBTableSize + 1 values of the given function from 0 to 1, worked out in double precision
+template <typename Fn>
+static std::vector<float> MakeSRGBTable(Fn fn)
+{
+	std::vector<float> table(SRGBTableSize + 1);
+	for (int i = 0; i <= SRGBTableSize; ++i)  table[i] = static_cast<float>(fn(static_cast<double>(i) / SRGBTableSize));
+	return table;
+}
+
+const float* SRGBToLinearTable()
+{
+	static const std::vector<float> table = MakeSRGBTable([](double c) { return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4); });
+	return table.data();
+}
+
+const float* LinearToSRGBTable()
+{
+	static const std::vector<float> table = MakeSRGBTable([](double c) { return c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1 / 2.4) - 0.055; });
+	return table.data();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Arrays and images
+//--------------------------------------------------------------------------------------
+
+// Return the name of a conversion, for display
+const char* ColourConversionName(ColourConversion conversion)
+{
+	static const char* names[static_cast<int>(ColourConversion::NumConversions)] =
+		{ "RGBToHSL", "HSLToRGB", "RGBToHSV", "HSVToRGB", "SRGBToLinear", "LinearToSRGB", "SRGBToLinearExact", "LinearToSRGBExact", "Luminance" };
+	return names[static_cast<int>(conversion)];
+}
+
+
+// Convert count colours with packs of F, then single colours for the remainder
+template <typename F, typename ConvertFn>
+static void ConvertPixels(const ColourRGBA* in, ColourRGBA* out, unsigned int count, ConvertFn convert)
+{
+	ForEachPack<F>(count, [&](auto pack, unsigned int i)
+	{
+		StorePixels(out + i, convert(LoadPixels(in + i, pack)));
+	});
+}
+
+// Convert count colours with the given pack type. The switch is outside the loop so each conversion gets its own loop
+template <typename F>
+static void ConvertPixels(ColourConversion conversion, const ColourRGBA* in, ColourRGBA* out, unsigned int count)
+{
+	switch (conversion)
+	{
+	case ColourConversion::RGBToHSL:           ConvertPixels<F>(in, out, count, [](const auto& c) { return RGBToHSL(c); });           break;
+	case ColourConversion::HSLToRGB:           ConvertPixels<F>(in, out, count, [](const auto& c) { return HSLToRGB(c); });           break;
+	case ColourConversion::RGBToHSV:           ConvertPixels<F>(in, out, count, [](const auto& c) { return RGBToHSV(c); });           break;
+	case ColourConversion::HSVToRGB:           ConvertPixels<F>(in, out, count, [](const auto& c) { return HSVToRGB(c); });           break;
+	case ColourConversion::SRGBToLinear:       ConvertPixels<F>(in, out, count, [](const auto& c) { return SRGBToLinear(c); });       break;
+	case ColourConversion::LinearToSRGB:       ConvertPixels<F>(in, out, count, [](const auto& c) { return LinearToSRGB(c); });       break;
+	case ColourConversion::SRGBToLinearExact:  ConvertPixels<F>(in, out, count, [](const auto& c) { return SRGBToLinearExact(c); });  break;
+	case ColourConversion::LinearToSRGBExact:  ConvertPixels<F>(in, out, count, [](const auto& c) { return LinearToSRGBExact(c); });  break;
+	case ColourConversion::Luminance:
+		ConvertPixels<F>(in, out, count, [](const auto& c)
+		{
+			auto grey = c;
+			grey.r = grey.g = grey.b = Luminance(c);
+			return grey;
+		});
+		break;
+	default: break;
+	}
+}
+
+
+// Convert count colours. in and out may be the same
+void ConvertColours(ColourConversion conversion, const ColourRGBA* in, ColourRGBA* out, unsigned int count, int lanes /*= 0*/)
+{
+	WithPack(lanes, [&](auto pack) { ConvertPixels<decltype(pack)>(conversion, in, out, count); });
+}
+
+// Convert a whole image, out is resized to match
+void ConvertImage(ColourConversion conversion, const ImageRGBA& in, ImageRGBA& out, int lanes /*= 0*/)
+{
+	if (&out != &in && (out.Width() != in.Width() || out.Height() != in.Height()))  out = ImageRGBA(in.Width(), in.Height());
+	ConvertColours(conversion, in.Data(), out.Data(), in.Width() * in.Height(), lanes);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Largest difference in red, green or blue between count pairs of colours. For hues, the difference around the circle
+static float MaxDifference(const ColourRGBA* a, const ColourRGBA* b, unsigned int count, bool redIsHue = false)
+{
+	float difference = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		float red = std::abs(a[i].r - b[i].r);
+		if (redIsHue)  red = std::min(red, 360.0f - red);
+		difference = std::max({ difference, red, std::abs(a[i].g - b[i].g), std::abs(a[i].b - b[i].b) });
+	}
+	return difference;
+}
+
+
+// Time each conversion on a random image of the given size, repeats times, and measure the conversion errors
+ColourBenchmark BenchmarkColourConversions(unsigned int width, unsigned int height, unsigned int repeats)
+{
+	using Clock = std::chrono::steady_clock;
+	ColourBenchmark result;
+	const unsigned int count = width * height;
+	if (count == 0 || repeats == 0)  return result;
+
+	// Random colours, the same each run, with some greys and some pure primaries and secondaries
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+	ImageRGBA image(width, height);
+	ColourRGBA* pixels = image.Data();
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		pixels[i] = { value(generator), value(generator), value(generator), value(generator) };
+		if (i % 16 == 0)  pixels[i].g = pixels[i].b = pixels[i].r;
+		if (i % 16 == 1)  pixels[i] = { static_cast<float>(i & 2), static_cast<float>(i & 4) / 4, static_cast<float>(i & 8) / 8, 1 };
+	}
+
+	// All pack widths should give the same results
+	ImageRGBA converted, reference, back;
+	result.match = true;
+	for (int c = 0; c < static_cast<int>(ColourConversion::NumConversions); ++c)
+	{
+		ConvertImage(static_cast<ColourConversion>(c), image, reference, 1);
+		for (int lanes : { 4, 8 })
+		{
+			ConvertImage(static_cast<ColourConversion>(c), image, converted, lanes);
+			result.match = result.match && std::memcmp(converted.Data(), reference.Data(), count * sizeof(ColourRGBA)) == 0;
+		}
+	}
+
+	// Round trips
+	ConvertImage(ColourConversion::RGBToHSL, image, converted);
+	ConvertImage(ColourConversion::HSLToRGB, converted, back);
+	result.hslRoundTripError = MaxDifference(pixels, back.Data(), count);
+	ConvertImage(ColourConversion::RGBToHSV, image, converted);
+	ConvertImage(ColourConversion::HSVToRGB, converted, back);
+	result.hsvRoundTripError = MaxDifference(pixels, back.Data(), count);
+	ConvertImage(ColourConversion::SRGBToLinear, image, converted);
+	ConvertImage(ColourConversion::LinearToSRGB, converted, back);
+	result.srgbRoundTripError = MaxDifference(pixels, back.Data(), count);
+
+	// Tables against the exact formulas
+	ConvertImage(ColourConversion::SRGBToLinearExact, image, reference);
+	ConvertImage(ColourConversion::SRGBToLinear, image, converted);
+	result.srgbToLinearError = MaxDifference(reference.Data(), converted.Data(), count);
+	ConvertImage(ColourConversion::LinearToSRGBExact, image, reference);
+	ConvertImage(ColourConversion::LinearToSRGB, image, converted);
+	result.linearToSRGBError = MaxDifference(reference.Data(), converted.Data(), count);
+
+	// Known hues and the saturation and lightness / value of pure colours
+	const ColourRGBA known[] = { { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }, { 0, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 }, { 1, 0.5f, 0 } };
+	const float knownHues[] = { 0, 60, 120, 180, 240, 300, 30 };
+	for (int i = 0; i < 7; ++i)
+	{
+		ColourRGBA hsl = RGBToHSL(known[i]);
+		ColourRGBA hsv = RGBToHSV(known[i]);
+		ColourRGBA expectedHSL = { knownHues[i], 1, 0.5f };
+		ColourRGBA expectedHSV = { knownHues[i], 1, 1 };
+		result.hueError = std::max({ result.hueError, MaxDifference(&hsl, &expectedHSL, 1, true), MaxDifference(&hsv, &expectedHSV, 1, true) });
+	}
+
+	// The sRGB round trip is limited by the linear to sRGB table
+	const float roundTripTolerance = 1e-5f;
+	result.passed = result.match && result.hslRoundTripError < roundTripTolerance && result.hsvRoundTripError < roundTripTolerance &&
+	                result.hueError < roundTripTolerance && result.srgbToLinearError <= 3e-7f && result.linearToSRGBError <= 2e-5f &&
+	                result.srgbRoundTripError <= 2e-5f;
+
+	// Megapixels per second running the given function
+	auto time = [&](auto run)
+	{
+		run(); // Warm up
+		auto start = Clock::now();
+		for (unsigned int repeat = 0; repeat < repeats; ++repeat)  run();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		return seconds > 0 ? count * static_cast<double>(repeats) / (seconds * 1000000.0) : 0;
+	};
+
+	result.copyMPS = time([&]() { std::memcpy(converted.Data(), pixels, count * sizeof(ColourRGBA)); });
+	for (int c = 0; c < static_cast<int>(ColourConversion::NumConversions); ++c)
+	{
+		result.scalarMPS[c] = time([&]() { ConvertImage(static_cast<ColourConversion>(c), image, converted, 1); });
+		result.simdMPS[c]   = time([&]() { ConvertImage(static_cast<ColourConversion>(c), image, converted); });
+	}
+
+	return result;
+}
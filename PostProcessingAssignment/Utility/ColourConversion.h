@@ -0,0 +1,239 @@
+//--------------------------------------------------------------------------------------
+// Colour conversions - HSL, HSV, sRGB / linear and luminance, for single colours and images
+//--------------------------------------------------------------------------------------
+// All colours use 0->1 for each of red, green and blue. Hue is in degrees, 0->360, saturation,
+// lightness and value are 0->1. HSL and HSV colours are held in a ColourRGBA with hue in r,
+// saturation in g and lightness / value in b. Alpha is always passed through unchanged.
+//
+// The conversions are written once as templates on the colour packs in ColourPack.h, with no
+// branches, so whole images convert 4 or 8 pixels at a time with the same results as one at a
+// time. sRGB / linear conversion has two versions:
+//   Exact - the sRGB formulas, using std::pow for each lane. Works for colours above 1 (HDR)
+//   Table - linear interpolation in a 4096-entry table, many times faster. Inputs are clamped to
+//           0->1. Measured largest error against Exact (see BenchmarkColourConversions):
+//           3e-7 for sRGB to linear, 2e-5 for linear to sRGB (1/200th of an 8-bit step)
+
+#ifndef _COLOURCONVERSION_H_INCLUDED_
+#define _COLOURCONVERSION_H_INCLUDED_
+
+#include "ColourPack.h"
+#include "ImageRGBA.h"
+
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+// Colour packs
+//--------------------------------------------------------------------------------------
+
+// Hue in degrees of colours with the given largest channel and chroma (largest - smallest channel). Chroma must not be 0
+template <typename F>
+inline F Hue(const Colour<F>& rgb, F maximum, F chroma)
+{
+	// Position around the hexagon of primary and secondary colours, 0->6, starting from the largest channel
+	F hueR = (rgb.g - rgb.b) / chroma;
+	hueR = Select(hueR < Splat(0.0f, F()), hueR + 6.0f, hueR);
+	F hueG = (rgb.b - rgb.r) / chroma + 2.0f;
+	F hueB = (rgb.r - rgb.g) / chroma + 4.0f;
+	return Select(rgb.r >= maximum, hueR, Select(rgb.g >= maximum, hueG, hueB)) * 60.0f;
+}
+
+template <typename F>
+inline Colour<F> RGBToHSL(const Colour<F>& rgb)
+{
+	F maximum = Max(Max(rgb.r, rgb.g), rgb.b);
+	F minimum = Min(Min(rgb.r, rgb.g), rgb.b);
+	F chroma = maximum - minimum;
+	F lightness = (maximum + minimum) * 0.5f;
+	F saturation = chroma / (1.0f - Max(2.0f * lightness - 1.0f, 1.0f - 2.0f * lightness));
+
+	// Greys have no hue or saturation, the divisions above gave infinity or NaN
+	auto grey = chroma <= Splat(0.0f, F());
+	F zero = Splat(0.0f, F());
+	return { Select(grey, zero, Hue(rgb, maximum, chroma)), Select(grey, zero, saturation), lightness, rgb.a };
+}
+
+template <typename F>
+inline Colour<F> HSLToRGB(const Colour<F>& hsl)
+{
+	// Each channel is a trapezoid wave around the hue circle, offset by a third of the circle for each channel
+	F amplitude = hsl.g * Min(hsl.b, 1.0f - hsl.b);
+	auto channel = [&](float offset)
+	{
+		F k = hsl.r * (1.0f / 30.0f) + offset;
+		k = k - 12.0f * Floor(k * (1.0f / 12.0f));
+		return hsl.b - amplitude * Max(Splat(-1.0f, F()), Min(Min(k - 3.0f, 9.0f - k), Splat(1.0f, F())));
+	};
+	return { channel(0), channel(8), channel(4), hsl.a };
+}
+
+template <typename F>
+inline Colour<F> RGBToHSV(const Colour<F>& rgb)
+{
+	F maximum = Max(Max(rgb.r, rgb.g), rgb.b);
+	F chroma = maximum - Min(Min(rgb.r, rgb.g), rgb.b);
+	auto grey = chroma <= Splat(0.0f, F());
+	F zero = Splat(0.0f, F());
+	return { Select(grey, zero, Hue(rgb, maximum, chroma)), Select(grey, zero, chroma / maximum), maximum, rgb.a };
+}
+
+template <typename F>
+inline Colour<F> HSVToRGB(const Colour<F>& hsv)
+{
+	F amplitude = hsv.b * hsv.g;
+	auto channel = [&](float offset)
+	{
+		F k = hsv.r * (1.0f / 60.0f) + offset;
+		k = k - 6.0f * Floor(k * (1.0f / 6.0f));
+		return hsv.b - amplitude * Max(Splat(0.0f, F()), Min(Min(k, 4.0f - k), Splat(1.0f, F())));
+	};
+	return { channel(5), channel(3), channel(1), hsv.a };
+}
+
+
+// Relative luminance of linear RGB colours (Rec. 709 / sRGB primaries)
+template <typename F>
+inline F Luminance(const Colour<F>& rgb)
+{
+	return rgb.r * 0.2126f + rgb.g * 0.7152f + rgb.b * 0.0722f;
+}
+
+
+// The sRGB transfer functions for single values
+inline float SRGBToLinearExact(float c)  { return c <= 0.04045f   ? c * (1.0f / 12.92f) : std::pow((c + 0.055f) * (1.0f / 1.055f), 2.4f); }
+inline float LinearToSRGBExact(float c)  { return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f; }
+
+// Apply a function of one float to each lane of a pack
+template <typename F, typename Fn>
+inline F EachLane(F values, Fn fn)
+{
+	alignas(32) float lanes[F::Lanes];
+	Store(lanes, values);
+	for (auto& lane : lanes)  lane = fn(lane);
+	return Load(lanes, F());
+}
+
+template <typename F>
+inline Colour<F> SRGBToLinearExact(const Colour<F>& c)
+{
+	auto convert = [](float f) { return SRGBToLinearExact(f); };
+	return { EachLane(c.r, convert), EachLane(c.g, convert), EachLane(c.b, convert), c.a };
+}
+
+template <typename F>
+inline Colour<F> LinearToSRGBExact(const Colour<F>& c)
+{
+	auto convert = [](float f) { return LinearToSRGBExact(f); };
+	return { EachLane(c.r, convert), EachLane(c.g, convert), EachLane(c.b, convert), c.a };
+}
+
+
+// Tables for the Table versions, SRGBTableSize + 1 values from 0 to 1 inclusive. Built on first use
+const int SRGBTableSize = 4096;
+const float* SRGBToLinearTable();
+const float* LinearToSRGBTable();
+
+// Linearly interpolate in one of the tables above, values are clamped to 0->1
+template <typename F>
+inline F LookUpSRGBTable(const float* table, F values)
+{
+	F position = Saturate(values) * static_cast<float>(SRGBTableSize);
+	F index = Min(Floor(position), Splat(static_cast<float>(SRGBTableSize - 1), F()));
+	auto i = ToInt(index);
+	F below = Gather(table, i);
+	F above = Gather(table + 1, i);
+	return below + (above - below) * (position - index);
+}
+
+template <typename F>
+inline Colour<F> SRGBToLinear(const Colour<F>& c)
+{
+	const float* table = SRGBToLinearTable();
+	return { LookUpSRGBTable(table, c.r), LookUpSRGBTable(table, c.g), LookUpSRGBTable(table, c.b), c.a };
+}
+
+template <typename F>
+inline Colour<F> LinearToSRGB(const Colour<F>& c)
+{
+	const float* table = LinearToSRGBTable();
+	return { LookUpSRGBTable(table, c.r), LookUpSRGBTable(table, c.g), LookUpSRGBTable(table, c.b), c.a };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Single colours
+//--------------------------------------------------------------------------------------
+
+// Call a colour pack conversion on one colour
+template <typename ConvertFn>
+inline ColourRGBA ConvertColour(const ColourRGBA& colour, ConvertFn convert)
+{
+	ColourRGBA result;
+	StorePixels(&result, convert(LoadPixels(&colour, Float1())));
+	return result;
+}
+
+inline ColourRGBA RGBToHSL(const ColourRGBA& rgb)           { return ConvertColour(rgb, [](const Colour<Float1>& c) { return RGBToHSL(c); }); }
+inline ColourRGBA HSLToRGB(const ColourRGBA& hsl)           { return ConvertColour(hsl, [](const Colour<Float1>& c) { return HSLToRGB(c); }); }
+inline ColourRGBA RGBToHSV(const ColourRGBA& rgb)           { return ConvertColour(rgb, [](const Colour<Float1>& c) { return RGBToHSV(c); }); }
+inline ColourRGBA HSVToRGB(const ColourRGBA& hsv)           { return ConvertColour(hsv, [](const Colour<Float1>& c) { return HSVToRGB(c); }); }
+inline ColourRGBA SRGBToLinear(const ColourRGBA& srgb)      { return ConvertColour(srgb, [](const Colour<Float1>& c) { return SRGBToLinear(c); }); }
+inline ColourRGBA LinearToSRGB(const ColourRGBA& linear)    { return ConvertColour(linear, [](const Colour<Float1>& c) { return LinearToSRGB(c); }); }
+inline float      Luminance(const ColourRGBA& linear)       { return linear.r * 0.2126f + linear.g * 0.7152f + linear.b * 0.0722f; }
+
+
+//--------------------------------------------------------------------------------------
+// Arrays and images
+//--------------------------------------------------------------------------------------
+
+enum class ColourConversion
+{
+	RGBToHSL,
+	HSLToRGB,
+	RGBToHSV,
+	HSVToRGB,
+	SRGBToLinear,      // Table versions
+	LinearToSRGB,
+	SRGBToLinearExact,
+	LinearToSRGBExact,
+	Luminance,         // Grey of the same luminance
+	NumConversions
+};
+
+// Return the name of a conversion, for display
+const char* ColourConversionName(ColourConversion conversion);
+
+// Convert count colours. in and out may be the same. The lanes parameter chooses the pack width: 8 (AVX2), 4 (SSE4.1) or 1
+// (plain C++), any other value or one the CPU doesn't support uses the widest it does
+void ConvertColours(ColourConversion conversion, const ColourRGBA* in, ColourRGBA* out, unsigned int count, int lanes = 0);
+
+// Convert a whole image, out is resized to match. in and out may be the same image
+void ConvertImage(ColourConversion conversion, const ImageRGBA& in, ImageRGBA& out, int lanes = 0);
+
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+
+// Results of BenchmarkColourConversions. Throughputs are megapixels per second on one thread
+struct ColourBenchmark
+{
+	double copyMPS = 0; // Copying the image, the most any conversion could manage
+	double scalarMPS[static_cast<int>(ColourConversion::NumConversions)] = {}; // Each conversion one pixel at a time
+	double simdMPS  [static_cast<int>(ColourConversion::NumConversions)] = {}; // Widest pack the CPU supports
+
+	float hslRoundTripError   = 0; // Largest channel difference after RGB -> HSL -> RGB
+	float hsvRoundTripError   = 0;
+	float srgbRoundTripError  = 0; // sRGB -> linear -> sRGB using the tables
+	float srgbToLinearError   = 0; // Largest difference of the table version from the exact one
+	float linearToSRGBError   = 0;
+	float hueError            = 0; // Largest hue difference (degrees) from known colours such as pure red, yellow, cyan
+	bool  match  = false; // True if all pack widths gave the same results
+	bool  passed = false; // True if the above and all errors are within those documented at the top of this file
+};
+
+// Time each conversion on a random image of the given size, repeats times, and measure the conversion errors
+ColourBenchmark BenchmarkColourConversions(unsigned int width, unsigned int height, unsigned int repeats);
+
+
+#endif // _COLOURCONVERSION_H_INCLUDED_
@@ -0,0 +1,129 @@
+//--------------------------------------------------------------------------------------
+// Colour packs - the colours of 1, 4 or 8 pixels, one channel per SIMD pack
+//--------------------------------------------------------------------------------------
+// Images hold the four channels of each pixel together, code working on packs (see SIMDPack.h)
+// wants a pack of reds, a pack of greens etc. so pixels are transposed as they are read and
+// written. Used by the CPU post-processes and the colour conversions
+
+#ifndef _COLOURPACK_H_INCLUDED_
+#define _COLOURPACK_H_INCLUDED_
+
+#include "ColourRGBA.h"
+#include "SIMDPack.h"
+
+
+// A colour for each lane of a pack
+template <typename F>
+struct Colour
+{
+	F r, g, b, a;
+};
+
+
+// Single pixel
+inline Colour<Float1> GatherPixels(const ColourRGBA* pixels, Int1 index)
+{
+	const ColourRGBA& pixel = pixels[index.v];
+	return { { pixel.r }, { pixel.g }, { pixel.b }, { pixel.a } };
+}
+
+inline Colour<Float1> LoadPixels(const ColourRGBA* pixels, Float1)
+{
+	return GatherPixels(pixels, { 0 });
+}
+
+inline void StorePixels(ColourRGBA* pixels, const Colour<Float1>& colour)
+{
+	*pixels = { colour.r.v, colour.g.v, colour.b.v, colour.a.v };
+}
+
+
+// Four pixels
+inline Colour<Float4> Transpose(__m128 p0, __m128 p1, __m128 p2, __m128 p3)
+{
+	_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+	return { { p0 }, { p1 }, { p2 }, { p3 } };
+}
+
+inline Colour<Float4> GatherPixels(const ColourRGBA* pixels, Int4 index)
+{
+	alignas(16) int i[4];
+	Store(i, index);
+	return Transpose(_mm_loadu_ps(&pixels[i[0]].r), _mm_loadu_ps(&pixels[i[1]].r),
+	                 _mm_loadu_ps(&pixels[i[2]].r), _mm_loadu_ps(&pixels[i[3]].r));
+}
+
+inline Colour<Float4> LoadPixels(const ColourRGBA* pixels, Float4)
+{
+	return Transpose(_mm_loadu_ps(&pixels[0].r), _mm_loadu_ps(&pixels[1].r), _mm_loadu_ps(&pixels[2].r), _mm_loadu_ps(&pixels[3].r));
+}
+
+inline void StorePixels(ColourRGBA* pixels, const Colour<Float4>& colour)
+{
+	__m128 p0 = colour.r.v, p1 = colour.g.v, p2 = colour.b.v, p3 = colour.a.v;
+	_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+	_mm_storeu_ps(&pixels[0].r, p0);
+	_mm_storeu_ps(&pixels[1].r, p1);
+	_mm_storeu_ps(&pixels[2].r, p2);
+	_mm_storeu_ps(&pixels[3].r, p3);
+}
+
+
+// Eight pixels. AVX shuffles work within each half of the register, so pixels 0-3 are transposed in the
+// lower half and pixels 4-7 in the upper half. Swaps between rows of pixels and packs of channels both ways
+inline void Transpose(__m256& p0, __m256& p1, __m256& p2, __m256& p3)
+{
+	__m256 t0 = _mm256_unpacklo_ps(p0, p1);
+	__m256 t1 = _mm256_unpacklo_ps(p2, p3);
+	__m256 t2 = _mm256_unpackhi_ps(p0, p1);
+	__m256 t3 = _mm256_unpackhi_ps(p2, p3);
+	p0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	p1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	p2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	p3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Two pixels in one register, the first in the lower half
+inline __m256 LoadPixelPair(const ColourRGBA& lower, const ColourRGBA& upper)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&lower.r)), _mm_loadu_ps(&upper.r), 1);
+}
+
+inline Colour<Float8> GatherPixels(const ColourRGBA* pixels, Int8 index)
+{
+	alignas(32) int i[8];
+	Store(i, index);
+	__m256 p0 = LoadPixelPair(pixels[i[0]], pixels[i[4]]);
+	__m256 p1 = LoadPixelPair(pixels[i[1]], pixels[i[5]]);
+	__m256 p2 = LoadPixelPair(pixels[i[2]], pixels[i[6]]);
+	__m256 p3 = LoadPixelPair(pixels[i[3]], pixels[i[7]]);
+	Transpose(p0, p1, p2, p3);
+	return { { p0 }, { p1 }, { p2 }, { p3 } };
+}
+
+inline Colour<Float8> LoadPixels(const ColourRGBA* pixels, Float8)
+{
+	__m256 p0 = LoadPixelPair(pixels[0], pixels[4]);
+	__m256 p1 = LoadPixelPair(pixels[1], pixels[5]);
+	__m256 p2 = LoadPixelPair(pixels[2], pixels[6]);
+	__m256 p3 = LoadPixelPair(pixels[3], pixels[7]);
+	Transpose(p0, p1, p2, p3);
+	return { { p0 }, { p1 }, { p2 }, { p3 } };
+}
+
+inline void StorePixels(ColourRGBA* pixels, const Colour<Float8>& colour)
+{
+	__m256 p0 = colour.r.v, p1 = colour.g.v, p2 = colour.b.v, p3 = colour.a.v;
+	Transpose(p0, p1, p2, p3);
+	_mm_storeu_ps(&pixels[0].r, _mm256_castps256_ps128(p0));
+	_mm_storeu_ps(&pixels[1].r, _mm256_castps256_ps128(p1));
+	_mm_storeu_ps(&pixels[2].r, _mm256_castps256_ps128(p2));
+	_mm_storeu_ps(&pixels[3].r, _mm256_castps256_ps128(p3));
+	_mm_storeu_ps(&pixels[4].r, _mm256_extractf128_ps(p0, 1));
+	_mm_storeu_ps(&pixels[5].r, _mm256_extractf128_ps(p1, 1));
+	_mm_storeu_ps(&pixels[6].r, _mm256_extractf128_ps(p2, 1));
+	_mm_storeu_ps(&pixels[7].r, _mm256_extractf128_ps(p3, 1));
+}
+
+
+#endif // _COLOURPACK_H_INCLUDED_
@@ -36,25 +36,56 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
 }
 
 
+// Create a texture that can be rendered to and also passed to shaders (e.g. for post-processing). Fills in the
+// texture, render target view and shader resource view pointers, which need to be released before quitting.
+// Returns false on failure
+bool CreateRenderTexture(unsigned int width, unsigned int height, DXGI_FORMAT format, ID3D11Texture2D** texture,
+                         ID3D11RenderTargetView** renderTarget, ID3D11ShaderResourceView** textureSRV)
+{
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    textureDesc.Width = width;
+    textureDesc.Height = height;
+    textureDesc.MipLevels = 1; // No mip-maps when rendering to textures (or we would have to render every level)
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = format;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // Will use texture as render target, and pass it to shaders
+    textureDesc.CPUAccessFlags = 0;
+    textureDesc.MiscFlags = 0;
+    if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, NULL, texture)))
+    {
+        return false;
+    }
+
+    // Get a "view" of the texture as a render target and as a shader resource
+    if (FAILED(gD3DDevice->CreateRenderTargetView(*texture, NULL, renderTarget)))
+    {
+        return false;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srDesc = {};
+    srDesc.Format = textureDesc.Format;
+    srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srDesc.Texture2D.MostDetailedMip = 0;
+    srDesc.Texture2D.MipLevels = 1;
+    if (FAILED(gD3DDevice->CreateShaderResourceView(*texture, &srDesc, textureSRV)))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
 //--------------------------------------------------------------------------------------
-// Camera Helpers
+// Compile-time tests
 //--------------------------------------------------------------------------------------
 
-// A "projection matrix" contains properties of a camera. Covered mid-module - the maths is an optional topic (not examinable).
-// - Aspect ratio is screen width / height (like 4:3, 16:9)
-// - FOVx is the viewing angle from left->right (high values give a fish-eye look),
-// - near and far clip are the range of z distances that can be rendered
-CMatrix4x4 MakeProjectionMatrix(float aspectRatio /*= 4.0f / 3.0f*/, float FOVx /*= ToRadians(60)*/,
-                                float nearClip /*= 0.1f*/, float farClip /*= 10000.0f*/)
-{
-    float tanFOVx = std::tan(FOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = aspectRatio / tanFOVx;
-    float scaleZa = farClip / (farClip - nearClip);
-    float scaleZb = -nearClip * scaleZa;
-
-    return CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
-                         0.0f, scaleY,    0.0f,   0.0f,
-                         0.0f,   0.0f, scaleZa,   1.0f,
-                         0.0f,   0.0f, scaleZb,   0.0f };
-}
+// A 90 degree square projection maps x and y straight through and the near and far clip to depths 0 and 1
+constexpr CMatrix4x4 testProjection = MakeProjectionMatrix(1.0f, ToRadians(90.0f), 1.0f, 101.0f);
+static_assert(testProjection.e00 > 0.999999f && testProjection.e00 < 1.000001f && testProjection.e11 == testProjection.e00,
+              "MakeProjectionMatrix scales x and y by 1 / tan(FOV / 2)");
+static_assert(testProjection.e22 * 1.0f + testProjection.e32 == 0.0f && testProjection.e22 * 101.0f + testProjection.e32 == 101.0f,
+              "MakeProjectionMatrix depth range");
@@ -1,7 +1,7 @@
 //--------------------------------------------------------------------------------------
 // Helper functions to unclutter and simplify main code (Scene.cpp/.h)
 //--------------------------------------------------------------------------------------
-// Code in .cpp file
+// Code in .cpp file, except constexpr functions
 
 #ifndef _SCENE_HELPERS_H_INCLUDED_
 #define _SCENE_HELPERS_H_INCLUDED_
@@ -38,6 +38,12 @@ void UpdateConstantBuffer(ID3D11Buffer* buffer, const T& bufferData)
 // The function will fill in these pointers with usable data. Returns false on failure
 bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
 
+// Create a texture that can be rendered to and also passed to shaders (e.g. for post-processing). Fills in the
+// texture, render target view and shader resource view pointers, which need to be released before quitting.
+// Returns false on failure
+bool CreateRenderTexture(unsigned int width, unsigned int height, DXGI_FORMAT format, ID3D11Texture2D** texture,
+                         ID3D11RenderTargetView** renderTarget, ID3D11ShaderResourceView** textureSRV);
+
 
 //--------------------------------------------------------------------------------------
 // Camera helpers
@@ -47,8 +53,21 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
 // - Aspect ratio is screen width / height (like 4:3, 16:9)
 // - FOVx is the viewing angle from left->right (high values give a fish-eye look),
 // - near and far clip are the range of z distances that can be rendered
-CMatrix4x4 MakeProjectionMatrix(float aspectRatio = 4.0f / 3.0f, float FOVx = ToRadians(60),
-                                float nearClip = 0.1f, float farClip = 10000.0f);
+// Constexpr so a fixed projection can be made at compile time
+constexpr CMatrix4x4 MakeProjectionMatrix(float aspectRatio = 4.0f / 3.0f, float FOVx = ToRadians(60),
+                                          float nearClip = 0.1f, float farClip = 10000.0f)
+{
+    float tanFOVx = ConstexprTan(FOVx * 0.5f);
+    float scaleX = 1.0f / tanFOVx;
+    float scaleY = aspectRatio / tanFOVx;
+    float scaleZa = farClip / (farClip - nearClip);
+    float scaleZb = -nearClip * scaleZa;
+
+    return CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
+                         0.0f, scaleY,    0.0f,   0.0f,
+                         0.0f,   0.0f, scaleZa,   1.0f,
+                         0.0f,   0.0f, scaleZb,   0.0f };
+}
 
 
 #endif //_SCENE_HELPERS_H_INCLUDED_
@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------
+// ImageRGBA class - a 2D image held in CPU memory with float colours
+//--------------------------------------------------------------------------------------
+
+#include "ImageRGBA.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Image of the given size filled with a single colour
+ImageRGBA::ImageRGBA(unsigned int width, unsigned int height, const ColourRGBA& fill /*= { 0, 0, 0, 1 }*/)
+	: mWidth(width), mHeight(height), mPixels(width * height, fill)
+{
+}
+
+
+// Return the pixel containing the given UV (0->1 across the image), clamped to the edges like gPointSampler
+ColourRGBA ImageRGBA::SamplePoint(const CVector2& uv) const
+{
+	int x = static_cast<int>(std::floor(uv.x * mWidth));
+	int y = static_cast<int>(std::floor(uv.y * mHeight));
+	x = std::min(std::max(x, 0), static_cast<int>(mWidth)  - 1);
+	y = std::min(std::max(y, 0), static_cast<int>(mHeight) - 1);
+	return Pixel(x, y);
+}
+
+
+// Bilinear filtering, the given function converts texel coordinates outside the image to ones inside
+template <typename EdgeFn>
+ColourRGBA ImageRGBA::SampleBilinear(const CVector2& uv, EdgeFn edge) const
+{
+	// Texel centres are at half-pixel positions, so offset by half a pixel to find the four surrounding texels
+	float fx = uv.x * mWidth  - 0.5f;
+	float fy = uv.y * mHeight - 0.5f;
+	float floorX = std::floor(fx);
+	float floorY = std::floor(fy);
+	float tx = fx - floorX;
+	float ty = fy - floorY;
+
+	int x0 = edge(static_cast<int>(floorX),     mWidth);
+	int x1 = edge(static_cast<int>(floorX) + 1, mWidth);
+	int y0 = edge(static_cast<int>(floorY),     mHeight);
+	int y1 = edge(static_cast<int>(floorY) + 1, mHeight);
+
+	const ColourRGBA& c00 = Pixel(x0, y0);
+	const ColourRGBA& c10 = Pixel(x1, y0);
+	const ColourRGBA& c01 = Pixel(x0, y1);
+	const ColourRGBA& c11 = Pixel(x1, y1);
+
+	auto blend = [&](float a00, float a10, float a01, float a11)
+	{
+		float top    = a00 + (a10 - a00) * tx;
+		float bottom = a01 + (a11 - a01) * tx;
+		return top + (bottom - top) * ty;
+	};
+	return { blend(c00.r, c10.r, c01.r, c11.r), blend(c00.g, c10.g, c01.g, c11.g),
+	         blend(c00.b, c10.b, c01.b, c11.b), blend(c00.a, c10.a, c01.a, c11.a) };
+}
+
+
+// Return the bilinear filtered colour at the given UV, wrapping around the edges like gTrilinearSampler
+ColourRGBA ImageRGBA::SampleBilinearWrap(const CVector2& uv) const
+{
+	// The extra modulus handles negative values
+	return SampleBilinear(uv, [](int i, int size) { return ((i % size) + size) % size; });
+}
+
+
+// Return the bilinear filtered colour at the given UV, clamped to the edges like gBilinearSampler
+ColourRGBA ImageRGBA::SampleBilinearClamp(const CVector2& uv) const
+{
+	return SampleBilinear(uv, [](int i, int size) { return std::min(std::max(i, 0), size - 1); });
+}
+
+
+// Return the largest difference between two images in any of red, green or blue. Images of different sizes return -1
+float MaxColourDifference(const ImageRGBA& a, const ImageRGBA& b)
+{
+	if (a.Width() != b.Width() || a.Height() != b.Height())  return -1;
+
+	float difference = 0;
+	const ColourRGBA* pixelA = a.Data();
+	const ColourRGBA* pixelB = b.Data();
+	for (unsigned int i = 0; i < a.Width() * a.Height(); ++i, ++pixelA, ++pixelB)
+	{
+		difference = std::max(difference, std::abs(pixelA->r - pixelB->r));
+		difference = std::max(difference, std::abs(pixelA->g - pixelB->g));
+		difference = std::max(difference, std::abs(pixelA->b - pixelB->b));
+	}
+	return difference;
+}
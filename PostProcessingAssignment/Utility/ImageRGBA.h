@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------------------
+// ImageRGBA class - a 2D image held in CPU memory with float colours
+//--------------------------------------------------------------------------------------
+// Used to run post-processes on the CPU, e.g. to check the output of the GPU versions or
+// to measure them without a GPU. Sampling functions mirror the samplers in State.cpp
+
+#ifndef _IMAGERGBA_H_INCLUDED_
+#define _IMAGERGBA_H_INCLUDED_
+
+#include "ColourRGBA.h"
+#include "CVector2.h"
+
+#include <vector>
+
+class ImageRGBA
+{
+public:
+
+	// Construction //
+
+	// Empty image
+	ImageRGBA() {}
+
+	// Image of the given size filled with a single colour
+	ImageRGBA(unsigned int width, unsigned int height, const ColourRGBA& fill = { 0, 0, 0, 1 });
+
+
+	// Data access //
+
+	unsigned int Width()  const { return mWidth;  }
+	unsigned int Height() const { return mHeight; }
+
+	// Pixels are stored in rows from the top-left
+	ColourRGBA&       Pixel(unsigned int x, unsigned int y)       { return mPixels[y * mWidth + x]; }
+	const ColourRGBA& Pixel(unsigned int x, unsigned int y) const { return mPixels[y * mWidth + x]; }
+
+	ColourRGBA*       Data()       { return mPixels.data(); }
+	const ColourRGBA* Data() const { return mPixels.data(); }
+
+
+	// Sampling //
+
+	// Return the pixel containing the given UV (0->1 across the image), clamped to the edges like gPointSampler
+	ColourRGBA SamplePoint(const CVector2& uv) const;
+
+	// Return the bilinear filtered colour at the given UV, wrapping around the edges like gTrilinearSampler does
+	// when magnifying (there are no mip-maps so minified sampling is not the same as the GPU)
+	ColourRGBA SampleBilinearWrap(const CVector2& uv) const;
+
+	// Return the bilinear filtered colour at the given UV, clamped to the edges like gBilinearSampler does when magnifying
+	ColourRGBA SampleBilinearClamp(const CVector2& uv) const;
+
+
+private:
+	// Bilinear filtering, the given function converts texel coordinates outside the image to ones inside
+	template <typename EdgeFn>
+	ColourRGBA SampleBilinear(const CVector2& uv, EdgeFn edge) const;
+
+	unsigned int            mWidth  = 0;
+	unsigned int            mHeight = 0;
+	std::vector<ColourRGBA> mPixels;
+};
+
+
+// Return the largest difference between two images in any of red, green or blue. Images of different sizes return -1
+float MaxColourDifference(const ImageRGBA& a, const ImageRGBA& b);
+
+
+#endif // _IMAGERGBA_H_INCLUDED_
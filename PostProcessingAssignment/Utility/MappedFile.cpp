@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------
+// MappedFile class - read-only view of a whole file mapped into memory
+//--------------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(mData, other.mData);
+		std::swap(mSize, other.mSize);
+		std::swap(mMapping, other.mMapping);
+	}
+	return *this;
+}
+
+
+// Map the given file, closing any file already mapped. Returns false on failure, including for empty files
+bool MappedFile::Open(const std::string& fileName)
+{
+	Close();
+
+#ifdef _WIN32
+	// The mapping keeps the file open, so the file handle can be closed straight away
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)  return false;
+
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && static_cast<unsigned long long>(size.QuadPart) <= SIZE_MAX)
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	CloseHandle(file);
+	if (mapping == nullptr)  return false;
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	mMapping = mapping;
+	mSize = static_cast<size_t>(size.QuadPart);
+#else
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0)  return false;
+
+	struct stat status;
+	void* data = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	close(file);
+	if (data == MAP_FAILED)  return false;
+	mSize = static_cast<size_t>(status.st_size);
+#endif
+
+	mData = static_cast<const unsigned char*>(data);
+	return true;
+}
+
+
+// Unmap the file, the pointer from Data() is no longer valid
+void MappedFile::Close()
+{
+	if (mData == nullptr)  return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+	CloseHandle(mMapping);
+#else
+	munmap(const_cast<unsigned char*>(mData), mSize);
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+}
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------
+// MappedFile class - read-only view of a whole file mapped into memory
+//--------------------------------------------------------------------------------------
+// The operating system pages the file in as it is read, so there is no copy into a buffer
+// of our own and nothing is read that isn't used. The contents stay valid until the file is
+// closed. Uses a file mapping on Windows and mmap elsewhere
+
+#ifndef _MAPPED_FILE_H_INCLUDED_
+#define _MAPPED_FILE_H_INCLUDED_
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile()  { Close(); }
+
+	// Can be moved but not copied, only one object owns the mapping
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other);
+	MappedFile& operator=(MappedFile&& other);
+
+
+	// Map the given file, closing any file already mapped. Returns false on failure, including for empty files
+	bool Open(const std::string& fileName);
+
+	// Unmap the file, the pointer from Data() is no longer valid
+	void Close();
+
+
+	// The start of the file, aligned to a memory page, or null if no file is open
+	const unsigned char* Data() const { return mData; }
+
+	// Size of the file in bytes
+	size_t Size() const { return mSize; }
+
+	bool IsOpen() const { return mData != nullptr; }
+
+
+private:
+	const unsigned char* mData = nullptr;
+	size_t               mSize = 0;
+	void*                mMapping = nullptr; // Windows file mapping handle, unused elsewhere
+};
+
+
+#endif // _MAPPED_FILE_H_INCLUDED_
@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------
+// Memory usage of this process
+//--------------------------------------------------------------------------------------
+
+#include "MemoryUsage.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+
+// Bytes of physical memory currently used by this process, 0 if it can't be found
+size_t ProcessMemoryBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))  return 0;
+	return counters.WorkingSetSize;
+#else
+	// Second value in statm is the resident set in pages
+	FILE* statm = std::fopen("/proc/self/statm", "r");
+	if (statm == nullptr)  return 0;
+	unsigned long long total = 0, resident = 0;
+	int read = std::fscanf(statm, "%llu %llu", &total, &resident);
+	std::fclose(statm);
+	return read == 2 ? static_cast<size_t>(resident * sysconf(_SC_PAGESIZE)) : 0;
+#endif
+}
+
+
+// Start sampling every given number of microseconds
+void PeakMemorySampler::Start(unsigned int intervalMicroseconds /*= 100*/)
+{
+	Stop();
+	mPeak = ProcessMemoryBytes();
+	mRunning = true;
+	mThread = std::thread([this, intervalMicroseconds]()
+	{
+		while (mRunning)
+		{
+			size_t bytes = ProcessMemoryBytes();
+			if (bytes > mPeak)  mPeak = bytes; // Only this thread raises the peak while sampling
+			std::this_thread::sleep_for(std::chrono::microseconds(intervalMicroseconds));
+		}
+	});
+}
+
+
+// Stop sampling and return the largest memory use seen, including at Start and Stop
+size_t PeakMemorySampler::Stop()
+{
+	if (!mThread.joinable())  return mPeak;
+
+	size_t bytes = ProcessMemoryBytes();
+	mRunning = false;
+	mThread.join();
+	if (bytes > mPeak)  mPeak = bytes;
+	return mPeak;
+}
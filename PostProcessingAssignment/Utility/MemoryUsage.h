@@ -0,0 +1,39 @@
+//--------------------------------------------------------------------------------------
+// Memory usage of this process
+//--------------------------------------------------------------------------------------
+// Physical memory in use (the working set on Windows, resident set elsewhere), and a sampler
+// to find the peak over part of the program. Operating systems only keep a peak for the whole
+// life of the process, which can't show how much one task such as loading a mesh needed
+
+#ifndef _MEMORY_USAGE_H_INCLUDED_
+#define _MEMORY_USAGE_H_INCLUDED_
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+// Bytes of physical memory currently used by this process, 0 if it can't be found
+size_t ProcessMemoryBytes();
+
+
+// Samples ProcessMemoryBytes on another thread to find the peak between Start and Stop. Peaks shorter than the sampling
+// interval can be missed
+class PeakMemorySampler
+{
+public:
+	~PeakMemorySampler()  { Stop(); }
+
+	// Start sampling every given number of microseconds
+	void Start(unsigned int intervalMicroseconds = 100);
+
+	// Stop sampling and return the largest memory use seen, including at Start and Stop
+	size_t Stop();
+
+private:
+	std::thread         mThread;
+	std::atomic<bool>   mRunning{ false };
+	std::atomic<size_t> mPeak{ 0 };
+};
+
+
+#endif // _MEMORY_USAGE_H_INCLUDED_
@@ -0,0 +1,198 @@
+//--------------------------------------------------------------------------------------
+// RangeAllocator class - hands out ranges of a larger block, e.g. space in a GPU buffer
+//--------------------------------------------------------------------------------------
+
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Construction
+//--------------------------------------------------------------------------------------
+
+// Allocator for a block of the given size, all of it free
+RangeAllocator::RangeAllocator(uint32_t capacity /*= 0*/)
+{
+	Grow(capacity);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Allocation
+//--------------------------------------------------------------------------------------
+
+// Return the start of a range of the given size, or Invalid if there is no free range large enough
+uint32_t RangeAllocator::Allocate(uint32_t size)
+{
+	if (size == 0)  return 0;
+
+	// Smallest free range the size fits in, the lowest one if there are several the same size
+	auto bySize = mBySize.lower_bound({ size, 0 });
+	if (bySize == mBySize.end())  return Invalid;
+
+	uint32_t offset = bySize->second;
+	uint32_t rangeSize = bySize->first;
+	RemoveFreeRange(mByOffset.find(offset));
+	if (rangeSize > size)  AddFreeRange(offset + size, rangeSize - size); // Take the start, the rest stays free
+
+	mFree -= size;
+	return offset;
+}
+
+
+// Free a range returned by Allocate, with the same size. It is joined up with free ranges either side
+void RangeAllocator::Free(uint32_t offset, uint32_t size)
+{
+	if (size == 0)  return;
+	mFree += size;
+
+	auto next = mByOffset.lower_bound(offset);
+	if (next != mByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = std::next(next);
+		RemoveFreeRange(std::prev(next));
+	}
+	if (next != mByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeRange(previous);
+		}
+	}
+	AddFreeRange(offset, size);
+}
+
+
+// Make the block larger, the new space is free. Does nothing if the capacity is not larger
+void RangeAllocator::Grow(uint32_t capacity)
+{
+	if (capacity <= mCapacity)  return;
+
+	uint32_t oldCapacity = mCapacity;
+	mCapacity = capacity;
+	Free(oldCapacity, capacity - oldCapacity); // Joins up with a free range at the old end
+}
+
+
+// Add or remove a free range from both orders
+void RangeAllocator::AddFreeRange(uint32_t offset, uint32_t size)
+{
+	mByOffset.emplace(offset, size);
+	mBySize.emplace(size, offset);
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<uint32_t, uint32_t>::iterator range)
+{
+	mBySize.erase({ range->second, range->first });
+	mByOffset.erase(range);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Allocate and free random sized ranges for the given number of operations, checking the ranges in use never overlap, that
+// freed space is reused and joined back up, and measuring how fragmented the free space becomes
+RangeAllocatorCheck CheckRangeAllocator(unsigned int operations)
+{
+	RangeAllocatorCheck result;
+	const uint32_t capacity = 1 << 20;
+	std::mt19937 generator(1);
+
+	// Sizes as a mesh pool sees them, mostly small sub-meshes with a few large ones
+	auto randomSize = [&]()
+	{
+		return (generator() % 8 == 0) ? 1024 + generator() % 16384 : 1 + generator() % 1024;
+	};
+
+	// Every unit in use is marked, so overlapping ranges are found as they are allocated
+	RangeAllocator allocator(capacity);
+	std::vector<unsigned char> inUse(capacity, 0);
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+	result.noOverlaps = true;
+	auto mark = [&](uint32_t offset, uint32_t size, unsigned char value)
+	{
+		if (offset > capacity || capacity - offset < size)
+		{
+			result.noOverlaps = false;
+			return;
+		}
+		for (uint32_t i = offset; i < offset + size; ++i)
+		{
+			if (inUse[i] == value)  result.noOverlaps = false;
+			inUse[i] = value;
+		}
+	};
+	auto freeRandomRange = [&]()
+	{
+		size_t index = generator() % ranges.size();
+		allocator.Free(ranges[index].first, ranges[index].second);
+		mark(ranges[index].first, ranges[index].second, 0);
+		ranges[index] = ranges.back();
+		ranges.pop_back();
+	};
+
+	// Random allocations and frees, keeping about half the block in use. The marking isn't timed
+	double seconds = 0;
+	for (unsigned int i = 0; i < operations; ++i)
+	{
+		uint32_t size = randomSize();
+		bool allocate = ranges.empty() || allocator.Used() < capacity / 2;
+
+		auto start = std::chrono::steady_clock::now();
+		uint32_t offset = allocate ? allocator.Allocate(size) : RangeAllocator::Invalid;
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (offset != RangeAllocator::Invalid)
+		{
+			mark(offset, size, 1);
+			ranges.push_back({ offset, size });
+		}
+		else if (!ranges.empty())
+		{
+			start = std::chrono::steady_clock::now();
+			freeRandomRange();
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+	result.allocationsPerSecond = seconds > 0 ? operations / seconds : 0;
+	result.fragmentation = allocator.Fragmentation();
+
+	// Fill up until an allocation fails
+	while (true)
+	{
+		uint32_t size = randomSize();
+		uint32_t offset = allocator.Allocate(size);
+		if (offset == RangeAllocator::Invalid)  break;
+		mark(offset, size, 1);
+		ranges.push_back({ offset, size });
+	}
+	result.utilisation = static_cast<float>(allocator.Used()) / capacity;
+
+	// A range freed between two in use is given back for the same size
+	RangeAllocator small(300);
+	uint32_t a = small.Allocate(100), b = small.Allocate(100), c = small.Allocate(100);
+	small.Free(b, 100);
+	result.reused = a == 0 && b == 100 && c == 200 && small.NumFreeRanges() == 1 && small.Allocate(100) == b && small.FreeSpace() == 0 &&
+	                small.Allocate(1) == RangeAllocator::Invalid;
+
+	// Freeing everything, in random order, joins it all back into one range
+	while (!ranges.empty())  freeRandomRange();
+	bool allFree = allocator.NumFreeRanges() == 1 && allocator.LargestFree() == capacity && allocator.Fragmentation() == 0;
+	uint32_t first = allocator.Allocate(capacity / 2);
+	allocator.Grow(capacity * 2);
+	allocator.Free(first, capacity / 2);
+	result.coalesced = allFree && first == 0 && allocator.NumFreeRanges() == 1 && allocator.LargestFree() == capacity * 2;
+
+	result.passed = result.noOverlaps && result.reused && result.coalesced;
+	return result;
+}
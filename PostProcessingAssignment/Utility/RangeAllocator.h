@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------
+// RangeAllocator class - hands out ranges of a larger block, e.g. space in a GPU buffer
+//--------------------------------------------------------------------------------------
+// Keeps only the bookkeeping, in whatever units the caller likes (bytes, vertices, indices),
+// the memory itself is owned elsewhere. Free ranges are kept sorted by position so a range that
+// is freed joins up with its free neighbours, and sorted by size so each allocation takes the
+// smallest free range it fits in ("best fit"), which keeps the large ranges for large requests.
+//
+// Plain C++ with no DirectX
+
+#ifndef _RANGE_ALLOCATOR_H_INCLUDED_
+#define _RANGE_ALLOCATOR_H_INCLUDED_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+class RangeAllocator
+{
+public:
+	static const uint32_t Invalid = ~0u; // Returned by Allocate when there is no free range large enough
+
+	// Construction //
+
+	// Allocator for a block of the given size, all of it free
+	explicit RangeAllocator(uint32_t capacity = 0);
+
+
+	// Allocation //
+
+	// Return the start of a range of the given size, or Invalid if there is no free range large enough. Sizes of 0 return 0 and
+	// need not be freed
+	uint32_t Allocate(uint32_t size);
+
+	// Free a range returned by Allocate, with the same size
+	void Free(uint32_t offset, uint32_t size);
+
+	// Make the block larger, the new space is free. Does nothing if the capacity is not larger
+	void Grow(uint32_t capacity);
+
+
+	// Data access //
+
+	uint32_t Capacity()      const { return mCapacity; }
+	uint32_t Used()          const { return mCapacity - mFree; }
+	uint32_t FreeSpace()     const { return mFree; }
+	uint32_t LargestFree()   const { return mBySize.empty() ? 0 : mBySize.rbegin()->first; }
+	uint32_t NumFreeRanges() const { return static_cast<uint32_t>(mByOffset.size()); }
+
+	// How broken up the free space is: 0 if it is all in one range (or there is none), towards 1 as more of it is in small
+	// ranges. It is 1 - the largest free range / all free space
+	float Fragmentation() const  { return mFree == 0 ? 0.0f : 1.0f - static_cast<float>(LargestFree()) / mFree; }
+
+
+private:
+	// Add or remove a free range from both orders
+	void AddFreeRange(uint32_t offset, uint32_t size);
+	void RemoveFreeRange(std::map<uint32_t, uint32_t>::iterator range);
+
+	std::map<uint32_t, uint32_t>             mByOffset; // Free ranges, offset -> size
+	std::set<std::pair<uint32_t, uint32_t>>  mBySize;   // Free ranges, (size, offset)
+
+	uint32_t mCapacity = 0;
+	uint32_t mFree     = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckRangeAllocator
+struct RangeAllocatorCheck
+{
+	double allocationsPerSecond = 0; // Allocate and Free pairs per second during the random part
+
+	float fragmentation = 0; // Fragmentation after the random part, with about half the block in use
+	float utilisation   = 0; // Space in use when the first allocation failed, as a fraction of the capacity
+
+	bool noOverlaps = false; // True if no two ranges in use ever overlapped, or went past the capacity
+	bool reused     = false; // True if freeing a range then allocating the same size again gave back the same range
+	bool coalesced  = false; // True if freeing everything left a single free range of the whole block, also after Grow
+	bool passed     = false; // True if all of the above
+};
+
+// Allocate and free random sized ranges for the given number of operations, checking the ranges in use never overlap, that
+// freed space is reused and joined back up, and measuring how fragmented the free space becomes
+RangeAllocatorCheck CheckRangeAllocator(unsigned int operations);
+
+
+#endif // _RANGE_ALLOCATOR_H_INCLUDED_
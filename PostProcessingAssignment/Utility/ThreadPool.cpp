@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// ThreadPool class - runs many small tasks over several threads
+//--------------------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+
+// Pool with the given number of threads including the calling thread, 0 for one per hardware thread
+ThreadPool::ThreadPool(unsigned int numThreads /*= 0*/)
+{
+	if (numThreads == 0)  numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (unsigned int i = 0; i < numThreads; ++i)  mQueues.push_back(std::make_unique<TaskQueue>());
+	for (unsigned int i = 1; i < numThreads; ++i)  mThreads.emplace_back(&ThreadPool::WorkerThread, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mJobStarted.notify_all();
+	for (auto& thread : mThreads)  thread.join();
+}
+
+
+// Run task(index, thread) for each index from 0 to count-1 and return when all are done
+void ThreadPool::ParallelFor(unsigned int count, const std::function<void(unsigned int index, unsigned int thread)>& task)
+{
+	if (count == 0)  return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &task;
+		mRemaining = count;
+
+		// Deal out blocks of neighbouring tasks, which often share data (e.g. image tiles reading the same rows). The job is set
+		// before the tasks are queued, so a thread that takes a task through the queue lock always sees this job
+		const unsigned int numQueues = NumThreads();
+		for (unsigned int q = 0; q < numQueues; ++q)
+		{
+			std::lock_guard<std::mutex> queueLock(mQueues[q]->mutex);
+			for (unsigned int i = q * count / numQueues; i < (q + 1) * count / numQueues; ++i)  mQueues[q]->tasks.push_back(i);
+		}
+		++mGeneration;
+	}
+	mJobStarted.notify_all();
+
+	while (RunTask(0)) {}
+
+	// Other threads may still be running their last tasks
+	std::unique_lock<std::mutex> lock(mMutex);
+	mJobFinished.wait(lock, [&] { return mRemaining == 0; });
+}
+
+
+// Run tasks as they are given until the pool is destroyed
+void ThreadPool::WorkerThread(unsigned int thread)
+{
+	unsigned int generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobStarted.wait(lock, [&] { return mQuit || mGeneration != generation; });
+			if (mQuit)  return;
+			generation = mGeneration;
+		}
+		while (RunTask(thread)) {}
+	}
+}
+
+
+// Run one task from the thread's own queue, or stolen from another. Return false if there are none left
+bool ThreadPool::RunTask(unsigned int thread)
+{
+	bool found = false;
+	unsigned int index = 0;
+	{
+		std::lock_guard<std::mutex> lock(mQueues[thread]->mutex);
+		if (!mQueues[thread]->tasks.empty())
+		{
+			index = mQueues[thread]->tasks.front();
+			mQueues[thread]->tasks.pop_front();
+			found = true;
+		}
+	}
+
+	// Steal from the far end of another queue, away from where its own thread is working
+	for (unsigned int i = 1; !found && i < NumThreads(); ++i)
+	{
+		TaskQueue& victim = *mQueues[(thread + i) % NumThreads()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			index = victim.tasks.back();
+			victim.tasks.pop_back();
+			found = true;
+			++mSteals;
+		}
+	}
+	if (!found)  return false;
+
+	(*mJob)(index, thread);
+
+	if (--mRemaining == 0)
+	{
+		// Lock so the notification can't be missed between ParallelFor checking mRemaining and waiting
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobFinished.notify_all();
+	}
+	return true;
+}
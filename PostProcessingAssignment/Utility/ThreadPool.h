@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// ThreadPool class - runs many small tasks over several threads
+//--------------------------------------------------------------------------------------
+// Threads are created once and wait between jobs. A job is a number of tasks with the same
+// function, each thread is dealt a block of neighbouring tasks and when it runs out it takes
+// ("steals") tasks from the end of another thread's block, so threads that are slowed down
+// (by the OS or by harder tasks) don't hold up the job
+
+#ifndef _THREADPOOL_H_INCLUDED_
+#define _THREADPOOL_H_INCLUDED_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+
+	// Construction //
+
+	// Pool with the given number of threads including the calling thread, 0 for one per hardware thread
+	explicit ThreadPool(unsigned int numThreads = 0);
+
+	~ThreadPool();
+
+	// Threads can't be copied
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+
+	// Running tasks //
+
+	// Run task(index, thread) for each index from 0 to count-1 and return when all are done. The calling thread runs tasks
+	// too and is thread 0, the others are numbered from 1, so tasks can use the thread number to pick per-thread data
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int index, unsigned int thread)>& task);
+
+
+	// Data access //
+
+	// Threads including the calling thread
+	unsigned int NumThreads() const { return static_cast<unsigned int>(mQueues.size()); }
+
+	// Total tasks taken from another thread's block since the pool was created
+	unsigned long long Steals() const { return mSteals; }
+
+
+private:
+	// Tasks waiting for one thread. It takes from the front, other threads steal from the back
+	struct TaskQueue
+	{
+		std::mutex               mutex;
+		std::deque<unsigned int> tasks;
+	};
+
+	// Run tasks as they are given until the pool is destroyed
+	void WorkerThread(unsigned int thread);
+
+	// Run one task from the thread's own queue, or stolen from another. Return false if there are none left
+	bool RunTask(unsigned int thread);
+
+	std::vector<std::thread>                mThreads;
+	std::vector<std::unique_ptr<TaskQueue>> mQueues;
+
+	std::mutex              mMutex;      // Guards the job and generation, and is used with the condition variables
+	std::condition_variable mJobStarted;
+	std::condition_variable mJobFinished;
+	const std::function<void(unsigned int, unsigned int)>* mJob = nullptr;
+	unsigned int            mGeneration = 0; // Increased for each job so waiting threads can tell there's a new one
+	bool                    mQuit       = false;
+
+	std::atomic<unsigned int>       mRemaining{ 0 }; // Tasks of the current job not yet finished
+	std::atomic<unsigned long long> mSteals{ 0 };
+};
+
+
+#endif // _THREADPOOL_H_INCLUDED_
@@ -0,0 +1,661 @@
+//--------------------------------------------------------------------------------------
+// Vertex packing - smaller vertex formats for mesh data
+//--------------------------------------------------------------------------------------
+
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+
+//--------------------------------------------------------------------------------------
+// Octahedral encoding
+//--------------------------------------------------------------------------------------
+
+static float SignNotZero(float value)  { return value >= 0 ? 1.0f : -1.0f; }
+
+// Project the vector onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper so the whole surface is
+// the square from -1 to 1
+CVector2 EncodeOctahedral(const CVector3& v)
+{
+	float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+	if (length == 0)  return { 0, 0 };
+
+	CVector2 e = { v.x / length, v.y / length };
+	if (v.z < 0)  e = { (1 - std::abs(e.y)) * SignNotZero(e.x), (1 - std::abs(e.x)) * SignNotZero(e.y) };
+	return e;
+}
+
+// Same as DecodeOctahedral in Common.hlsli
+CVector3 DecodeOctahedral(const CVector2& e)
+{
+	CVector3 v = { e.x, e.y, 1 - std::abs(e.x) - std::abs(e.y) };
+	float fold = std::max(-v.z, 0.0f);
+	v.x += (v.x >= 0) ? -fold : fold;
+	v.y += (v.y >= 0) ? -fold : fold;
+	return Normalise(v);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Single values
+//--------------------------------------------------------------------------------------
+// Each kind of value has a function to pack it and one to give back what the GPU reads. The
+// GPU turns normalised integers to floats as value / 65535 (unsigned) or max(value / 32767, -1)
+// (signed)
+
+static uint16_t PackUnorm16(float value, float offset, float scale)
+{
+	if (scale == 0)  return 0;
+	float fraction = std::min(std::max((value - offset) / scale, 0.0f), 1.0f);
+	return static_cast<uint16_t>(fraction * 65535 + 0.5f);
+}
+
+static float UnpackUnorm16(uint16_t value, float offset, float scale)
+{
+	return (value / 65535.0f) * scale + offset;
+}
+
+
+static float UnpackSnorm16(int16_t value)
+{
+	return std::max(value / 32767.0f, -1.0f);
+}
+
+// Angle in radians between two unit vectors, accurate for small angles
+static float AngleBetween(const CVector3& a, const CVector3& b)
+{
+	return std::atan2(Length(Cross(a, b)), Dot(a, b));
+}
+
+// Octahedral encoding in two signed 16-bit values. Of the four ways to round the encoding to the grid, the one that decodes
+// closest to the vector is used
+static void PackOctahedral(const CVector3& v, int16_t packed[2])
+{
+	CVector2 e = EncodeOctahedral(v);
+	float x = std::floor(e.x * 32767), y = std::floor(e.y * 32767);
+	CVector3 unit = Normalise(v);
+
+	float bestAngle = std::numeric_limits<float>::max();
+	for (int corner = 0; corner < 4; ++corner)
+	{
+		float cornerX = std::min(std::max(x + (corner & 1), -32767.0f), 32767.0f);
+		float cornerY = std::min(std::max(y + (corner >> 1), -32767.0f), 32767.0f);
+		int16_t candidate[2] = { static_cast<int16_t>(cornerX), static_cast<int16_t>(cornerY) };
+		float angle = AngleBetween(unit, DecodeOctahedral({ UnpackSnorm16(candidate[0]), UnpackSnorm16(candidate[1]) }));
+		if (angle < bestAngle)
+		{
+			bestAngle = angle;
+			packed[0] = candidate[0];
+			packed[1] = candidate[1];
+		}
+	}
+}
+
+static CVector3 UnpackOctahedral(const int16_t packed[2])
+{
+	return DecodeOctahedral({ UnpackSnorm16(packed[0]), UnpackSnorm16(packed[1]) });
+}
+
+
+// Bone weights as 8-bit values that add up to the same total as the weights (to 255 if they add up to 1). Each weight is rounded
+// down, then the ones that lost most are rounded up until the total is reached
+static void PackWeights(const float weights[4], uint8_t packed[4])
+{
+	float scaled[4], total = 0;
+	int packedTotal = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		scaled[i] = std::min(std::max(weights[i], 0.0f), 1.0f) * 255;
+		total += scaled[i];
+		packed[i] = static_cast<uint8_t>(scaled[i]);
+		packedTotal += packed[i];
+	}
+
+	int target = std::min(static_cast<int>(total + 0.5f), 255);
+	while (packedTotal < target)
+	{
+		int largest = -1;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (packed[i] < 255 && (largest < 0 || scaled[i] - packed[i] > scaled[largest] - packed[largest]))  largest = i;
+		}
+		if (largest < 0)  break;
+		++packed[largest];
+		++packedTotal;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sub-meshes
+//--------------------------------------------------------------------------------------
+
+// The elements of a sub-mesh that can be packed, null for those it doesn't have
+struct PackableElements
+{
+	const VertexElement* position = nullptr;
+	const VertexElement* normal   = nullptr;
+	const VertexElement* tangent  = nullptr;
+	const VertexElement* uv       = nullptr;
+	const VertexElement* weights  = nullptr;
+};
+
+static PackableElements FindPackableElements(const MeshSubMeshData& subMesh)
+{
+	PackableElements elements;
+	for (auto& element : subMesh.layout)
+	{
+		if (element.semanticIndex != 0)  continue;
+		if      (element.semantic == "position" && element.format == VertexFormat::Float3)  elements.position = &element;
+		else if (element.semantic == "normal"   && element.format == VertexFormat::Float3)  elements.normal   = &element;
+		else if (element.semantic == "tangent"  && element.format == VertexFormat::Float3)  elements.tangent  = &element;
+		else if (element.semantic == "uv"       && element.format == VertexFormat::Float2)  elements.uv       = &element;
+		else if (element.semantic == "weights"  && element.format == VertexFormat::Float4)  elements.weights  = &element;
+	}
+	return elements;
+}
+
+// Read count floats of a vertex element. Vertices are bytes, so copy rather than cast
+static void ReadFloats(const MeshSubMeshData& subMesh, unsigned int vertex, const VertexElement& element, float* values, unsigned int count)
+{
+	std::memcpy(values, subMesh.vertices.data() + static_cast<size_t>(vertex) * subMesh.vertexSize + element.offset, count * sizeof(float));
+}
+
+
+// Decode values that fit a sub-mesh's positions and uvs into the 16-bit grids
+static VertexDecode FitDecode(const MeshSubMeshData& subMesh, const PackableElements& elements)
+{
+	VertexDecode decode;
+	if (subMesh.numVertices == 0)  return decode;
+
+	if (elements.position)
+	{
+		CVector3 minPosition, maxPosition;
+		for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+		{
+			CVector3 position;
+			ReadFloats(subMesh, v, *elements.position, &position.x, 3);
+			minPosition = (v == 0) ? position : CVector3{ std::min(minPosition.x, position.x), std::min(minPosition.y, position.y), std::min(minPosition.z, position.z) };
+			maxPosition = (v == 0) ? position : CVector3{ std::max(maxPosition.x, position.x), std::max(maxPosition.y, position.y), std::max(maxPosition.z, position.z) };
+		}
+		decode.positionOffset = minPosition;
+		decode.positionScale  = maxPosition - minPosition;
+	}
+
+	if (elements.uv)
+	{
+		CVector2 minUV, maxUV;
+		for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+		{
+			CVector2 uv;
+			ReadFloats(subMesh, v, *elements.uv, &uv.x, 2);
+			minUV = (v == 0) ? uv : CVector2{ std::min(minUV.x, uv.x), std::min(minUV.y, uv.y) };
+			maxUV = (v == 0) ? uv : CVector2{ std::max(maxUV.x, uv.x), std::max(maxUV.y, uv.y) };
+		}
+		decode.uvOffset = minUV;
+		decode.uvScale  = maxUV - minUV;
+	}
+	return decode;
+}
+
+
+// Length of the shortest triangle edge that isn't zero length, or infinity if there are none
+static float ShortestEdge(const MeshSubMeshData& subMesh, const VertexElement& position)
+{
+	float shortest = std::numeric_limits<float>::infinity();
+	for (size_t i = 0; i + 2 < subMesh.indices.size(); i += 3)
+	{
+		CVector3 corners[3];
+		for (int c = 0; c < 3; ++c)  ReadFloats(subMesh, subMesh.indices[i + c], position, &corners[c].x, 3);
+		for (int c = 0; c < 3; ++c)
+		{
+			float edge = Length(corners[(c + 1) % 3] - corners[c]);
+			if (edge > 0)  shortest = std::min(shortest, edge);
+		}
+	}
+	return shortest;
+}
+
+
+// Largest errors from packing each kind of value in a sub-mesh, and the position error allowed for it
+struct SubMeshPackErrors
+{
+	float position = 0, normal = 0, uv = 0, weight = 0;
+	float positionAllowed = 0;
+};
+
+static SubMeshPackErrors MeasurePackErrors(const MeshSubMeshData& subMesh, const PackableElements& elements, const VertexDecode& decode,
+                                           const VertexPackLimits& limits)
+{
+	SubMeshPackErrors errors;
+	for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+	{
+		if (elements.position)
+		{
+			CVector3 position;
+			ReadFloats(subMesh, v, *elements.position, &position.x, 3);
+			CVector3 unpacked;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float offset = (&decode.positionOffset.x)[axis], scale = (&decode.positionScale.x)[axis];
+				(&unpacked.x)[axis] = UnpackUnorm16(PackUnorm16((&position.x)[axis], offset, scale), offset, scale);
+			}
+			errors.position = std::max(errors.position, Length(unpacked - position));
+		}
+
+		for (auto element : { elements.normal, elements.tangent })
+		{
+			if (element == nullptr)  continue;
+			CVector3 normal;
+			ReadFloats(subMesh, v, *element, &normal.x, 3);
+			if (Length(normal) == 0)  continue; // Can't be encoded, but shaders can't use it either
+			int16_t packed[2];
+			PackOctahedral(normal, packed);
+			errors.normal = std::max(errors.normal, AngleBetween(Normalise(normal), UnpackOctahedral(packed)));
+		}
+
+		if (elements.uv)
+		{
+			CVector2 uv;
+			ReadFloats(subMesh, v, *elements.uv, &uv.x, 2);
+			float u = UnpackUnorm16(PackUnorm16(uv.x, decode.uvOffset.x, decode.uvScale.x), decode.uvOffset.x, decode.uvScale.x);
+			float w = UnpackUnorm16(PackUnorm16(uv.y, decode.uvOffset.y, decode.uvScale.y), decode.uvOffset.y, decode.uvScale.y);
+			errors.uv = std::max({ errors.uv, std::abs(u - uv.x), std::abs(w - uv.y) });
+		}
+
+		if (elements.weights)
+		{
+			float weights[4];
+			uint8_t packed[4];
+			ReadFloats(subMesh, v, *elements.weights, weights, 4);
+			PackWeights(weights, packed);
+			for (int i = 0; i < 4; ++i)  errors.weight = std::max(errors.weight, std::abs(packed[i] / 255.0f - weights[i]));
+		}
+	}
+
+	errors.positionAllowed = elements.position ? limits.positionError * ShortestEdge(subMesh, *elements.position) : 0;
+	return errors;
+}
+
+
+// Which kinds of value to pack in a mesh
+struct PackChoice
+{
+	bool positions, normals, uvs, weights;
+};
+
+// Rebuild a sub-mesh's vertices with the chosen kinds of value packed, using the given decode values
+static void PackSubMesh(MeshSubMeshData& subMesh, const PackChoice& choice, const VertexDecode& decode)
+{
+	PackableElements elements = FindPackableElements(subMesh);
+
+	// New layout, in the same order with the packed elements smaller
+	std::vector<VertexElement> layout = subMesh.layout;
+	unsigned int vertexSize = 0;
+	for (auto& element : layout)
+	{
+		const VertexElement* source = &subMesh.layout[&element - layout.data()];
+		if      (source == elements.position && choice.positions)  element.format = VertexFormat::UShort4Norm;
+		else if ((source == elements.normal || source == elements.tangent) && choice.normals)  element.format = VertexFormat::Short2Norm;
+		else if (source == elements.uv      && choice.uvs)      element.format = VertexFormat::UShort2Norm;
+		else if (source == elements.weights && choice.weights)  element.format = VertexFormat::UByte4Norm;
+		element.offset = vertexSize;
+		vertexSize += VertexFormatSize(element.format);
+	}
+
+	std::vector<unsigned char> vertices(static_cast<size_t>(subMesh.numVertices) * vertexSize);
+	for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+	{
+		for (size_t e = 0; e < layout.size(); ++e)
+		{
+			const VertexElement& source = subMesh.layout[e];
+			const VertexElement& target = layout[e];
+			unsigned char* out = vertices.data() + static_cast<size_t>(v) * vertexSize + target.offset;
+			if (target.format == source.format)
+			{
+				std::memcpy(out, subMesh.vertices.data() + static_cast<size_t>(v) * subMesh.vertexSize + source.offset, VertexFormatSize(source.format));
+			}
+			else if (target.format == VertexFormat::UShort4Norm)
+			{
+				float position[3];
+				ReadFloats(subMesh, v, source, position, 3);
+				uint16_t packed[4] = { PackUnorm16(position[0], decode.positionOffset.x, decode.positionScale.x),
+				                       PackUnorm16(position[1], decode.positionOffset.y, decode.positionScale.y),
+				                       PackUnorm16(position[2], decode.positionOffset.z, decode.positionScale.z), 0 };
+				std::memcpy(out, packed, sizeof(packed));
+			}
+			else if (target.format == VertexFormat::Short2Norm)
+			{
+				CVector3 normal;
+				ReadFloats(subMesh, v, source, &normal.x, 3);
+				int16_t packed[2] = { 0, 0 };
+				PackOctahedral(normal, packed);
+				std::memcpy(out, packed, sizeof(packed));
+			}
+			else if (target.format == VertexFormat::UShort2Norm)
+			{
+				float uv[2];
+				ReadFloats(subMesh, v, source, uv, 2);
+				uint16_t packed[2] = { PackUnorm16(uv[0], decode.uvOffset.x, decode.uvScale.x), PackUnorm16(uv[1], decode.uvOffset.y, decode.uvScale.y) };
+				std::memcpy(out, packed, sizeof(packed));
+			}
+			else if (target.format == VertexFormat::UByte4Norm)
+			{
+				float weights[4];
+				ReadFloats(subMesh, v, source, weights, 4);
+				PackWeights(weights, out);
+			}
+		}
+	}
+
+	subMesh.layout = layout;
+	subMesh.vertexSize = vertexSize;
+	subMesh.vertices = std::move(vertices);
+
+	// Keep the identity for values that weren't packed
+	subMesh.decode = VertexDecode();
+	if (choice.positions)
+	{
+		subMesh.decode.positionScale  = decode.positionScale;
+		subMesh.decode.positionOffset = decode.positionOffset;
+	}
+	if (choice.uvs)
+	{
+		subMesh.decode.uvScale  = decode.uvScale;
+		subMesh.decode.uvOffset = decode.uvOffset;
+	}
+	subMesh.decode.octahedral = choice.normals && (elements.normal || elements.tangent);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Meshes
+//--------------------------------------------------------------------------------------
+
+// Pack the vertices of mesh data into smaller formats where the error is within the limits, and set each sub-mesh's decode values
+VertexPackResult PackMeshData(MeshData& data, const VertexPackLimits& limits /*= VertexPackLimits()*/)
+{
+	VertexPackResult result;
+	for (auto& subMesh : data.subMeshes)
+	{
+		result.vertexBytesBefore += subMesh.vertices.size();
+		result.indexBytesBefore  += subMesh.indices.size() * sizeof(uint32_t);
+		result.indexBytesAfter   += subMesh.indices.size() * IndexSize(subMesh.numVertices);
+	}
+
+	// Each kind of value is packed if all sub-meshes are within the limits. Sub-meshes already packed are left alone
+	PackChoice choice = { true, true, true, true };
+	bool anyPackable = false;
+	std::vector<VertexDecode> decodes(data.subMeshes.size());
+	for (size_t i = 0; i < data.subMeshes.size(); ++i)
+	{
+		const MeshSubMeshData& subMesh = data.subMeshes[i];
+		PackableElements elements = FindPackableElements(subMesh);
+		decodes[i] = FitDecode(subMesh, elements);
+		SubMeshPackErrors errors = MeasurePackErrors(subMesh, elements, decodes[i], limits);
+		if (errors.position > errors.positionAllowed && elements.position)  choice.positions = false;
+		if (errors.normal > limits.normalError)  choice.normals = false;
+		if (errors.uv     > limits.uvError)      choice.uvs     = false;
+		if (errors.weight > limits.weightError)  choice.weights = false;
+		anyPackable = anyPackable || elements.position || elements.normal || elements.tangent || elements.uv || elements.weights;
+
+		result.positionError = std::max(result.positionError, errors.position);
+		result.normalError   = std::max(result.normalError,   errors.normal);
+		result.uvError       = std::max(result.uvError,       errors.uv);
+		result.weightError   = std::max(result.weightError,   errors.weight);
+	}
+
+	if (anyPackable)
+	{
+		for (size_t i = 0; i < data.subMeshes.size(); ++i)  PackSubMesh(data.subMeshes[i], choice, decodes[i]);
+	}
+
+	result.positions = choice.positions && anyPackable;
+	result.normals   = choice.normals   && anyPackable;
+	result.uvs       = choice.uvs       && anyPackable;
+	result.weights   = choice.weights   && anyPackable;
+	if (!result.positions)  result.positionError = 0;
+	if (!result.normals)    result.normalError   = 0;
+	if (!result.uvs)        result.uvError       = 0;
+	if (!result.weights)    result.weightError   = 0;
+
+	for (auto& subMesh : data.subMeshes)  result.vertexBytesAfter += subMesh.vertices.size();
+	return result;
+}
+
+
+// Turn packed mesh data back into floats and reset the decode values
+void UnpackMeshData(MeshData& data)
+{
+	for (auto& subMesh : data.subMeshes)
+	{
+		const VertexDecode& decode = subMesh.decode;
+		std::vector<VertexElement> layout = subMesh.layout;
+		unsigned int vertexSize = 0;
+		for (auto& element : layout)
+		{
+			if      (element.format == VertexFormat::UShort4Norm && element.semantic == "position")  element.format = VertexFormat::Float3;
+			else if (element.format == VertexFormat::Short2Norm  && decode.octahedral)               element.format = VertexFormat::Float3;
+			else if (element.format == VertexFormat::UShort2Norm && element.semantic == "uv")        element.format = VertexFormat::Float2;
+			else if (element.format == VertexFormat::UByte4Norm  && element.semantic == "weights")   element.format = VertexFormat::Float4;
+			element.offset = vertexSize;
+			vertexSize += VertexFormatSize(element.format);
+		}
+
+		std::vector<unsigned char> vertices(static_cast<size_t>(subMesh.numVertices) * vertexSize);
+		for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+		{
+			for (size_t e = 0; e < layout.size(); ++e)
+			{
+				const VertexElement& source = subMesh.layout[e];
+				const VertexElement& target = layout[e];
+				const unsigned char* in = subMesh.vertices.data() + static_cast<size_t>(v) * subMesh.vertexSize + source.offset;
+				unsigned char* out = vertices.data() + static_cast<size_t>(v) * vertexSize + target.offset;
+				if (target.format == source.format)
+				{
+					std::memcpy(out, in, VertexFormatSize(source.format));
+				}
+				else if (source.format == VertexFormat::UShort4Norm)
+				{
+					uint16_t packed[4];
+					std::memcpy(packed, in, sizeof(packed));
+					float position[3] = { UnpackUnorm16(packed[0], decode.positionOffset.x, decode.positionScale.x),
+					                      UnpackUnorm16(packed[1], decode.positionOffset.y, decode.positionScale.y),
+					                      UnpackUnorm16(packed[2], decode.positionOffset.z, decode.positionScale.z) };
+					std::memcpy(out, position, sizeof(position));
+				}
+				else if (source.format == VertexFormat::Short2Norm)
+				{
+					int16_t packed[2];
+					std::memcpy(packed, in, sizeof(packed));
+					CVector3 normal = UnpackOctahedral(packed);
+					std::memcpy(out, &normal.x, 3 * sizeof(float));
+				}
+				else if (source.format == VertexFormat::UShort2Norm)
+				{
+					uint16_t packed[2];
+					std::memcpy(packed, in, sizeof(packed));
+					float uv[2] = { UnpackUnorm16(packed[0], decode.uvOffset.x, decode.uvScale.x), UnpackUnorm16(packed[1], decode.uvOffset.y, decode.uvScale.y) };
+					std::memcpy(out, uv, sizeof(uv));
+				}
+				else if (source.format == VertexFormat::UByte4Norm)
+				{
+					float weights[4] = { in[0] / 255.0f, in[1] / 255.0f, in[2] / 255.0f, in[3] / 255.0f };
+					std::memcpy(out, weights, sizeof(weights));
+				}
+			}
+		}
+
+		subMesh.layout = layout;
+		subMesh.vertexSize = vertexSize;
+		subMesh.vertices = std::move(vertices);
+		subMesh.decode = VertexDecode();
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// A skinned mesh with tangents, laid out as Mesh.cpp imports it, with two sub-meshes. Each is a bumpy grid of the given number of
+// vertices (rounded down to a square) with random normals, tangents and weights
+static MeshData RandomPackingMesh(unsigned int vertices, std::mt19937& generator)
+{
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> fraction(0.0f, 1.0f);
+	unsigned int side = std::max(static_cast<unsigned int>(std::sqrt(static_cast<double>(vertices))), 2u);
+
+	MeshData data;
+	data.hasBones = true;
+	data.nodes.resize(1);
+	data.nodes[0].offsetMatrix = MatrixIdentity();
+	data.nodes[0].defaultMatrix = MatrixIdentity();
+	data.nodes[0].subMeshes = { 0, 1 };
+
+	data.subMeshes.resize(2);
+	for (size_t s = 0; s < data.subMeshes.size(); ++s)
+	{
+		MeshSubMeshData& subMesh = data.subMeshes[s];
+		subMesh.layout = { { "position", 0, VertexFormat::Float3,  0 }, { "normal", 0, VertexFormat::Float3, 12 },
+		                   { "tangent",  0, VertexFormat::Float3, 24 }, { "uv",     0, VertexFormat::Float2, 36 },
+		                   { "bones",    0, VertexFormat::UByte4, 44 }, { "weights",0, VertexFormat::Float4, 48 } };
+		subMesh.vertexSize = 64;
+		subMesh.numVertices = side * side;
+		subMesh.vertices.resize(static_cast<size_t>(subMesh.numVertices) * subMesh.vertexSize);
+
+		// Sub-meshes of different sizes and places
+		float spacing = (s == 0) ? 0.5f : 3.0f;
+		CVector3 origin = { -100.0f * s, 20.0f, 7.0f * s };
+		for (unsigned int z = 0; z < side; ++z)
+		{
+			for (unsigned int x = 0; x < side; ++x)
+			{
+				unsigned char* vertex = subMesh.vertices.data() + static_cast<size_t>(z * side + x) * subMesh.vertexSize;
+				CVector3 position = origin + CVector3{ x * spacing, unit(generator) * spacing * 0.25f, z * spacing };
+				CVector3 normal  = Normalise({ unit(generator), unit(generator), unit(generator) });
+				CVector3 tangent = Normalise({ unit(generator), unit(generator), unit(generator) });
+				CVector2 uv = { static_cast<float>(x) / (side - 1), static_cast<float>(z) / (side - 1) };
+				unsigned char bones[4];
+				float weights[4], total = 0;
+				for (int i = 0; i < 4; ++i)
+				{
+					bones[i] = static_cast<unsigned char>(generator() % 64);
+					weights[i] = fraction(generator);
+					total += weights[i];
+				}
+				for (auto& weight : weights)  weight /= total;
+
+				std::memcpy(vertex,      &position.x, 12);
+				std::memcpy(vertex + 12, &normal.x,   12);
+				std::memcpy(vertex + 24, &tangent.x,  12);
+				std::memcpy(vertex + 36, &uv.x,       8);
+				std::memcpy(vertex + 44, bones,       4);
+				std::memcpy(vertex + 48, weights,     16);
+			}
+		}
+
+		for (unsigned int z = 0; z + 1 < side; ++z)
+		{
+			for (unsigned int x = 0; x + 1 < side; ++x)
+			{
+				uint32_t corner = z * side + x;
+				subMesh.indices.insert(subMesh.indices.end(), { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 });
+			}
+		}
+	}
+	return data;
+}
+
+
+// Pack random skinned meshes with tangents, unpack them and check the errors against the bounds for the bits used
+VertexPackCheck CheckVertexPacking(unsigned int vertices)
+{
+	VertexPackCheck result;
+	std::mt19937 generator(1);
+	const MeshData original = RandomPackingMesh(vertices, generator);
+
+	MeshData packed = original;
+	VertexPackResult packing = PackMeshData(packed);
+	MeshData unpacked = packed;
+	UnpackMeshData(unpacked);
+
+	// Largest angle between a unit vector and the nearest point of the octahedral grid: half a diagonal step of the grid is
+	// sqrt(2) / 32767, which can stretch to about sqrt(2) times that on the sphere where the octahedron's faces meet
+	const float octahedralBound = 2.0f / 32767;
+
+	result.weightsSumToOne = packing.weights;
+	for (size_t s = 0; s < original.subMeshes.size(); ++s)
+	{
+		const MeshSubMeshData& before = original.subMeshes[s];
+		const MeshSubMeshData& after  = unpacked.subMeshes[s];
+		const MeshSubMeshData& packedSubMesh = packed.subMeshes[s];
+		const VertexDecode& decode = packedSubMesh.decode;
+		if (after.vertexSize != before.vertexSize)  return result;
+
+		for (unsigned int v = 0; v < before.numVertices; ++v)
+		{
+			float a[16], b[16];
+			std::memcpy(a, before.vertices.data() + static_cast<size_t>(v) * before.vertexSize, before.vertexSize);
+			std::memcpy(b, after.vertices.data()  + static_cast<size_t>(v) * after.vertexSize,  after.vertexSize);
+
+			// Half a grid step on each axis, plus rounding in the float maths
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float scale = (&decode.positionScale.x)[axis], offset = (&decode.positionOffset.x)[axis];
+				float bound = scale / 131070 + 4 * std::numeric_limits<float>::epsilon() * (std::abs(offset) + std::abs(scale));
+				result.positionError = std::max(result.positionError, std::abs(a[axis] - b[axis]) / bound);
+			}
+			for (int vector : { 3, 6 })
+			{
+				float angle = AngleBetween(CVector3(a + vector), CVector3(b + vector));
+				result.normalError = std::max(result.normalError, angle / octahedralBound);
+			}
+			for (int axis = 0; axis < 2; ++axis)
+			{
+				float scale = (&decode.uvScale.x)[axis], offset = (&decode.uvOffset.x)[axis];
+				float bound = scale / 131070 + 4 * std::numeric_limits<float>::epsilon() * (std::abs(offset) + std::abs(scale));
+				result.uvError = std::max(result.uvError, std::abs(a[9 + axis] - b[9 + axis]) / bound);
+			}
+			const unsigned char* packedWeights = packedSubMesh.vertices.data() + static_cast<size_t>(v) * packedSubMesh.vertexSize + packedSubMesh.layout[5].offset;
+			if (packedWeights[0] + packedWeights[1] + packedWeights[2] + packedWeights[3] != 255)  result.weightsSumToOne = false;
+			for (int i = 12; i < 16; ++i)  result.weightError = std::max(result.weightError, std::abs(a[i] - b[i]) * 255);
+		}
+	}
+
+	result.sizeRatio = packing.vertexBytesBefore > 0 ? static_cast<double>(packing.vertexBytesAfter) / packing.vertexBytesBefore : 0;
+
+	// Meshes that can't be packed within the limits: uvs tiled many times, and limits too tight for positions and normals. Each
+	// should leave just that kind of value as floats
+	MeshData tiled = original;
+	for (auto& subMesh : tiled.subMeshes)
+	{
+		for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+		{
+			float* uv = reinterpret_cast<float*>(subMesh.vertices.data() + static_cast<size_t>(v) * subMesh.vertexSize + 36);
+			uv[0] *= 100;
+			uv[1] *= 100;
+		}
+	}
+	VertexPackResult tiledPacking = PackMeshData(tiled);
+
+	VertexPackLimits tight;
+	tight.positionError = 1e-6f;
+	tight.normalError   = 1e-7f;
+	MeshData precise = original;
+	VertexPackResult precisePacking = PackMeshData(precise, tight);
+
+	result.limitsRespected = !tiledPacking.uvs && tiledPacking.positions && tiledPacking.normals && tiledPacking.weights &&
+	                         tiled.subMeshes[0].layout[3].format == VertexFormat::Float2 &&
+	                         !precisePacking.positions && !precisePacking.normals && precisePacking.uvs && precisePacking.weights &&
+	                         precise.subMeshes[0].layout[0].format == VertexFormat::Float3 && !precise.subMeshes[0].decode.octahedral;
+
+	result.passed = packing.positions && packing.normals && packing.uvs && packing.weights && result.weightsSumToOne &&
+	                result.limitsRespected && result.positionError <= 1 && result.normalError <= 1 && result.uvError <= 1 &&
+	                result.weightError <= 1 && result.sizeRatio <= 0.5;
+	return result;
+}
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// Vertex packing - smaller vertex formats for mesh data
+//--------------------------------------------------------------------------------------
+// Imported vertices hold floats: 32 bytes for a position, normal and uv, 52 with bones. Packing
+// stores each value in fewer bits, in formats the GPU turns back into floats as it reads them:
+//  - Positions as 16-bit fractions of the sub-mesh's bounding box
+//  - Normals and tangents as two 16-bit values using the octahedral encoding, which maps the
+//    unit sphere onto a square so no bits are spent on the length
+//  - Uvs as 16-bit fractions of the range of uvs in the sub-mesh
+//  - Bone weights as 8-bit fractions, rounded so the four still add up to exactly 1
+// That is 16 bytes per vertex, 24 with bones. The vertex shaders decode positions, uvs and
+// normals with the sub-mesh's VertexDecode (see MeshData.h), which Mesh passes in the per-model
+// constants. Indices are made 16-bit on the GPU when they fit, see IndexSize in MeshData.h.
+//
+// Each kind of value is packed in a mesh only if the error it adds is within the limits given
+// for every sub-mesh, otherwise all of the mesh keeps the floats for it.
+//
+// Plain C++ with no DirectX or assimp
+
+#ifndef _VERTEX_PACKING_H_INCLUDED_
+#define _VERTEX_PACKING_H_INCLUDED_
+
+#include "MeshData.h"
+
+
+//--------------------------------------------------------------------------------------
+// Packing
+//--------------------------------------------------------------------------------------
+
+// Largest errors packing is allowed to add. Positions are compared to the size of the mesh's smallest details, the others
+// are fixed amounts
+struct VertexPackLimits
+{
+	float positionError = 0.01f;          // Distance moved, as a fraction of the shortest edge (of non-zero length) in the sub-mesh
+	float normalError   = 0.001f;         // Angle in radians, for normals and tangents
+	float uvError       = 1.0f / 32768;   // A 16th of a texel on a 2048 texture
+	float weightError   = 1.0f / 255;     // Difference in any bone weight
+};
+
+// What PackMeshData packed, and the largest errors found in the values it packed
+struct VertexPackResult
+{
+	bool positions = false;
+	bool normals   = false; // Normals and tangents
+	bool uvs       = false;
+	bool weights   = false;
+
+	float positionError = 0; // Distance, in the mesh's units
+	float normalError   = 0; // Radians
+	float uvError       = 0;
+	float weightError   = 0;
+
+	size_t vertexBytesBefore = 0; // All sub-meshes
+	size_t vertexBytesAfter  = 0;
+	size_t indexBytesBefore  = 0; // With 32-bit indices
+	size_t indexBytesAfter   = 0; // With indices the size given by IndexSize
+};
+
+// Pack the vertices of mesh data into smaller formats where the error is within the limits, and set each sub-mesh's decode
+// values. Finds vertex elements by semantic name ("position", "normal", "tangent", "uv" and "weights") in float formats,
+// other elements are left as they are
+VertexPackResult PackMeshData(MeshData& data, const VertexPackLimits& limits = VertexPackLimits());
+
+// Turn packed mesh data back into floats, as the vertex shaders do (without the rounding of the GPU's maths), and reset the
+// decode values. Data that isn't packed is unchanged
+void UnpackMeshData(MeshData& data);
+
+
+// Octahedral encoding of a unit vector into two values from -1 to 1, and back again
+CVector2 EncodeOctahedral(const CVector3& v);
+CVector3 DecodeOctahedral(const CVector2& e);
+
+
+//--------------------------------------------------------------------------------------
+// Check
+//--------------------------------------------------------------------------------------
+
+// Results of CheckVertexPacking
+struct VertexPackCheck
+{
+	// Largest errors after packing and unpacking random meshes, as fractions of the largest error expected from the number of
+	// bits used, so all should be at most 1
+	float positionError = 0; // Against half a step of the 16-bit grid over the sub-mesh's box, on each axis
+	float normalError   = 0; // Against the angle of one step of the 16-bit octahedral grid
+	float uvError       = 0; // Against half a step of the 16-bit grid over the sub-mesh's uv range, on each axis
+	float weightError   = 0; // Against one 8-bit step
+
+	double sizeRatio = 0; // Bytes of packed vertices over those of the floats
+
+	bool weightsSumToOne = false; // True if the packed bone weights of every vertex added up to exactly 255
+	bool limitsRespected = false; // True if meshes whose uvs, positions or normals can't be packed within the limits were left as floats
+	bool passed          = false; // True if all of the above, all errors were at most 1, and the size was at most half
+};
+
+// Pack random skinned meshes with tangents, each sub-mesh with the given number of vertices, unpack them and check the errors
+// against the bounds for the bits used
+VertexPackCheck CheckVertexPacking(unsigned int vertices);
+
+
+#endif // _VERTEX_PACKING_H_INCLUDED_